@@ -3,6 +3,7 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <algorithm>
 
 #include <components/nif/niffile.hpp>
 #include <components/files/constrainedfilestream.hpp>
@@ -13,10 +14,49 @@
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 
+#include <osg/Timer>
+
 // Create local aliases for brevity
 namespace bpo = boost::program_options;
 namespace bfs = boost::filesystem;
 
+///Statistics gathered in benchmark mode
+struct BenchmarkStats
+{
+    bool mEnabled;
+    size_t mFiles;
+    size_t mBytes;
+    double mParseTime;
+    size_t mRecordAllocations;
+    size_t mRecordBytes;
+    size_t mPeakRecordBytes;
+
+    BenchmarkStats() : mEnabled(false), mFiles(0), mBytes(0), mParseTime(0.0)
+      , mRecordAllocations(0), mRecordBytes(0), mPeakRecordBytes(0) {}
+};
+
+BenchmarkStats benchmarkStats;
+
+bool memoryMapped = false;
+
+///Parse a nif file from a stream or a VFS::File, recording statistics in benchmark mode
+template <class Source>
+void readNIF(Source source, const std::string& name)
+{
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    Nif::NIFFile nif(source, name);
+    osg::Timer_t end = osg::Timer::instance()->tick();
+
+    benchmarkStats.mFiles++;
+    benchmarkStats.mBytes += nif.getFileSize();
+    benchmarkStats.mParseTime += osg::Timer::instance()->delta_s(start, end);
+
+    const Nif::RecordArena& arena = nif.getRecordArena();
+    benchmarkStats.mRecordAllocations += arena.getNumAllocations();
+    benchmarkStats.mRecordBytes += arena.getBytesUsed();
+    benchmarkStats.mPeakRecordBytes = std::max(benchmarkStats.mPeakRecordBytes, arena.getBytesReserved());
+}
+
 ///See if the file has the named extension
 bool hasExtension(std::string filename, std::string  extensionToFind)
 {
@@ -61,14 +101,14 @@ void readVFS(VFS::Archive* anArchive,std::string archivePath = "")
             if(isNIF(name))
             {
             //           std::cout << "Decoding: " << name << std::endl;
-                Nif::NIFFile temp_nif(myManager.get(name),archivePath+name);
+                readNIF(it->second,archivePath+name);
             }
             else if(isBSA(name))
             {
                 if(!archivePath.empty() && !isBSA(archivePath))
                 {
 //                     std::cout << "Reading BSA File: " << name << std::endl;
-                    readVFS(new VFS::BsaArchive(archivePath+name),archivePath+name+"/");
+                    readVFS(new VFS::BsaArchive(archivePath+name, memoryMapped),archivePath+name+"/");
 //                     std::cout << "Done with BSA File: " << name << std::endl;
                 }
             }
@@ -89,6 +129,8 @@ std::vector<std::string> parseOptions (int argc, char** argv)
         "Allowed options");
     desc.add_options()
         ("help,h", "print help message.")
+        ("benchmark,b", "report the time spent parsing nif files.")
+        ("memory-mapped,m", "map BSA files into memory and parse the nif files in place.")
         ("input-file", bpo::value< std::vector<std::string> >(), "input file")
         ;
 
@@ -116,6 +158,8 @@ std::vector<std::string> parseOptions (int argc, char** argv)
         std::cout << desc << std::endl;
         exit(1);
     }
+    benchmarkStats.mEnabled = variables.count("benchmark") != 0;
+    memoryMapped = variables.count("memory-mapped") != 0;
     if (variables.count("input-file"))
     {
         return variables["input-file"].as< std::vector<std::string> >();
@@ -139,12 +183,12 @@ int main(int argc, char **argv)
             if(isNIF(name))
             {
                 //std::cout << "Decoding: " << name << std::endl;
-                Nif::NIFFile temp_nif(Files::openConstrainedFileStream(name.c_str()),name);
+                readNIF(Files::openConstrainedFileStream(name.c_str()),name);
              }
              else if(isBSA(name))
              {
 //                 std::cout << "Reading BSA File: " << name << std::endl;
-                readVFS(new VFS::BsaArchive(name));
+                readVFS(new VFS::BsaArchive(name, memoryMapped));
              }
              else if(bfs::is_directory(bfs::path(name)))
              {
@@ -161,5 +205,18 @@ int main(int argc, char **argv)
             std::cerr << "ERROR, an exception has occurred:  " << e.what() << std::endl;
         }
      }
+
+     if (benchmarkStats.mEnabled)
+     {
+         double megabytes = benchmarkStats.mBytes / (1024.0 * 1024.0);
+         std::cout << "Parsed " << benchmarkStats.mFiles << " nif files (" << megabytes << " MB) in "
+                   << benchmarkStats.mParseTime << " s";
+         if (benchmarkStats.mParseTime > 0)
+             std::cout << ", " << megabytes / benchmarkStats.mParseTime << " MB/s";
+         std::cout << std::endl;
+         std::cout << "Record allocations: " << benchmarkStats.mRecordAllocations
+                   << " (" << benchmarkStats.mRecordBytes << " bytes), peak per file: "
+                   << benchmarkStats.mPeakRecordBytes << " bytes" << std::endl;
+     }
      return 0;
 }
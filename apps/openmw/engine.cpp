@@ -21,6 +21,7 @@
 
 #include <components/resource/resourcesystem.hpp>
 #include <components/resource/texturemanager.hpp>
+#include <components/resource/scenemanager.hpp>
 
 #include <components/compiler/extensions0.hpp>
 
@@ -171,8 +172,17 @@ void OMW::Engine::frame(float frametime)
             mEnvironment.getWindowManager()->update();
         }
 
+        // drop unused resources
+        mResourceSystem->updateCache(mViewer->getFrameStamp()->getReferenceTime());
+
         int frameNumber = mViewer->getFrameStamp()->getFrameNumber();
         osg::Stats* stats = mViewer->getViewerStats();
+        mResourceSystem->reportStats(frameNumber, stats);
+        if (mEnvironment.getStateManager()->getState()!=
+            MWBase::StateManager::State_NoGame)
+        {
+            mEnvironment.getWorld()->reportStats(frameNumber, stats);
+        }
         stats->setAttribute(frameNumber, "script_time_begin", osg::Timer::instance()->delta_s(mStartTick, beforeScriptTick));
         stats->setAttribute(frameNumber, "script_time_taken", osg::Timer::instance()->delta_s(beforeScriptTick, afterScriptTick));
         stats->setAttribute(frameNumber, "script_time_end", osg::Timer::instance()->delta_s(mStartTick, afterScriptTick));
@@ -447,7 +457,8 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
 
     mVFS.reset(new VFS::Manager(mFSStrict));
 
-    VFS::registerArchives(mVFS.get(), mFileCollections, mArchives, true);
+    VFS::registerArchives(mVFS.get(), mFileCollections, mArchives, true,
+                          Settings::Manager::getBool("memory mapped archives", "General"));
 
     mResourceSystem.reset(new Resource::ResourceSystem(mVFS.get()));
     mResourceSystem->getTextureManager()->setUnRefImageDataAfterApply(true);
@@ -458,6 +469,12 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     int maxAnisotropy = Settings::Manager::getInt("anisotropy", "General");
     mResourceSystem->getTextureManager()->setFilterSettings(min, mag, maxAnisotropy);
 
+    mResourceSystem->setExpiryDelay(Settings::Manager::getFloat("cache expiry delay", "Cells"));
+    mResourceSystem->getSceneManager()->setMaxCacheSize(
+                static_cast<size_t>(Settings::Manager::getInt("scene cache max size", "Cells")) * 1024 * 1024);
+    mResourceSystem->getTextureManager()->setMaxCacheSize(
+                static_cast<size_t>(Settings::Manager::getInt("texture cache max size", "Cells")) * 1024 * 1024);
+
     // Create input and UI first to set up a bootstrapping environment for
     // showing a loading screen and keeping the window responsive while doing so
 
@@ -509,7 +526,7 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     // Create the world
     mEnvironment.setWorld( new MWWorld::World (mViewer, rootNode, mResourceSystem.get(),
         mFileCollections, mContentFiles, mEncoder, mFallbackMap,
-        mActivationDistanceOverride, mCellName, mStartupScript, mResDir.string()));
+        mActivationDistanceOverride, mCellName, mStartupScript, mResDir.string(), mCfgMgr.getCachePath().string()));
     mEnvironment.getWorld()->setupPlayer();
     input->setPlayer(&mEnvironment.getWorld()->getPlayer());
 
@@ -627,6 +644,10 @@ void OMW::Engine::go()
                                    "mechanics_time_taken", 1000.0, true, false, "mechanics_time_begin", "mechanics_time_end", 10000);
     statshandler->addUserStatsLine("Physics", osg::Vec4f(1.f, 1.f, 1.f, 1.f), osg::Vec4f(1.f, 1.f, 1.f, 1.f),
                                    "physics_time_taken", 1000.0, true, false, "physics_time_begin", "physics_time_end", 10000);
+    statshandler->addUserStatsLine("Movement", osg::Vec4f(1.f, 1.f, 1.f, 1.f), osg::Vec4f(1.f, 1.f, 1.f, 1.f),
+                                   "physics_movement_time_taken", 1000.0, true, false, "", "", 10000);
+    statshandler->addUserStatsLine("Actors solved", osg::Vec4f(1.f, 1.f, 1.f, 1.f), osg::Vec4f(1.f, 1.f, 1.f, 1.f),
+                                   "physics_actors_solved", 1.0, false, false, "", "", 10000);
 
     mViewer->addEventHandler(statshandler);
 
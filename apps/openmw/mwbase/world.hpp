@@ -16,6 +16,7 @@ namespace osg
     class Vec3f;
     class Quat;
     class Image;
+    class Stats;
 }
 
 namespace Loading
@@ -346,6 +347,9 @@ namespace MWBase
 
             virtual void update (float duration, bool paused) = 0;
 
+            /// Report the physics costs of the last frame to the viewer stats.
+            virtual void reportStats (unsigned int frameNumber, osg::Stats* stats) = 0;
+
             virtual MWWorld::Ptr placeObject (const MWWorld::Ptr& object, float cursorX, float cursorY, int amount) = 0;
             ///< copy and place an object into the gameworld at the specified cursor position
             /// @param object
@@ -13,6 +13,8 @@
 
 #include "../mwscript/compilercontext.hpp"
 
+#include "infoindex.hpp"
+
 namespace ESM
 {
     struct Dialogue;
@@ -25,6 +27,8 @@ namespace MWDialogue
             std::map<std::string, ESM::Dialogue> mDialogueMap;
             std::set<std::string> mKnownTopics;// Those are the topics the player knows.
 
+            InfoIndex mInfoIndex;
+
             // Modified faction reactions. <Faction1, <Faction2, Difference> >
             typedef std::map<std::string, std::map<std::string, int> > ModFactionReactionMap;
             ModFactionReactionMap mChangedFactionReaction;
@@ -5,6 +5,8 @@
 
 #include "../mwworld/ptr.hpp"
 
+#include "infoindex.hpp"
+
 namespace ESM
 {
     struct DialInfo;
@@ -20,6 +22,11 @@ namespace MWDialogue
             MWWorld::Ptr mActor;
             int mChoice;
             bool mTalkedToPlayer;
+            InfoIndex* mIndex;
+            InfoIndex::Speaker mSpeaker;
+
+            void getCandidates (const ESM::Dialogue& dialogue, std::vector<const ESM::DialInfo*>& candidates) const;
+            ///< Get the infos of \a dialogue that need to be tested, all of them if there is no index.
 
             bool testActor (const ESM::DialInfo& info) const;
             ///< Is this the right actor for this \a info?
@@ -51,7 +58,8 @@ namespace MWDialogue
 
         public:
 
-            Filter (const MWWorld::Ptr& actor, int choice, bool talkedToPlayer);
+            Filter (const MWWorld::Ptr& actor, int choice, bool talkedToPlayer, InfoIndex* index = NULL);
+            ///< \param index If given, only the infos that pass the static conditions of the index are tested.
 
             std::vector<const ESM::DialInfo *> list (const ESM::Dialogue& dialogue,
                 bool fallbackToInfoRefusal, bool searchAll, bool invertDisposition=false) const;
@@ -0,0 +1,102 @@
+#include "infoindex.hpp"
+
+#include <components/esm/loaddial.hpp>
+#include <components/misc/stringops.hpp>
+
+namespace MWDialogue
+{
+    InfoIndex::Speaker::Speaker()
+        : mIsCreature (false)
+        , mIsFemale (false)
+    {
+    }
+
+    bool InfoIndex::Entry::test (const Speaker& speaker) const
+    {
+        if (speaker.mIsCreature)
+        {
+            if (mNeedsNpc)
+                return false;
+        }
+        else
+        {
+            if (!mRace.empty() && mRace!=speaker.mRace)
+                return false;
+
+            if (!mClass.empty() && mClass!=speaker.mClass)
+                return false;
+
+            if (!mFaction.empty() && mFaction!=speaker.mFaction)
+                return false;
+
+            if (mGender==(speaker.mIsFemale ? ESM::DialInfo::Male : ESM::DialInfo::Female))
+                return false;
+        }
+
+        // supports partial matches, just like getPcCell
+        if (!mCell.empty() && speaker.mPlayerCell.compare (0, mCell.size(), mCell)!=0)
+            return false;
+
+        return true;
+    }
+
+    void InfoIndex::getCandidates (const ESM::Dialogue& dialogue, const Speaker& speaker,
+        std::vector<const ESM::DialInfo*>& candidates)
+    {
+        const DialogueIndex& index = getIndex (dialogue);
+
+        static const std::vector<Entry> sNoInfos;
+        std::map<std::string, std::vector<Entry> >::const_iterator found = index.mActorInfos.find (speaker.mId);
+        const std::vector<Entry>& actorInfos = found!=index.mActorInfos.end() ? found->second : sNoInfos;
+
+        // Creatures must not have topics aside of those specific to their id
+        const std::vector<Entry>& otherInfos = speaker.mIsCreature ? sNoInfos : index.mOtherInfos;
+
+        // Merge both buckets in the order of the dialogue
+        std::vector<Entry>::const_iterator actorIt = actorInfos.begin();
+        std::vector<Entry>::const_iterator otherIt = otherInfos.begin();
+        while (actorIt!=actorInfos.end() || otherIt!=otherInfos.end())
+        {
+            const Entry* entry;
+            if (otherIt==otherInfos.end() || (actorIt!=actorInfos.end() && actorIt->mOrder<otherIt->mOrder))
+                entry = &*actorIt++;
+            else
+                entry = &*otherIt++;
+
+            if (entry->test (speaker))
+                candidates.push_back (entry->mInfo);
+        }
+    }
+
+    const InfoIndex::DialogueIndex& InfoIndex::getIndex (const ESM::Dialogue& dialogue)
+    {
+        std::map<const ESM::Dialogue*, DialogueIndex>::iterator found = mDialogues.find (&dialogue);
+        if (found!=mDialogues.end())
+            return found->second;
+
+        DialogueIndex& index = mDialogues[&dialogue];
+
+        unsigned int order = 0;
+        for (ESM::Dialogue::InfoContainer::const_iterator iter = dialogue.mInfo.begin();
+            iter!=dialogue.mInfo.end(); ++iter, ++order)
+        {
+            Entry entry;
+            entry.mInfo = &*iter;
+            entry.mOrder = order;
+            entry.mRace = Misc::StringUtils::lowerCase (iter->mRace);
+            entry.mClass = Misc::StringUtils::lowerCase (iter->mClass);
+            entry.mFaction = Misc::StringUtils::lowerCase (iter->mFaction);
+            entry.mCell = Misc::StringUtils::lowerCase (iter->mCell);
+            entry.mGender = iter->mData.mGender;
+            entry.mNeedsNpc = !iter->mRace.empty() || !iter->mClass.empty() || !iter->mFaction.empty()
+                || iter->mData.mRank!=-1;
+
+            if (iter->mActor.empty())
+                index.mOtherInfos.push_back (entry);
+            else
+                index.mActorInfos[Misc::StringUtils::lowerCase (iter->mActor)].push_back (entry);
+        }
+
+        return index;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef GAME_MWDIALOGUE_INFOINDEX_H
+#define GAME_MWDIALOGUE_INFOINDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ESM
+{
+    struct DialInfo;
+    struct Dialogue;
+}
+
+namespace MWDialogue
+{
+    /// \brief Index of the infos of the dialogues by their static conditions
+    ///
+    /// The infos of a dialogue are bucketed by the actor id they require. Within a bucket, the speaker, race, class,
+    /// faction, gender and cell conditions are kept in lowercase next to each other, so the infos that can not apply
+    /// to a speaker are skipped without testing their select structs. A dialogue is indexed the first time it is used.
+    /// \note The dialogues must not be changed or destroyed while they are indexed.
+    class InfoIndex
+    {
+        public:
+
+            /// The static properties of the speaker and the player's cell, all in lowercase
+            struct Speaker
+            {
+                std::string mId;
+                std::string mRace;
+                std::string mClass;
+                std::string mFaction;
+                std::string mPlayerCell;
+                bool mIsCreature;
+                bool mIsFemale;
+
+                Speaker();
+            };
+
+            /// Add the infos of \a dialogue that pass the static conditions for \a speaker to \a candidates,
+            /// in the order of the dialogue. The conditions that depend on the game state are not tested.
+            void getCandidates (const ESM::Dialogue& dialogue, const Speaker& speaker,
+                std::vector<const ESM::DialInfo*>& candidates);
+
+        private:
+
+            struct Entry
+            {
+                const ESM::DialInfo* mInfo;
+                // Position in the dialogue, to merge the buckets
+                unsigned int mOrder;
+
+                std::string mRace;
+                std::string mClass;
+                std::string mFaction;
+                std::string mCell;
+                int mGender;
+                bool mNeedsNpc;
+
+                bool test (const Speaker& speaker) const;
+            };
+
+            struct DialogueIndex
+            {
+                // Infos for a specific actor id
+                std::map<std::string, std::vector<Entry> > mActorInfos;
+                // Infos for any actor
+                std::vector<Entry> mOtherInfos;
+            };
+
+            const DialogueIndex& getIndex (const ESM::Dialogue& dialogue);
+
+            std::map<const ESM::Dialogue*, DialogueIndex> mDialogues;
+    };
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "activespells.hpp"
 
+#include <algorithm>
+
 #include <components/misc/rng.hpp>
 
 #include <components/misc/stringops.hpp>
@@ -17,6 +19,9 @@ namespace MWMechanics
     {
         bool rebuild = false;
 
+        // Only the effects that expired need to be summed up again
+        std::vector<EffectKey> expired;
+
         MWWorld::TimeStamp now = MWBase::Environment::get().getWorld()->getTimeStamp();
 
         // Erase no longer active spells and effects
@@ -27,8 +32,11 @@ namespace MWMechanics
             {
                 if (!timeToExpire (iter))
                 {
+                    const std::vector<ActiveEffect>& effects = iter->second.mEffects;
+                    for (std::vector<ActiveEffect>::const_iterator effectIt = effects.begin(); effectIt != effects.end(); ++effectIt)
+                        expired.push_back(EffectKey(effectIt->mEffectId, effectIt->mArg));
+
                     mSpells.erase (iter++);
-                    rebuild = true;
                 }
                 else
                 {
@@ -39,8 +47,8 @@ namespace MWMechanics
                         MWWorld::TimeStamp end = start + static_cast<double>(effectIt->mDuration)*MWBase::Environment::get().getWorld()->getTimeScaleFactor()/(60*60);
                         if (end <= now)
                         {
+                            expired.push_back(EffectKey(effectIt->mEffectId, effectIt->mArg));
                             effectIt = effects.erase(effectIt);
-                            rebuild = true;
                         }
                         else
                             ++effectIt;
@@ -60,30 +68,50 @@ namespace MWMechanics
 
         if (rebuild)
             rebuildEffects();
+        else if (!expired.empty())
+            rebuildEffects(expired);
     }
 
     void ActiveSpells::rebuildEffects() const
     {
-        MWWorld::TimeStamp now = MWBase::Environment::get().getWorld()->getTimeStamp();
-
         mEffects = MagicEffects();
 
         for (TIterator iter (begin()); iter!=end(); ++iter)
-        {
-            const MWWorld::TimeStamp& start = iter->second.mTimeStamp;
+            addEffects(iter->second, NULL);
+    }
 
-            const std::vector<ActiveEffect>& effects = iter->second.mEffects;
+    void ActiveSpells::rebuildEffects(std::vector<EffectKey>& keys) const
+    {
+        std::sort(keys.begin(), keys.end());
 
-            for (std::vector<ActiveEffect>::const_iterator effectIt = effects.begin(); effectIt != effects.end(); ++effectIt)
-            {
-                double duration = effectIt->mDuration;
-                MWWorld::TimeStamp end = start;
-                end += duration * 
-                    MWBase::Environment::get().getWorld()->getTimeScaleFactor()/(60*60);
+        for (std::vector<EffectKey>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+            mEffects.remove(*it);
 
-                if (end>now)
-                    mEffects.add(MWMechanics::EffectKey(effectIt->mEffectId, effectIt->mArg), MWMechanics::EffectParam(effectIt->mMagnitude));
-            }
+        for (TIterator iter (begin()); iter!=end(); ++iter)
+            addEffects(iter->second, &keys);
+    }
+
+    void ActiveSpells::addEffects(const ActiveSpellParams& params, const std::vector<EffectKey>* keys) const
+    {
+        MWWorld::TimeStamp now = MWBase::Environment::get().getWorld()->getTimeStamp();
+
+        const MWWorld::TimeStamp& start = params.mTimeStamp;
+
+        const std::vector<ActiveEffect>& effects = params.mEffects;
+
+        for (std::vector<ActiveEffect>::const_iterator effectIt = effects.begin(); effectIt != effects.end(); ++effectIt)
+        {
+            EffectKey key (effectIt->mEffectId, effectIt->mArg);
+            if (keys && !std::binary_search(keys->begin(), keys->end(), key))
+                continue;
+
+            double duration = effectIt->mDuration;
+            MWWorld::TimeStamp end = start;
+            end += duration *
+                MWBase::Environment::get().getWorld()->getTimeScaleFactor()/(60*60);
+
+            if (end>now)
+                mEffects.add(key, MWMechanics::EffectParam(effectIt->mMagnitude));
         }
     }
 
@@ -165,6 +193,10 @@ namespace MWMechanics
         if (it == end() || stack)
         {
             mSpells.insert(std::make_pair(id, params));
+
+            // The new effects are simply added to the totals, unless they are rebuilt anyway
+            if (!mSpellsChanged)
+                addEffects(params, NULL);
         }
         else
         {
@@ -174,9 +206,8 @@ namespace MWMechanics
             // spell effects and add to existing effects of spell
             mergeEffects(params.mEffects, it->second.mEffects);
             it->second = params;
+            mSpellsChanged = true;
         }
-
-        mSpellsChanged = true;
     }
 
     void ActiveSpells::mergeEffects(std::vector<ActiveEffect>& addTo, const std::vector<ActiveEffect>& from)
@@ -55,6 +55,13 @@ namespace MWMechanics
             
             void rebuildEffects() const;
 
+            /// Sum up the effects with the given \a keys again, e.g. after some of them expired. The other effects are kept.
+            void rebuildEffects(std::vector<EffectKey>& keys) const;
+
+            /// Add the effects of \a params that have not expired yet to mEffects.
+            /// \param keys If not NULL, only add the effects with these keys. Must be sorted.
+            void addEffects(const ActiveSpellParams& params, const std::vector<EffectKey>* keys) const;
+
             /// Add any effects that are in "from" and not in "addTo" to "addTo"
             void mergeEffects(std::vector<ActiveEffect>& addTo, const std::vector<ActiveEffect>& from);
 
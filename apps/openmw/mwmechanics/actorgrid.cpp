@@ -0,0 +1,162 @@
+#include "actorgrid.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+    typedef std::pair<float, MWWorld::Ptr> DistanceAndPtr;
+
+    bool isCloser(const DistanceAndPtr& left, const DistanceAndPtr& right)
+    {
+        return left.first < right.first;
+    }
+}
+
+namespace MWMechanics
+{
+    ActorGrid::ActorGrid(float cellSize)
+        : mCellSize(cellSize)
+    {
+    }
+
+    ActorGrid::CellIndex ActorGrid::getCellIndex(const osg::Vec3f& position) const
+    {
+        return CellIndex(static_cast<int>(std::floor(position.x() / mCellSize)),
+                         static_cast<int>(std::floor(position.y() / mCellSize)));
+    }
+
+    void ActorGrid::insert(const MWWorld::Ptr& ptr, const osg::Vec3f& position)
+    {
+        remove(ptr);
+
+        CellIndex index = getCellIndex(position);
+        addToCell(ptr, position, index);
+        mActorCells[ptr] = index;
+    }
+
+    void ActorGrid::remove(const MWWorld::Ptr& ptr)
+    {
+        std::map<MWWorld::Ptr, CellIndex>::iterator found = mActorCells.find(ptr);
+        if (found == mActorCells.end())
+            return;
+
+        removeFromCell(ptr, found->second);
+        mActorCells.erase(found);
+    }
+
+    std::vector<ActorGrid::Entry>::iterator ActorGrid::findEntry(const MWWorld::Ptr& ptr, const CellIndex& index, CellMap::iterator& cell)
+    {
+        cell = mCells.find(index);
+        std::vector<Entry>& entries = cell->second;
+        for (std::vector<Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            if (it->mPtr == ptr)
+                return it;
+        }
+        return entries.end();
+    }
+
+    void ActorGrid::removeFromCell(const MWWorld::Ptr& ptr, const CellIndex& index)
+    {
+        CellMap::iterator cell;
+        std::vector<Entry>::iterator entry = findEntry(ptr, index, cell);
+        if (entry != cell->second.end())
+            cell->second.erase(entry);
+        if (cell->second.empty())
+            mCells.erase(cell);
+    }
+
+    void ActorGrid::addToCell(const MWWorld::Ptr& ptr, const osg::Vec3f& position, const CellIndex& index)
+    {
+        Entry entry;
+        entry.mPtr = ptr;
+        entry.mPosition = position;
+        mCells[index].push_back(entry);
+    }
+
+    void ActorGrid::update(const MWWorld::Ptr& ptr, const osg::Vec3f& position)
+    {
+        std::map<MWWorld::Ptr, CellIndex>::iterator found = mActorCells.find(ptr);
+        if (found == mActorCells.end())
+            return;
+
+        CellIndex index = getCellIndex(position);
+        if (index == found->second)
+        {
+            CellMap::iterator cell;
+            findEntry(ptr, index, cell)->mPosition = position;
+            return;
+        }
+
+        removeFromCell(ptr, found->second);
+        addToCell(ptr, position, index);
+        found->second = index;
+    }
+
+    void ActorGrid::updatePtr(const MWWorld::Ptr& old, const MWWorld::Ptr& ptr)
+    {
+        std::map<MWWorld::Ptr, CellIndex>::iterator found = mActorCells.find(old);
+        if (found == mActorCells.end())
+            return;
+
+        CellIndex index = found->second;
+        CellMap::iterator cell;
+        findEntry(old, index, cell)->mPtr = ptr;
+
+        mActorCells.erase(found);
+        mActorCells[ptr] = index;
+    }
+
+    void ActorGrid::clear()
+    {
+        mCells.clear();
+        mActorCells.clear();
+    }
+
+    void ActorGrid::getEntriesInRange(const osg::Vec3f& position, float radius, std::vector<const Entry*>& out) const
+    {
+        const float sqrRadius = radius * radius;
+
+        CellIndex min = getCellIndex(position - osg::Vec3f(radius, radius, 0));
+        CellIndex max = getCellIndex(position + osg::Vec3f(radius, radius, 0));
+
+        // The cells are sorted by x, then y, so each column of the range is a single run of the map
+        for (int x = min.first; x <= max.first; ++x)
+        {
+            CellMap::const_iterator it = mCells.lower_bound(CellIndex(x, min.second));
+            for (; it != mCells.end() && it->first.first == x && it->first.second <= max.second; ++it)
+            {
+                const std::vector<Entry>& entries = it->second;
+                for (std::vector<Entry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+                {
+                    if ((entry->mPosition - position).length2() <= sqrRadius)
+                        out.push_back(&*entry);
+                }
+            }
+        }
+    }
+
+    void ActorGrid::getActorsInRange(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out) const
+    {
+        std::vector<const Entry*> entries;
+        getEntriesInRange(position, radius, entries);
+        for (std::vector<const Entry*>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+            out.push_back((*it)->mPtr);
+    }
+
+    void ActorGrid::getNearestActors(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out) const
+    {
+        std::vector<const Entry*> entries;
+        getEntriesInRange(position, radius, entries);
+
+        std::vector<DistanceAndPtr> sorted;
+        sorted.reserve(entries.size());
+        for (std::vector<const Entry*>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+            sorted.push_back(DistanceAndPtr(((*it)->mPosition - position).length2(), (*it)->mPtr));
+        std::stable_sort(sorted.begin(), sorted.end(), isCloser);
+
+        for (std::vector<DistanceAndPtr>::const_iterator it = sorted.begin(); it != sorted.end(); ++it)
+            out.push_back(it->second);
+    }
+}
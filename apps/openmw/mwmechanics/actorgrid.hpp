@@ -0,0 +1,73 @@
+#ifndef GAME_MWMECHANICS_ACTORGRID_H
+#define GAME_MWMECHANICS_ACTORGRID_H
+
+#include <map>
+#include <vector>
+
+#include <osg/Vec3f>
+
+#include "../mwworld/ptr.hpp"
+
+namespace MWMechanics
+{
+    /// @brief Uniform grid over the positions of the active actors, to find the actors near a position
+    /// without checking all of them.
+    /// @note The grid keeps the position an actor had when it was inserted or updated, so it must be told when an actor moves.
+    class ActorGrid
+    {
+        public:
+
+            /// @param cellSize Width of a grid cell in game units.
+            ActorGrid(float cellSize);
+
+            void insert(const MWWorld::Ptr& ptr, const osg::Vec3f& position);
+
+            void remove(const MWWorld::Ptr& ptr);
+            ///< \note Ignored, if \a ptr is not in the grid.
+
+            void update(const MWWorld::Ptr& ptr, const osg::Vec3f& position);
+            ///< Move an actor to the grid cell of its new position.
+            ///
+            /// \note Ignored, if \a ptr is not in the grid.
+
+            void updatePtr(const MWWorld::Ptr& old, const MWWorld::Ptr& ptr);
+            ///< Replace the Ptr of an actor, e.g. after it moved to a different cell. Keeps its position.
+
+            void clear();
+
+            void getActorsInRange(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out) const;
+            ///< Append the actors within \a radius of \a position to \a out.
+
+            void getNearestActors(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out) const;
+            ///< Append the actors within \a radius of \a position to \a out, nearest first.
+
+        private:
+
+            struct Entry
+            {
+                MWWorld::Ptr mPtr;
+                osg::Vec3f mPosition;
+            };
+
+            typedef std::pair<int, int> CellIndex;
+            typedef std::map<CellIndex, std::vector<Entry> > CellMap;
+
+            CellIndex getCellIndex(const osg::Vec3f& position) const;
+
+            /// @return The entries of the grid cell, and the entry of \a ptr in them.
+            std::vector<Entry>::iterator findEntry(const MWWorld::Ptr& ptr, const CellIndex& index, CellMap::iterator& cell);
+
+            void getEntriesInRange(const osg::Vec3f& position, float radius, std::vector<const Entry*>& out) const;
+
+            void removeFromCell(const MWWorld::Ptr& ptr, const CellIndex& index);
+
+            void addToCell(const MWWorld::Ptr& ptr, const osg::Vec3f& position, const CellIndex& index);
+
+            float mCellSize;
+
+            CellMap mCells;
+            std::map<MWWorld::Ptr, CellIndex> mActorCells;
+    };
+}
+
+#endif
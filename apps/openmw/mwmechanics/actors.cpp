@@ -38,6 +38,19 @@
 namespace
 {
 
+float getMaxHeadTrackDistance(const MWWorld::Ptr& actor)
+{
+    static const float fMaxHeadTrackDistance = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
+            .find("fMaxHeadTrackDistance")->getFloat();
+    static const float fInteriorHeadTrackMult = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
+            .find("fInteriorHeadTrackMult")->getFloat();
+    float maxDistance = fMaxHeadTrackDistance;
+    const ESM::Cell* currentCell = actor.getCell()->getCell();
+    if (!currentCell->isExterior() && !(currentCell->mData.mFlags & ESM::Cell::QuasiEx))
+        maxDistance *= fInteriorHeadTrackMult;
+    return maxDistance;
+}
+
 bool isConscious(const MWWorld::Ptr& ptr)
 {
     const MWMechanics::CreatureStats& stats = ptr.getClass().getCreatureStats(ptr);
@@ -233,14 +246,7 @@ namespace MWMechanics
     void Actors::updateHeadTracking(const MWWorld::Ptr& actor, const MWWorld::Ptr& targetActor,
                                     MWWorld::Ptr& headTrackTarget, float& sqrHeadTrackDistance)
     {
-        static const float fMaxHeadTrackDistance = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
-                .find("fMaxHeadTrackDistance")->getFloat();
-        static const float fInteriorHeadTrackMult = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
-                .find("fInteriorHeadTrackMult")->getFloat();
-        float maxDistance = fMaxHeadTrackDistance;
-        const ESM::Cell* currentCell = actor.getCell()->getCell();
-        if (!currentCell->isExterior() && !(currentCell->mData.mFlags & ESM::Cell::QuasiEx))
-            maxDistance *= fInteriorHeadTrackMult;
+        float maxDistance = getMaxHeadTrackDistance(actor);
 
         const ESM::Position& actor1Pos = actor.getRefData().getPosition();
         const ESM::Position& actor2Pos = targetActor.getRefData().getPosition();
@@ -487,7 +493,7 @@ namespace MWMechanics
 
         // tickable effects (i.e. effects having a lasting impact after expiry)
         // these effects can be applied as "instant" (handled in spellcasting.cpp) or with a duration, handled here
-        for (MagicEffects::Collection::const_iterator it = effects.begin(); it != effects.end(); ++it)
+        for (MagicEffects::const_iterator it = effects.begin(); it != effects.end(); ++it)
         {
             effectTick(creatureStats, ptr, it->first, it->second.getMagnitude() * duration);
         }
@@ -879,7 +885,10 @@ namespace MWMechanics
         }
     }
 
-    Actors::Actors() {}
+    Actors::Actors()
+        : mActorGrid(2048.f)
+    {
+    }
 
     Actors::~Actors()
     {
@@ -894,6 +903,7 @@ namespace MWMechanics
         if (!anim)
             return;
         mActors.insert(std::make_pair(ptr, new Actor(ptr, anim)));
+        mActorGrid.insert(ptr, ptr.getRefData().getPosition().asVec3());
         if (updateImmediately)
             mActors[ptr]->getCharacterController()->update(0);
     }
@@ -905,6 +915,7 @@ namespace MWMechanics
         {
             delete iter->second;
             mActors.erase(iter);
+            mActorGrid.remove(ptr);
         }
     }
 
@@ -918,9 +929,15 @@ namespace MWMechanics
 
             actor->updatePtr(ptr);
             mActors.insert(std::make_pair(ptr, actor));
+            mActorGrid.updatePtr(old, ptr);
         }
     }
 
+    void Actors::updatePosition(const MWWorld::Ptr& ptr)
+    {
+        mActorGrid.update(ptr, ptr.getRefData().getPosition().asVec3());
+    }
+
     void Actors::dropActors (const MWWorld::CellStore *cellStore, const MWWorld::Ptr& ignore)
     {
         PtrActorMap::iterator iter = mActors.begin();
@@ -929,6 +946,7 @@ namespace MWMechanics
             if(iter->first.getCell()==cellStore && iter->first != ignore)
             {
                 delete iter->second;
+                mActorGrid.remove(iter->first);
                 mActors.erase(iter++);
             }
             else
@@ -955,7 +973,14 @@ namespace MWMechanics
             // (it only does some throttling for targets beyond the "AI distance", so doesn't give any guarantees as to whether AI will be enabled or not)
             // This distance could be made configurable later, but the setting must be marked with a big warning:
             // using higher values will make a quest in Bloodmoon harder or impossible to complete (bug #1876)
-            const float sqrProcessingDistance = 7168*7168;
+            const float processingDistance = 7168;
+            const float sqrProcessingDistance = processingDistance*processingDistance;
+
+            // Positions may have been changed without notifying us, e.g. when loading a game
+            for(PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
+                mActorGrid.update(iter->first, iter->first.getRefData().getPosition().asVec3());
+
+            std::vector<MWWorld::Ptr> neighbours;
 
             /// \todo move update logic to Actor class where appropriate
 
@@ -980,11 +1005,18 @@ namespace MWMechanics
                             if (iter->first != player)
                                 adjustCommandedActor(iter->first);
 
-                            for(PtrActorMap::iterator it(mActors.begin()); it != mActors.end(); ++it)
+                            // player is not AI-controlled
+                            if (iter->first != player)
                             {
-                                if (it->first == iter->first || iter->first == player) // player is not AI-controlled
-                                    continue;
-                                engageCombat(iter->first, it->first, it->first == player);
+                                // engageCombat ignores actors beyond the processing distance
+                                neighbours.clear();
+                                mActorGrid.getActorsInRange(iter->first.getRefData().getPosition().asVec3(), processingDistance, neighbours);
+                                for (std::vector<MWWorld::Ptr>::const_iterator it = neighbours.begin(); it != neighbours.end(); ++it)
+                                {
+                                    if (*it == iter->first)
+                                        continue;
+                                    engageCombat(iter->first, *it, *it == player);
+                                }
                             }
                         }
                         if (timerUpdateHeadTrack == 0)
@@ -992,11 +1024,15 @@ namespace MWMechanics
                             float sqrHeadTrackDistance = std::numeric_limits<float>::max();
                             MWWorld::Ptr headTrackTarget;
 
-                            for(PtrActorMap::iterator it(mActors.begin()); it != mActors.end(); ++it)
+                            // Nearest first, so the LOS and awareness checks can stop at the first actor that passes them
+                            neighbours.clear();
+                            mActorGrid.getNearestActors(iter->first.getRefData().getPosition().asVec3(),
+                                                        getMaxHeadTrackDistance(iter->first), neighbours);
+                            for (std::vector<MWWorld::Ptr>::const_iterator it = neighbours.begin(); it != neighbours.end() && headTrackTarget.isEmpty(); ++it)
                             {
-                                if (it->first == iter->first)
+                                if (*it == iter->first)
                                     continue;
-                                updateHeadTracking(iter->first, it->first, headTrackTarget, sqrHeadTrackDistance);
+                                updateHeadTracking(iter->first, *it, headTrackTarget, sqrHeadTrackDistance);
                             }
                             iter->second->getCharacterController()->setHeadTrackTarget(headTrackTarget);
                         }
@@ -1113,16 +1149,17 @@ namespace MWMechanics
 
                     bool detected = false;
 
-                    for (PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
+                    neighbours.clear();
+                    mActorGrid.getActorsInRange(player.getRefData().getPosition().asVec3(), static_cast<float>(radius), neighbours);
+                    for (std::vector<MWWorld::Ptr>::const_iterator iter(neighbours.begin()); iter != neighbours.end(); ++iter)
                     {
-                        if (iter->first == player)  // not the player
+                        if (*iter == player)  // not the player
                             continue;
 
-                        // is the player in range and can they be detected
-                        if ((iter->first.getRefData().getPosition().asVec3() - player.getRefData().getPosition().asVec3()).length2() <= radius*radius
-                            && MWBase::Environment::get().getWorld()->getLOS(player, iter->first))
+                        // can the player be detected
+                        if (MWBase::Environment::get().getWorld()->getLOS(player, *iter))
                         {
-                            if (MWBase::Environment::get().getMechanicsManager()->awarenessCheck(player, iter->first))
+                            if (MWBase::Environment::get().getMechanicsManager()->awarenessCheck(player, *iter))
                             {
                                 detected = true;
                                 avoidedNotice = false;
@@ -1283,11 +1320,12 @@ namespace MWMechanics
 
     void Actors::getObjectsInRange(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out)
     {
-        for (PtrActorMap::iterator iter = mActors.begin(); iter != mActors.end(); ++iter)
-        {
-            if ((iter->first.getRefData().getPosition().asVec3() - position).length2() <= radius*radius)
-                out.push_back(iter->first);
-        }
+        mActorGrid.getActorsInRange(position, radius, out);
+    }
+
+    void Actors::getNearestActors(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out)
+    {
+        mActorGrid.getNearestActors(position, radius, out);
     }
 
     std::list<MWWorld::Ptr> Actors::getActorsFollowing(const MWWorld::Ptr& actor)
@@ -1401,6 +1439,7 @@ namespace MWMechanics
             it->second = NULL;
         }
         mActors.clear();
+        mActorGrid.clear();
         mDeathCount.clear();
     }
 
@@ -8,6 +8,7 @@
 #include <list>
 
 #include "movement.hpp"
+#include "actorgrid.hpp"
 #include "../mwbase/world.hpp"
 
 namespace MWWorld
@@ -70,6 +71,11 @@ namespace MWMechanics
             void updateActor(const MWWorld::Ptr &old, const MWWorld::Ptr& ptr);
             ///< Updates an actor with a new Ptr
 
+            void updatePosition(const MWWorld::Ptr& ptr);
+            ///< Must be called when an actor has moved, to keep the range queries accurate.
+            ///
+            /// \note Ignored, if \a ptr is not a registered actor.
+
             void dropActors (const MWWorld::CellStore *cellStore, const MWWorld::Ptr& ignore);
             ///< Deregister all actors (except for \a ignore) in the given cell.
 
@@ -111,6 +117,9 @@ namespace MWMechanics
 
             void getObjectsInRange(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out);
 
+            void getNearestActors(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out);
+            ///< Like getObjectsInRange, but sorted by distance, nearest first.
+
             ///Returns the list of actors which are following the given actor
             /**ie AiFollow is active and the target is the actor **/
             std::list<MWWorld::Ptr> getActorsFollowing(const MWWorld::Ptr& actor);
@@ -133,6 +142,9 @@ namespace MWMechanics
     private:
         PtrActorMap mActors;
 
+        // The positions of the actors in mActors
+        ActorGrid mActorGrid;
+
     };
 }
 
@@ -1,6 +1,7 @@
 #include "magiceffects.hpp"
 
 #include <cstdlib>
+#include <algorithm>
 
 #include <stdexcept>
 
@@ -86,40 +87,126 @@ namespace MWMechanics
         return *this;
     }
 
-    void MagicEffects::remove(const EffectKey &key)
+    MagicEffects::const_iterator::const_iterator (const MagicEffects* effects, int id, Collection::const_iterator argIt)
+        : mEffects (effects), mId (id), mArgIt (argIt), mInTable (false)
     {
-        mCollection.erase(key);
+        seek();
     }
 
-    void MagicEffects::add (const EffectKey& key, const EffectParam& param)
+    MagicEffects::const_iterator& MagicEffects::const_iterator::operator++ ()
+    {
+        if (mInTable)
+            ++mId;
+        else
+            ++mArgIt;
+        seek();
+        return *this;
+    }
+
+    MagicEffects::const_iterator MagicEffects::const_iterator::operator++ (int)
     {
-        Collection::iterator iter = mCollection.find (key);
+        const_iterator iter (*this);
+        ++*this;
+        return iter;
+    }
 
-        if (iter==mCollection.end())
+    bool MagicEffects::const_iterator::operator== (const const_iterator& other) const
+    {
+        return mId==other.mId && mArgIt==other.mArgIt;
+    }
+
+    bool MagicEffects::const_iterator::operator!= (const const_iterator& other) const
+    {
+        return !(*this==other);
+    }
+
+    void MagicEffects::const_iterator::seek()
+    {
+        while (mId<ESM::MagicEffect::Length && !mEffects->mPresent[mId])
+            ++mId;
+
+        if (mId<ESM::MagicEffect::Length
+            && (mArgIt==mEffects->mArgEffects.end() || EffectKey (mId) < mArgIt->first))
         {
-            mCollection.insert (std::make_pair (key, param));
+            mInTable = true;
+            mValue = std::make_pair (EffectKey (mId), mEffects->mEffects[mId]);
         }
-        else
+        else if (mArgIt!=mEffects->mArgEffects.end())
+        {
+            mInTable = false;
+            mValue = *mArgIt;
+        }
+    }
+
+    MagicEffects::MagicEffects()
+    {
+        std::fill (mPresent, mPresent+ESM::MagicEffect::Length, false);
+    }
+
+    MagicEffects::const_iterator MagicEffects::begin() const
+    {
+        return const_iterator (this, 0, mArgEffects.begin());
+    }
+
+    MagicEffects::const_iterator MagicEffects::end() const
+    {
+        return const_iterator (this, ESM::MagicEffect::Length, mArgEffects.end());
+    }
+
+    bool MagicEffects::isIndexed (const EffectKey& key)
+    {
+        return key.mArg==-1 && key.mId>=0 && key.mId<ESM::MagicEffect::Length;
+    }
+
+    EffectParam& MagicEffects::getOrAdd (const EffectKey& key)
+    {
+        if (!isIndexed (key))
+            return mArgEffects[key];
+
+        mPresent[key.mId] = true;
+        return mEffects[key.mId];
+    }
+
+    void MagicEffects::remove(const EffectKey &key)
+    {
+        if (isIndexed (key))
         {
-            iter->second += param;
+            mPresent[key.mId] = false;
+            mEffects[key.mId] = EffectParam();
         }
+        else
+            mArgEffects.erase(key);
+    }
+
+    void MagicEffects::add (const EffectKey& key, const EffectParam& param)
+    {
+        getOrAdd (key) += param;
     }
 
     void MagicEffects::modifyBase(const EffectKey &key, int diff)
     {
-        mCollection[key].modifyBase(diff);
+        getOrAdd (key).modifyBase(diff);
     }
 
     void MagicEffects::setModifiers(const MagicEffects &effects)
     {
-        for (Collection::iterator it = mCollection.begin(); it != mCollection.end(); ++it)
+        for (int i=0; i<ESM::MagicEffect::Length; ++i)
+        {
+            if (mPresent[i] || effects.mPresent[i])
+            {
+                mPresent[i] = true;
+                mEffects[i].setModifier(effects.mEffects[i].getModifier());
+            }
+        }
+
+        for (Collection::iterator it = mArgEffects.begin(); it != mArgEffects.end(); ++it)
         {
             it->second.setModifier(effects.get(it->first).getModifier());
         }
 
-        for (Collection::const_iterator it = effects.begin(); it != effects.end(); ++it)
+        for (Collection::const_iterator it = effects.mArgEffects.begin(); it != effects.mArgEffects.end(); ++it)
         {
-            mCollection[it->first].setModifier(it->second.getModifier());
+            mArgEffects[it->first].setModifier(it->second.getModifier());
         }
     }
 
@@ -132,14 +219,23 @@ namespace MWMechanics
             return *this;
         }
 
-        for (Collection::const_iterator iter (effects.begin()); iter!=effects.end(); ++iter)
+        for (int i=0; i<ESM::MagicEffect::Length; ++i)
+        {
+            if (effects.mPresent[i])
+            {
+                mPresent[i] = true;
+                mEffects[i] += effects.mEffects[i];
+            }
+        }
+
+        for (Collection::const_iterator iter (effects.mArgEffects.begin()); iter!=effects.mArgEffects.end(); ++iter)
         {
-            Collection::iterator result = mCollection.find (iter->first);
+            Collection::iterator result = mArgEffects.find (iter->first);
 
-            if (result!=mCollection.end())
+            if (result!=mArgEffects.end())
                 result->second += iter->second;
             else
-                mCollection.insert (*iter);
+                mArgEffects.insert (*iter);
         }
 
         return *this;
@@ -147,9 +243,12 @@ namespace MWMechanics
 
     EffectParam MagicEffects::get (const EffectKey& key) const
     {
-        Collection::const_iterator iter = mCollection.find (key);
+        if (isIndexed (key))
+            return mEffects[key.mId];
+
+        Collection::const_iterator iter = mArgEffects.find (key);
 
-        if (iter==mCollection.end())
+        if (iter==mArgEffects.end())
         {
             return EffectParam();
         }
@@ -163,12 +262,19 @@ namespace MWMechanics
     {
         MagicEffects result;
 
+        // Effects that are not present are zero in the table, so adding, changing and removing are the same
+        for (int i=0; i<ESM::MagicEffect::Length; ++i)
+        {
+            if (now.mPresent[i] || prev.mPresent[i])
+                result.add (EffectKey (i), now.mEffects[i] - prev.mEffects[i]);
+        }
+
         // adding/changing
-        for (Collection::const_iterator iter (now.begin()); iter!=now.end(); ++iter)
+        for (Collection::const_iterator iter (now.mArgEffects.begin()); iter!=now.mArgEffects.end(); ++iter)
         {
-            Collection::const_iterator other = prev.mCollection.find (iter->first);
+            Collection::const_iterator other = prev.mArgEffects.find (iter->first);
 
-            if (other==prev.end())
+            if (other==prev.mArgEffects.end())
             {
                 // adding
                 result.add (iter->first, iter->second);
@@ -181,10 +287,10 @@ namespace MWMechanics
         }
 
         // removing
-        for (Collection::const_iterator iter (prev.begin()); iter!=prev.end(); ++iter)
+        for (Collection::const_iterator iter (prev.mArgEffects.begin()); iter!=prev.mArgEffects.end(); ++iter)
         {
-            Collection::const_iterator other = now.mCollection.find (iter->first);
-            if (other==now.end())
+            Collection::const_iterator other = now.mArgEffects.find (iter->first);
+            if (other==now.mArgEffects.end())
             {
                 result.add (iter->first, EffectParam() - iter->second);
             }
@@ -196,7 +302,7 @@ namespace MWMechanics
     void MagicEffects::writeState(ESM::MagicEffects &state) const
     {
         // Don't need to save Modifiers, they are recalculated every frame anyway.
-        for (Collection::const_iterator iter (begin()); iter!=end(); ++iter)
+        for (const_iterator iter (begin()); iter!=end(); ++iter)
         {
             if (iter->second.getBase() != 0)
             {
@@ -210,7 +316,7 @@ namespace MWMechanics
     {
         for (std::map<int, int>::const_iterator it = state.mEffects.begin(); it != state.mEffects.end(); ++it)
         {
-            mCollection[EffectKey(it->first)].setBase(it->second);
+            getOrAdd(EffectKey(it->first)).setBase(it->second);
         }
     }
 }
@@ -4,6 +4,8 @@
 #include <map>
 #include <string>
 
+#include <components/esm/loadmgef.hpp>
+
 namespace ESM
 {
     struct ENAMstruct;
@@ -80,21 +82,67 @@ namespace MWMechanics
     };
 
     /// \brief Effects currently affecting a NPC or creature
+    /// \par Effects without an argument are kept in a table indexed by the effect id, so looking them up does not need
+    /// a search. Effects with a skill or attribute argument are kept in a small map on the side.
     class MagicEffects
     {
         public:
 
             typedef std::map<EffectKey, EffectParam> Collection;
 
+            /// Iterates the effects in the order of their keys, like the iterator of a std::map<EffectKey, EffectParam>.
+            class const_iterator
+            {
+                public:
+
+                    typedef std::pair<EffectKey, EffectParam> value_type;
+
+                    const_iterator (const MagicEffects* effects, int id, Collection::const_iterator argIt);
+
+                    const value_type& operator* () const { return mValue; }
+                    const value_type* operator-> () const { return &mValue; }
+
+                    const_iterator& operator++ ();
+                    const_iterator operator++ (int);
+
+                    bool operator== (const const_iterator& other) const;
+                    bool operator!= (const const_iterator& other) const;
+
+                private:
+
+                    /// Skip to the next effect in the table, and pick the smaller key of the table and the map.
+                    void seek();
+
+                    const MagicEffects* mEffects;
+                    int mId;
+                    Collection::const_iterator mArgIt;
+                    bool mInTable;
+                    value_type mValue;
+            };
+
         private:
 
-            Collection mCollection;
+            friend class const_iterator;
+
+            /// Is \a key stored in the table, rather than in mArgEffects?
+            static bool isIndexed (const EffectKey& key);
+
+            /// Get the effect for \a key, adding it if it is not present.
+            EffectParam& getOrAdd (const EffectKey& key);
+
+            // Effects that are not present are kept at EffectParam()
+            EffectParam mEffects[ESM::MagicEffect::Length];
+            bool mPresent[ESM::MagicEffect::Length];
+
+            Collection mArgEffects;
 
         public:
 
-            Collection::const_iterator begin() const { return mCollection.begin(); }
+            MagicEffects();
+
+            const_iterator begin() const;
 
-            Collection::const_iterator end() const { return mCollection.end(); }
+            const_iterator end() const;
 
             void readState (const ESM::MagicEffects& state);
             void writeState (ESM::MagicEffects& state) const;
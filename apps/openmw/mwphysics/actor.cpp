@@ -43,6 +43,8 @@ Actor::Actor(const MWWorld::Ptr& ptr, osg::ref_ptr<Resource::BulletShapeInstance
     mCollisionObject->setCollisionShape(mShape.get());
     mCollisionObject->setUserPointer(static_cast<PtrHolder*>(this));
 
+    resetSimulationPosition(ptr.getRefData().getPosition().asVec3());
+
     updateRotation();
     updateScale();
     // already called by updateScale()
@@ -84,8 +86,11 @@ void Actor::updateCollisionMask()
 
 void Actor::updatePosition()
 {
-    osg::Vec3f position = mPtr.getRefData().getPosition().asVec3();
+    setPosition(mPtr.getRefData().getPosition().asVec3());
+}
 
+void Actor::setPosition(const osg::Vec3f& position)
+{
     btTransform tr = mCollisionObject->getWorldTransform();
     osg::Vec3f scaledTranslation = mRotation * osg::componentMultiply(mMeshTranslation, mScale);
     osg::Vec3f newPosition = scaledTranslation + position;
@@ -155,6 +160,25 @@ void Actor::setWalkingOnWater(bool walkingOnWater)
     mWalkingOnWater = walkingOnWater;
 }
 
+void Actor::resetSimulationPosition(const osg::Vec3f &position)
+{
+    mPreviousPosition = position;
+    mSimulationPosition = position;
+    mRenderPosition = position;
+}
+
+void Actor::setSimulationPosition(const osg::Vec3f &position)
+{
+    mPreviousPosition = mSimulationPosition;
+    mSimulationPosition = position;
+}
+
+osg::Vec3f Actor::interpolatePosition(float alpha)
+{
+    mRenderPosition = mPreviousPosition * (1.f - alpha) + mSimulationPosition * alpha;
+    return mRenderPosition;
+}
+
 void Actor::setCanWaterWalk(bool waterWalk)
 {
     if (waterWalk != mCanWaterWalk)
@@ -65,6 +65,10 @@ namespace MWPhysics
         void updateRotation();
         void updatePosition();
 
+        /// Moves the collision body to where it would be with the actor's feet at \a position, e.g. a simulation step.
+        /// updatePosition() moves it back to the position of the reference.
+        void setPosition(const osg::Vec3f& position);
+
         /**
          * Returns the half extents of the collision body (scaled according to collision scale)
          */
@@ -115,6 +119,27 @@ namespace MWPhysics
         void setWalkingOnWater(bool walkingOnWater);
         bool isWalkingOnWater() const;
 
+        /// Moves the simulation to the given position without interpolating, e.g. when the actor was teleported.
+        void resetSimulationPosition(const osg::Vec3f& position);
+
+        /// Stores the result of a simulation step. The position of the previous step is kept for interpolation.
+        void setSimulationPosition(const osg::Vec3f& position);
+
+        const osg::Vec3f& getSimulationPosition() const
+        {
+            return mSimulationPosition;
+        }
+
+        /// Interpolates between the previous and the last simulation step, and stores the result as the rendered position.
+        /// @param alpha The fraction of a step that has passed since the last step.
+        osg::Vec3f interpolatePosition(float alpha);
+
+        /// The position last returned by interpolatePosition.
+        const osg::Vec3f& getRenderPosition() const
+        {
+            return mRenderPosition;
+        }
+
     private:
         /// Removes then re-adds the collision object to the dynamics world
         void updateCollisionMask();
@@ -134,6 +159,11 @@ namespace MWPhysics
         osg::Vec3f mRenderingScale;
         osg::Vec3f mPosition;
 
+        // Positions of the actor's feet, like the reference position
+        osg::Vec3f mPreviousPosition;
+        osg::Vec3f mSimulationPosition;
+        osg::Vec3f mRenderPosition;
+
         osg::Vec3f mForce;
         bool mOnGround;
         bool mInternalCollisionMode;
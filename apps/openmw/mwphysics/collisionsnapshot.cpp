@@ -0,0 +1,131 @@
+#include "collisionsnapshot.hpp"
+
+#include <vector>
+
+#include <BulletCollision/CollisionDispatch/btCollisionObject.h>
+#include <BulletCollision/CollisionDispatch/btCollisionWorld.h>
+#include <BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+
+#include "convert.hpp"
+
+namespace MWPhysics
+{
+
+CollisionSnapshot::CollisionSnapshot()
+    : mCollisionConfiguration(new btDefaultCollisionConfiguration)
+    , mDispatcher(new btCollisionDispatcher(mCollisionConfiguration.get()))
+    , mBroadphase(new btDbvtBroadphase)
+    , mCollisionWorld(new btCollisionWorld(mDispatcher.get(), mBroadphase.get(), mCollisionConfiguration.get()))
+    , mUpdateCount(0)
+{
+    // Like the original world, the bounds are only updated for the copies that moved
+    mCollisionWorld->setForceUpdateAllAabbs(false);
+}
+
+CollisionSnapshot::~CollisionSnapshot()
+{
+    for (CopyMap::iterator it = mCopies.begin(); it != mCopies.end(); ++it)
+    {
+        mCollisionWorld->removeCollisionObject(it->second.mObject);
+        delete it->second.mObject;
+    }
+}
+
+void CollisionSnapshot::update(const btCollisionWorld *world)
+{
+    ++mUpdateCount;
+
+    const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+    for (int i=0; i<objects.size(); ++i)
+    {
+        const btCollisionObject* original = objects[i];
+        CopyMap::iterator found = mCopies.find(original);
+        if (found == mCopies.end())
+        {
+            Copy copy;
+            copy.mObject = new btCollisionObject;
+            found = mCopies.insert(std::make_pair(original, copy)).first;
+        }
+
+        found->second.mUpdateCount = mUpdateCount;
+        updateCopy(original, found->second);
+    }
+
+    // Objects removed from the original world. The address of one may have been reused for a new object,
+    // that was updated above.
+    std::vector<const btCollisionObject*> removed;
+    for (CopyMap::iterator it = mCopies.begin(); it != mCopies.end(); ++it)
+    {
+        if (it->second.mUpdateCount != mUpdateCount)
+        {
+            mCollisionWorld->removeCollisionObject(it->second.mObject);
+            delete it->second.mObject;
+            removed.push_back(it->first);
+        }
+    }
+    for (std::vector<const btCollisionObject*>::const_iterator it = removed.begin(); it != removed.end(); ++it)
+        mCopies.erase(*it);
+}
+
+void CollisionSnapshot::updateObject(const btCollisionObject *object)
+{
+    CopyMap::iterator found = mCopies.find(object);
+    if (found != mCopies.end())
+        updateCopy(object, found->second);
+}
+
+void CollisionSnapshot::updateCopy(const btCollisionObject *original, Copy &copy)
+{
+    btCollisionObject* object = copy.mObject;
+    const btBroadphaseProxy* originalHandle = original->getBroadphaseHandle();
+
+    // Not in the world yet, or added again with a different group or mask, e.g. an actor that can walk on water now
+    const btBroadphaseProxy* handle = object->getBroadphaseHandle();
+    bool readd = !handle || handle->m_collisionFilterGroup != originalHandle->m_collisionFilterGroup
+            || handle->m_collisionFilterMask != originalHandle->m_collisionFilterMask;
+
+    osg::Vec3f aabbMin = toOsg(originalHandle->m_aabbMin);
+    osg::Vec3f aabbMax = toOsg(originalHandle->m_aabbMax);
+
+    if (!readd && object->getCollisionShape() == original->getCollisionShape()
+            && object->getWorldTransform() == original->getWorldTransform()
+            && copy.mAabbMin == aabbMin && copy.mAabbMax == aabbMax)
+    {
+        object->setUserPointer(original->getUserPointer());
+        return;
+    }
+
+    copy.mAabbMin = aabbMin;
+    copy.mAabbMax = aabbMax;
+
+    // The shape is only read by the queries, never changed
+    object->setCollisionShape(const_cast<btCollisionShape*>(original->getCollisionShape()));
+    object->setWorldTransform(original->getWorldTransform());
+    object->setUserPointer(original->getUserPointer());
+    object->setCollisionFlags(original->getCollisionFlags());
+
+    if (readd)
+    {
+        if (handle)
+            mCollisionWorld->removeCollisionObject(object);
+        mCollisionWorld->addCollisionObject(object, originalHandle->m_collisionFilterGroup, originalHandle->m_collisionFilterMask);
+    }
+    else
+        mCollisionWorld->updateSingleAabb(object);
+}
+
+btCollisionObject* CollisionSnapshot::getCopy(const btCollisionObject *object) const
+{
+    CopyMap::const_iterator found = mCopies.find(object);
+    if (found == mCopies.end())
+        return NULL;
+    return found->second.mObject;
+}
+
+btCollisionWorld* CollisionSnapshot::getCollisionWorld()
+{
+    return mCollisionWorld.get();
+}
+
+}
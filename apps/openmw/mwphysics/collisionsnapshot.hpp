@@ -0,0 +1,69 @@
+#ifndef OPENMW_MWPHYSICS_COLLISIONSNAPSHOT_H
+#define OPENMW_MWPHYSICS_COLLISIONSNAPSHOT_H
+
+#include <map>
+#include <memory>
+
+#include <osg/Vec3f>
+
+class btCollisionWorld;
+class btCollisionObject;
+class btCollisionShape;
+class btBroadphaseInterface;
+class btDefaultCollisionConfiguration;
+class btCollisionDispatcher;
+
+namespace MWPhysics
+{
+
+    /// @brief A copy of a collision world, to run queries on another thread while the original is queried as well.
+    /// The collision objects are copied, their shapes are shared with the original world.
+    /// @note The shapes must not change while the copy is queried, and a query only sees the state of the original
+    /// world from the last update.
+    class CollisionSnapshot
+    {
+    public:
+        CollisionSnapshot();
+        ~CollisionSnapshot();
+
+        /// Add, move and remove the copies, so they match all objects of \a world.
+        void update(const btCollisionWorld* world);
+
+        /// Move the copy of a single object of the original world, e.g. an actor that moved since the last update().
+        /// @note Ignored if \a object was not in the world at the last update().
+        void updateObject(const btCollisionObject* object);
+
+        /// @return The copy of \a object, or NULL if it was not in the world at the last update().
+        btCollisionObject* getCopy(const btCollisionObject* object) const;
+
+        btCollisionWorld* getCollisionWorld();
+
+    private:
+        struct Copy
+        {
+            btCollisionObject* mObject;
+            // The broadphase bounds of the original at the last update, which change with its shape
+            osg::Vec3f mAabbMin;
+            osg::Vec3f mAabbMax;
+            unsigned int mUpdateCount;
+        };
+
+        typedef std::map<const btCollisionObject*, Copy> CopyMap;
+
+        void updateCopy(const btCollisionObject* original, Copy& copy);
+
+        std::auto_ptr<btDefaultCollisionConfiguration> mCollisionConfiguration;
+        std::auto_ptr<btCollisionDispatcher> mDispatcher;
+        std::auto_ptr<btBroadphaseInterface> mBroadphase;
+        std::auto_ptr<btCollisionWorld> mCollisionWorld;
+
+        CopyMap mCopies;
+        unsigned int mUpdateCount;
+
+        CollisionSnapshot(const CollisionSnapshot&);
+        CollisionSnapshot& operator=(const CollisionSnapshot&);
+    };
+
+}
+
+#endif
@@ -1,8 +1,11 @@
 #include "physicssystem.hpp"
 
 #include <stdexcept>
+#include <iostream>
 
 #include <osg/Group>
+#include <osg/Stats>
+#include <osg/Timer>
 
 #include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
 #include <BulletCollision/CollisionShapes/btConeShape.h>
@@ -22,8 +25,10 @@
 
 #include <components/esm/loadgmst.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
+#include <components/settings/settings.hpp>
 
 #include <components/nifosg/particle.hpp> // FindRecIndexVisitor
+#include <components/sceneutil/workqueue.hpp>
 
 #include "../mwbase/world.hpp"
 #include "../mwbase/environment.hpp"
@@ -43,6 +48,7 @@
 #include "../mwworld/class.hpp"
 
 #include "collisiontype.hpp"
+#include "collisionsnapshot.hpp"
 #include "actor.hpp"
 #include "convert.hpp"
 #include "trace.h"
@@ -194,6 +200,30 @@ namespace MWPhysics
 
 
     public:
+        /// What the solver needs to know about the game world. Gathered on the main thread, so the solver does
+        /// not query the world from other threads.
+        struct WorldState
+        {
+            float mSwimHeightScale;
+            float mStormWalkMult;
+            bool mIsInStorm;
+            osg::Vec3f mStormDirection;
+        };
+
+        static WorldState getWorldState()
+        {
+            const MWBase::World* world = MWBase::Environment::get().getWorld();
+            const MWWorld::Store<ESM::GameSetting>& gmst = world->getStore().get<ESM::GameSetting>();
+
+            WorldState state;
+            state.mSwimHeightScale = gmst.find("fSwimHeightScale")->getFloat();
+            state.mStormWalkMult = gmst.find("fStromWalkMult")->getFloat();
+            state.mIsInStorm = world->isInStorm();
+            if (state.mIsInStorm)
+                state.mStormDirection = world->getStormDirection();
+            return state;
+        }
+
         static osg::Vec3f traceDown(const MWWorld::Ptr &ptr, Actor* actor, btCollisionWorld* collisionWorld, float maxHeight)
         {
             osg::Vec3f position(ptr.getRefData().getPosition().asVec3());
@@ -233,12 +263,14 @@ namespace MWPhysics
             }
         }
 
-        static osg::Vec3f move(const MWWorld::Ptr &ptr, Actor* physicActor, const osg::Vec3f &movement, float time,
-                                  bool isFlying, float waterlevel, float slowFall, btCollisionWorld* collisionWorld,
-                               std::map<MWWorld::Ptr, MWWorld::Ptr>& standingCollisionTracker)
+        /// @param colobj The collision object of the actor in \a collisionWorld.
+        /// @param standingCollision Set to the object the actor ends up standing on, if any.
+        static osg::Vec3f move(const MWWorld::Ptr &ptr, Actor* physicActor, btCollisionObject* colobj, const osg::Vec3f& startPosition,
+                               const osg::Vec3f &movement, float time, bool isFlying, float waterlevel, float slowFall,
+                               const WorldState& worldState, btCollisionWorld* collisionWorld, MWWorld::Ptr& standingCollision)
         {
             const ESM::Position& refpos = ptr.getRefData().getPosition();
-            osg::Vec3f position(refpos.asVec3());
+            osg::Vec3f position(startPosition);
 
             // Early-out for totally static creatures
             // (Not sure if gravity should still apply?)
@@ -255,7 +287,6 @@ namespace MWPhysics
                                     ) * movement * time;
             }
 
-            btCollisionObject *colobj = physicActor->getCollisionObject();
             osg::Vec3f halfExtents = physicActor->getHalfExtents();
 
             // NOTE: here we don't account for the collision box translation (i.e. physicActor->getPosition() - refpos.pos).
@@ -264,9 +295,7 @@ namespace MWPhysics
             // While this is strictly speaking wrong, it's needed for MW compatibility.
             position.z() += halfExtents.z();
 
-            static const float fSwimHeightScale = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
-                    .find("fSwimHeightScale")->getFloat();
-            float swimlevel = waterlevel + halfExtents.z() - (physicActor->getRenderingHalfExtents().z() * 2 * fSwimHeightScale);
+            float swimlevel = waterlevel + halfExtents.z() - (physicActor->getRenderingHalfExtents().z() * 2 * worldState.mSwimHeightScale);
 
             ActorTracer tracer;
             osg::Vec3f inertia = physicActor->getInertialForce();
@@ -296,13 +325,11 @@ namespace MWPhysics
             ptr.getClass().getMovementSettings(ptr).mPosition[2] = 0;
 
             // Now that we have the effective movement vector, apply wind forces to it
-            if (MWBase::Environment::get().getWorld()->isInStorm())
+            if (worldState.mIsInStorm)
             {
-                osg::Vec3f stormDirection = MWBase::Environment::get().getWorld()->getStormDirection();
+                const osg::Vec3f& stormDirection = worldState.mStormDirection;
                 float angleDegrees = osg::RadiansToDegrees(std::acos(stormDirection * velocity / (stormDirection.length() * velocity.length())));
-                static const float fStromWalkMult = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
-                        .find("fStromWalkMult")->getFloat();
-                velocity *= 1.f-(fStromWalkMult * (angleDegrees/180.f));
+                velocity *= 1.f-(worldState.mStormWalkMult * (angleDegrees/180.f));
             }
 
             osg::Vec3f origVelocity = velocity;
@@ -313,8 +340,10 @@ namespace MWPhysics
              * nextpos is the local variable used to find potential newPosition, using velocity and remainingTime
              * The initial velocity was set earlier (see above).
              */
+            // The cutoff used to be 0.01 s, which is 0.6 of a step at 60 Hz. Keep it relative to the step,
+            // so steps at high step rates (shorter than 0.01 s) are not cut off before the actor moves at all.
             float remainingTime = time;
-            for(int iterations = 0; iterations < sMaxIterations && remainingTime > 0.01f; ++iterations)
+            for(int iterations = 0; iterations < sMaxIterations && remainingTime > time * 0.6f; ++iterations)
             {
                 osg::Vec3f nextpos = newPosition + velocity * remainingTime;
 
@@ -411,7 +440,7 @@ namespace MWPhysics
                     const btCollisionObject* standingOn = tracer.mHitObject;
                     const PtrHolder* ptrHolder = static_cast<PtrHolder*>(standingOn->getUserPointer());
                     if (ptrHolder)
-                        standingCollisionTracker[ptr] = ptrHolder->getPtr();
+                        standingCollision = ptrHolder->getPtr();
 
                     if (standingOn->getBroadphaseHandle()->m_collisionFilterGroup == CollisionType_Water)
                         physicActor->setWalkingOnWater(true);
@@ -459,6 +488,77 @@ namespace MWPhysics
     };
 
 
+    // ---------------------------------------------------------------
+
+    /// The movement of an actor in this frame, and the result of its current step.
+    struct ActorMovement
+    {
+        MWWorld::Ptr mPtr;
+        Actor* mActor;
+
+        osg::Vec3f mMovement;
+        float mWaterLevel;
+        float mSlowFall;
+        bool mIsFlying;
+        bool mIsSwimming;
+
+        osg::Vec3f mPosition;
+        MWWorld::Ptr mStandingOn;
+    };
+
+    typedef std::vector<ActorMovement> ActorMovementList;
+
+    /// Solve a step of the movements [begin, end).
+    /// @param snapshot The snapshot \a collisionWorld belongs to, or NULL if it is the world of the actors.
+    void solveMovements(ActorMovementList& movements, unsigned int begin, unsigned int end, float dt,
+                        const MovementSolver::WorldState& worldState, btCollisionWorld* collisionWorld, const CollisionSnapshot* snapshot)
+    {
+        for (unsigned int i=begin; i<end; ++i)
+        {
+            ActorMovement& movement = movements[i];
+            btCollisionObject* colobj = movement.mActor->getCollisionObject();
+            if (snapshot)
+                colobj = snapshot->getCopy(colobj);
+
+            movement.mStandingOn = MWWorld::Ptr();
+            movement.mPosition = MovementSolver::move(movement.mPtr, movement.mActor, colobj, movement.mActor->getSimulationPosition(),
+                                                      movement.mMovement, dt, movement.mIsFlying, movement.mWaterLevel, movement.mSlowFall,
+                                                      worldState, collisionWorld, movement.mStandingOn);
+        }
+    }
+
+    class MovementSolverItem : public SceneUtil::WorkItem
+    {
+    public:
+        MovementSolverItem(ActorMovementList& movements, unsigned int begin, unsigned int end, float dt,
+                           const MovementSolver::WorldState& worldState, CollisionSnapshot* snapshot)
+            : mMovements(movements)
+            , mBegin(begin)
+            , mEnd(end)
+            , mDt(dt)
+            , mWorldState(worldState)
+            , mSnapshot(snapshot)
+        {
+        }
+
+        virtual void doWork()
+        {
+            solveMovements(mMovements, mBegin, mEnd, mDt, mWorldState, mSnapshot->getCollisionWorld(), mSnapshot);
+            mTicket->signalDone();
+        }
+
+    private:
+        ActorMovementList& mMovements;
+        unsigned int mBegin;
+        unsigned int mEnd;
+        float mDt;
+        MovementSolver::WorldState mWorldState;
+        CollisionSnapshot* mSnapshot;
+    };
+
+    // Fewer actors are solved faster on the main thread alone than by keeping the snapshots up to date
+    static const unsigned int sMinActorsPerThread = 4;
+
     // ---------------------------------------------------------------
 
     class HeightField
@@ -635,10 +735,15 @@ namespace MWPhysics
 
     // ---------------------------------------------------------------
 
-    PhysicsSystem::PhysicsSystem(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> parentNode)
+    PhysicsSystem::PhysicsSystem(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> parentNode, const std::string& cachePath)
         : mShapeManager(new Resource::BulletShapeManager(resourceSystem->getVFS(), resourceSystem->getSceneManager()))
+        , mResourceSystem(resourceSystem)
         , mDebugDrawEnabled(false)
         , mTimeAccum(0.0f)
+        , mPhysicsDt(1.f / 60.f)
+        , mMaxSubsteps(1)
+        , mMovementTime(0.0)
+        , mNumMovementsSolved(0)
         , mWaterHeight(0)
         , mWaterEnabled(false)
         , mParentNode(parentNode)
@@ -652,10 +757,47 @@ namespace MWPhysics
         // Don't update AABBs of all objects every frame. Most objects in MW are static, so we don't need this.
         // Should a "static" object ever be moved, we have to update its AABB manually using DynamicsWorld::updateSingleAabb.
         mCollisionWorld->setForceUpdateAllAabbs(false);
+
+        float stepRate = Settings::Manager::getFloat("step rate", "Physics");
+        if (stepRate < 10.f || stepRate > 240.f)
+        {
+            std::cerr << "Warning: step rate " << stepRate << " is out of range (10 to 240), clamping" << std::endl;
+            stepRate = std::max(10.f, std::min(240.f, stepRate));
+        }
+        mPhysicsDt = 1.f / stepRate;
+        mMaxSubsteps = std::max(1, Settings::Manager::getInt("max substeps", "Physics"));
+
+        int numThreads = std::max(0, Settings::Manager::getInt("solver num threads", "Physics"));
+#if BT_BULLET_VERSION < 287
+        // Older versions record every query in a single, global profile, so only one thread may query at a time
+        if (numThreads > 0)
+        {
+            std::cerr << "Bullet " << BT_BULLET_VERSION << " does not support queries from several threads, "
+                      << "the actor movement is solved on the main thread" << std::endl;
+            numThreads = 0;
+        }
+#endif
+        if (numThreads > 0)
+        {
+            mWorkQueue.reset(new SceneUtil::WorkQueue(numThreads));
+            for (int i=0; i<numThreads; ++i)
+                mSnapshots.push_back(new CollisionSnapshot);
+        }
+
+        mShapeManager->setMaxCacheSize(static_cast<size_t>(Settings::Manager::getInt("shape cache max size", "Cells")) * 1024 * 1024);
+        if (Settings::Manager::getBool("shape disk cache", "Cells"))
+            mShapeManager->setDiskCache(boost::filesystem::path(cachePath) / "shapes");
+        mResourceSystem->addResourceManager(mShapeManager.get());
     }
 
     PhysicsSystem::~PhysicsSystem()
     {
+        mResourceSystem->removeResourceManager(mShapeManager.get());
+
+        mWorkQueue.reset();
+        for (std::vector<CollisionSnapshot*>::iterator it = mSnapshots.begin(); it != mSnapshots.end(); ++it)
+            delete *it;
+
         if (mWaterCollisionObject.get())
             mCollisionWorld->removeCollisionObject(mWaterCollisionObject.get());
 
@@ -682,6 +824,11 @@ namespace MWPhysics
         delete mBroadphase;
     }
 
+    Resource::BulletShapeManager* PhysicsSystem::getShapeManager()
+    {
+        return mShapeManager.get();
+    }
+
     bool PhysicsSystem::toggleDebugRendering()
     {
         mDebugDrawEnabled = !mDebugDrawEnabled;
@@ -1268,60 +1415,177 @@ namespace MWPhysics
     {
         mMovementResults.clear();
 
-        mTimeAccum += dt;
-        if(mTimeAccum >= 1.0f/60.0f)
-        {
-            // Collision events should be available on every frame
+        // Drop the time that can not be simulated within the substep limit. The simulation slows down
+        // then, rather than taking ever more steps and dragging the frame rate further down.
+        mTimeAccum = std::min(mTimeAccum + dt, mMaxSubsteps * mPhysicsDt);
+        int numSteps = static_cast<int>(mTimeAccum / mPhysicsDt);
+        mTimeAccum -= numSteps * mPhysicsDt;
+        // The fraction of a step that has passed since the last step, to interpolate the rendered positions
+        float alpha = std::min(1.f, mTimeAccum / mPhysicsDt);
+
+        // Collision events should be available on every frame
+        if (numSteps > 0)
             mStandingCollisions.clear();
 
-            const MWBase::World *world = MWBase::Environment::get().getWorld();
-            PtrVelocityList::iterator iter = mMovementQueue.begin();
-            for(;iter != mMovementQueue.end();++iter)
+        osg::Timer_t start = osg::Timer::instance()->tick();
+
+        const MWBase::World *world = MWBase::Environment::get().getWorld();
+        ActorMovementList movements;
+        PtrVelocityList::iterator iter = mMovementQueue.begin();
+        for(;iter != mMovementQueue.end();++iter)
+        {
+            ActorMap::iterator foundActor = mActors.find(iter->first);
+            if (foundActor == mActors.end()) // actor was already removed from the scene
+                continue;
+            Actor* physicActor = foundActor->second;
+
+            // The actor was moved by something other than the simulation, e.g. teleported by a script
+            osg::Vec3f position = iter->first.getRefData().getPosition().asVec3();
+            if (position != physicActor->getRenderPosition())
+                physicActor->resetSimulationPosition(position);
+
+            ActorMovement movement;
+            movement.mPtr = iter->first;
+            movement.mActor = physicActor;
+            movement.mMovement = iter->second;
+
+            if (numSteps > 0)
             {
                 float waterlevel = -std::numeric_limits<float>::max();
                 const MWWorld::CellStore *cell = iter->first.getCell();
                 if(cell->getCell()->hasWater())
                     waterlevel = cell->getWaterLevel();
 
-                float oldHeight = iter->first.getRefData().getPosition().pos[2];
-
                 const MWMechanics::MagicEffects& effects = iter->first.getClass().getCreatureStats(iter->first).getMagicEffects();
 
                 bool waterCollision = false;
                 if (effects.get(ESM::MagicEffect::WaterWalking).getMagnitude()
                         && cell->getCell()->hasWater()
-                        && !world->isUnderwater(iter->first.getCell(),
-                                               osg::Vec3f(iter->first.getRefData().getPosition().asVec3())))
+                        && !world->isUnderwater(iter->first.getCell(), position))
                     waterCollision = true;
 
-                ActorMap::iterator foundActor = mActors.find(iter->first);
-                if (foundActor == mActors.end()) // actor was already removed from the scene
-                    continue;
-                Actor* physicActor = foundActor->second;
                 physicActor->setCanWaterWalk(waterCollision);
 
+                movement.mWaterLevel = waterlevel;
                 // Slow fall reduces fall speed by a factor of (effect magnitude / 200)
-                float slowFall = 1.f - std::max(0.f, std::min(1.f, effects.get(ESM::MagicEffect::SlowFall).getMagnitude() * 0.005f));
+                movement.mSlowFall = 1.f - std::max(0.f, std::min(1.f, effects.get(ESM::MagicEffect::SlowFall).getMagnitude() * 0.005f));
+                movement.mIsFlying = world->isFlying(iter->first);
+                movement.mIsSwimming = world->isSwimming(iter->first);
+            }
+
+            movements.push_back(movement);
+        }
+
+        if (numSteps > 0 && !movements.empty())
+        {
+            MovementSolver::WorldState worldState = MovementSolver::getWorldState();
+
+            // The actors collide with each other at their simulated positions, rather than the rendered ones
+            for (ActorMovementList::iterator it = movements.begin(); it != movements.end(); ++it)
+            {
+                it->mActor->setPosition(it->mActor->getSimulationPosition());
+                mCollisionWorld->updateSingleAabb(it->mActor->getCollisionObject());
+            }
+
+            // The main thread solves the first share of the actors against the world itself, each worker thread
+            // another share against its snapshot
+            unsigned int numShares = std::min(static_cast<unsigned int>(mSnapshots.size()) + 1,
+                                              std::max(1u, static_cast<unsigned int>(movements.size()) / sMinActorsPerThread));
+            for (unsigned int i=1; i<numShares; ++i)
+                mSnapshots[i-1]->update(mCollisionWorld);
+
+            for (int step=0; step<numSteps; ++step)
+            {
+                // Every actor sees the others where they were at the start of the step, so the result does not
+                // depend on the order the actors are solved in, nor on the thread they are solved on
+                std::vector<osg::ref_ptr<SceneUtil::WorkTicket> > tickets;
+                for (unsigned int i=1; i<numShares; ++i)
+                {
+                    tickets.push_back(mWorkQueue->addWorkItem(new MovementSolverItem(movements, movements.size() * i / numShares,
+                                                                                     movements.size() * (i+1) / numShares, mPhysicsDt,
+                                                                                     worldState, mSnapshots[i-1]),
+                                                              SceneUtil::WorkQueue::Priority_High));
+                }
+                solveMovements(movements, 0, movements.size() / numShares, mPhysicsDt, worldState, mCollisionWorld, NULL);
+                for (std::vector<osg::ref_ptr<SceneUtil::WorkTicket> >::iterator it = tickets.begin(); it != tickets.end(); ++it)
+                    (*it)->waitTillDone();
 
-                osg::Vec3f newpos = MovementSolver::move(iter->first, physicActor, iter->second, mTimeAccum,
-                                                            world->isFlying(iter->first),
-                                                            waterlevel, slowFall, mCollisionWorld, mStandingCollisions);
+                resolveActorContacts(movements);
 
-                float heightDiff = newpos.z() - oldHeight;
+                for (ActorMovementList::iterator it = movements.begin(); it != movements.end(); ++it)
+                {
+                    for (unsigned int i=1; i<numShares; ++i)
+                        mSnapshots[i-1]->updateObject(it->mActor->getCollisionObject());
 
-                if (heightDiff < 0)
-                    iter->first.getClass().getCreatureStats(iter->first).addToFallHeight(-heightDiff);
+                    // A jump is only applied once, swimming and flying upwards are continuous
+                    if (!it->mIsFlying && !it->mIsSwimming)
+                        it->mMovement.z() = 0.f;
+                }
+            }
 
-                mMovementResults.push_back(std::make_pair(iter->first, newpos));
+            for (ActorMovementList::iterator it = movements.begin(); it != movements.end(); ++it)
+            {
+                it->mActor->updatePosition();
+                mCollisionWorld->updateSingleAabb(it->mActor->getCollisionObject());
             }
 
-            mTimeAccum = 0.0f;
+            mNumMovementsSolved += movements.size();
+            mMovementTime += osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
         }
+
+        for (ActorMovementList::iterator it = movements.begin(); it != movements.end(); ++it)
+            mMovementResults.push_back(std::make_pair(it->mPtr, it->mActor->interpolatePosition(alpha)));
+
         mMovementQueue.clear();
 
         return mMovementResults;
     }
 
+    void PhysicsSystem::resolveActorContacts(std::vector<ActorMovement>& movements)
+    {
+        // In the order the movements were queued, so the result is the same every time. Every actor is moved to
+        // its resolved position before the next one is checked against it, the actors after it are still where
+        // they were at the start of the step.
+        for (ActorMovementList::iterator it = movements.begin(); it != movements.end(); ++it)
+        {
+            Actor* physicActor = it->mActor;
+            osg::Vec3f oldPosition = physicActor->getSimulationPosition();
+            osg::Vec3f newPosition = it->mPosition;
+
+            // Two actors may have moved into each other, as each one was solved against where the other one
+            // was before. Trace the move again against the actors only, like the solver traces it.
+            if (physicActor->getCollisionMode() && (newPosition - oldPosition).length2() > 0.0001f)
+            {
+                osg::Vec3f halfHeight (0.f, 0.f, physicActor->getHalfExtents().z());
+                ActorTracer tracer;
+                tracer.doTrace(physicActor->getCollisionObject(), oldPosition + halfHeight, newPosition + halfHeight,
+                               mCollisionWorld, CollisionType_Actor);
+                if (tracer.mFraction < 1.0f)
+                    newPosition = tracer.mEndPos - halfHeight;
+            }
+
+            float heightDiff = newPosition.z() - oldPosition.z();
+            if (heightDiff < 0)
+                it->mPtr.getClass().getCreatureStats(it->mPtr).addToFallHeight(-heightDiff);
+
+            if (!it->mStandingOn.isEmpty())
+                mStandingCollisions[it->mPtr] = it->mStandingOn;
+
+            physicActor->setSimulationPosition(newPosition);
+            physicActor->setPosition(newPosition);
+            mCollisionWorld->updateSingleAabb(physicActor->getCollisionObject());
+        }
+    }
+
+    void PhysicsSystem::reportStats(unsigned int frameNumber, osg::Stats *stats)
+    {
+        // Movement is solved at the step rate (10 to 240 Hz), so a frame may report no solving at all
+        stats->setAttribute(frameNumber, "physics_movement_time_taken", mMovementTime);
+        stats->setAttribute(frameNumber, "physics_actors_solved", mNumMovementsSolved);
+        mMovementTime = 0.0;
+        mNumMovementsSolved = 0;
+    }
+
     void PhysicsSystem::stepSimulation(float dt)
     {
         for (std::set<Object*>::iterator it = mAnimatedObjects.begin(); it != mAnimatedObjects.end(); ++it)
@@ -4,6 +4,7 @@
 #include <memory>
 #include <map>
 #include <set>
+#include <vector>
 
 #include <osg/Quat>
 #include <osg/ref_ptr>
@@ -15,6 +16,7 @@
 namespace osg
 {
     class Group;
+    class Stats;
 }
 
 namespace MWRender
@@ -32,6 +34,11 @@ namespace Resource
     class ResourceSystem;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 class btCollisionWorld;
 class btBroadphaseInterface;
 class btDefaultCollisionConfiguration;
@@ -46,13 +53,18 @@ namespace MWPhysics
     class HeightField;
     class Object;
     class Actor;
+    class CollisionSnapshot;
+    struct ActorMovement;
 
     class PhysicsSystem
     {
         public:
-            PhysicsSystem (Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> parentNode);
+            /// @param cachePath Directory to store built collision shapes in, see the "shape disk cache" setting.
+            PhysicsSystem (Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> parentNode, const std::string& cachePath);
             ~PhysicsSystem ();
 
+            Resource::BulletShapeManager* getShapeManager();
+
             void enableWater(float height);
             void setWaterHeight(float height);
             void disableWater();
@@ -131,11 +143,16 @@ namespace MWPhysics
             void queueObjectMovement(const MWWorld::Ptr &ptr, const osg::Vec3f &velocity);
 
             /// Apply all queued movements, then clear the list.
+            /// @par The movement is simulated in fixed steps. The returned positions are interpolated
+            /// between the last two steps, so the actors move smoothly at any frame rate.
             const PtrVelocityList& applyQueuedMovement(float dt);
 
             /// Clear the queued movements list without applying.
             void clearQueuedMovement();
 
+            /// Report the time spent solving actor movement and the number of actors solved since the last call.
+            void reportStats(unsigned int frameNumber, osg::Stats* stats);
+
             /// Return true if \a actor has been standing on \a object in this frame
             /// This will trigger whenever the object is directly below the actor.
             /// It doesn't matter if the actor is stationary or moving.
@@ -163,12 +180,16 @@ namespace MWPhysics
 
             void updateWater();
 
+            /// Keep the actors that were solved at the same time from ending up inside each other.
+            void resolveActorContacts(std::vector<ActorMovement>& movements);
+
             btBroadphaseInterface* mBroadphase;
             btDefaultCollisionConfiguration* mCollisionConfiguration;
             btCollisionDispatcher* mDispatcher;
             btCollisionWorld* mCollisionWorld;
 
             std::auto_ptr<Resource::BulletShapeManager> mShapeManager;
+            Resource::ResourceSystem* mResourceSystem;
 
             typedef std::map<MWWorld::Ptr, Object*> ObjectMap;
             ObjectMap mObjects;
@@ -194,7 +215,18 @@ namespace MWPhysics
             PtrVelocityList mMovementQueue;
             PtrVelocityList mMovementResults;
 
+            // Simulation time that has not been stepped yet, less than one step
             float mTimeAccum;
+            float mPhysicsDt;
+            int mMaxSubsteps;
+
+            // Solve the actor movement on these threads as well, each against its own snapshot of the collision world
+            std::auto_ptr<SceneUtil::WorkQueue> mWorkQueue;
+            std::vector<CollisionSnapshot*> mSnapshots;
+
+            // Movement solving since the last reportStats
+            double mMovementTime;
+            unsigned int mNumMovementsSolved;
 
             float mWaterHeight;
             float mWaterEnabled;
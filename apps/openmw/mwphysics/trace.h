@@ -19,7 +19,9 @@ namespace MWPhysics
 
         float mFraction;
 
-        void doTrace(btCollisionObject *actor, const osg::Vec3f& start, const osg::Vec3f& end, btCollisionWorld* world);
+        /// @param collisionMask Only hit the groups in both the actor's collision mask and this mask.
+        void doTrace(btCollisionObject *actor, const osg::Vec3f& start, const osg::Vec3f& end, btCollisionWorld* world,
+                     int collisionMask = ~0);
         void findGround(const Actor* actor, const osg::Vec3f& start, const osg::Vec3f& end, btCollisionWorld* world);
     };
 }
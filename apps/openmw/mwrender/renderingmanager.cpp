@@ -2,6 +2,9 @@
 
 #include <stdexcept>
 #include <limits>
+#include <algorithm>
+
+#include <boost/filesystem/path.hpp>
 
 #include <osg/Light>
 #include <osg/LightModel>
@@ -26,8 +29,11 @@
 #include <components/sceneutil/lightmanager.hpp>
 #include <components/sceneutil/statesetupdater.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
+#include <components/sceneutil/riggeometry.hpp>
+#include <components/sceneutil/workqueue.hpp>
 
 #include <components/terrain/terraingrid.hpp>
+#include <components/terrain/quadtreeworld.hpp>
 
 #include <components/esm/loadcell.hpp>
 
@@ -126,7 +132,7 @@ namespace MWRender
     };
 
     RenderingManager::RenderingManager(osgViewer::Viewer* viewer, osg::ref_ptr<osg::Group> rootNode, Resource::ResourceSystem* resourceSystem,
-                                       const MWWorld::Fallback* fallback, const std::string& resourcePath)
+                                       const MWWorld::Fallback* fallback, const std::string& resourcePath, const std::string& cachePath)
         : mViewer(viewer)
         , mRootNode(rootNode)
         , mResourceSystem(resourceSystem)
@@ -146,6 +152,13 @@ namespace MWRender
 
         mRootNode->addChild(lightRoot);
 
+        int skinningThreads = std::max(0, Settings::Manager::getInt("skinning num threads", "Objects"));
+        if (skinningThreads > 0)
+        {
+            mSkinningWorkQueue.reset(new SceneUtil::WorkQueue(skinningThreads));
+            SceneUtil::RigGeometry::setWorkQueue(mSkinningWorkQueue.get());
+        }
+
         mPathgrid.reset(new Pathgrid(mRootNode));
 
         mObjects.reset(new Objects(mResourceSystem, lightRoot));
@@ -158,8 +171,23 @@ namespace MWRender
 
         mWater.reset(new Water(mRootNode, lightRoot, mResourceSystem, mViewer->getIncrementalCompileOperation(), fallback, resourcePath));
 
-        mTerrain.reset(new Terrain::TerrainGrid(lightRoot, mResourceSystem, mViewer->getIncrementalCompileOperation(),
-                                                new TerrainStorage(mResourceSystem->getVFS(), false), Mask_Terrain));
+        if (Settings::Manager::getBool("distant land", "Terrain"))
+        {
+            boost::filesystem::path compositeMapDirectory;
+            if (Settings::Manager::getBool("composite map disk cache", "Terrain"))
+                compositeMapDirectory = boost::filesystem::path(cachePath) / "terrain";
+            mTerrain.reset(new Terrain::QuadTreeWorld(lightRoot, mResourceSystem, mViewer->getIncrementalCompileOperation(),
+                                                      new TerrainStorage(mResourceSystem->getVFS(), false), Mask_Terrain,
+                                                      Settings::Manager::getFloat("lod factor", "Terrain"),
+                                                      std::max(0, Settings::Manager::getInt("chunk cache size", "Terrain")),
+                                                      Settings::Manager::getFloat("composite map distance", "Terrain"),
+                                                      Settings::Manager::getInt("composite map resolution", "Terrain"),
+                                                      compositeMapDirectory,
+                                                      static_cast<size_t>(std::max(0, Settings::Manager::getInt("composite map cache size", "Terrain"))) * 1024 * 1024));
+        }
+        else
+            mTerrain.reset(new Terrain::TerrainGrid(lightRoot, mResourceSystem, mViewer->getIncrementalCompileOperation(),
+                                                    new TerrainStorage(mResourceSystem->getVFS(), false), Mask_Terrain));
 
         mCamera.reset(new Camera(mViewer->getCamera()));
 
@@ -208,6 +236,7 @@ namespace MWRender
         mFieldOfView = Settings::Manager::getFloat("field of view", "General");
         updateProjectionMatrix();
         mStateUpdater->setFogEnd(mViewDistance);
+        mTerrain->setViewDistance(mViewDistance);
 
         mRootNode->getOrCreateStateSet()->addUniform(new osg::Uniform("near", mNearClip));
         mRootNode->getOrCreateStateSet()->addUniform(new osg::Uniform("far", mViewDistance));
@@ -215,6 +244,7 @@ namespace MWRender
 
     RenderingManager::~RenderingManager()
     {
+        SceneUtil::RigGeometry::setWorkQueue(NULL);
     }
 
     MWRender::Objects& RenderingManager::getObjects()
@@ -227,6 +257,11 @@ namespace MWRender
         return mResourceSystem;
     }
 
+    Terrain::World* RenderingManager::getTerrain()
+    {
+        return mTerrain.get();
+    }
+
     void RenderingManager::setNightEyeFactor(float factor)
     {
         if (factor != mNightEyeFactor)
@@ -387,6 +422,7 @@ namespace MWRender
 
         osg::Vec3f focal, cameraPos;
         mCamera->getPosition(focal, cameraPos);
+        mTerrain->update(cameraPos);
         if (mWater->isUnderwater(cameraPos))
         {
             setFogColor(mUnderwaterColor * mUnderwaterWeight + mFogColor * (1.f-mUnderwaterWeight));
@@ -686,6 +722,8 @@ namespace MWRender
     {
         mSky->setMoonColour(false);
 
+        mTerrain->getStorage()->clearCache();
+
         notifyWorldSpaceChanged();
     }
 
@@ -806,6 +844,7 @@ namespace MWRender
             {
                 mViewDistance = Settings::Manager::getFloat("viewing distance", "Camera");
                 mStateUpdater->setFogEnd(mViewDistance);
+                mTerrain->setViewDistance(mViewDistance);
                 updateProjectionMatrix();
             }
             else if (it->first == "General" && (it->second == "texture filtering" || it->second == "anisotropy"))
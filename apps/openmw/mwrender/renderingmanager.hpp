@@ -27,6 +27,11 @@ namespace osgViewer
     class Viewer;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace ESM
 {
     struct Cell;
@@ -58,13 +63,15 @@ namespace MWRender
     {
     public:
         RenderingManager(osgViewer::Viewer* viewer, osg::ref_ptr<osg::Group> rootNode, Resource::ResourceSystem* resourceSystem,
-                         const MWWorld::Fallback* fallback, const std::string& resourcePath);
+                         const MWWorld::Fallback* fallback, const std::string& resourcePath, const std::string& cachePath);
         ~RenderingManager();
 
         MWRender::Objects& getObjects();
 
         Resource::ResourceSystem* getResourceSystem();
 
+        Terrain::World* getTerrain();
+
         void setNightEyeFactor(float factor);
 
         void setAmbientColour(const osg::Vec4f& colour);
@@ -179,6 +186,10 @@ namespace MWRender
 
         osg::ref_ptr<osg::Light> mSunLight;
 
+        // Declared before the objects, animations and terrain, so they are destroyed before it. The scene graph roots
+        // above outlive it, ~RenderingManager stops the RigGeometries from queueing more skinning before that.
+        std::auto_ptr<SceneUtil::WorkQueue> mSkinningWorkQueue;
+
         std::auto_ptr<Pathgrid> mPathgrid;
         std::auto_ptr<Objects> mObjects;
         std::auto_ptr<Water> mWater;
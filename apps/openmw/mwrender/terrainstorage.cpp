@@ -51,6 +51,14 @@ namespace MWRender
         maxY += 1;
     }
 
+    bool TerrainStorage::hasData(int cellX, int cellY)
+    {
+        const MWWorld::ESMStore &esmStore =
+            MWBase::Environment::get().getWorld()->getStore();
+        const ESM::Land* land = esmStore.get<ESM::Land>().search(cellX, cellY);
+        return land && (land->mDataTypes & ESM::Land::DATA_VHGT);
+    }
+
     const ESM::Land* TerrainStorage::getLand(int cellX, int cellY)
     {
         const MWWorld::ESMStore &esmStore =
@@ -61,7 +69,21 @@ namespace MWRender
 
         const int flags = ESM::Land::DATA_VCLR|ESM::Land::DATA_VHGT|ESM::Land::DATA_VNML|ESM::Land::DATA_VTEX;
         if (!land->isDataLoaded(flags))
+        {
             land->loadData(flags);
+
+            // Vertices at the borders of a cell need the data of the neighbouring cells,
+            // and streaming usually continues there, so load them along with this one.
+            for (int y=cellY-1; y<=cellY+1; ++y)
+            {
+                for (int x=cellX-1; x<=cellX+1; ++x)
+                {
+                    const ESM::Land* neighbour = esmStore.get<ESM::Land>().search(x, y);
+                    if (neighbour && !neighbour->isDataLoaded(flags))
+                        neighbour->loadData(flags);
+                }
+            }
+        }
         return land;
     }
 
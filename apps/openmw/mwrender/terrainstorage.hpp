@@ -20,6 +20,9 @@ namespace MWRender
 
         /// Get bounds of the whole terrain in cell units
         virtual void getBounds(float& minX, float& maxX, float& minY, float& maxY);
+
+        /// Whether the land record of the cell has heights, without loading them
+        virtual bool hasData(int cellX, int cellY);
     };
 
 }
@@ -42,7 +42,17 @@ namespace MWScript
             Interpreter::Interpreter mInterpreter;
             bool mOpcodesInstalled;
 
-            typedef std::pair<std::vector<Interpreter::Type_Code>, Compiler::Locals> CompiledScript;
+            struct CompiledScript
+            {
+                std::vector<Interpreter::Type_Code> mByteCode;
+                Compiler::Locals mLocals;
+                Interpreter::Program mProgram; ///< decoded on the first run
+
+                CompiledScript (const std::vector<Interpreter::Type_Code>& byteCode, const Compiler::Locals& locals)
+                : mByteCode (byteCode), mLocals (locals)
+                {}
+            };
+
             typedef std::map<std::string, CompiledScript> ScriptCollection;
 
             ScriptCollection mScripts;
@@ -0,0 +1,230 @@
+#include "cellpreloader.hpp"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include <components/resource/resourcesystem.hpp>
+#include <components/resource/scenemanager.hpp>
+#include <components/resource/bulletshapemanager.hpp>
+#include <components/misc/resourcehelpers.hpp>
+#include <components/terrain/world.hpp>
+
+#include "../mwbase/environment.hpp"
+#include "../mwbase/world.hpp"
+
+#include "cellstore.hpp"
+#include "esmstore.hpp"
+#include "class.hpp"
+
+namespace
+{
+
+    struct ListModelsFunctor
+    {
+        std::set<std::string>& mMeshes;
+        const VFS::Manager* mVFS;
+
+        ListModelsFunctor(std::set<std::string>& meshes, const VFS::Manager* vfs)
+            : mMeshes(meshes), mVFS(vfs)
+        {
+        }
+
+        bool operator() (const MWWorld::Ptr& ptr)
+        {
+            if (ptr.getRefData().isDeleted() || !ptr.getRefData().isEnabled())
+                return true;
+
+            std::string model = ptr.getClass().getModel(ptr);
+            if (!model.empty())
+                mMeshes.insert(Misc::ResourceHelpers::correctActorModelPath(model, mVFS));
+            return true;
+        }
+    };
+
+}
+
+namespace MWWorld
+{
+
+    /// The resources of a preloaded cell. Holding on to them keeps them from being released by the resource caches.
+    class PreloadedObjects : public osg::Referenced
+    {
+    public:
+        PreloadedObjects()
+        {
+            setThreadSafeRefUnref(true);
+        }
+
+        std::vector<osg::ref_ptr<const osg::Referenced> > mObjects;
+    };
+
+    class PreloadItem : public SceneUtil::WorkItem
+    {
+    public:
+        PreloadItem(CellStore* cell, Resource::SceneManager* sceneManager, Resource::BulletShapeManager* bulletShapeManager,
+                    Terrain::World* terrain, PreloadedObjects* objects)
+            : mIsExterior(cell->getCell()->isExterior())
+            , mX(cell->getCell()->getGridX())
+            , mY(cell->getCell()->getGridY())
+            , mSceneManager(sceneManager)
+            , mBulletShapeManager(bulletShapeManager)
+            , mTerrain(terrain)
+            , mObjects(objects)
+        {
+            // The references must be read on the main thread, the ESM readers are shared
+            ListModelsFunctor functor(mMeshes, sceneManager->getVFS());
+            cell->forEachConst(functor);
+        }
+
+        virtual void doWork()
+        {
+            for (std::set<std::string>::const_iterator it = mMeshes.begin(); it != mMeshes.end() && !mTicket->isCancelled(); ++it)
+            {
+                try
+                {
+                    mObjects->mObjects.push_back(mSceneManager->getTemplate(*it));
+                    if (mBulletShapeManager)
+                    {
+                        osg::ref_ptr<Resource::BulletShape> shape = mBulletShapeManager->getShape(*it);
+                        if (shape)
+                            mObjects->mObjects.push_back(shape);
+                    }
+                }
+                catch (std::exception&)
+                {
+                    // ignore, the error will be reported when the cell is loaded
+                }
+            }
+
+            if (mIsExterior && mTerrain && !mTicket->isCancelled())
+                mTerrain->cacheCell(mX, mY);
+
+            mTicket->signalDone();
+        }
+
+    private:
+        bool mIsExterior;
+        int mX;
+        int mY;
+        std::set<std::string> mMeshes;
+
+        Resource::SceneManager* mSceneManager;
+        Resource::BulletShapeManager* mBulletShapeManager;
+        Terrain::World* mTerrain;
+
+        osg::ref_ptr<PreloadedObjects> mObjects;
+    };
+
+    CellPreloader::CellPreloader(Resource::ResourceSystem *resourceSystem, Resource::BulletShapeManager *bulletShapeManager,
+                                 Terrain::World *terrain, int numThreads)
+        : mResourceSystem(resourceSystem)
+        , mBulletShapeManager(bulletShapeManager)
+        , mTerrain(terrain)
+        , mWorkQueue(new SceneUtil::WorkQueue(std::max(1, numThreads)))
+        , mExpiryDelay(0.0)
+        , mMaxCacheSize(0)
+    {
+    }
+
+    CellPreloader::~CellPreloader()
+    {
+        clear();
+    }
+
+    void CellPreloader::preload(CellStore *cell, double timestamp)
+    {
+        PreloadMap::iterator found = mPreloadCells.find(cell);
+        if (found != mPreloadCells.end())
+        {
+            found->second.mTimeStamp = timestamp;
+            if (!found->second.mTicket->isCancelled())
+                return;
+
+            // The cell was about to expire, and its work item may have stopped early or not run at all.
+            // Preload it again. The cancelled work item keeps its own objects until it is done.
+        }
+        else if (mPreloadCells.size() >= mMaxCacheSize)
+            return;
+
+        if (cell->getCell()->isExterior())
+        {
+            // Terrain data is loaded on demand, which is not thread safe.
+            // Load it for the terrain of this cell, including the borders shared with the neighbouring cells.
+            const MWWorld::Store<ESM::Land>& lands = MWBase::Environment::get().getWorld()->getStore().get<ESM::Land>();
+            const int flags = ESM::Land::DATA_VCLR|ESM::Land::DATA_VHGT|ESM::Land::DATA_VNML|ESM::Land::DATA_VTEX;
+            for (int y=cell->getCell()->getGridY()-1; y<=cell->getCell()->getGridY()+1; ++y)
+            {
+                for (int x=cell->getCell()->getGridX()-1; x<=cell->getCell()->getGridX()+1; ++x)
+                {
+                    const ESM::Land* land = lands.search(x, y);
+                    if (land && !land->isDataLoaded(flags))
+                        land->loadData(flags);
+                }
+            }
+        }
+
+        Entry entry;
+        entry.mTimeStamp = timestamp;
+        entry.mObjects = new PreloadedObjects;
+        entry.mTicket = mWorkQueue->addWorkItem(new PreloadItem(cell, mResourceSystem->getSceneManager(),
+                                                                mBulletShapeManager, mTerrain, entry.mObjects),
+                                                SceneUtil::WorkQueue::Priority_Low);
+        mPreloadCells[cell] = entry;
+    }
+
+    void CellPreloader::updateCache(double timestamp)
+    {
+        for (PreloadMap::iterator it = mPreloadCells.begin(); it != mPreloadCells.end();)
+        {
+            if (it->second.mTimeStamp + mExpiryDelay < timestamp)
+            {
+                it->second.mTicket->cancel();
+
+                // Don't block on work in progress, try again on the next update
+                if (it->second.mTicket->isDone())
+                {
+                    discard(it->first);
+                    mPreloadCells.erase(it++);
+                    continue;
+                }
+            }
+            ++it;
+        }
+    }
+
+    void CellPreloader::clear()
+    {
+        for (PreloadMap::iterator it = mPreloadCells.begin(); it != mPreloadCells.end(); ++it)
+            it->second.mTicket->cancel();
+
+        for (PreloadMap::iterator it = mPreloadCells.begin(); it != mPreloadCells.end(); ++it)
+        {
+            it->second.mTicket->waitTillDone();
+            discard(it->first);
+        }
+        mPreloadCells.clear();
+    }
+
+    void CellPreloader::discard(CellStore* cell)
+    {
+        if (cell->getCell()->isExterior() && mTerrain)
+            mTerrain->uncacheCell(cell->getCell()->getGridX(), cell->getCell()->getGridY());
+    }
+
+    void CellPreloader::setExpiryDelay(double expiryDelay)
+    {
+        mExpiryDelay = expiryDelay;
+    }
+
+    void CellPreloader::setMaxCacheSize(unsigned int maxCacheSize)
+    {
+        mMaxCacheSize = maxCacheSize;
+    }
+
+    unsigned int CellPreloader::getCacheSize() const
+    {
+        return mPreloadCells.size();
+    }
+
+}
@@ -0,0 +1,86 @@
+#ifndef GAME_MWWORLD_CELLPRELOADER_H
+#define GAME_MWWORLD_CELLPRELOADER_H
+
+#include <map>
+#include <memory>
+
+#include <osg/ref_ptr>
+
+#include <components/sceneutil/workqueue.hpp>
+
+namespace Resource
+{
+    class ResourceSystem;
+    class BulletShapeManager;
+}
+
+namespace Terrain
+{
+    class World;
+}
+
+namespace MWWorld
+{
+    class CellStore;
+
+    class PreloadedObjects;
+
+    /// @brief Loads the meshes, collision shapes and terrain of cells in the background, before they
+    /// become active. Loading the cell into the scene then mostly hits the resource caches.
+    class CellPreloader
+    {
+    public:
+        /// @param numThreads Number of background threads to use for preloading
+        CellPreloader(Resource::ResourceSystem* resourceSystem, Resource::BulletShapeManager* bulletShapeManager,
+                      Terrain::World* terrain, int numThreads);
+        ~CellPreloader();
+
+        /// Ask a background thread to preload the resources of this cell. Renews the request if the cell
+        /// is already preloaded, and preloads it again if it was about to expire.
+        /// @note Loads the references of the cell, if necessary.
+        void preload(CellStore* cell, double timestamp);
+
+        /// Discard preloaded cells that have not been requested for longer than the expiry delay.
+        void updateCache(double timestamp);
+
+        /// Discard all preloaded cells.
+        void clear();
+
+        /// How long to keep a preloaded cell after the last request for it.
+        void setExpiryDelay(double expiryDelay);
+
+        /// The maximum number of cells to keep preloaded. Further requests are ignored until old cells expire.
+        void setMaxCacheSize(unsigned int maxCacheSize);
+
+        unsigned int getCacheSize() const;
+
+    private:
+        struct Entry
+        {
+            double mTimeStamp;
+            osg::ref_ptr<SceneUtil::WorkTicket> mTicket;
+            osg::ref_ptr<PreloadedObjects> mObjects;
+        };
+
+        /// Release what was preloaded for a cell. The work item must be done.
+        void discard(CellStore* cell);
+
+        Resource::ResourceSystem* mResourceSystem;
+        Resource::BulletShapeManager* mBulletShapeManager;
+        Terrain::World* mTerrain;
+
+        std::auto_ptr<SceneUtil::WorkQueue> mWorkQueue;
+
+        double mExpiryDelay;
+        unsigned int mMaxCacheSize;
+
+        typedef std::map<CellStore*, Entry> PreloadMap;
+        PreloadMap mPreloadCells;
+
+        CellPreloader(const CellPreloader&);
+        CellPreloader& operator= (const CellPreloader&);
+    };
+
+}
+
+#endif
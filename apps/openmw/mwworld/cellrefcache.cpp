@@ -0,0 +1,103 @@
+#include "cellrefcache.hpp"
+
+#include <algorithm>
+
+#include <OpenThreads/ScopedLock>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/loadcell.hpp>
+#include <components/misc/stringops.hpp>
+
+namespace MWWorld
+{
+    CellRefCache::CellRefCache (std::size_t maxCells) : mMaxCells (maxCells) {}
+
+    boost::shared_ptr<const CellRefCache::RefList> CellRefCache::getRefs (const ESM::Cell *cell,
+        std::vector<ESM::ESMReader>& esm)
+    {
+        std::map<const ESM::Cell *, Entry>::iterator found = mCells.find (cell);
+
+        if (found!=mCells.end())
+        {
+            mLru.splice (mLru.begin(), mLru, found->second.mLruPosition);
+            return found->second.mRefs;
+        }
+
+        boost::shared_ptr<RefList> refs (new RefList);
+        readRefs (cell, esm, *refs);
+
+        // Dynamically generated cells have no references, and may not outlive the cache
+        if (mMaxCells==0 || cell->mContextList.empty())
+            return refs;
+
+        while (mCells.size()>=mMaxCells)
+        {
+            mCells.erase (mLru.back());
+            mLru.pop_back();
+        }
+
+        mLru.push_front (cell);
+
+        Entry entry;
+        entry.mRefs = refs;
+        entry.mLruPosition = mLru.begin();
+        mCells.insert (std::make_pair (cell, entry));
+
+        return refs;
+    }
+
+    void CellRefCache::clear()
+    {
+        mCells.clear();
+        mLru.clear();
+    }
+
+    void CellRefCache::readRefs (const ESM::Cell *cell, std::vector<ESM::ESMReader>& esm, RefList& refs)
+    {
+        refs.clear();
+
+        if (cell->mContextList.empty())
+            return; // this is a dynamically generated cell -> skipping.
+
+        // Sorted, so the references can be checked without going through the whole list each time
+        std::vector<ESM::RefNum> movedRefs;
+        movedRefs.reserve (cell->mMovedRefs.size());
+        for (ESM::MovedCellRefTracker::const_iterator it = cell->mMovedRefs.begin(); it != cell->mMovedRefs.end(); ++it)
+            movedRefs.push_back (it->mRefNum);
+        std::sort (movedRefs.begin(), movedRefs.end());
+
+        Ref ref;
+
+        // Load references from all plugins that do something with this cell.
+        // The readers are shared with the land data, which the terrain loads in the background.
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(ESM::ESMReader::getOnDemandMutex());
+        for (size_t i = 0; i < cell->mContextList.size(); i++)
+        {
+            // Reopen the ESM reader and seek to the right position.
+            int index = cell->mContextList.at(i).index;
+            cell->restore (esm[index], i);
+
+            ref.mRef.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
+
+            // Get each reference in turn
+            while (cell->getNextRef (esm[index], ref.mRef, ref.mDeleted))
+            {
+                // Don't load reference if it was moved to a different cell.
+                if (std::binary_search (movedRefs.begin(), movedRefs.end(), ref.mRef.mRefNum))
+                    continue;
+
+                Misc::StringUtils::toLower (ref.mRef.mRefID);
+                refs.push_back (ref);
+            }
+        }
+
+        // Moved references, from separately tracked list.
+        for (ESM::CellRefTracker::const_iterator it = cell->mLeasedRefs.begin(); it != cell->mLeasedRefs.end(); ++it)
+        {
+            ref.mRef = *it;
+            ref.mDeleted = false;
+            Misc::StringUtils::toLower (ref.mRef.mRefID);
+            refs.push_back (ref);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef GAME_MWWORLD_CELLREFCACHE_H
+#define GAME_MWWORLD_CELLREFCACHE_H
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <components/esm/cellref.hpp>
+
+namespace ESM
+{
+    class ESMReader;
+    struct Cell;
+}
+
+namespace MWWorld
+{
+    /// \brief The references of cells, as read from the content files
+    ///
+    /// Reading the references of a cell means seeking to the cell in every content file that
+    /// changes it and parsing each reference. The cache does that once per cell, later loads
+    /// of the cell copy the references from memory. The least recently used cells are dropped
+    /// once more than the maximum number of cells are cached.
+    class CellRefCache
+    {
+        public:
+
+            struct Ref
+            {
+                ESM::CellRef mRef; ///< with lower case ID
+                bool mDeleted;
+            };
+
+            typedef std::vector<Ref> RefList;
+
+        private:
+
+            typedef std::list<const ESM::Cell *> LruList;
+
+            struct Entry
+            {
+                boost::shared_ptr<const RefList> mRefs;
+                LruList::iterator mLruPosition;
+            };
+
+            std::map<const ESM::Cell *, Entry> mCells;
+            LruList mLru; ///< most recently used first
+            std::size_t mMaxCells;
+
+            CellRefCache (const CellRefCache&);
+            CellRefCache& operator= (const CellRefCache&);
+
+        public:
+
+            CellRefCache (std::size_t maxCells);
+
+            boost::shared_ptr<const RefList> getRefs (const ESM::Cell *cell, std::vector<ESM::ESMReader>& esm);
+            ///< Return the references of \a cell, reading them if they are not cached.
+
+            void clear();
+
+            static void readRefs (const ESM::Cell *cell, std::vector<ESM::ESMReader>& esm, RefList& refs);
+            ///< Read the references of \a cell from the content files, except for references that
+            /// were moved to another cell. References moved into the cell are appended.
+    };
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <components/esm/defs.hpp>
 #include <components/esm/cellstate.hpp>
 #include <components/loadinglistener/loadinglistener.hpp>
+#include <components/settings/settings.hpp>
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/world.hpp"
@@ -13,6 +14,7 @@
 #include "esmstore.hpp"
 #include "containerstore.hpp"
 #include "cellstore.hpp"
+#include "refidindex.hpp"
 
 MWWorld::CellStore *MWWorld::Cells::getCellStore (const ESM::Cell *cell)
 {
@@ -23,7 +25,7 @@ MWWorld::CellStore *MWWorld::Cells::getCellStore (const ESM::Cell *cell)
 
         if (result==mInteriors.end())
         {
-            result = mInteriors.insert (std::make_pair (lowerName, CellStore (cell))).first;
+            result = mInteriors.insert (std::make_pair (lowerName, CellStore (cell, &mRefIdIndex, &mRefCache))).first;
         }
 
         return &result->second;
@@ -36,7 +38,7 @@ MWWorld::CellStore *MWWorld::Cells::getCellStore (const ESM::Cell *cell)
         if (result==mExteriors.end())
         {
             result = mExteriors.insert (std::make_pair (
-                std::make_pair (cell->getGridX(), cell->getGridY()), CellStore (cell))).first;
+                std::make_pair (cell->getGridX(), cell->getGridY()), CellStore (cell, &mRefIdIndex, &mRefCache))).first;
 
         }
 
@@ -48,23 +50,24 @@ void MWWorld::Cells::clear()
 {
     mInteriors.clear();
     mExteriors.clear();
-    std::fill(mIdCache.begin(), mIdCache.end(), std::make_pair("", (MWWorld::CellStore*)0));
-    mIdCacheIndex = 0;
+    mRefIdIndex.clear();
 }
 
-MWWorld::Ptr MWWorld::Cells::getPtrAndCache (const std::string& name, CellStore& cellStore)
+MWWorld::Ptr MWWorld::Cells::getPtrIfNotLoaded (const std::string& name, CellStore& cellStore)
 {
-    Ptr ptr = getPtr (name, cellStore);
+    // The references of loaded cells are indexed, no need to search them again
+    if (cellStore.getState()==CellStore::State_Loaded)
+        return Ptr();
 
-    if (!ptr.isEmpty() && ptr.isInCell())
-    {
-        mIdCache[mIdCacheIndex].first = name;
-        mIdCache[mIdCacheIndex].second = &cellStore;
-        if (++mIdCacheIndex>=mIdCache.size())
-            mIdCacheIndex = 0;
-    }
+    return getPtr (name, cellStore);
+}
 
-    return ptr;
+MWWorld::Ptr MWWorld::Cells::searchInContainersIfLoaded (const std::string& name, CellStore& cellStore)
+{
+    if (cellStore.getState()!=CellStore::State_Loaded)
+        return Ptr();
+
+    return cellStore.searchInContainer (name);
 }
 
 void MWWorld::Cells::writeCell (ESM::ESMWriter& writer, CellStore& cell) const
@@ -86,8 +89,7 @@ void MWWorld::Cells::writeCell (ESM::ESMWriter& writer, CellStore& cell) const
 
 MWWorld::Cells::Cells (const MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& reader)
 : mStore (store), mReader (reader),
-  mIdCache (40, std::pair<std::string, CellStore *> ("", (CellStore*)0)), /// \todo make cache size configurable
-  mIdCacheIndex (0)
+  mRefCache (Settings::Manager::getInt ("reference cache size", "Cells"))
 {}
 
 MWWorld::CellStore *MWWorld::Cells::getExterior (int x, int y)
@@ -114,7 +116,7 @@ MWWorld::CellStore *MWWorld::Cells::getExterior (int x, int y)
         }
 
         result = mExteriors.insert (std::make_pair (
-            std::make_pair (x, y), CellStore (cell))).first;
+            std::make_pair (x, y), CellStore (cell, &mRefIdIndex, &mRefCache))).first;
     }
 
     if (result->second.getState()!=CellStore::State_Loaded)
@@ -135,7 +137,7 @@ MWWorld::CellStore *MWWorld::Cells::getInterior (const std::string& name)
     {
         const ESM::Cell *cell = mStore.get<ESM::Cell>().find(lowerName);
 
-        result = mInteriors.insert (std::make_pair (lowerName, CellStore (cell))).first;
+        result = mInteriors.insert (std::make_pair (lowerName, CellStore (cell, &mRefIdIndex, &mRefCache))).first;
     }
 
     if (result->second.getState()!=CellStore::State_Loaded)
@@ -183,23 +185,39 @@ MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name, CellStore& cell,
 
 MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name)
 {
-    // First check the cache
-    for (std::vector<std::pair<std::string, CellStore *> >::iterator iter (mIdCache.begin());
-        iter!=mIdCache.end(); ++iter)
-        if (iter->first==name && iter->second)
+    // First check the loaded cells that have references with this ID
+    if (const RefIdIndex::CellList *indexed = mRefIdIndex.find (name))
+        for (RefIdIndex::CellList::const_iterator iter (indexed->begin()); iter!=indexed->end(); ++iter)
         {
-            Ptr ptr = getPtr (name, *iter->second);
+            Ptr ptr = getPtr (name, **iter);
             if (!ptr.isEmpty())
                 return ptr;
         }
 
+    // The contents of containers are not indexed, check the containers of the loaded cells
+    for (std::map<std::pair<int, int>, CellStore>::reverse_iterator iter = mExteriors.rbegin();
+        iter!=mExteriors.rend(); ++iter)
+    {
+        Ptr ptr = searchInContainersIfLoaded (name, iter->second);
+        if (!ptr.isEmpty())
+            return ptr;
+    }
+
+    for (std::map<std::string, CellStore>::iterator iter = mInteriors.begin();
+        iter!=mInteriors.end(); ++iter)
+    {
+        Ptr ptr = searchInContainersIfLoaded (name, iter->second);
+        if (!ptr.isEmpty())
+            return ptr;
+    }
+
     // Then check cells that are already listed
     // Search in reverse, this is a workaround for an ambiguous chargen_plank reference in the vanilla game.
     // there is one at -22,16 and one at -2,-9, the latter should be used.
     for (std::map<std::pair<int, int>, CellStore>::reverse_iterator iter = mExteriors.rbegin();
         iter!=mExteriors.rend(); ++iter)
     {
-        Ptr ptr = getPtrAndCache (name, iter->second);
+        Ptr ptr = getPtrIfNotLoaded (name, iter->second);
         if (!ptr.isEmpty())
             return ptr;
     }
@@ -207,7 +225,7 @@ MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name)
     for (std::map<std::string, CellStore>::iterator iter = mInteriors.begin();
         iter!=mInteriors.end(); ++iter)
     {
-        Ptr ptr = getPtrAndCache (name, iter->second);
+        Ptr ptr = getPtrIfNotLoaded (name, iter->second);
         if (!ptr.isEmpty())
             return ptr;
     }
@@ -220,7 +238,7 @@ MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name)
     {
         CellStore *cellStore = getCellStore (&(*iter));
 
-        Ptr ptr = getPtrAndCache (name, *cellStore);
+        Ptr ptr = getPtrIfNotLoaded (name, *cellStore);
 
         if (!ptr.isEmpty())
             return ptr;
@@ -230,7 +248,7 @@ MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name)
     {
         CellStore *cellStore = getCellStore (&(*iter));
 
-        Ptr ptr = getPtrAndCache (name, *cellStore);
+        Ptr ptr = getPtrIfNotLoaded (name, *cellStore);
 
         if (!ptr.isEmpty())
             return ptr;
@@ -247,7 +265,7 @@ void MWWorld::Cells::getExteriorPtrs(const std::string &name, std::vector<MWWorl
     {
         CellStore *cellStore = getCellStore (&(*iter));
 
-        Ptr ptr = getPtrAndCache (name, *cellStore);
+        Ptr ptr = getPtr (name, *cellStore);
 
         if (!ptr.isEmpty())
             out.push_back(ptr);
@@ -261,7 +279,7 @@ void MWWorld::Cells::getInteriorPtrs(const std::string &name, std::vector<MWWorl
     {
         CellStore *cellStore = getCellStore (&(*iter));
 
-        Ptr ptr = getPtrAndCache (name, *cellStore);
+        Ptr ptr = getPtr (name, *cellStore);
 
         if (!ptr.isEmpty())
             out.push_back(ptr);
@@ -342,3 +360,8 @@ bool MWWorld::Cells::readRecord (ESM::ESMReader& reader, uint32_t type,
 
     return false;
 }
+
+const MWWorld::RefIdIndex& MWWorld::Cells::getRefIdIndex() const
+{
+    return mRefIdIndex;
+}
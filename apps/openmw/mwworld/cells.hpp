@@ -6,6 +6,8 @@
 #include <string>
 
 #include "ptr.hpp"
+#include "refidindex.hpp"
+#include "cellrefcache.hpp"
 
 namespace ESM
 {
@@ -31,15 +33,17 @@ namespace MWWorld
             std::vector<ESM::ESMReader>& mReader;
             mutable std::map<std::string, CellStore> mInteriors;
             mutable std::map<std::pair<int, int>, CellStore> mExteriors;
-            std::vector<std::pair<std::string, CellStore *> > mIdCache;
-            std::size_t mIdCacheIndex;
+            RefIdIndex mRefIdIndex;
+            CellRefCache mRefCache;
 
             Cells (const Cells&);
             Cells& operator= (const Cells&);
 
             CellStore *getCellStore (const ESM::Cell *cell);
 
-            Ptr getPtrAndCache (const std::string& name, CellStore& cellStore);
+            Ptr getPtrIfNotLoaded (const std::string& name, CellStore& cellStore);
+
+            Ptr searchInContainersIfLoaded (const std::string& name, CellStore& cellStore);
 
             void writeCell (ESM::ESMWriter& writer, CellStore& cell) const;
 
@@ -59,9 +63,12 @@ namespace MWWorld
             ///< \param searchInContainers Only affect loaded cells.
             /// @note name must be lower case
 
+            /// Search the references of the loaded cells, then the contents of their containers, then the other cells.
             /// @note name must be lower case
             Ptr getPtr (const std::string& name);
 
+            const RefIdIndex& getRefIdIndex() const;
+
             /// Get all Ptrs referencing \a name in exterior cells
             /// @note Due to the current implementation of getPtr this only supports one Ptr per cell.
             /// @note name must be lower case
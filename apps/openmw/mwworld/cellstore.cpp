@@ -24,9 +24,26 @@
 #include "esmstore.hpp"
 #include "class.hpp"
 #include "containerstore.hpp"
+#include "refidindex.hpp"
 
 namespace
 {
+    struct IndexRefsFunctor
+    {
+        MWWorld::RefIdIndex& mIndex;
+        MWWorld::CellStore *mCell;
+
+        IndexRefsFunctor (MWWorld::RefIdIndex& index, MWWorld::CellStore *cell)
+        : mIndex (index), mCell (cell)
+        {}
+
+        bool operator() (const MWWorld::Ptr& ptr)
+        {
+            mIndex.insert (ptr.getCellRef().getRefId(), mCell);
+            return true;
+        }
+    };
+
     template<typename T>
     MWWorld::Ptr searchInContainerList (MWWorld::CellRefList<T>& containerList, const std::string& id)
     {
@@ -179,8 +196,8 @@ namespace MWWorld
         return (ref.mRef.mRefnum == pRefnum);
     }
 
-    CellStore::CellStore (const ESM::Cell *cell)
-      : mCell (cell), mState (State_Unloaded), mHasState (false), mLastRespawn(0,0)
+    CellStore::CellStore (const ESM::Cell *cell, RefIdIndex *refIdIndex, CellRefCache *refCache)
+      : mCell (cell), mRefIdIndex (refIdIndex), mRefCache (refCache), mState (State_Unloaded), mHasState (false), mLastRespawn(0,0)
     {
         mWaterLevel = cell->mWater;
     }
@@ -341,6 +358,8 @@ namespace MWWorld
 
             mState = State_Loaded;
 
+            indexRefs();
+
             // TODO: the pathgrid graph only needs to be loaded for active cells, so move this somewhere else.
             // In a simple test, loading the graph for all cells in MW + expansions took 200 ms
             mPathgridGraph.load(this);
@@ -357,89 +376,60 @@ namespace MWWorld
         }
     }
 
-    void CellStore::listRefs(const MWWorld::ESMStore &store, std::vector<ESM::ESMReader> &esm)
+    void CellStore::indexRefs()
     {
-        assert (mCell);
+        if (!mRefIdIndex)
+            return;
 
-        if (mCell->mContextList.empty())
-            return; // this is a dynamically generated cell -> skipping.
+        IndexRefsFunctor functor (*mRefIdIndex, this);
+        forEachConst (functor);
+    }
 
-        // Load references from all plugins that do something with this cell.
-        for (size_t i = 0; i < mCell->mContextList.size(); i++)
-        {
-            // Reopen the ESM reader and seek to the right position.
-            int index = mCell->mContextList.at(i).index;
-            mCell->restore (esm[index], i);
+    void CellStore::refInserted (const Ptr& ptr)
+    {
+        if (mRefIdIndex && mState==State_Loaded)
+            mRefIdIndex->insert (ptr.getCellRef().getRefId(), this);
+    }
 
-            ESM::CellRef ref;
+    void CellStore::refRemoved (const Ptr& ptr)
+    {
+        if (mRefIdIndex)
+            mRefIdIndex->changed();
+    }
 
-            // Get each reference in turn
-            bool deleted = false;
-            while (mCell->getNextRef (esm[index], ref, deleted))
-            {
-                if (deleted)
-                    continue;
+    boost::shared_ptr<const CellRefCache::RefList> CellStore::getRefs (std::vector<ESM::ESMReader> &esm) const
+    {
+        assert (mCell);
 
-                // Don't list reference if it was moved to a different cell.
-                ESM::MovedCellRefTracker::const_iterator iter =
-                    std::find(mCell->mMovedRefs.begin(), mCell->mMovedRefs.end(), ref.mRefNum);
-                if (iter != mCell->mMovedRefs.end()) {
-                    continue;
-                }
+        if (mRefCache)
+            return mRefCache->getRefs (mCell, esm);
 
-                mIds.push_back (Misc::StringUtils::lowerCase (ref.mRefID));
-            }
-        }
+        boost::shared_ptr<CellRefCache::RefList> refs (new CellRefCache::RefList);
+        CellRefCache::readRefs (mCell, esm, *refs);
+        return refs;
+    }
 
-        // List moved references, from separately tracked list.
-        for (ESM::CellRefTracker::const_iterator it = mCell->mLeasedRefs.begin(); it != mCell->mLeasedRefs.end(); ++it)
-        {
-            const ESM::CellRef &ref = *it;
+    void CellStore::listRefs(const MWWorld::ESMStore &store, std::vector<ESM::ESMReader> &esm)
+    {
+        boost::shared_ptr<const CellRefCache::RefList> refs = getRefs (esm);
 
-            mIds.push_back(Misc::StringUtils::lowerCase(ref.mRefID));
-        }
+        mIds.reserve (refs->size());
+
+        for (CellRefCache::RefList::const_iterator it = refs->begin(); it != refs->end(); ++it)
+            if (!it->mDeleted)
+                mIds.push_back (it->mRef.mRefID);
 
         std::sort (mIds.begin(), mIds.end());
     }
 
     void CellStore::loadRefs(const MWWorld::ESMStore &store, std::vector<ESM::ESMReader> &esm)
     {
-        assert (mCell);
-
-        if (mCell->mContextList.empty())
-            return; // this is a dynamically generated cell -> skipping.
-
-        // Load references from all plugins that do something with this cell.
-        for (size_t i = 0; i < mCell->mContextList.size(); i++)
-        {
-            // Reopen the ESM reader and seek to the right position.
-            int index = mCell->mContextList.at(i).index;
-            mCell->restore (esm[index], i);
-
-            ESM::CellRef ref;
-            ref.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
-
-            // Get each reference in turn
-            bool deleted = false;
-            while(mCell->getNextRef(esm[index], ref, deleted))
-            {
-                // Don't load reference if it was moved to a different cell.
-                ESM::MovedCellRefTracker::const_iterator iter =
-                    std::find(mCell->mMovedRefs.begin(), mCell->mMovedRefs.end(), ref.mRefNum);
-                if (iter != mCell->mMovedRefs.end()) {
-                    continue;
-                }
+        boost::shared_ptr<const CellRefCache::RefList> refs = getRefs (esm);
 
-                loadRef (ref, deleted, store);
-            }
-        }
-
-        // Load moved references, from separately tracked list.
-        for (ESM::CellRefTracker::const_iterator it = mCell->mLeasedRefs.begin(); it != mCell->mLeasedRefs.end(); ++it)
+        for (CellRefCache::RefList::const_iterator it = refs->begin(); it != refs->end(); ++it)
         {
-            ESM::CellRef &ref = const_cast<ESM::CellRef&>(*it);
-
-            loadRef (ref, false, store);
+            ESM::CellRef ref = it->mRef;
+            loadRef (ref, it->mDeleted, store);
         }
     }
 
@@ -693,6 +683,10 @@ namespace MWWorld
                     throw std::runtime_error ("unknown type in cell reference section");
             }
         }
+
+        // The saved game may have added references
+        if (mState==State_Loaded)
+            indexRefs();
     }
 
     bool operator== (const CellStore& left, const CellStore& right)
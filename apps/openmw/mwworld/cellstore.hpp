@@ -11,6 +11,7 @@
 
 #include "livecellref.hpp"
 #include "cellreflist.hpp"
+#include "cellrefcache.hpp"
 
 #include <components/esm/loadacti.hpp>
 #include <components/esm/loadalch.hpp>
@@ -46,6 +47,7 @@ namespace MWWorld
 {
     class Ptr;
     class ESMStore;
+    class RefIdIndex;
 
 
     /// \brief Mutable state of a cell
@@ -66,6 +68,8 @@ namespace MWWorld
             boost::shared_ptr<ESM::FogState> mFogState;
 
             const ESM::Cell *mCell;
+            RefIdIndex *mRefIdIndex;
+            CellRefCache *mRefCache;
             State mState;
             bool mHasState;
             std::vector<std::string> mIds;
@@ -96,7 +100,9 @@ namespace MWWorld
 
         public:
 
-            CellStore (const ESM::Cell *cell_);
+            CellStore (const ESM::Cell *cell_, RefIdIndex *refIdIndex = 0, CellRefCache *refCache = 0);
+            ///< \param refIdIndex Index to add the references of this cell to, once it is loaded.
+            /// \param refCache Cache to read the references of this cell from.
 
             const ESM::Cell *getCell() const;
 
@@ -168,6 +174,18 @@ namespace MWWorld
                     forEachImp (functor, mCreatureLists);
             }
 
+            /// Call functor (ref) for each reference, like forEach(), but without marking the cell as
+            /// having state. The functor must not modify the references.
+            template<class Functor>
+            bool forEachConst (Functor& functor) const
+            {
+                CellStore* self = const_cast<CellStore*>(this);
+                bool hasState = mHasState;
+                bool result = self->forEach (functor);
+                self->mHasState = hasState;
+                return result;
+            }
+
             template<class Functor>
             bool forEachContainer (Functor& functor)
             {
@@ -198,6 +216,13 @@ namespace MWWorld
             void respawn ();
             ///< Check mLastRespawn and respawn references if necessary. This is a no-op if the cell is not loaded.
 
+            void refInserted (const Ptr& ptr);
+            ///< Update the reference ID index for a reference that was inserted into this cell.
+
+            void refRemoved (const Ptr& ptr);
+            ///< Update the reference ID index for a reference of this cell that was deleted or
+            /// moved to another cell.
+
             template <class T>
             CellRefList<T>& get() {
                 throw std::runtime_error ("Storage for type " + std::string(typeid(T).name())+ " does not exist in cells");
@@ -228,6 +253,12 @@ namespace MWWorld
                 return true;
             }
 
+            /// Add all references to the reference ID index
+            void indexRefs();
+
+            /// Get the references of this cell from the content files
+            boost::shared_ptr<const CellRefCache::RefList> getRefs (std::vector<ESM::ESMReader> &esm) const;
+
             /// Run through references and store IDs
             void listRefs(const MWWorld::ESMStore &store, std::vector<ESM::ESMReader> &esm);
 
@@ -12,6 +12,7 @@
 #include "ptr.hpp"
 #include "refdata.hpp"
 #include "nullaction.hpp"
+#include "cellstore.hpp"
 #include "failedaction.hpp"
 #include "actiontake.hpp"
 #include "containerstore.hpp"
@@ -343,6 +344,7 @@ namespace MWWorld
     {
         Ptr newPtr = copyToCellImpl(ptr, cell);
         newPtr.getCellRef().unsetRefNum(); // This RefNum is only valid within the original cell of the reference
+        cell.refInserted(newPtr);
         return newPtr;
     }
 
@@ -21,6 +21,12 @@ struct ContentLoader
     {
     }
 
+    /// Called for every content file in load order, before any of them is loaded.
+    /// Loaders may use this to start processing the files in the background.
+    virtual void prepare(const boost::filesystem::path& filepath, int index)
+    {
+    }
+
     virtual void load(const boost::filesystem::path& filepath, int& index)
     {
       std::cout << "Loading content file " << filepath.string() << std::endl;
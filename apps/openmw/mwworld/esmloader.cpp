@@ -1,11 +1,92 @@
 #include "esmloader.hpp"
 #include "esmstore.hpp"
 
+#include <algorithm>
+
+#include <osg/Timer>
+
+#include <OpenThreads/Thread>
+
 #include <components/esm/esmreader.hpp>
+#include <components/sceneutil/workqueue.hpp>
+#include <components/to_utf8/to_utf8.hpp>
 
 namespace MWWorld
 {
 
+/// A content file that is opened and staged in the background.
+struct EsmLoader::PreparedFile
+{
+    PreparedFile(ToUTF8::Utf8Encoder* encoder)
+        : mStageTime(0.0)
+    {
+        // The encoder is not thread safe, so the worker needs its own copy
+        if (encoder)
+            mEncoder.reset(new ToUTF8::Utf8Encoder(*encoder));
+    }
+
+    ESM::ESMReader mReader;
+    StagedContent mStaged;
+
+    std::auto_ptr<ToUTF8::Utf8Encoder> mEncoder;
+
+    /// Error message if preparing the file failed
+    std::string mError;
+
+    /// Time spent on the worker thread, in seconds
+    double mStageTime;
+
+    osg::ref_ptr<SceneUtil::WorkTicket> mTicket;
+};
+
+namespace
+{
+
+class PrepareFileWorkItem : public SceneUtil::WorkItem
+{
+public:
+    PrepareFileWorkItem(const boost::filesystem::path& filepath, int index, boost::shared_ptr<EsmLoader::PreparedFile> prepared,
+                        std::vector<ESM::ESMReader>& readers, ESMStore& store)
+        : mPath(filepath)
+        , mIndex(index)
+        , mPrepared(prepared)
+        , mReaders(readers)
+        , mStore(store)
+    {
+    }
+
+    virtual void doWork()
+    {
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        try
+        {
+            ESM::ESMReader& reader = mPrepared->mReader;
+            reader.setEncoder(mPrepared->mEncoder.get());
+            reader.setIndex(mIndex);
+            reader.setGlobalReaderList(&mReaders);
+            reader.open(mPath.string());
+
+            mStore.stage(reader, mPrepared->mStaged);
+        }
+        catch (std::exception& e)
+        {
+            mPrepared->mError = e.what();
+        }
+        mPrepared->mStageTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+        mTicket->signalDone();
+    }
+
+private:
+    boost::filesystem::path mPath;
+    int mIndex;
+    boost::shared_ptr<EsmLoader::PreparedFile> mPrepared;
+    std::vector<ESM::ESMReader>& mReaders;
+    ESMStore& mStore;
+};
+
+}
+
 EsmLoader::EsmLoader(MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& readers,
   ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener)
   : ContentLoader(listener)
@@ -15,17 +96,59 @@ EsmLoader::EsmLoader(MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& read
 {
 }
 
+EsmLoader::~EsmLoader()
+{
+}
+
+void EsmLoader::prepare(const boost::filesystem::path& filepath, int index)
+{
+  if (!mWorkQueue.get())
+    mWorkQueue.reset(new SceneUtil::WorkQueue(std::max(1, OpenThreads::GetNumberOfProcessors() - 1)));
+
+  boost::shared_ptr<PreparedFile> prepared (new PreparedFile(mEncoder));
+  PrepareFileWorkItem* item = new PrepareFileWorkItem(filepath, index, prepared, mEsm, mStore);
+  // The loading screen waits for the files
+  prepared->mTicket = mWorkQueue->addWorkItem(item, SceneUtil::WorkQueue::Priority_High);
+  mPreparedFiles[index] = prepared;
+}
+
 void EsmLoader::load(const boost::filesystem::path& filepath, int& index)
 {
   ContentLoader::load(filepath.filename(), index);
 
-  ESM::ESMReader lEsm;
-  lEsm.setEncoder(mEncoder);
-  lEsm.setIndex(index);
-  lEsm.setGlobalReaderList(&mEsm);
-  lEsm.open(filepath.string());
-  mEsm[index] = lEsm;
-  mStore.load(mEsm[index], &mListener);
+  PreparedFiles::iterator found = mPreparedFiles.find(index);
+  if (found == mPreparedFiles.end())
+  {
+    ESM::ESMReader lEsm;
+    lEsm.setEncoder(mEncoder);
+    lEsm.setIndex(index);
+    lEsm.setGlobalReaderList(&mEsm);
+    lEsm.open(filepath.string());
+    mEsm[index] = lEsm;
+    mStore.load(mEsm[index], &mListener);
+    return;
+  }
+
+  boost::shared_ptr<PreparedFile> prepared = found->second;
+  mPreparedFiles.erase(found);
+
+  osg::Timer_t start = osg::Timer::instance()->tick();
+  prepared->mTicket->waitTillDone();
+  osg::Timer_t ready = osg::Timer::instance()->tick();
+
+  if (!prepared->mError.empty())
+    throw std::runtime_error(prepared->mError);
+
+  mEsm[index] = prepared->mReader;
+  mEsm[index].setEncoder(mEncoder);
+  mStore.loadStaged(mEsm[index], prepared->mStaged, &mListener);
+
+  osg::Timer_t end = osg::Timer::instance()->tick();
+
+  std::cout << "  " << prepared->mStaged.mNumStaged << " of " << prepared->mStaged.mEntries.size()
+            << " records parsed in the background in " << prepared->mStageTime * 1000.0 << " ms, waited "
+            << osg::Timer::instance()->delta_m(start, ready) << " ms, merged in "
+            << osg::Timer::instance()->delta_m(ready, end) << " ms" << std::endl;
 }
 
 } /* namespace MWWorld */
@@ -2,6 +2,10 @@
 #define ESMLOADER_HPP
 
 #include <vector>
+#include <map>
+#include <memory>
+
+#include <boost/shared_ptr.hpp>
 
 #include "contentloader.hpp"
 
@@ -15,6 +19,11 @@ namespace ESM
     class ESMReader;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace MWWorld
 {
 
@@ -24,13 +33,24 @@ struct EsmLoader : public ContentLoader
 {
     EsmLoader(MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& readers,
       ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener);
+    virtual ~EsmLoader();
+
+    /// Open the file and parse its records on a worker thread.
+    void prepare(const boost::filesystem::path& filepath, int index);
 
     void load(const boost::filesystem::path& filepath, int& index);
 
+    struct PreparedFile;
+
     private:
       std::vector<ESM::ESMReader>& mEsm;
       MWWorld::ESMStore& mStore;
       ToUTF8::Utf8Encoder* mEncoder;
+
+      std::auto_ptr<SceneUtil::WorkQueue> mWorkQueue;
+
+      typedef std::map<int, boost::shared_ptr<PreparedFile> > PreparedFiles;
+      PreparedFiles mPreparedFiles;
 };
 
 } /* namespace MWWorld */
@@ -26,12 +26,19 @@ static bool isCacheableRecord(int id)
     return false;
 }
 
-void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
+StagedContent::StagedContent()
+    : mNumStaged(0)
 {
-    listener->setProgressRange(1000);
+}
 
-    ESM::Dialogue *dialogue = 0;
+StagedContent::~StagedContent()
+{
+    for (std::vector<Entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+        delete it->mRecord;
+}
 
+void ESMStore::setupMasters(ESM::ESMReader &esm)
+{
     /// \todo Move this to somewhere else. ESMReader?
     // Cache parent esX files by tracking their indices in the global list of
     //  all files/readers used by the engine. This will greaty accelerate
@@ -59,64 +66,154 @@ void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
         }
         mast.index = index;
     }
+}
 
-    // Loop through all records
-    while(esm.hasMoreRecs())
+void ESMStore::addId(const RecordId &id, uint32_t type, StoreBase *store)
+{
+    if (id.mIsDeleted)
     {
-        ESM::NAME n = esm.getRecName();
-        esm.getRecHeader();
+        store->eraseStatic(id.mId);
+        return;
+    }
 
-        // Look up the record type.
-        std::map<int, StoreBase *>::iterator it = mStores.find(n.val);
+    // Insert the reference into the global lookup
+    if (!id.mId.empty() && isCacheableRecord(type)) {
+        mIds[Misc::StringUtils::lowerCase (id.mId)] = type;
+    }
+}
 
-        if (it == mStores.end()) {
-            if (n.val == ESM::REC_INFO) {
-                if (dialogue)
-                {
-                    dialogue->readInfo(esm, esm.getIndex() != 0);
-                }
-                else
-                {
-                    std::cerr << "error: info record without dialog" << std::endl;
-                    esm.skipRecord();
-                }
-            } else if (n.val == ESM::REC_MGEF) {
-                mMagicEffects.load (esm);
-            } else if (n.val == ESM::REC_SKIL) {
-                mSkills.load (esm);
-            }
-            else if (n.val==ESM::REC_FILT || n.val == ESM::REC_DBGP)
+void ESMStore::loadRecord(ESM::ESMReader &esm, ESM::NAME n, ESM::Dialogue*& dialogue)
+{
+    // Look up the record type.
+    std::map<int, StoreBase *>::iterator it = mStores.find(n.val);
+
+    if (it == mStores.end()) {
+        if (n.val == ESM::REC_INFO) {
+            if (dialogue)
             {
-                // ignore project file only records
-                esm.skipRecord();
-            }
-            else {
-                std::stringstream error;
-                error << "Unknown record: " << n.toString();
-                throw std::runtime_error(error.str());
+                dialogue->readInfo(esm, esm.getIndex() != 0);
             }
-        } else {
-            RecordId id = it->second->load(esm);
-            if (id.mIsDeleted)
+            else
             {
-                it->second->eraseStatic(id.mId);
-                continue;
+                std::cerr << "error: info record without dialog" << std::endl;
+                esm.skipRecord();
             }
-
+        } else if (n.val == ESM::REC_MGEF) {
+            mMagicEffects.load (esm);
+        } else if (n.val == ESM::REC_SKIL) {
+            mSkills.load (esm);
+        }
+        else if (n.val==ESM::REC_FILT || n.val == ESM::REC_DBGP)
+        {
+            // ignore project file only records
+            esm.skipRecord();
+        }
+        else {
+            std::stringstream error;
+            error << "Unknown record: " << n.toString();
+            throw std::runtime_error(error.str());
+        }
+    } else {
+        RecordId id = it->second->load(esm);
+        if (!id.mIsDeleted)
+        {
             if (n.val==ESM::REC_DIAL) {
                 dialogue = const_cast<ESM::Dialogue*>(mDialogs.find(id.mId));
             } else {
                 dialogue = 0;
             }
-            // Insert the reference into the global lookup
-            if (!id.mId.empty() && isCacheableRecord(n.val)) {
-                mIds[Misc::StringUtils::lowerCase (id.mId)] = n.val;
-            }
         }
+        addId(id, n.val, it->second);
+    }
+}
+
+void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
+{
+    listener->setProgressRange(1000);
+
+    ESM::Dialogue *dialogue = 0;
+
+    setupMasters(esm);
+
+    // Loop through all records
+    while(esm.hasMoreRecs())
+    {
+        ESM::NAME n = esm.getRecName();
+        esm.getRecHeader();
+
+        loadRecord(esm, n, dialogue);
+
         listener->setProgress(static_cast<size_t>(esm.getFileOffset() / (float)esm.getFileSize() * 1000));
     }
 }
 
+void ESMStore::stage(ESM::ESMReader &esm, StagedContent& staged)
+{
+    while(esm.hasMoreRecs())
+    {
+        StagedContent::Entry entry;
+        entry.mFilePos = esm.getFileOffset();
+
+        ESM::NAME n = esm.getRecName();
+        esm.getRecHeader();
+
+        entry.mType = n.val;
+        entry.mRecord = NULL;
+
+        std::map<int, StoreBase *>::iterator it = mStores.find(n.val);
+        if (it != mStores.end())
+            entry.mRecord = it->second->stage(esm);
+
+        if (entry.mRecord)
+            ++staged.mNumStaged;
+        else
+            esm.skipRecord();
+
+        staged.mEntries.push_back(entry);
+    }
+}
+
+void ESMStore::loadStaged(ESM::ESMReader &esm, StagedContent& staged, Loading::Listener* listener)
+{
+    listener->setProgressRange(1000);
+
+    ESM::Dialogue *dialogue = 0;
+
+    setupMasters(esm);
+
+    for (std::vector<StagedContent::Entry>::iterator entry = staged.mEntries.begin(); entry != staged.mEntries.end(); ++entry)
+    {
+        if (entry->mRecord)
+        {
+            RecordId id = entry->mRecord->insert();
+            if (!id.mIsDeleted)
+                dialogue = 0;
+            addId(id, entry->mType, mStores.find(entry->mType)->second);
+
+            delete entry->mRecord;
+            entry->mRecord = NULL;
+        }
+        else
+        {
+            // Go back to the record and load it the regular way
+            ESM::ESM_Context context = esm.getContext();
+            context.filePos = entry->mFilePos;
+            context.leftFile = esm.getFileSize() - entry->mFilePos;
+            context.leftRec = 0;
+            context.leftSub = 0;
+            context.subCached = false;
+            esm.restoreContext(context);
+
+            ESM::NAME n = esm.getRecName();
+            esm.getRecHeader();
+
+            loadRecord(esm, n, dialogue);
+        }
+
+        listener->setProgress(static_cast<size_t>(entry->mFilePos / (float)esm.getFileSize() * 1000));
+    }
+}
+
 void ESMStore::setUp()
 {
     std::map<int, StoreBase *>::iterator it = mStores.begin();
@@ -14,6 +14,31 @@ namespace Loading
 
 namespace MWWorld
 {
+    /// @brief The records of a content file, parsed ahead of time by ESMStore::stage.
+    struct StagedContent
+    {
+        struct Entry
+        {
+            uint32_t mType;
+            /// Position of the record in the content file
+            size_t mFilePos;
+            /// The parsed record, or NULL if the record must be loaded in sequence
+            StagedRecord* mRecord;
+        };
+
+        std::vector<Entry> mEntries;
+
+        /// Number of entries with a parsed record
+        size_t mNumStaged;
+
+        StagedContent();
+        ~StagedContent();
+
+    private:
+        StagedContent(const StagedContent&);
+        StagedContent& operator=(const StagedContent&);
+    };
+
     class ESMStore
     {
         Store<ESM::Activator>       mActivators;
@@ -74,6 +99,15 @@ namespace MWWorld
 
         unsigned int mDynamicCount;
 
+        /// Resolve the indices of the master files of this content file
+        void setupMasters(ESM::ESMReader &esm);
+
+        /// Load a record of a type that must be loaded in sequence. The record header must have been read.
+        void loadRecord(ESM::ESMReader &esm, ESM::NAME n, ESM::Dialogue*& dialogue);
+
+        /// Update the ID lookup for a record that has been loaded into the store for the given record type.
+        void addId(const RecordId& id, uint32_t type, StoreBase* store);
+
     public:
         /// \todo replace with SharedIterator<StoreBase>
         typedef std::map<int, StoreBase *>::const_iterator iterator;
@@ -160,6 +194,15 @@ namespace MWWorld
 
         void load(ESM::ESMReader &esm, Loading::Listener* listener);
 
+        /// Parse the records of a content file that do not depend on other records being loaded,
+        /// to be inserted later by loadStaged(). The remaining records are only skipped.
+        /// @note Does not modify the store, so it may be called from a worker thread during loading.
+        void stage(ESM::ESMReader &esm, StagedContent& staged);
+
+        /// Load a content file staged with stage(). Has the same result as load().
+        /// @param esm Reader for the content file, may be the same that was used for staging.
+        void loadStaged(ESM::ESMReader &esm, StagedContent& staged, Loading::Listener* listener);
+
         template <class T>
         const Store<T> &get() const {
             throw std::runtime_error("Storage for this type not exist");
@@ -0,0 +1,151 @@
+#ifndef OPENMW_MWWORLD_RECORDINDEX_H
+#define OPENMW_MWWORLD_RECORDINDEX_H
+
+#include <string>
+#include <vector>
+#include <cctype>
+
+#include <components/misc/stringops.hpp>
+
+namespace MWWorld
+{
+    /// @brief Case insensitive hash index from record IDs to records.
+    /// @par Lookups do not allocate and accept IDs in any letter case. The index does not own the
+    /// ID strings, they must stay valid for as long as they are indexed (e.g. the keys of a std::map).
+    template <class T>
+    class RecordIndex
+    {
+        struct Entry
+        {
+            size_t mHash;
+            const std::string* mId; // lower case, NULL for empty slots
+            T* mRecord;
+        };
+
+        // Open addressing with linear probing, the capacity is a power of two
+        std::vector<Entry> mEntries;
+        size_t mSize;
+
+        size_t findSlot(const char* id, size_t length, size_t hash) const
+        {
+            const size_t mask = mEntries.size() - 1;
+            for (size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+            {
+                const Entry& entry = mEntries[slot];
+                if (!entry.mId)
+                    return slot;
+                if (entry.mHash != hash || entry.mId->size() != length)
+                    continue;
+
+                size_t i=0;
+                for (; i<length; ++i)
+                    if (tolower(id[i]) != (*entry.mId)[i])
+                        break;
+                if (i == length)
+                    return slot;
+            }
+        }
+
+        void grow()
+        {
+            std::vector<Entry> entries;
+            entries.swap(mEntries);
+
+            Entry empty = { 0, NULL, NULL };
+            mEntries.assign(entries.empty() ? 16 : entries.size() * 2, empty);
+
+            const size_t mask = mEntries.size() - 1;
+            for (typename std::vector<Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+            {
+                if (!it->mId)
+                    continue;
+                size_t slot = it->mHash & mask;
+                while (mEntries[slot].mId)
+                    slot = (slot + 1) & mask;
+                mEntries[slot] = *it;
+            }
+        }
+
+    public:
+        RecordIndex()
+            : mSize(0)
+        {}
+
+        void clear()
+        {
+            mEntries.clear();
+            mSize = 0;
+        }
+
+        size_t size() const
+        {
+            return mSize;
+        }
+
+        /// Add a record, or replace the record that is indexed under the same ID.
+        /// @param id Lower case ID, must outlive its entry in the index.
+        void insert(const std::string& id, T* record)
+        {
+            if ((mSize + 1) * 2 > mEntries.size())
+                grow();
+
+            size_t hash = Misc::StringUtils::ciHash(id);
+            Entry& entry = mEntries[findSlot(id.data(), id.size(), hash)];
+            if (!entry.mId)
+                ++mSize;
+            entry.mHash = hash;
+            entry.mId = &id;
+            entry.mRecord = record;
+        }
+
+        /// @return Was the ID indexed?
+        bool erase(const std::string& id)
+        {
+            if (mEntries.empty())
+                return false;
+
+            const size_t mask = mEntries.size() - 1;
+            size_t slot = findSlot(id.data(), id.size(), Misc::StringUtils::ciHash(id));
+            if (!mEntries[slot].mId)
+                return false;
+
+            // Shift back the following entries of the probe sequence, so no tombstones are needed
+            size_t next = slot;
+            while (true)
+            {
+                next = (next + 1) & mask;
+                const Entry& entry = mEntries[next];
+                if (!entry.mId)
+                    break;
+
+                size_t home = entry.mHash & mask;
+                bool movable = slot <= next ? (home <= slot || home > next) : (home <= slot && home > next);
+                if (movable)
+                {
+                    mEntries[slot] = entry;
+                    slot = next;
+                }
+            }
+
+            mEntries[slot].mId = NULL;
+            mEntries[slot].mRecord = NULL;
+            --mSize;
+            return true;
+        }
+
+        /// @param id ID in any letter case, does not need to be null terminated.
+        T* find(const char* id, size_t length) const
+        {
+            if (mEntries.empty())
+                return NULL;
+            return mEntries[findSlot(id, length, Misc::StringUtils::ciHash(id, length))].mRecord;
+        }
+
+        T* find(const std::string& id) const
+        {
+            return find(id.data(), id.size());
+        }
+    };
+}
+
+#endif
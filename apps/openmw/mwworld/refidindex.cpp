@@ -0,0 +1,71 @@
+#include "refidindex.hpp"
+
+#include <algorithm>
+
+#include <components/esm/loadcell.hpp>
+#include <components/misc/stringops.hpp>
+
+#include "cellstore.hpp"
+
+namespace
+{
+    /// Exteriors first, in reverse order of their coordinates, then interiors by name.
+    /// \note Matches the search order of Cells::getPtr.
+    bool searchedBefore (const MWWorld::CellStore *left, const MWWorld::CellStore *right)
+    {
+        const ESM::Cell *leftCell = left->getCell();
+        const ESM::Cell *rightCell = right->getCell();
+
+        if (leftCell->isExterior()!=rightCell->isExterior())
+            return leftCell->isExterior();
+
+        if (leftCell->isExterior())
+            return std::make_pair (leftCell->getGridX(), leftCell->getGridY())
+                > std::make_pair (rightCell->getGridX(), rightCell->getGridY());
+
+        return Misc::StringUtils::ciLess (leftCell->mName, rightCell->mName);
+    }
+}
+
+namespace MWWorld
+{
+    RefIdIndex::RefIdIndex() : mRevision (0) {}
+
+    void RefIdIndex::insert (const std::string& id, CellStore *cell)
+    {
+        ++mRevision;
+
+        CellList& cells = mCells[id];
+
+        CellList::iterator iter = std::lower_bound (cells.begin(), cells.end(), cell, searchedBefore);
+
+        if (iter==cells.end() || *iter!=cell)
+            cells.insert (iter, cell);
+    }
+
+    void RefIdIndex::changed()
+    {
+        ++mRevision;
+    }
+
+    void RefIdIndex::clear()
+    {
+        ++mRevision;
+        mCells.clear();
+    }
+
+    const RefIdIndex::CellList *RefIdIndex::find (const std::string& id) const
+    {
+        std::map<std::string, CellList>::const_iterator iter = mCells.find (id);
+
+        if (iter==mCells.end())
+            return 0;
+
+        return &iter->second;
+    }
+
+    unsigned int RefIdIndex::getRevision() const
+    {
+        return mRevision;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef GAME_MWWORLD_REFIDINDEX_H
+#define GAME_MWWORLD_REFIDINDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MWWorld
+{
+    class CellStore;
+
+    /// \brief Index of the loaded cells that contain references with a given ID
+    ///
+    /// A cell is added to the index when a reference is inserted into it, including when it is
+    /// loaded. Cells are not removed when their references are deleted or moved away, so the
+    /// cells of an ID still need to be searched, but no other cells.
+    ///
+    /// The revision changes whenever references are inserted, deleted or moved, so a reference
+    /// resolved earlier can be reused as long as the revision is the same.
+    class RefIdIndex
+    {
+        public:
+
+            typedef std::vector<CellStore *> CellList;
+
+        private:
+
+            std::map<std::string, CellList> mCells;
+            unsigned int mRevision;
+
+            RefIdIndex (const RefIdIndex&);
+            RefIdIndex& operator= (const RefIdIndex&);
+
+        public:
+
+            RefIdIndex();
+
+            void insert (const std::string& id, CellStore *cell);
+            ///< \note id must be lower case
+
+            void changed();
+            ///< A reference was deleted or moved.
+
+            void clear();
+
+            const CellList *find (const std::string& id) const;
+            ///< Return the cells that contain references with the ID \a id, exteriors first, in the
+            /// order that Cells::getPtr searches them. Returns 0 if there are none.
+            /// \note id must be lower case
+
+            unsigned int getRevision() const;
+    };
+}
+
+#endif
@@ -1,7 +1,12 @@
 #include "scene.hpp"
 
 #include <limits>
+#include <cmath>
+#include <algorithm>
 #include <iostream>
+#include <typeinfo>
+
+#include <osg/Timer>
 
 #include <components/loadinglistener/loadinglistener.hpp>
 #include <components/misc/resourcehelpers.hpp>
@@ -24,6 +29,7 @@
 #include "class.hpp"
 #include "cellfunctors.hpp"
 #include "cellstore.hpp"
+#include "cellpreloader.hpp"
 
 namespace
 {
@@ -129,6 +135,26 @@ namespace
 
         return true;
     }
+
+    struct ListTeleportDoorsFunctor
+    {
+        const osg::Vec3f& mPos;
+        float mMaxDistance;
+        std::vector<MWWorld::Ptr>& mDoors;
+
+        ListTeleportDoorsFunctor (const osg::Vec3f& pos, float maxDistance, std::vector<MWWorld::Ptr>& doors)
+            : mPos (pos), mMaxDistance (maxDistance), mDoors (doors)
+        {}
+
+        bool operator() (const MWWorld::Ptr& ptr)
+        {
+            if (ptr.getTypeName() == typeid(ESM::Door).name() && ptr.getCellRef().getTeleport()
+                    && !ptr.getRefData().isDeleted() && ptr.getRefData().isEnabled()
+                    && (ptr.getRefData().getPosition().asVec3() - mPos).length2() <= mMaxDistance * mMaxDistance)
+                mDoors.push_back(ptr);
+            return true;
+        }
+    };
 }
 
 
@@ -169,6 +195,16 @@ namespace MWWorld
 
     void Scene::update (float duration, bool paused)
     {
+        if (mPreloadEnabled && mCurrentCell && !paused)
+        {
+            mPreloadTimer += duration;
+            if (mPreloadTimer > 0.1f)
+            {
+                preloadCells(mPreloadTimer);
+                mPreloadTimer = 0.f;
+            }
+        }
+
         if (mNeedMapUpdate)
         {
             // Note: exterior cell maps must be updated, even if they were visited before, because the set of surrounding cells might be different
@@ -291,6 +327,9 @@ namespace MWWorld
             unloadCell (active++);
         assert(mActiveCells.empty());
         mCurrentCell = NULL;
+
+        // The cells are about to be cleared
+        mPreloader->clear();
     }
 
     void Scene::playerMoved(const osg::Vec3f &pos)
@@ -433,12 +472,25 @@ namespace MWWorld
         mechMgr->updateCell(old, player);
         mechMgr->watchActor(player);
 
+        mLastPlayerPos = player.getRefData().getPosition().asVec3();
+
         MWBase::Environment::get().getWorld()->adjustSky();
     }
 
     Scene::Scene (MWRender::RenderingManager& rendering, MWPhysics::PhysicsSystem *physics)
     : mCurrentCell (0), mCellChanged (false), mPhysics(physics), mRendering(rendering), mNeedMapUpdate(false)
+    , mPreloadTimer(0.f)
     {
+        mPreloader.reset(new CellPreloader(rendering.getResourceSystem(), physics->getShapeManager(), rendering.getTerrain(),
+                                           Settings::Manager::getInt("preload num threads", "Cells")));
+        mPreloader->setExpiryDelay(Settings::Manager::getFloat("preload cell expiry delay", "Cells"));
+        mPreloader->setMaxCacheSize(Settings::Manager::getInt("preload cell cache max", "Cells"));
+
+        mPreloadEnabled = Settings::Manager::getBool("preload enabled", "Cells");
+        mPreloadExteriorGrid = Settings::Manager::getBool("preload exterior grid", "Cells");
+        mPreloadDoors = Settings::Manager::getBool("preload doors", "Cells");
+        mPreloadDistance = Settings::Manager::getFloat("preload distance", "Cells");
+        mPredictionTime = Settings::Manager::getFloat("prediction time", "Cells");
     }
 
     Scene::~Scene()
@@ -587,6 +639,99 @@ namespace MWWorld
         return false;
     }
 
+    void Scene::preloadCells(float dt)
+    {
+        MWBase::World* world = MWBase::Environment::get().getWorld();
+        osg::Vec3f playerPos = world->getPlayerPtr().getRefData().getPosition().asVec3();
+        osg::Vec3f moved = playerPos - mLastPlayerPos;
+        osg::Vec3f predictedPos = playerPos + moved / dt * mPredictionTime;
+        mLastPlayerPos = playerPos;
+
+        if (mPreloadDoors)
+            preloadTeleportDoorDestinations(playerPos);
+
+        if (mPreloadExteriorGrid && mCurrentCell->isExterior())
+        {
+            preloadExteriorGrid(playerPos);
+            preloadExteriorGrid(predictedPos);
+        }
+
+        mPreloader->updateCache(osg::Timer::instance()->time_s());
+    }
+
+    void Scene::preloadTeleportDoorDestinations(const osg::Vec3f& playerPos)
+    {
+        std::vector<Ptr> teleportDoors;
+        ListTeleportDoorsFunctor functor (playerPos, mPreloadDistance, teleportDoors);
+        for (CellStoreCollection::const_iterator iter (mActiveCells.begin()); iter!=mActiveCells.end(); ++iter)
+            (*iter)->forEachConst(functor);
+
+        MWBase::World* world = MWBase::Environment::get().getWorld();
+        double timestamp = osg::Timer::instance()->time_s();
+        for (std::vector<Ptr>::const_iterator it = teleportDoors.begin(); it != teleportDoors.end(); ++it)
+        {
+            try
+            {
+                CellStore* cell;
+                if (it->getCellRef().getDestCell().empty())
+                {
+                    ESM::Position pos = it->getCellRef().getDoorDest();
+                    int x, y;
+                    world->positionToIndex(pos.pos[0], pos.pos[1], x, y);
+                    cell = world->getExterior(x, y);
+                }
+                else
+                    cell = world->getInterior(it->getCellRef().getDestCell());
+
+                if (!isCellActive(*cell))
+                    mPreloader->preload(cell, timestamp);
+            }
+            catch (std::exception&)
+            {
+                // ignore error for now, would spam the log too much
+            }
+        }
+    }
+
+    void Scene::preloadExteriorGrid(const osg::Vec3f& pos)
+    {
+        MWBase::World* world = MWBase::Environment::get().getWorld();
+
+        int cellX, cellY;
+        getGridCenter(cellX, cellY);
+        float centerX, centerY;
+        world->indexToPosition(cellX, cellY, centerX, centerY, true);
+
+        // Look ahead by the preload distance on the axes where the position is close to changing the grid
+        const float maxDistance = 8192/2 + 1024; // same threshold as in playerMoved()
+        float lookX = pos.x();
+        float lookY = pos.y();
+        if (std::abs(lookX - centerX) > maxDistance - mPreloadDistance)
+            lookX += lookX > centerX ? mPreloadDistance : -mPreloadDistance;
+        if (std::abs(lookY - centerY) > maxDistance - mPreloadDistance)
+            lookY += lookY > centerY ? mPreloadDistance : -mPreloadDistance;
+
+        if (std::max(std::abs(lookX - centerX), std::abs(lookY - centerY)) <= maxDistance)
+            return;
+
+        int newX, newY;
+        world->positionToIndex(lookX, lookY, newX, newY);
+
+        const int halfGridSize = Settings::Manager::getInt("exterior cell load distance", "Cells");
+        double timestamp = osg::Timer::instance()->time_s();
+        for (int x=newX-halfGridSize; x<=newX+halfGridSize; ++x)
+        {
+            for (int y=newY-halfGridSize; y<=newY+halfGridSize; ++y)
+            {
+                // already active
+                if (std::abs(x-cellX) <= halfGridSize && std::abs(y-cellY) <= halfGridSize)
+                    continue;
+
+                mPreloader->preload(world->getExterior(x, y), timestamp);
+            }
+        }
+    }
+
     Ptr Scene::searchPtrViaActorId (int actorId)
     {
         for (CellStoreCollection::const_iterator iter (mActiveCells.begin());
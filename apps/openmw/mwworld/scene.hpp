@@ -3,15 +3,13 @@
 
 //#include "../mwrender/renderingmanager.hpp"
 
+#include <osg/Vec3f>
+
 #include "ptr.hpp"
 #include "globals.hpp"
 
 #include <set>
-
-namespace osg
-{
-    class Vec3f;
-}
+#include <memory>
 
 namespace ESM
 {
@@ -43,6 +41,7 @@ namespace MWWorld
 {
     class Player;
     class CellStore;
+    class CellPreloader;
 
     class Scene
     {
@@ -60,6 +59,15 @@ namespace MWWorld
 
             bool mNeedMapUpdate;
 
+            std::auto_ptr<CellPreloader> mPreloader;
+            float mPreloadTimer;
+            bool mPreloadEnabled;
+            bool mPreloadExteriorGrid;
+            bool mPreloadDoors;
+            float mPreloadDistance;
+            float mPredictionTime;
+            osg::Vec3f mLastPlayerPos;
+
             void insertCell (CellStore &cell, bool rescale, Loading::Listener* loadingListener);
 
             // Load and unload cells as necessary to create a cell grid with "X" and "Y" in the center
@@ -67,6 +75,10 @@ namespace MWWorld
 
             void getGridCenter(int& cellX, int& cellY);
 
+            void preloadCells(float dt);
+            void preloadTeleportDoorDestinations(const osg::Vec3f& playerPos);
+            void preloadExteriorGrid(const osg::Vec3f& pos);
+
         public:
 
             Scene (MWRender::RenderingManager& rendering, MWPhysics::PhysicsSystem *physics);
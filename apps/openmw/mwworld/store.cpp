@@ -42,6 +42,24 @@ namespace
 
 namespace MWWorld
 {
+    template <class T>
+    class StagedStoreRecord : public StagedRecord
+    {
+    public:
+        StagedStoreRecord(Store<T>& store)
+            : mStore(store), mIsDeleted(false)
+        {}
+
+        virtual RecordId insert()
+        {
+            return mStore.insertLoaded(mRecord, mIsDeleted);
+        }
+
+        Store<T>& mStore;
+        T mRecord;
+        bool mIsDeleted;
+    };
+
     RecordId::RecordId(const std::string &id, bool isDeleted)
         : mId(id), mIsDeleted(isDeleted)
     {}
@@ -115,6 +133,8 @@ namespace MWWorld
     Store<T>::Store(const Store<T>& orig)
         : mStatic(orig.mStatic)
     {
+        for (typename Static::iterator it = mStatic.begin(); it != mStatic.end(); ++it)
+            mStaticIndex.insert(it->first, &it->second);
     }
 
     template<typename T>
@@ -124,32 +144,26 @@ namespace MWWorld
         assert(mShared.size() >= mStatic.size());
         mShared.erase(mShared.begin() + mStatic.size(), mShared.end());
         mDynamic.clear();
+        mDynamicIndex.clear();
     }
 
     template<typename T>
     const T *Store<T>::search(const std::string &id) const
     {
-        T item;
-        item.mId = Misc::StringUtils::lowerCase(id);
-
-        typename Dynamic::const_iterator dit = mDynamic.find(item.mId);
-        if (dit != mDynamic.end()) {
-            return &dit->second;
-        }
-
-        typename std::map<std::string, T>::const_iterator it = mStatic.find(item.mId);
-
-        if (it != mStatic.end() && Misc::StringUtils::ciEqual(it->second.mId, id)) {
-            return &(it->second);
-        }
+        return search(id.data(), id.size());
+    }
+    template<typename T>
+    const T *Store<T>::search(const char *id, size_t length) const
+    {
+        if (const T *record = mDynamicIndex.find(id, length))
+            return record;
 
-        return 0;
+        return mStaticIndex.find(id, length);
     }
     template<typename T>
     bool Store<T>::isDynamic(const std::string &id) const
     {
-        typename Dynamic::const_iterator dit = mDynamic.find(id);
-        return (dit != mDynamic.end());
+        return mDynamicIndex.find(id) != NULL;
     }
     template<typename T>
     const T *Store<T>::searchRandom(const std::string &id) const
@@ -190,11 +204,34 @@ namespace MWWorld
         bool isDeleted = false;
 
         record.load(esm, isDeleted);
+        return insertLoaded(record, isDeleted);
+    }
+    template<typename T>
+    StagedRecord *Store<T>::stage(ESM::ESMReader &esm)
+    {
+        StagedStoreRecord<T>* staged = new StagedStoreRecord<T>(*this);
+        try
+        {
+            staged->mRecord.load(esm, staged->mIsDeleted);
+        }
+        catch (...)
+        {
+            delete staged;
+            throw;
+        }
+        return staged;
+    }
+    template<typename T>
+    RecordId Store<T>::insertLoaded(T &record, bool isDeleted)
+    {
         Misc::StringUtils::toLower(record.mId);
 
         std::pair<typename Static::iterator, bool> inserted = mStatic.insert(std::make_pair(record.mId, record));
         if (inserted.second)
+        {
             mShared.push_back(&inserted.first->second);
+            mStaticIndex.insert(inserted.first->first, &inserted.first->second);
+        }
         else
             inserted.first->second = record;
 
@@ -245,6 +282,7 @@ namespace MWWorld
         T *ptr = &result.first->second;
         if (result.second) {
             mShared.push_back(ptr);
+            mDynamicIndex.insert(result.first->first, ptr);
         } else {
             *ptr = item;
         }
@@ -259,6 +297,7 @@ namespace MWWorld
         T *ptr = &result.first->second;
         if (result.second) {
             mShared.push_back(ptr);
+            mStaticIndex.insert(result.first->first, ptr);
         } else {
             *ptr = item;
         }
@@ -267,10 +306,9 @@ namespace MWWorld
     template<typename T>
     bool Store<T>::eraseStatic(const std::string &id)
     {
-        T item;
-        item.mId = Misc::StringUtils::lowerCase(id);
+        std::string idLower = Misc::StringUtils::lowerCase(id);
 
-        typename std::map<std::string, T>::iterator it = mStatic.find(item.mId);
+        typename std::map<std::string, T>::iterator it = mStatic.find(idLower);
 
         if (it != mStatic.end() && Misc::StringUtils::ciEqual(it->second.mId, id)) {
             // delete from the static part of mShared
@@ -278,12 +316,13 @@ namespace MWWorld
             typename std::vector<T *>::iterator end = sharedIter + mStatic.size();
 
             while (sharedIter != mShared.end() && sharedIter != end) {
-                if((*sharedIter)->mId == item.mId) {
+                if((*sharedIter)->mId == idLower) {
                     mShared.erase(sharedIter);
                     break;
                 }
                 ++sharedIter;
             }
+            mStaticIndex.erase(it->first);
             mStatic.erase(it);
         }
 
@@ -298,6 +337,7 @@ namespace MWWorld
         if (it == mDynamic.end()) {
             return false;
         }
+        mDynamicIndex.erase(it->first);
         mDynamic.erase(it);
 
         // have to reinit the whole shared part
@@ -410,6 +450,10 @@ namespace MWWorld
     
     // Land
     //=========================================================================
+    Store<ESM::Land>::Store()
+        : mGridMinX(0), mGridMinY(0), mGridWidth(0), mGridHeight(0)
+    {
+    }
     Store<ESM::Land>::~Store()
     {
         for (std::vector<ESM::Land *>::const_iterator it =
@@ -433,6 +477,13 @@ namespace MWWorld
     }
     ESM::Land *Store<ESM::Land>::search(int x, int y) const
     {
+        if (!mGrid.empty())
+        {
+            if (x < mGridMinX || y < mGridMinY || x >= mGridMinX + mGridWidth || y >= mGridMinY + mGridHeight)
+                return 0;
+            return mGrid[(y - mGridMinY) * mGridWidth + (x - mGridMinX)];
+        }
+
         ESM::Land land;
         land.mX = x, land.mY = y;
 
@@ -462,24 +513,54 @@ namespace MWWorld
         ptr->load(esm, isDeleted);
 
         // Same area defined in multiple plugins? -> last plugin wins
-        // Can't use search() because we aren't sorted yet - is there any other way to speed this up?
-        for (std::vector<ESM::Land*>::iterator it = mStatic.begin(); it != mStatic.end(); ++it)
+        std::pair<Index::iterator, bool> inserted =
+            mIndex.insert(std::make_pair(std::make_pair(ptr->mX, ptr->mY), mStatic.size()));
+        if (inserted.second)
+            mStatic.push_back(ptr);
+        else
         {
-            if ((*it)->mX == ptr->mX && (*it)->mY == ptr->mY)
-            {
-                delete *it;
-                mStatic.erase(it);
-                break;
-            }
+            delete mStatic[inserted.first->second];
+            mStatic[inserted.first->second] = ptr;
         }
 
-        mStatic.push_back(ptr);
+        // The grid is outdated until the next setUp()
+        mGrid.clear();
 
         return RecordId("", isDeleted);
     }
     void Store<ESM::Land>::setUp()
     {
         std::sort(mStatic.begin(), mStatic.end(), Compare());
+
+        mIndex.clear();
+        mGrid.clear();
+        if (mStatic.empty())
+            return;
+
+        int minX = mStatic.front()->mX;
+        int maxX = mStatic.back()->mX;
+        int minY = mStatic.front()->mY;
+        int maxY = minY;
+        for (size_t i=0; i<mStatic.size(); ++i)
+        {
+            mIndex.insert(std::make_pair(std::make_pair(mStatic[i]->mX, mStatic[i]->mY), i));
+            minY = std::min(minY, mStatic[i]->mY);
+            maxY = std::max(maxY, mStatic[i]->mY);
+        }
+
+        // A few stray records far away from the landmass would waste a lot of memory,
+        // use the binary search in that case
+        const double gridSize = (double(maxX) - minX + 1) * (double(maxY) - minY + 1);
+        if (gridSize > 16.0 * mStatic.size() + 65536.0)
+            return;
+
+        mGridMinX = minX;
+        mGridMinY = minY;
+        mGridWidth = maxX - minX + 1;
+        mGridHeight = maxY - minY + 1;
+        mGrid.assign(static_cast<size_t>(gridSize), static_cast<ESM::Land*>(0));
+        for (std::vector<ESM::Land *>::const_iterator it = mStatic.begin(); it != mStatic.end(); ++it)
+            mGrid[((*it)->mY - mGridMinY) * mGridWidth + ((*it)->mX - mGridMinX)] = *it;
     }
 
 
@@ -1036,6 +1117,13 @@ namespace MWWorld
         }
     }
 
+    template <>
+    StagedRecord *Store<ESM::Dialogue>::stage(ESM::ESMReader &esm)
+    {
+        // INFO records are added to the preceding dialogue, so dialogues must be loaded in sequence
+        return NULL;
+    }
+
     template <>
     inline RecordId Store<ESM::Dialogue>::load(ESM::ESMReader &esm) {
         // The original letter case of a dialogue ID is saved, because it's printed
@@ -1049,7 +1137,8 @@ namespace MWWorld
         if (found == mStatic.end())
         {
             dialogue.loadData(esm, isDeleted);
-            mStatic.insert(std::make_pair(idLower, dialogue));
+            found = mStatic.insert(std::make_pair(idLower, dialogue)).first;
+            mStaticIndex.insert(found->first, &found->second);
         }
         else
         {
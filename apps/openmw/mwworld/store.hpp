@@ -6,6 +6,7 @@
 #include <map>
 
 #include "recordcmp.hpp"
+#include "recordindex.hpp"
 
 namespace ESM
 {
@@ -27,6 +28,15 @@ namespace MWWorld
         RecordId(const std::string &id = "", bool isDeleted = false);
     };
 
+    /// A record that has been parsed from a content file, but not yet inserted into its store.
+    struct StagedRecord
+    {
+        virtual ~StagedRecord() {}
+
+        /// Insert the record into the store it was parsed for.
+        virtual RecordId insert() = 0;
+    };
+
     struct StoreBase
     {
         virtual ~StoreBase() {}
@@ -38,6 +48,11 @@ namespace MWWorld
         virtual int getDynamicSize() const { return 0; }
         virtual RecordId load(ESM::ESMReader &esm) = 0;
 
+        virtual StagedRecord* stage(ESM::ESMReader &esm) { return NULL; }
+        ///< Parse a record without inserting it, for loading content files in parallel.
+        /// Must not modify the store, as it may be called from a worker thread.
+        /// \return NULL without reading anything if records of this type must be loaded in sequence.
+
         virtual bool eraseStatic(const std::string &id) {return false;}
         virtual void clearDynamic() {}
 
@@ -144,10 +159,18 @@ namespace MWWorld
         typedef std::map<std::string, T> Dynamic;
         typedef std::map<std::string, T> Static;
 
+        // Hashed lookup into mStatic and mDynamic, keyed by the map keys
+        RecordIndex<T> mStaticIndex;
+        RecordIndex<T> mDynamicIndex;
+
         friend class ESMStore;
 
+        // Not implemented, the indices would point to the records of the assigned store
+        Store<T>& operator=(const Store<T>&);
+
     public:
         Store();
+        /// Copies the static records, and indexes the copies.
         Store(const Store<T> &orig);
 
         typedef SharedIterator<T> iterator;
@@ -158,6 +181,10 @@ namespace MWWorld
 
         const T *search(const std::string &id) const;
 
+        /// Search for a record without constructing a string.
+        /// @param id ID in any letter case, does not need to be null terminated.
+        const T *search(const char *id, size_t length) const;
+
         /**
          * Does the record with this ID come from the dynamic store?
          */
@@ -189,6 +216,11 @@ namespace MWWorld
         bool erase(const T &item);
 
         RecordId load(ESM::ESMReader &esm);
+        StagedRecord* stage(ESM::ESMReader &esm);
+
+        /// Insert a record that has been parsed from a content file.
+        RecordId insertLoaded(T &record, bool isDeleted);
+
         void write(ESM::ESMWriter& writer, Loading::Listener& progress) const;
         RecordId read(ESM::ESMReader& reader);
     };
@@ -225,9 +257,21 @@ namespace MWWorld
     {
         std::vector<ESM::Land *> mStatic;
 
+        // Position of each record in mStatic, so that later plugins can override records while loading
+        typedef std::map<std::pair<int, int>, size_t> Index;
+        Index mIndex;
+
+        // Records by cell coordinates, built by setUp(). Left empty if the landmass is too sparse.
+        std::vector<ESM::Land *> mGrid;
+        int mGridMinX;
+        int mGridMinY;
+        int mGridWidth;
+        int mGridHeight;
+
     public:
         typedef SharedIterator<ESM::Land> iterator;
 
+        Store();
         virtual ~Store();
 
         size_t getSize() const;
@@ -93,6 +93,13 @@ namespace MWWorld
             return mLoaders.insert(std::make_pair(extension, loader)).second;
         }
 
+        void prepare(const boost::filesystem::path& filepath, int index)
+        {
+            LoadersContainer::iterator it(mLoaders.find(Misc::StringUtils::lowerCase(filepath.extension().string())));
+            if (it != mLoaders.end())
+                it->second->prepare(filepath, index);
+        }
+
         void load(const boost::filesystem::path& filepath, int& index)
         {
             LoadersContainer::iterator it(mLoaders.find(Misc::StringUtils::lowerCase(filepath.extension().string())));
@@ -154,7 +161,7 @@ namespace MWWorld
         const std::vector<std::string>& contentFiles,
         ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
         int activationDistanceOverride, const std::string& startCell, const std::string& startupScript,
-            const std::string& resourcePath)
+            const std::string& resourcePath, const std::string& cachePath)
     : mResourceSystem(resourceSystem), mFallback(fallbackMap), mPlayer (0), mLocalScripts (mStore),
       mSky (true), mCells (mStore, mEsm),
       mGodMode(false), mScriptsEnabled(true), mContentFiles (contentFiles),
@@ -162,9 +169,9 @@ namespace MWWorld
       mStartCell (startCell), mTeleportEnabled(true),
       mLevitationEnabled(true), mGoToJail(false), mDaysInPrison(0)
     {
-        mPhysics = new MWPhysics::PhysicsSystem(resourceSystem, rootNode);
+        mPhysics = new MWPhysics::PhysicsSystem(resourceSystem, rootNode, cachePath);
         mProjectileManager.reset(new ProjectileManager(rootNode, resourceSystem, mPhysics));
-        mRendering = new MWRender::RenderingManager(viewer, rootNode, resourceSystem, &mFallback, resourcePath);
+        mRendering = new MWRender::RenderingManager(viewer, rootNode, resourceSystem, &mFallback, resourcePath, cachePath);
 
         mEsm.resize(contentFiles.size());
         Loading::Listener* listener = MWBase::Environment::get().getWindowManager()->getLoadingScreen();
@@ -311,6 +318,7 @@ namespace MWWorld
         }
 
         mCells.clear();
+        mResolvedPtrs.clear();
 
         mDoorStates.clear();
 
@@ -640,17 +648,40 @@ namespace MWWorld
 
         std::string lowerCaseName = Misc::StringUtils::lowerCase(name);
 
-        for (Scene::CellStoreCollection::const_iterator iter (mWorldScene->getActiveCells().begin());
-            iter!=mWorldScene->getActiveCells().end(); ++iter)
-        {
-            // TODO: caching still doesn't work efficiently here (only works for the one CellStore that the reference is in)
-            CellStore* cellstore = *iter;
-            Ptr ptr = mCells.getPtr (lowerCaseName, *cellstore, false);
+        const RefIdIndex& refIdIndex = mCells.getRefIdIndex();
 
-            if (!ptr.isEmpty())
+        std::map<std::string, ResolvedPtr>::const_iterator resolved = mResolvedPtrs.find (lowerCaseName);
+        if (resolved!=mResolvedPtrs.end() && resolved->second.mRevision==refIdIndex.getRevision())
+        {
+            // Check the revision first, the reference may not exist anymore otherwise
+            const Ptr& ptr = resolved->second.mPtr;
+            if (!ptr.getRefData().isDeletedByContentFile()
+                && (ptr.getCellRef().hasContentFile() || ptr.getRefData().getCount() > 0)
+                && mWorldScene->isCellActive (*ptr.getCell()))
                 return ptr;
         }
 
+        // Only the cells that have references with this ID need to be searched
+        if (const RefIdIndex::CellList *cells = refIdIndex.find (lowerCaseName))
+        {
+            for (RefIdIndex::CellList::const_iterator iter (cells->begin()); iter!=cells->end(); ++iter)
+            {
+                CellStore* cellstore = *iter;
+                if (!mWorldScene->isCellActive (*cellstore))
+                    continue;
+
+                Ptr ptr = mCells.getPtr (lowerCaseName, *cellstore, false);
+
+                if (!ptr.isEmpty())
+                {
+                    ResolvedPtr& entry = mResolvedPtrs[lowerCaseName];
+                    entry.mPtr = ptr;
+                    entry.mRevision = refIdIndex.getRevision();
+                    return ptr;
+                }
+            }
+        }
+
         if (!activeOnly)
         {
             ret = mCells.getPtr (lowerCaseName);
@@ -1075,6 +1106,9 @@ namespace MWWorld
         {
             ptr.getRefData().setCount(0);
 
+            if (ptr.isInCell())
+                ptr.getCell()->refRemoved (ptr);
+
             if (ptr.isInCell()
                 && mWorldScene->getActiveCells().find(ptr.getCell()) != mWorldScene->getActiveCells().end()
                 && ptr.getRefData().isEnabled())
@@ -1190,12 +1224,14 @@ namespace MWWorld
                     }
                 }
                 ptr.getRefData().setCount(0);
+                currCell->refRemoved (ptr);
             }
         }
         if (haveToMove && newPtr.getRefData().getBaseNode())
         {
             mRendering->moveObject(newPtr, vec);
             mPhysics->updatePosition(newPtr);
+            MWBase::Environment::get().getMechanicsManager()->updatePosition(newPtr);
         }
         if (isPlayer)
         {
@@ -1553,6 +1589,11 @@ namespace MWWorld
         updatePlayer(paused);
     }
 
+    void World::reportStats (unsigned int frameNumber, osg::Stats* stats)
+    {
+        mPhysics->reportStats(frameNumber, stats);
+    }
+
     void World::updatePlayer(bool paused)
     {
         MWWorld::Ptr player = getPlayerPtr();
@@ -2540,15 +2581,16 @@ namespace MWWorld
     void World::loadContentFiles(const Files::Collections& fileCollections,
         const std::vector<std::string>& content, ContentLoader& contentLoader)
     {
+        std::vector<boost::filesystem::path> paths;
         std::vector<std::string>::const_iterator it(content.begin());
         std::vector<std::string>::const_iterator end(content.end());
-        for (int idx = 0; it != end; ++it, ++idx)
+        for (; it != end; ++it)
         {
             boost::filesystem::path filename(*it);
             const Files::MultiDirCollection& col = fileCollections.getCollection(filename.extension().string());
             if (col.doesExist(*it))
             {
-                contentLoader.load(col.getPath(*it), idx);
+                paths.push_back(col.getPath(*it));
             }
             else
             {
@@ -2557,6 +2599,12 @@ namespace MWWorld
                 throw std::runtime_error(msg.str());
             }
         }
+
+        for (int idx = 0; idx < int(paths.size()); ++idx)
+            contentLoader.prepare(paths[idx], idx);
+
+        for (int idx = 0; idx < int(paths.size()); ++idx)
+            contentLoader.load(paths[idx], idx);
     }
 
     bool World::startSpellCast(const Ptr &actor)
@@ -113,6 +113,16 @@ namespace MWWorld
             std::map<MWWorld::Ptr, int> mDoorStates;
             ///< only holds doors that are currently moving. 1 = opening, 2 = closing
 
+            struct ResolvedPtr
+            {
+                Ptr mPtr;
+                unsigned int mRevision;
+            };
+
+            std::map<std::string, ResolvedPtr> mResolvedPtrs;
+            ///< References in active cells found by searchPtr, valid as long as the revision of the
+            /// reference ID index does not change.
+
             std::string mStartCell;
 
             void updateWeather(float duration, bool paused = false);
@@ -176,7 +186,8 @@ namespace MWWorld
                 const Files::Collections& fileCollections,
                 const std::vector<std::string>& contentFiles,
                 ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
-                int activationDistanceOverride, const std::string& startCell, const std::string& startupScript, const std::string& resourcePath);
+                int activationDistanceOverride, const std::string& startCell, const std::string& startupScript, const std::string& resourcePath,
+                const std::string& cachePath);
 
             virtual ~World();
 
@@ -442,6 +453,8 @@ namespace MWWorld
 
             virtual void update (float duration, bool paused);
 
+            virtual void reportStats (unsigned int frameNumber, osg::Stats* stats);
+
             virtual MWWorld::Ptr placeObject (const MWWorld::Ptr& object, float cursorX, float cursorY, int amount);
             ///< copy and place an object into the gameworld at the specified cursor position
             /// @param object
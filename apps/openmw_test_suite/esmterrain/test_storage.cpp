@@ -0,0 +1,419 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include <osg/Image>
+#include <osg/Timer>
+
+#include "components/esmterrain/storage.hpp"
+#include "components/vfs/manager.hpp"
+
+namespace
+{
+
+const int gridSize = 4;
+
+// Random land on a grid of cells, with some cells missing and some without normals or colours
+class TestStorage : public ESMTerrain::Storage
+{
+public:
+    TestStorage(const VFS::Manager* vfs)
+        : ESMTerrain::Storage(vfs)
+    {
+        std::srand(1);
+        for (int x=0; x<gridSize; ++x)
+        {
+            for (int y=0; y<gridSize; ++y)
+            {
+                if (x == 3 && y == 1)
+                    continue;
+
+                int flags = ESM::Land::DATA_VHGT | ESM::Land::DATA_VTEX;
+                if (!(x == 2 && y == 0))
+                    flags |= ESM::Land::DATA_VNML;
+                if (!(x == 0 && y == 2))
+                    flags |= ESM::Land::DATA_VCLR;
+
+                ESM::Land& land = mLands[std::make_pair(x, y)];
+                land.mX = x;
+                land.mY = y;
+                land.add(flags);
+                ESM::Land::LandData* data = land.getLandData();
+                for (int i=0; i<ESM::Land::LAND_NUM_VERTS; ++i)
+                {
+                    data->mHeights[i] = static_cast<float>(std::rand() % 2000 - 1000);
+                    data->mNormals[i*3] = static_cast<signed char>(std::rand() % 60 - 30);
+                    data->mNormals[i*3+1] = static_cast<signed char>(std::rand() % 60 - 30);
+                    data->mNormals[i*3+2] = static_cast<signed char>(std::rand() % 60 + 20);
+                    for (int channel=0; channel<3; ++channel)
+                        data->mColours[i*3+channel] = static_cast<unsigned char>(std::rand() % 256);
+                }
+                for (int i=0; i<ESM::Land::LAND_NUM_TEXTURES; ++i)
+                    data->mTextures[i] = static_cast<unsigned short>((std::rand() % 3) ? 0 : std::rand() % 6 + 1);
+            }
+        }
+    }
+
+    const ESM::Land::LandData* getData(int cellX, int cellY, int flags) const
+    {
+        std::map<std::pair<int, int>, ESM::Land>::const_iterator found = mLands.find(std::make_pair(cellX, cellY));
+        if (found == mLands.end())
+            return NULL;
+        return found->second.getLandData(flags);
+    }
+
+    void setTexture(int cellX, int cellY, int index, unsigned short texture)
+    {
+        mLands[std::make_pair(cellX, cellY)].getLandData()->mTextures[index] = texture;
+    }
+
+private:
+    virtual const ESM::Land* getLand(int cellX, int cellY)
+    {
+        std::map<std::pair<int, int>, ESM::Land>::const_iterator found = mLands.find(std::make_pair(cellX, cellY));
+        if (found == mLands.end())
+            return NULL;
+        return &found->second;
+    }
+
+    virtual const ESM::LandTexture* getLandTexture(int index, short plugin)
+    {
+        std::map<int, ESM::LandTexture>::iterator found = mLandTextures.find(index);
+        if (found == mLandTextures.end())
+        {
+            ESM::LandTexture& ltex = mLandTextures[index];
+            ltex.mIndex = index;
+            ltex.mTexture = std::string(1, static_cast<char>('a' + index)) + ".dds";
+            return &ltex;
+        }
+        return &found->second;
+    }
+
+    virtual void getBounds(float& minX, float& maxX, float& minY, float& maxY)
+    {
+        minX = minY = 0;
+        maxX = maxY = gridSize;
+    }
+
+    std::map<std::pair<int, int>, ESM::Land> mLands;
+    std::map<int, ESM::LandTexture> mLandTextures;
+};
+
+struct Vertices
+{
+    Vertices()
+        : mPositions(new osg::Vec3Array)
+        , mNormals(new osg::Vec3Array)
+        , mColours(new osg::Vec4Array)
+    {
+    }
+
+    void fill(ESMTerrain::Storage& storage, int lodLevel, float size, const osg::Vec2f& center)
+    {
+        storage.fillVertexBuffers(lodLevel, size, center, mPositions, mNormals, mColours);
+    }
+
+    osg::ref_ptr<osg::Vec3Array> mPositions;
+    osg::ref_ptr<osg::Vec3Array> mNormals;
+    osg::ref_ptr<osg::Vec4Array> mColours;
+};
+
+void expectNear(const osg::Vec3f& expected, const osg::Vec3f& actual)
+{
+    EXPECT_NEAR(expected.x(), actual.x(), 1e-5f);
+    EXPECT_NEAR(expected.y(), actual.y(), 1e-5f);
+    EXPECT_NEAR(expected.z(), actual.z(), 1e-5f);
+}
+
+}
+
+TEST(ESMTerrainStorageTest, vertices_of_a_cell)
+{
+    VFS::Manager vfs (false);
+    TestStorage storage (&vfs);
+
+    Vertices vertices;
+    vertices.fill(storage, 0, 1.f, osg::Vec2f(1.5f, 0.5f));
+
+    const int numVerts = ESM::Land::LAND_SIZE;
+    ASSERT_EQ(static_cast<unsigned int>(numVerts*numVerts), vertices.mPositions->size());
+    ASSERT_EQ(vertices.mPositions->size(), vertices.mNormals->size());
+    ASSERT_EQ(vertices.mPositions->size(), vertices.mColours->size());
+
+    const ESM::Land::LandData* data = storage.getData(1, 0, ESM::Land::DATA_VHGT);
+    // Takes the east edge from the cell (2,0), which has no normals
+    const ESM::Land::LandData* east = storage.getData(2, 0, ESM::Land::DATA_VCLR);
+    // Takes the north edge from the cell (1,1)
+    const ESM::Land::LandData* north = storage.getData(1, 1, ESM::Land::DATA_VNML);
+
+    for (int y=0; y<numVerts; ++y)
+    {
+        for (int x=0; x<numVerts; ++x)
+        {
+            const int index = x*numVerts + y;
+            const osg::Vec3f& position = (*vertices.mPositions)[index];
+            EXPECT_FLOAT_EQ((x / float(numVerts-1) - 0.5f) * 8192, position.x());
+            EXPECT_FLOAT_EQ((y / float(numVerts-1) - 0.5f) * 8192, position.y());
+            EXPECT_EQ(data->mHeights[y*numVerts + x], position.z());
+
+            // Corners are averaged from their neighbours
+            const bool corner = (x == 0 || x == numVerts-1) && (y == 0 || y == numVerts-1);
+            if (corner)
+                continue;
+
+            const osg::Vec3f& normal = (*vertices.mNormals)[index];
+            const osg::Vec4f& colour = (*vertices.mColours)[index];
+            const ESM::Land::LandData* source = data;
+            int sourceIndex = (y*numVerts + x) * 3;
+            if (x == numVerts-1)
+            {
+                source = east;
+                sourceIndex = y*numVerts*3;
+            }
+            else if (y == numVerts-1)
+            {
+                source = north;
+                sourceIndex = x*3;
+            }
+
+            if (x == numVerts-1)
+                expectNear(osg::Vec3f(0,0,1), normal);
+            else
+            {
+                osg::Vec3f expected (source->mNormals[sourceIndex], source->mNormals[sourceIndex+1], source->mNormals[sourceIndex+2]);
+                expected.normalize();
+                expectNear(expected, normal);
+            }
+
+            EXPECT_FLOAT_EQ(source->mColours[sourceIndex] / 255.f, colour.r());
+            EXPECT_FLOAT_EQ(source->mColours[sourceIndex+1] / 255.f, colour.g());
+            EXPECT_FLOAT_EQ(source->mColours[sourceIndex+2] / 255.f, colour.b());
+            EXPECT_EQ(1.f, colour.a());
+        }
+    }
+}
+
+TEST(ESMTerrainStorageTest, missing_land)
+{
+    VFS::Manager vfs (false);
+    TestStorage storage (&vfs);
+
+    Vertices vertices;
+    vertices.fill(storage, 2, 1.f, osg::Vec2f(3.5f, 1.5f));
+
+    for (unsigned int i=0; i<vertices.mPositions->size(); ++i)
+    {
+        EXPECT_EQ(-2048.f, (*vertices.mPositions)[i].z());
+        EXPECT_GT((*vertices.mNormals)[i].z(), 0.f);
+    }
+    // Not on an edge
+    expectNear(osg::Vec3f(0,0,1), (*vertices.mNormals)[5*17 + 5]);
+    EXPECT_EQ(osg::Vec4f(1,1,1,1), (*vertices.mColours)[5*17 + 5]);
+}
+
+TEST(ESMTerrainStorageTest, chunks_match_the_cells_they_cover)
+{
+    VFS::Manager vfs (false);
+    TestStorage storage (&vfs);
+
+    for (int lodLevel=0; lodLevel<3; ++lodLevel)
+    {
+        Vertices cells[2][2];
+        for (int cellX=0; cellX<2; ++cellX)
+            for (int cellY=0; cellY<2; ++cellY)
+                cells[cellX][cellY].fill(storage, lodLevel, 1.f, osg::Vec2f(cellX + 0.5f, cellY + 0.5f));
+        const int cellVerts = (ESM::Land::LAND_SIZE-1) / (1 << lodLevel) + 1;
+
+        // A chunk of four cells
+        Vertices chunk;
+        chunk.fill(storage, lodLevel, 2.f, osg::Vec2f(1.f, 1.f));
+        const int chunkVerts = 2*(cellVerts-1) + 1;
+        ASSERT_EQ(static_cast<unsigned int>(chunkVerts*chunkVerts), chunk.mPositions->size());
+        for (int x=0; x<chunkVerts; ++x)
+        {
+            for (int y=0; y<chunkVerts; ++y)
+            {
+                // The shared edge is taken from the first cell
+                int cellX = x > cellVerts-1 ? 1 : 0;
+                int cellY = y > cellVerts-1 ? 1 : 0;
+                int index = (x - cellX*(cellVerts-1)) * cellVerts + (y - cellY*(cellVerts-1));
+                const Vertices& cell = cells[cellX][cellY];
+                ASSERT_EQ((*cell.mPositions)[index].z(), (*chunk.mPositions)[x*chunkVerts + y].z());
+                ASSERT_EQ((*cell.mNormals)[index], (*chunk.mNormals)[x*chunkVerts + y]);
+                ASSERT_EQ((*cell.mColours)[index], (*chunk.mColours)[x*chunkVerts + y]);
+            }
+        }
+
+        // A quarter of a cell
+        Vertices quarter;
+        quarter.fill(storage, lodLevel, 0.25f, osg::Vec2f(0.625f, 0.875f));
+        const int quarterVerts = (cellVerts-1) / 4 + 1;
+        ASSERT_EQ(static_cast<unsigned int>(quarterVerts*quarterVerts), quarter.mPositions->size());
+        for (int x=0; x<quarterVerts; ++x)
+        {
+            for (int y=0; y<quarterVerts; ++y)
+            {
+                int index = (x + (cellVerts-1)/2) * cellVerts + y + 3*(cellVerts-1)/4;
+                const Vertices& cell = cells[0][0];
+                ASSERT_EQ((*cell.mPositions)[index].z(), (*quarter.mPositions)[x*quarterVerts + y].z());
+                ASSERT_EQ((*cell.mNormals)[index], (*quarter.mNormals)[x*quarterVerts + y]);
+                ASSERT_EQ((*cell.mColours)[index], (*quarter.mColours)[x*quarterVerts + y]);
+            }
+        }
+    }
+}
+
+TEST(ESMTerrainStorageTest, chunks_end_at_the_last_vertex_of_their_cells)
+{
+    VFS::Manager vfs (false);
+    TestStorage storage (&vfs);
+
+    // Down to one vertex every 16 rows / columns, as the QuadTreeWorld uses for chunks of four cells
+    for (int lodLevel=0; lodLevel<5; ++lodLevel)
+    {
+        Vertices chunk;
+        chunk.fill(storage, lodLevel, 4.f, osg::Vec2f(2.f, 2.f));
+        const int cellVerts = (ESM::Land::LAND_SIZE-1) / (1 << lodLevel) + 1;
+        const int chunkVerts = 4*(cellVerts-1) + 1;
+        ASSERT_EQ(static_cast<unsigned int>(chunkVerts*chunkVerts), chunk.mPositions->size());
+
+        // The far corner of each cell is its last vertex, rather than one past it
+        for (int cellX=0; cellX<4; ++cellX)
+        {
+            for (int cellY=0; cellY<4; ++cellY)
+            {
+                const int x = (cellX+1) * (cellVerts-1);
+                const int y = (cellY+1) * (cellVerts-1);
+                const ESM::Land::LandData* data = storage.getData(cellX, cellY, ESM::Land::DATA_VHGT);
+                const float height = data ? data->mHeights[ESM::Land::LAND_NUM_VERTS-1] : -2048.f;
+                EXPECT_EQ(height, (*chunk.mPositions)[x*chunkVerts + y].z());
+            }
+        }
+    }
+}
+
+TEST(ESMTerrainStorageTest, blendmaps)
+{
+    VFS::Manager vfs (false);
+    TestStorage storage (&vfs);
+
+    Terrain::Storage::ImageVector blendmaps;
+    std::vector<Terrain::LayerInfo> layers;
+    storage.getBlendmaps(1.f, osg::Vec2f(1.5f, 1.5f), false, blendmaps, layers);
+
+    ASSERT_GT(layers.size(), 1u);
+    ASSERT_EQ(layers.size() - 1, blendmaps.size());
+    EXPECT_EQ("textures\\_land_default.dds", layers[0].mDiffuseMap);
+
+    // The texture of a blendmap texel is at one texel to the west in the land data, see getVtexIndexAt
+    const ESM::Land::LandData* data = storage.getData(1, 1, ESM::Land::DATA_VTEX);
+    const int size = ESM::Land::LAND_TEXTURE_SIZE+1;
+    for (int y=0; y<size-1; ++y)
+    {
+        for (int x=1; x<size; ++x)
+        {
+            int texture = data->mTextures[y*ESM::Land::LAND_TEXTURE_SIZE + x-1];
+            std::string name = texture == 0 ? "textures\\_land_default.dds" : std::string(1, static_cast<char>('a' + texture-1)) + ".dds";
+            for (unsigned int layer=0; layer<layers.size(); ++layer)
+            {
+                bool selected = layers[layer].mDiffuseMap.find(name) != std::string::npos;
+                if (layer > 0)
+                    EXPECT_EQ(selected ? 255 : 0, *blendmaps[layer-1]->data(x, y));
+                else if (selected)
+                    EXPECT_EQ(0, texture);
+            }
+        }
+    }
+
+    // Packing puts four layers in one blendmap
+    Terrain::Storage::ImageVector packed;
+    std::vector<Terrain::LayerInfo> packedLayers;
+    storage.getBlendmaps(1.f, osg::Vec2f(1.5f, 1.5f), true, packed, packedLayers);
+    ASSERT_EQ(layers.size(), packedLayers.size());
+    ASSERT_EQ((blendmaps.size() + 3) / 4, packed.size());
+    for (unsigned int i=0; i<blendmaps.size(); ++i)
+    {
+        for (int y=0; y<size; ++y)
+            for (int x=0; x<size; ++x)
+                ASSERT_EQ(*blendmaps[i]->data(x, y), packed[i/4]->data(x, y)[i%4]);
+    }
+}
+
+TEST(ESMTerrainStorageTest, blendmaps_follow_changed_land_after_clearing_the_cache)
+{
+    VFS::Manager vfs (false);
+    TestStorage storage (&vfs);
+
+    // A texture that no cell uses, in the texel that the blendmap texel (1,0) of the cell (1,1) is taken from
+    storage.setTexture(1, 1, 0, 9);
+
+    Terrain::Storage::ImageVector blendmaps;
+    std::vector<Terrain::LayerInfo> layers;
+    storage.getBlendmaps(1.f, osg::Vec2f(1.5f, 1.5f), false, blendmaps, layers);
+    ASSERT_EQ("textures\\i.dds", layers.back().mDiffuseMap);
+    const size_t numLayers = layers.size();
+
+    // The texture ids of the cell are kept
+    storage.setTexture(1, 1, 0, 0);
+    blendmaps.clear();
+    layers.clear();
+    storage.getBlendmaps(1.f, osg::Vec2f(1.5f, 1.5f), false, blendmaps, layers);
+    EXPECT_EQ(numLayers, layers.size());
+
+    storage.clearCache();
+    blendmaps.clear();
+    layers.clear();
+    storage.getBlendmaps(1.f, osg::Vec2f(1.5f, 1.5f), false, blendmaps, layers);
+    EXPECT_EQ(numLayers - 1, layers.size());
+    for (unsigned int i=0; i<layers.size(); ++i)
+        EXPECT_NE("textures\\i.dds", layers[i].mDiffuseMap);
+}
+
+/// Measure the chunks per second of the vertex and blendmap generation over the whole test grid
+TEST(ESMTerrainStorageTest, DISABLED_chunk_benchmark)
+{
+    VFS::Manager vfs (false);
+    TestStorage storage (&vfs);
+
+    const unsigned int numIterations = 20;
+    const float chunkSize = 0.25f;
+
+    Vertices vertices;
+    unsigned int numChunks = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for (unsigned int i=0; i<numIterations; ++i)
+    {
+        for (float x=chunkSize/2; x<gridSize; x+=chunkSize)
+        {
+            for (float y=chunkSize/2; y<gridSize; y+=chunkSize)
+            {
+                vertices.fill(storage, 0, chunkSize, osg::Vec2f(x, y));
+                ++numChunks;
+            }
+        }
+    }
+    double vertexSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    unsigned int numBlendmapChunks = 0;
+    start = osg::Timer::instance()->tick();
+    for (unsigned int i=0; i<numIterations; ++i)
+    {
+        for (float x=0.5f; x<gridSize; x+=1.f)
+        {
+            for (float y=0.5f; y<gridSize; y+=1.f)
+            {
+                Terrain::Storage::ImageVector blendmaps;
+                std::vector<Terrain::LayerInfo> layers;
+                storage.getBlendmaps(1.f, osg::Vec2f(x, y), true, blendmaps, layers);
+                ++numBlendmapChunks;
+            }
+        }
+    }
+    double blendmapSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    std::cout << gridSize << "x" << gridSize << " cells, " << numIterations << " iterations: "
+              << "fillVertexBuffers " << numChunks / vertexSeconds << " chunks/s (quarter cells, lod 0), "
+              << "getBlendmaps " << numBlendmapChunks / blendmapSeconds << " chunks/s (cells, packed)" << std::endl;
+}
@@ -0,0 +1,297 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include <osg/Timer>
+
+#include "components/interpreter/interpreter.hpp"
+#include "components/interpreter/installopcodes.hpp"
+#include "components/interpreter/context.hpp"
+#include "components/compiler/generator.hpp"
+#include "components/compiler/literals.hpp"
+#include "components/compiler/locals.hpp"
+#include "components/compiler/output.hpp"
+
+namespace
+{
+
+typedef Compiler::Generator::CodeContainer Codes;
+
+/// Local variables only, everything else is a no-op
+class TestContext : public Interpreter::Context
+{
+public:
+    TestContext()
+        : mShorts(4, 0), mLongs(4, 0), mFloats(4, 0.f)
+    {
+    }
+
+    virtual int getLocalShort (int index) const { return mShorts.at(index); }
+    virtual int getLocalLong (int index) const { return mLongs.at(index); }
+    virtual float getLocalFloat (int index) const { return mFloats.at(index); }
+    virtual void setLocalShort (int index, int value) { mShorts.at(index) = value; }
+    virtual void setLocalLong (int index, int value) { mLongs.at(index) = value; }
+    virtual void setLocalFloat (int index, float value) { mFloats.at(index) = value; }
+
+    virtual void messageBox (const std::string& message, const std::vector<std::string>& buttons) {}
+    virtual void report (const std::string& message) {}
+    virtual bool menuMode() { return false; }
+    virtual int getGlobalShort (const std::string& name) const { return 0; }
+    virtual int getGlobalLong (const std::string& name) const { return 0; }
+    virtual float getGlobalFloat (const std::string& name) const { return 0; }
+    virtual void setGlobalShort (const std::string& name, int value) {}
+    virtual void setGlobalLong (const std::string& name, int value) {}
+    virtual void setGlobalFloat (const std::string& name, float value) {}
+    virtual std::vector<std::string> getGlobals () const { return std::vector<std::string>(); }
+    virtual char getGlobalType (const std::string& name) const { return ' '; }
+    virtual std::string getActionBinding(const std::string& action) const { return std::string(); }
+    virtual std::string getNPCName() const { return std::string(); }
+    virtual std::string getNPCRace() const { return std::string(); }
+    virtual std::string getNPCClass() const { return std::string(); }
+    virtual std::string getNPCFaction() const { return std::string(); }
+    virtual std::string getNPCRank() const { return std::string(); }
+    virtual std::string getPCName() const { return std::string(); }
+    virtual std::string getPCRace() const { return std::string(); }
+    virtual std::string getPCClass() const { return std::string(); }
+    virtual std::string getPCRank() const { return std::string(); }
+    virtual std::string getPCNextRank() const { return std::string(); }
+    virtual int getPCBounty() const { return 0; }
+    virtual std::string getCurrentCellName() const { return std::string(); }
+    virtual bool isScriptRunning (const std::string& name) const { return false; }
+    virtual void startScript (const std::string& name, const std::string& targetId) {}
+    virtual void stopScript (const std::string& name) {}
+    virtual float getDistance (const std::string& name, const std::string& id) const { return 0; }
+    virtual float getSecondsPassed() const { return 0; }
+    virtual bool isDisabled (const std::string& id) const { return false; }
+    virtual void enable (const std::string& id) {}
+    virtual void disable (const std::string& id) {}
+    virtual int getMemberShort (const std::string& id, const std::string& name, bool global) const { return 0; }
+    virtual int getMemberLong (const std::string& id, const std::string& name, bool global) const { return 0; }
+    virtual float getMemberFloat (const std::string& id, const std::string& name, bool global) const { return 0; }
+    virtual void setMemberShort (const std::string& id, const std::string& name, int value, bool global) {}
+    virtual void setMemberLong (const std::string& id, const std::string& name, int value, bool global) {}
+    virtual void setMemberFloat (const std::string& id, const std::string& name, float value, bool global) {}
+    virtual std::string getTargetId() const { return std::string(); }
+
+    std::vector<int> mShorts;
+    std::vector<int> mLongs;
+    std::vector<float> mFloats;
+};
+
+/// A script made of "while (long 0 < iterations) <block> endwhile", with the number of instructions it executes
+struct LoopScript
+{
+    std::vector<Interpreter::Type_Code> mCode;
+    unsigned int mExecuted;
+};
+
+/// @param block Code that increments long 0, in addition to any other work
+LoopScript makeLoopScript (Compiler::Output& output, int iterations, const Codes& block)
+{
+    Codes condition;
+    Compiler::Generator::fetchLocal (condition, 'l', 0);
+    Compiler::Generator::pushInt (condition, output.getLiterals(), iterations);
+    Compiler::Generator::compare (condition, 'l', 'l', 'l');
+
+    // Same layout as generated by Compiler::ControlParser
+    Codes loop;
+    Compiler::Generator::jump (loop, -static_cast<int> (block.size()+condition.size()));
+    Codes skip;
+    Compiler::Generator::jumpOnZero (skip, block.size()+loop.size()+1);
+    Codes loop2;
+    Compiler::Generator::jump (loop2, -static_cast<int> (block.size()+condition.size()+skip.size()));
+
+    Codes& code = output.getCode();
+    code.insert (code.end(), condition.begin(), condition.end());
+    code.insert (code.end(), skip.begin(), skip.end());
+    code.insert (code.end(), block.begin(), block.end());
+    code.insert (code.end(), loop2.begin(), loop2.end());
+
+    LoopScript script;
+    output.getCode (script.mCode);
+    script.mExecuted = iterations * (condition.size()+skip.size()+block.size()+loop2.size())
+        + condition.size() + skip.size();
+    return script;
+}
+
+void appendIncrement (Compiler::Output& output, Codes& block, int index)
+{
+    Codes value;
+    Compiler::Generator::fetchLocal (value, 'l', index);
+    Compiler::Generator::pushInt (value, output.getLiterals(), 1);
+    Compiler::Generator::add (value, 'l', 'l');
+    Compiler::Generator::assignToLocal (block, 'l', index, value, 'l');
+}
+
+/// long 0 += 1
+LoopScript makeCounterScript (int iterations)
+{
+    Compiler::Locals locals;
+    Compiler::Output output (locals);
+    Codes block;
+    appendIncrement (output, block, 0);
+    return makeLoopScript (output, iterations, block);
+}
+
+/// float 0 = float 0 * 0.5 + 1, long 0 += 1
+LoopScript makeFloatScript (int iterations)
+{
+    Compiler::Locals locals;
+    Compiler::Output output (locals);
+    Codes block;
+    Codes value;
+    Compiler::Generator::fetchLocal (value, 'f', 0);
+    Compiler::Generator::pushFloat (value, output.getLiterals(), 0.5f);
+    Compiler::Generator::mul (value, 'f', 'f');
+    Compiler::Generator::pushFloat (value, output.getLiterals(), 1.f);
+    Compiler::Generator::add (value, 'f', 'f');
+    Compiler::Generator::assignToLocal (block, 'f', 0, value, 'f');
+    appendIncrement (output, block, 0);
+    return makeLoopScript (output, iterations, block);
+}
+
+/// long 1 = long 1 + long 0 * 3, short 0 = long 1, float 1 = long 1, long 0 += 1
+LoopScript makeMixedScript (int iterations)
+{
+    Compiler::Locals locals;
+    Compiler::Output output (locals);
+    Codes block;
+    Codes value;
+    Compiler::Generator::fetchLocal (value, 'l', 1);
+    Compiler::Generator::fetchLocal (value, 'l', 0);
+    Compiler::Generator::pushInt (value, output.getLiterals(), 3);
+    Compiler::Generator::mul (value, 'l', 'l');
+    Compiler::Generator::add (value, 'l', 'l');
+    Compiler::Generator::assignToLocal (block, 'l', 1, value, 'l');
+    Codes fetch;
+    Compiler::Generator::fetchLocal (fetch, 'l', 1);
+    Compiler::Generator::assignToLocal (block, 's', 0, fetch, 'l');
+    Compiler::Generator::assignToLocal (block, 'f', 1, fetch, 'l');
+    appendIncrement (output, block, 0);
+    return makeLoopScript (output, iterations, block);
+}
+
+/// Wrap instructions in a script without literals
+std::vector<Interpreter::Type_Code> makeScript (const Codes& instructions)
+{
+    Compiler::Locals locals;
+    Compiler::Output output (locals);
+    output.getCode() = instructions;
+    std::vector<Interpreter::Type_Code> code;
+    output.getCode (code);
+    return code;
+}
+
+}
+
+struct InterpreterTest : public ::testing::Test
+{
+protected:
+    InterpreterTest()
+    {
+        Interpreter::installOpcodes (mInterpreter);
+    }
+
+    void run (const LoopScript& script)
+    {
+        mInterpreter.run (&script.mCode[0], script.mCode.size(), mContext);
+    }
+
+    Interpreter::Interpreter mInterpreter;
+    TestContext mContext;
+};
+
+TEST_F(InterpreterTest, loops)
+{
+    run (makeCounterScript (1000));
+    ASSERT_EQ(1000, mContext.mLongs[0]);
+
+    mContext = TestContext();
+    run (makeFloatScript (100));
+    ASSERT_EQ(100, mContext.mLongs[0]);
+    ASSERT_FLOAT_EQ(2.f, mContext.mFloats[0]);
+
+    mContext = TestContext();
+    run (makeMixedScript (10));
+    ASSERT_EQ(135, mContext.mLongs[1]);
+    ASSERT_EQ(135, mContext.mShorts[0]);
+    ASSERT_FLOAT_EQ(135.f, mContext.mFloats[1]);
+}
+
+TEST_F(InterpreterTest, reuse_program)
+{
+    LoopScript script = makeCounterScript (10);
+    Interpreter::Program program;
+    ASSERT_FALSE(program.isDecoded());
+
+    for (int i=0; i<3; ++i)
+        mInterpreter.run (&script.mCode[0], script.mCode.size(), program, mContext);
+
+    ASSERT_TRUE(program.isDecoded());
+    // The locals are not reset between runs, so only the first run loops
+    ASSERT_EQ(10, mContext.mLongs[0]);
+}
+
+TEST_F(InterpreterTest, unknown_opcode_reported_when_executed)
+{
+    Codes unknown;
+    unknown.push_back (Compiler::Generator::segment5 (0x3ffffff));
+
+    Codes skipped;
+    skipped.push_back (Compiler::Generator::segment5 (20)); // return
+    skipped.insert (skipped.end(), unknown.begin(), unknown.end());
+
+    std::vector<Interpreter::Type_Code> code = makeScript (skipped);
+    mInterpreter.run (&code[0], code.size(), mContext);
+
+    code = makeScript (unknown);
+    ASSERT_THROW(mInterpreter.run (&code[0], code.size(), mContext), std::runtime_error);
+
+    code = makeScript (Codes (1, 0xfc000000));
+    ASSERT_THROW(mInterpreter.run (&code[0], code.size(), mContext), std::runtime_error);
+}
+
+/// Run a corpus of short scripts, as local scripts are run once per frame, and measure the instructions per second
+TEST_F(InterpreterTest, DISABLED_script_corpus_benchmark)
+{
+    std::vector<LoopScript> corpus;
+    for (int iterations=1; iterations<=20; iterations+=3)
+    {
+        corpus.push_back (makeCounterScript (iterations));
+        corpus.push_back (makeFloatScript (iterations));
+        corpus.push_back (makeMixedScript (iterations));
+    }
+
+    const unsigned int runs = 2000;
+
+    std::vector<Interpreter::Program> programs (corpus.size());
+
+    double seconds[2] = { 0, 0 };
+    unsigned int executed = 0;
+
+    for (unsigned int i=0; i<runs; ++i)
+    {
+        for (int decodeOnce=0; decodeOnce<2; ++decodeOnce)
+        {
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            for (unsigned int j=0; j<corpus.size(); ++j)
+            {
+                mContext = TestContext();
+                if (decodeOnce)
+                    mInterpreter.run (&corpus[j].mCode[0], corpus[j].mCode.size(), programs[j], mContext);
+                else
+                    mInterpreter.run (&corpus[j].mCode[0], corpus[j].mCode.size(), mContext);
+            }
+            seconds[decodeOnce] += osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+        }
+
+        for (unsigned int j=0; j<corpus.size(); ++j)
+            executed += corpus[j].mExecuted;
+    }
+
+    std::cout << corpus.size() << " scripts, " << runs << " runs, " << executed << " instructions" << std::endl;
+    std::cout << "decoded on every run: " << executed / seconds[0] << " instructions/s" << std::endl;
+    std::cout << "decoded once: " << executed / seconds[1] << " instructions/s" << std::endl;
+}
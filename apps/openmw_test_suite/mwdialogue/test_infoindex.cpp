@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <sstream>
+
+#include <osg/Timer>
+
+#include <components/esm/loaddial.hpp>
+#include <components/misc/stringops.hpp>
+
+#include "apps/openmw/mwdialogue/infoindex.hpp"
+
+namespace
+{
+
+std::string makeId(const char* prefix, unsigned int i)
+{
+    std::ostringstream stream;
+    stream << prefix << i;
+    return stream.str();
+}
+
+/// A dialogue with infos for specific actors, races, classes, factions and cells, mixed in letter case
+ESM::Dialogue makeDialogue(unsigned int numInfos, unsigned int seed)
+{
+    ESM::Dialogue dialogue;
+    dialogue.mType = ESM::Dialogue::Topic;
+    for (unsigned int i=0; i<numInfos; ++i)
+    {
+        unsigned int n = i * 7 + seed;
+        ESM::DialInfo info;
+        info.blank();
+        if (n % 3 == 0)
+            info.mActor = makeId(n % 2 ? "NPC_" : "npc_", n % 50);
+        if (n % 5 == 1)
+            info.mRace = makeId("Race", n % 4);
+        if (n % 7 == 2)
+            info.mClass = makeId("class", n % 6);
+        if (n % 4 == 3)
+            info.mFaction = makeId("Faction", n % 3);
+        if (n % 11 == 4)
+            info.mCell = makeId("Balmora", n % 2);
+        info.mData.mGender = n % 6 == 5 ? ESM::DialInfo::Female : ESM::DialInfo::NA;
+        info.mData.mRank = -1;
+        dialogue.mInfo.push_back(info);
+    }
+    return dialogue;
+}
+
+MWDialogue::InfoIndex::Speaker makeSpeaker(unsigned int i)
+{
+    MWDialogue::InfoIndex::Speaker speaker;
+    speaker.mId = makeId("npc_", i % 50);
+    speaker.mRace = makeId("race", i % 4);
+    speaker.mClass = makeId("class", i % 6);
+    speaker.mFaction = makeId("faction", i % 3);
+    speaker.mPlayerCell = "balmora1, guild of mages";
+    speaker.mIsFemale = i % 2 == 0;
+    speaker.mIsCreature = i % 9 == 0;
+    return speaker;
+}
+
+/// The static conditions as Filter::testActor and Filter::testPlayer test them, as the reference
+bool testStatic(const ESM::DialInfo& info, const MWDialogue::InfoIndex::Speaker& speaker)
+{
+    if (!info.mActor.empty())
+    {
+        if (!Misc::StringUtils::ciEqual(info.mActor, speaker.mId))
+            return false;
+    }
+    else if (speaker.mIsCreature)
+        return false;
+
+    if (speaker.mIsCreature && (!info.mRace.empty() || !info.mClass.empty() || !info.mFaction.empty() || info.mData.mRank != -1))
+        return false;
+
+    if (!info.mRace.empty() && !Misc::StringUtils::ciEqual(info.mRace, speaker.mRace))
+        return false;
+    if (!info.mClass.empty() && !Misc::StringUtils::ciEqual(info.mClass, speaker.mClass))
+        return false;
+    if (!info.mFaction.empty() && !Misc::StringUtils::ciEqual(info.mFaction, speaker.mFaction))
+        return false;
+    if (!speaker.mIsCreature && info.mData.mGender == (speaker.mIsFemale ? 0 : 1))
+        return false;
+
+    if (!info.mCell.empty())
+    {
+        bool match = speaker.mPlayerCell.length() >= info.mCell.length() &&
+            Misc::StringUtils::ciEqual(speaker.mPlayerCell.substr(0, info.mCell.length()), info.mCell);
+        if (!match)
+            return false;
+    }
+    return true;
+}
+
+void listStatic(const ESM::Dialogue& dialogue, const MWDialogue::InfoIndex::Speaker& speaker,
+    std::vector<const ESM::DialInfo*>& candidates)
+{
+    for (ESM::Dialogue::InfoContainer::const_iterator iter = dialogue.mInfo.begin(); iter != dialogue.mInfo.end(); ++iter)
+        if (testStatic(*iter, speaker))
+            candidates.push_back(&*iter);
+}
+
+}
+
+TEST(InfoIndexTest, matches_static_conditions)
+{
+    ESM::Dialogue dialogue = makeDialogue(500, 3);
+    MWDialogue::InfoIndex index;
+
+    for (unsigned int i=0; i<100; ++i)
+    {
+        MWDialogue::InfoIndex::Speaker speaker = makeSpeaker(i);
+
+        std::vector<const ESM::DialInfo*> expected;
+        listStatic(dialogue, speaker, expected);
+
+        std::vector<const ESM::DialInfo*> candidates;
+        index.getCandidates(dialogue, speaker, candidates);
+
+        // Same infos, in the order of the dialogue
+        ASSERT_EQ(expected, candidates) << i;
+    }
+}
+
+TEST(InfoIndexTest, creature_only_gets_own_infos)
+{
+    ESM::Dialogue dialogue;
+    ESM::DialInfo info;
+    info.blank();
+    info.mData.mRank = -1;
+    info.mData.mGender = ESM::DialInfo::NA;
+    dialogue.mInfo.push_back(info);
+    info.mActor = "Guar";
+    dialogue.mInfo.push_back(info);
+
+    MWDialogue::InfoIndex::Speaker speaker;
+    speaker.mId = "guar";
+    speaker.mIsCreature = true;
+
+    MWDialogue::InfoIndex index;
+    std::vector<const ESM::DialInfo*> candidates;
+    index.getCandidates(dialogue, speaker, candidates);
+    ASSERT_EQ(1u, candidates.size());
+    EXPECT_EQ(&dialogue.mInfo.back(), candidates[0]);
+}
+
+/// Measure listing the candidate infos of every topic for many speakers, as updateTopics does, compared to testing every info
+TEST(InfoIndexTest, DISABLED_update_topics_benchmark)
+{
+    const unsigned int numDialogues = 600;
+    const unsigned int numSpeakers = 50;
+
+    std::vector<ESM::Dialogue> dialogues;
+    for (unsigned int i=0; i<numDialogues; ++i)
+        dialogues.push_back(makeDialogue(20 + i % 60, i));
+
+    std::vector<const ESM::DialInfo*> candidates;
+    size_t linearCount = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for (unsigned int s=0; s<numSpeakers; ++s)
+    {
+        MWDialogue::InfoIndex::Speaker speaker = makeSpeaker(s);
+        for (unsigned int i=0; i<numDialogues; ++i)
+        {
+            candidates.clear();
+            listStatic(dialogues[i], speaker, candidates);
+            linearCount += candidates.size();
+        }
+    }
+    double linearSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    MWDialogue::InfoIndex index;
+    size_t indexCount = 0;
+    start = osg::Timer::instance()->tick();
+    for (unsigned int s=0; s<numSpeakers; ++s)
+    {
+        MWDialogue::InfoIndex::Speaker speaker = makeSpeaker(s);
+        for (unsigned int i=0; i<numDialogues; ++i)
+        {
+            candidates.clear();
+            index.getCandidates(dialogues[i], speaker, candidates);
+            indexCount += candidates.size();
+        }
+    }
+    double indexSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    ASSERT_EQ(linearCount, indexCount);
+
+    // One update lists the candidates of every topic, as the dialogue window does when it opens
+    std::cout << numDialogues << " topics, " << linearCount / numSpeakers << " candidates per update: "
+              << "testing every info " << linearSeconds * 1000.0 / numSpeakers << " ms per update, "
+              << "InfoIndex (including indexing) " << indexSeconds * 1000.0 / numSpeakers << " ms per update" << std::endl;
+}
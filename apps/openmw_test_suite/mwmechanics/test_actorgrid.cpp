@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "apps/openmw/mwmechanics/actorgrid.hpp"
+
+namespace
+{
+
+const float cellSize = 100.f;
+
+/// The grid only compares Ptrs, it never dereferences them, so they can point anywhere
+MWWorld::Ptr makePtr(unsigned int id)
+{
+    static char refs[16];
+    return MWWorld::Ptr(reinterpret_cast<MWWorld::LiveCellRefBase*>(&refs[id]));
+}
+
+std::vector<MWWorld::Ptr> getSortedActorsInRange(const MWMechanics::ActorGrid& grid, const osg::Vec3f& position, float radius)
+{
+    std::vector<MWWorld::Ptr> actors;
+    grid.getActorsInRange(position, radius, actors);
+    std::sort(actors.begin(), actors.end());
+    return actors;
+}
+
+}
+
+TEST(ActorGridTest, insert_and_remove)
+{
+    MWMechanics::ActorGrid grid (cellSize);
+    grid.insert(makePtr(0), osg::Vec3f(10, 10, 0));
+    grid.insert(makePtr(1), osg::Vec3f(20, 10, 0));
+    // Another cell, and negative coordinates
+    grid.insert(makePtr(2), osg::Vec3f(-10, -350, 0));
+
+    std::vector<MWWorld::Ptr> actors = getSortedActorsInRange(grid, osg::Vec3f(0, 0, 0), 1000);
+    ASSERT_EQ(3u, actors.size());
+    ASSERT_EQ(makePtr(0), actors[0]);
+    ASSERT_EQ(makePtr(1), actors[1]);
+    ASSERT_EQ(makePtr(2), actors[2]);
+
+    // Inserting again moves the actor instead of adding it twice
+    grid.insert(makePtr(0), osg::Vec3f(-20, -340, 0));
+    actors = getSortedActorsInRange(grid, osg::Vec3f(-10, -350, 0), 50);
+    ASSERT_EQ(2u, actors.size());
+    ASSERT_EQ(makePtr(0), actors[0]);
+    ASSERT_EQ(makePtr(2), actors[1]);
+
+    grid.remove(makePtr(2));
+    grid.remove(makePtr(3));
+    actors = getSortedActorsInRange(grid, osg::Vec3f(0, 0, 0), 1000);
+    ASSERT_EQ(2u, actors.size());
+    ASSERT_EQ(makePtr(0), actors[0]);
+    ASSERT_EQ(makePtr(1), actors[1]);
+
+    grid.clear();
+    ASSERT_TRUE(getSortedActorsInRange(grid, osg::Vec3f(0, 0, 0), 1000).empty());
+}
+
+TEST(ActorGridTest, move_between_cells)
+{
+    MWMechanics::ActorGrid grid (cellSize);
+    grid.insert(makePtr(0), osg::Vec3f(50, 50, 0));
+
+    // Within the cell
+    grid.update(makePtr(0), osg::Vec3f(90, 50, 0));
+    ASSERT_TRUE(getSortedActorsInRange(grid, osg::Vec3f(50, 50, 0), 30).empty());
+    ASSERT_EQ(1u, getSortedActorsInRange(grid, osg::Vec3f(90, 50, 0), 1).size());
+
+    // To the next cell, and far away
+    grid.update(makePtr(0), osg::Vec3f(110, 50, 0));
+    ASSERT_TRUE(getSortedActorsInRange(grid, osg::Vec3f(90, 50, 0), 15).empty());
+    ASSERT_EQ(1u, getSortedActorsInRange(grid, osg::Vec3f(110, 50, 0), 1).size());
+
+    grid.update(makePtr(0), osg::Vec3f(-5000, 8000, 0));
+    ASSERT_TRUE(getSortedActorsInRange(grid, osg::Vec3f(110, 50, 0), 1000).empty());
+    ASSERT_EQ(1u, getSortedActorsInRange(grid, osg::Vec3f(-5000, 8000, 0), 1).size());
+
+    // Replacing the Ptr keeps the position
+    grid.updatePtr(makePtr(0), makePtr(1));
+    std::vector<MWWorld::Ptr> actors = getSortedActorsInRange(grid, osg::Vec3f(-5000, 8000, 0), 1);
+    ASSERT_EQ(1u, actors.size());
+    ASSERT_EQ(makePtr(1), actors[0]);
+
+    // Actors that are not in the grid are ignored
+    grid.update(makePtr(0), osg::Vec3f(0, 0, 0));
+    grid.updatePtr(makePtr(0), makePtr(2));
+    ASSERT_EQ(1u, getSortedActorsInRange(grid, osg::Vec3f(0, 0, 0), 100000).size());
+}
+
+TEST(ActorGridTest, range_at_cell_boundaries)
+{
+    MWMechanics::ActorGrid grid (cellSize);
+    // Right on the boundaries between the cells, and just below them
+    grid.insert(makePtr(0), osg::Vec3f(100, 0, 0));
+    grid.insert(makePtr(1), osg::Vec3f(99.9f, 0, 0));
+    grid.insert(makePtr(2), osg::Vec3f(0, -100, 0));
+    grid.insert(makePtr(3), osg::Vec3f(0, -100.1f, 0));
+    grid.insert(makePtr(4), osg::Vec3f(200, 200, 0));
+
+    // A range that ends exactly on an actor includes it
+    std::vector<MWWorld::Ptr> actors = getSortedActorsInRange(grid, osg::Vec3f(0, 0, 0), 100);
+    ASSERT_EQ(3u, actors.size());
+    ASSERT_EQ(makePtr(0), actors[0]);
+    ASSERT_EQ(makePtr(1), actors[1]);
+    ASSERT_EQ(makePtr(2), actors[2]);
+
+    // An actor in the corner of the next cell, within the bounds of the range but not within its radius
+    ASSERT_TRUE(getSortedActorsInRange(grid, osg::Vec3f(150, 150, 0), 60).empty());
+    actors = getSortedActorsInRange(grid, osg::Vec3f(150, 150, 0), 75);
+    ASSERT_EQ(1u, actors.size());
+    ASSERT_EQ(makePtr(4), actors[0]);
+
+    // The height is not part of the grid, but counts for the range
+    ASSERT_TRUE(getSortedActorsInRange(grid, osg::Vec3f(200, 200, 500), 100).empty());
+}
+
+TEST(ActorGridTest, nearest_first)
+{
+    MWMechanics::ActorGrid grid (cellSize);
+    grid.insert(makePtr(0), osg::Vec3f(250, 0, 0));
+    grid.insert(makePtr(1), osg::Vec3f(-30, 0, 0));
+    grid.insert(makePtr(2), osg::Vec3f(0, 120, 0));
+    grid.insert(makePtr(3), osg::Vec3f(1000, 0, 0));
+
+    std::vector<MWWorld::Ptr> actors;
+    actors.push_back(makePtr(5));
+    grid.getNearestActors(osg::Vec3f(0, 0, 0), 300, actors);
+    // Appended after what was there already
+    ASSERT_EQ(4u, actors.size());
+    ASSERT_EQ(makePtr(5), actors[0]);
+    ASSERT_EQ(makePtr(1), actors[1]);
+    ASSERT_EQ(makePtr(2), actors[2]);
+    ASSERT_EQ(makePtr(0), actors[3]);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "apps/openmw/mwmechanics/magiceffects.hpp"
+
+namespace
+{
+
+typedef std::map<MWMechanics::EffectKey, MWMechanics::EffectParam> Reference;
+
+/// Adds the same effects to \a effects and to a map, as the reference
+void addEffects(MWMechanics::MagicEffects& effects, Reference& reference, unsigned int numEffects, int seed)
+{
+    for (unsigned int i=0; i<numEffects; ++i)
+    {
+        int id = (i * 37 + seed) % ESM::MagicEffect::Length;
+        // Every fourth effect has an argument, like the attribute and skill effects
+        int arg = i % 4 == 0 ? static_cast<int>(i % 27) : -1;
+        MWMechanics::EffectKey key (id, arg);
+        MWMechanics::EffectParam param (i * 0.5f + seed);
+
+        effects.add(key, param);
+        reference[key] += param;
+    }
+}
+
+void expectEqual(const Reference& reference, const MWMechanics::MagicEffects& effects)
+{
+    MWMechanics::MagicEffects::const_iterator it = effects.begin();
+    for (Reference::const_iterator refIt = reference.begin(); refIt != reference.end(); ++refIt, ++it)
+    {
+        ASSERT_TRUE(it != effects.end());
+        EXPECT_EQ(refIt->first.mId, it->first.mId);
+        EXPECT_EQ(refIt->first.mArg, it->first.mArg);
+        EXPECT_FLOAT_EQ(refIt->second.getMagnitude(), it->second.getMagnitude());
+        EXPECT_FLOAT_EQ(refIt->second.getMagnitude(), effects.get(refIt->first).getMagnitude());
+    }
+    EXPECT_TRUE(it == effects.end());
+}
+
+}
+
+TEST(MagicEffectsTest, get_missing_effect)
+{
+    MWMechanics::MagicEffects effects;
+    EXPECT_TRUE(effects.begin() == effects.end());
+    EXPECT_EQ(0.f, effects.get(ESM::MagicEffect::Paralyze).getMagnitude());
+    EXPECT_EQ(0.f, effects.get(MWMechanics::EffectKey(ESM::MagicEffect::FortifyAttribute, 3)).getMagnitude());
+
+    effects.add(ESM::MagicEffect::Paralyze, MWMechanics::EffectParam(1.f));
+    effects.remove(ESM::MagicEffect::Paralyze);
+    EXPECT_EQ(0.f, effects.get(ESM::MagicEffect::Paralyze).getMagnitude());
+    EXPECT_TRUE(effects.begin() == effects.end());
+}
+
+TEST(MagicEffectsTest, iterates_in_key_order)
+{
+    MWMechanics::MagicEffects effects;
+    Reference reference;
+    addEffects(effects, reference, 200, 3);
+    expectEqual(reference, effects);
+
+    // An effect that cancels out is still iterated, like in the map
+    MWMechanics::EffectKey key (ESM::MagicEffect::Levitate);
+    effects.add(key, MWMechanics::EffectParam(5.f));
+    effects.add(key, MWMechanics::EffectParam(-5.f));
+    reference[key] += MWMechanics::EffectParam();
+    expectEqual(reference, effects);
+}
+
+TEST(MagicEffectsTest, remove_while_iterating)
+{
+    MWMechanics::MagicEffects effects;
+    Reference reference;
+    addEffects(effects, reference, 100, 7);
+
+    // Remove every other effect, as Spells does for the harmful effects of corprus
+    bool remove = true;
+    for (MWMechanics::MagicEffects::const_iterator it = effects.begin(); it != effects.end(); remove = !remove)
+    {
+        if (remove)
+        {
+            reference.erase(it->first);
+            effects.remove((it++)->first);
+        }
+        else
+            ++it;
+    }
+    expectEqual(reference, effects);
+}
+
+TEST(MagicEffectsTest, diff_and_modifiers)
+{
+    MWMechanics::MagicEffects prev, now;
+    Reference prevReference, nowReference;
+    addEffects(prev, prevReference, 50, 1);
+    addEffects(now, nowReference, 80, 2);
+
+    MWMechanics::MagicEffects result (prev);
+    result += MWMechanics::MagicEffects::diff(prev, now);
+    for (Reference::const_iterator it = nowReference.begin(); it != nowReference.end(); ++it)
+        EXPECT_FLOAT_EQ(it->second.getMagnitude(), result.get(it->first).getMagnitude());
+    for (Reference::const_iterator it = prevReference.begin(); it != prevReference.end(); ++it)
+        EXPECT_FLOAT_EQ(now.get(it->first).getMagnitude(), result.get(it->first).getMagnitude());
+
+    // The bases are kept, the modifiers are copied
+    MWMechanics::MagicEffects stats;
+    stats.modifyBase(ESM::MagicEffect::Chameleon, 20);
+    stats.setModifiers(now);
+    EXPECT_EQ(20, stats.get(ESM::MagicEffect::Chameleon).getBase());
+    EXPECT_FLOAT_EQ(now.get(ESM::MagicEffect::Chameleon).getModifier(), stats.get(ESM::MagicEffect::Chameleon).getModifier());
+    for (Reference::const_iterator it = nowReference.begin(); it != nowReference.end(); ++it)
+        EXPECT_FLOAT_EQ(it->second.getModifier(), stats.get(it->first).getModifier());
+}
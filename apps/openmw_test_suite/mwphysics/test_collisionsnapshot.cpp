@@ -0,0 +1,274 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include <BulletCollision/CollisionDispatch/btCollisionObject.h>
+#include <BulletCollision/CollisionDispatch/btCollisionWorld.h>
+#include <BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <BulletCollision/CollisionShapes/btBoxShape.h>
+#include <BulletCollision/CollisionShapes/btSphereShape.h>
+
+#include "components/sceneutil/workqueue.hpp"
+
+#include "apps/openmw/mwphysics/collisionsnapshot.hpp"
+
+namespace
+{
+
+/// Ignores the actor that is swept, like the ActorConvexCallback of the movement solver
+class SweepCallback : public btCollisionWorld::ClosestConvexResultCallback
+{
+public:
+    SweepCallback(const btCollisionObject* me, const btVector3& from, const btVector3& to)
+        : btCollisionWorld::ClosestConvexResultCallback(from, to)
+        , mMe(me)
+    {
+    }
+
+    virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace)
+    {
+        if (convexResult.m_hitCollisionObject == mMe)
+            return btScalar(1);
+        return btCollisionWorld::ClosestConvexResultCallback::addSingleResult(convexResult, normalInWorldSpace);
+    }
+
+private:
+    const btCollisionObject* mMe;
+};
+
+struct Movement
+{
+    btCollisionObject* mActor;
+    btVector3 mVelocity;
+    btVector3 mPosition;
+};
+
+typedef std::vector<Movement> MovementList;
+
+/// Solve a step of the movements [begin, end), as PhysicsSystem::applyQueuedMovement does through solveMovements.
+/// The actors are swept up to the first thing they hit, rather than sliding along it like the movement solver.
+/// @param snapshot The snapshot \a collisionWorld belongs to, or NULL if it is the world of the actors.
+void solveMovements(MovementList& movements, unsigned int begin, unsigned int end, float dt,
+                    btCollisionWorld* collisionWorld, const MWPhysics::CollisionSnapshot* snapshot)
+{
+    for (unsigned int i=begin; i<end; ++i)
+    {
+        Movement& movement = movements[i];
+        const btCollisionObject* actor = movement.mActor;
+        if (snapshot)
+            actor = snapshot->getCopy(actor);
+
+        btTransform from = actor->getWorldTransform();
+        btTransform to = from;
+        to.setOrigin(from.getOrigin() + movement.mVelocity * dt);
+
+        SweepCallback callback (actor, from.getOrigin(), to.getOrigin());
+        collisionWorld->convexSweepTest(static_cast<const btConvexShape*>(actor->getCollisionShape()), from, to, callback);
+        movement.mPosition = from.getOrigin().lerp(to.getOrigin(), callback.m_closestHitFraction);
+    }
+}
+
+class SolverItem : public SceneUtil::WorkItem
+{
+public:
+    SolverItem(MovementList& movements, unsigned int begin, unsigned int end, float dt, MWPhysics::CollisionSnapshot* snapshot)
+        : mMovements(movements)
+        , mBegin(begin)
+        , mEnd(end)
+        , mDt(dt)
+        , mSnapshot(snapshot)
+    {
+    }
+
+    virtual void doWork()
+    {
+        solveMovements(mMovements, mBegin, mEnd, mDt, mSnapshot->getCollisionWorld(), mSnapshot);
+        mTicket->signalDone();
+    }
+
+private:
+    MovementList& mMovements;
+    unsigned int mBegin;
+    unsigned int mEnd;
+    float mDt;
+    MWPhysics::CollisionSnapshot* mSnapshot;
+};
+
+/// A walled room with actors on a ring, walking towards and past each other
+class CollisionSnapshotTest : public ::testing::Test
+{
+protected:
+    CollisionSnapshotTest()
+        : mDispatcher(&mCollisionConfiguration)
+        , mCollisionWorld(&mDispatcher, &mBroadphase, &mCollisionConfiguration)
+        , mWallShape(btVector3(10.f, 200.f, 100.f))
+        , mActorShape(15.f)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        mCollisionWorld.setForceUpdateAllAabbs(false);
+
+        for (int i=0; i<4; ++i)
+        {
+            btTransform transform;
+            transform.setIdentity();
+            transform.setRotation(btQuaternion(btVector3(0, 0, 1), i * SIMD_HALF_PI));
+            transform.setOrigin(transform.getBasis() * btVector3(200.f, 0.f, 0.f));
+            addObject(&mWallShape, transform);
+        }
+
+        const unsigned int numActors = 24;
+        for (unsigned int i=0; i<numActors; ++i)
+        {
+            float angle = i * SIMD_2_PI / numActors;
+            btTransform transform;
+            transform.setIdentity();
+            transform.setOrigin(btVector3(std::cos(angle), std::sin(angle), 0.f) * 150.f);
+
+            Movement movement;
+            movement.mActor = addObject(&mActorShape, transform);
+            // Towards the opposite side of the ring, off by a bit so they do not all meet in the centre
+            movement.mVelocity = btVector3(-std::cos(angle + 0.2f), -std::sin(angle + 0.2f), 0.f) * (300.f + i * 10.f);
+            mMovements.push_back(movement);
+        }
+    }
+
+    virtual void TearDown()
+    {
+        for (unsigned int i=0; i<mObjects.size(); ++i)
+        {
+            mCollisionWorld.removeCollisionObject(mObjects[i]);
+            delete mObjects[i];
+        }
+    }
+
+    btCollisionObject* addObject(btCollisionShape* shape, const btTransform& transform)
+    {
+        btCollisionObject* object = new btCollisionObject;
+        object->setCollisionShape(shape);
+        object->setWorldTransform(transform);
+        mCollisionWorld.addCollisionObject(object);
+        mObjects.push_back(object);
+        return object;
+    }
+
+    /// Solve \a numSteps steps of the actors like PhysicsSystem::applyQueuedMovement, the main thread solving the first share
+    /// of the actors against the world and each of \a numThreads threads another share against its snapshot.
+    std::vector<btVector3> solve(unsigned int numThreads, int numSteps)
+    {
+        const float dt = 1.f/60.f;
+
+        SceneUtil::WorkQueue workQueue (numThreads);
+        std::vector<MWPhysics::CollisionSnapshot*> snapshots;
+        for (unsigned int i=0; i<numThreads; ++i)
+        {
+            snapshots.push_back(new MWPhysics::CollisionSnapshot);
+            snapshots.back()->update(&mCollisionWorld);
+        }
+
+        unsigned int numShares = numThreads + 1;
+        for (int step=0; step<numSteps; ++step)
+        {
+            std::vector<osg::ref_ptr<SceneUtil::WorkTicket> > tickets;
+            for (unsigned int i=1; i<numShares; ++i)
+            {
+                tickets.push_back(workQueue.addWorkItem(new SolverItem(mMovements, mMovements.size() * i / numShares,
+                                                                       mMovements.size() * (i+1) / numShares, dt, snapshots[i-1])));
+            }
+            solveMovements(mMovements, 0, mMovements.size() / numShares, dt, &mCollisionWorld, NULL);
+            for (unsigned int i=0; i<tickets.size(); ++i)
+                tickets[i]->waitTillDone();
+
+            for (MovementList::iterator it = mMovements.begin(); it != mMovements.end(); ++it)
+            {
+                it->mActor->getWorldTransform().setOrigin(it->mPosition);
+                mCollisionWorld.updateSingleAabb(it->mActor);
+                for (unsigned int i=0; i<snapshots.size(); ++i)
+                    snapshots[i]->updateObject(it->mActor);
+            }
+        }
+
+        for (unsigned int i=0; i<snapshots.size(); ++i)
+            delete snapshots[i];
+
+        std::vector<btVector3> positions;
+        for (MovementList::iterator it = mMovements.begin(); it != mMovements.end(); ++it)
+            positions.push_back(it->mPosition);
+        return positions;
+    }
+
+    btDefaultCollisionConfiguration mCollisionConfiguration;
+    btCollisionDispatcher mDispatcher;
+    btDbvtBroadphase mBroadphase;
+    btCollisionWorld mCollisionWorld;
+
+    btBoxShape mWallShape;
+    btSphereShape mActorShape;
+    std::vector<btCollisionObject*> mObjects;
+    MovementList mMovements;
+};
+
+}
+
+TEST_F(CollisionSnapshotTest, copies_follow_the_world)
+{
+    MWPhysics::CollisionSnapshot snapshot;
+    snapshot.update(&mCollisionWorld);
+    EXPECT_EQ(mCollisionWorld.getNumCollisionObjects(), snapshot.getCollisionWorld()->getNumCollisionObjects());
+
+    btCollisionObject* actor = mMovements[0].mActor;
+    actor->getWorldTransform().setOrigin(btVector3(1.f, 2.f, 3.f));
+    mCollisionWorld.updateSingleAabb(actor);
+    snapshot.updateObject(actor);
+    EXPECT_EQ(btVector3(1.f, 2.f, 3.f), snapshot.getCopy(actor)->getWorldTransform().getOrigin());
+
+    mCollisionWorld.removeCollisionObject(actor);
+    snapshot.update(&mCollisionWorld);
+    EXPECT_TRUE(snapshot.getCopy(actor) == NULL);
+    EXPECT_EQ(mCollisionWorld.getNumCollisionObjects(), snapshot.getCollisionWorld()->getNumCollisionObjects());
+    mCollisionWorld.addCollisionObject(actor);
+}
+
+/// The actors must end up in the same positions whether they are solved on the main thread alone ("solver num threads" = 0)
+/// or shared with worker threads solving against snapshots
+TEST_F(CollisionSnapshotTest, same_positions_with_and_without_solver_threads)
+{
+    const int numSteps = 30;
+
+    std::vector<btTransform> start;
+    for (MovementList::iterator it = mMovements.begin(); it != mMovements.end(); ++it)
+        start.push_back(it->mActor->getWorldTransform());
+
+    std::vector<btVector3> expected = solve(0, numSteps);
+
+    // Some actors should have been stopped by the walls or other actors, otherwise nothing is compared
+    unsigned int stopped = 0;
+    for (unsigned int i=0; i<mMovements.size(); ++i)
+    {
+        btVector3 free = start[i].getOrigin() + mMovements[i].mVelocity * (numSteps / 60.f);
+        if ((expected[i] - free).length() > 1.f)
+            ++stopped;
+    }
+    ASSERT_GT(stopped, 0u);
+
+    for (unsigned int numThreads=1; numThreads<=3; ++numThreads)
+    {
+        for (unsigned int i=0; i<mMovements.size(); ++i)
+        {
+            mMovements[i].mActor->setWorldTransform(start[i]);
+            mCollisionWorld.updateSingleAabb(mMovements[i].mActor);
+        }
+
+        std::vector<btVector3> positions = solve(numThreads, numSteps);
+        for (unsigned int i=0; i<positions.size(); ++i)
+        {
+            EXPECT_FLOAT_EQ(expected[i].x(), positions[i].x()) << numThreads << " threads, actor " << i;
+            EXPECT_FLOAT_EQ(expected[i].y(), positions[i].y()) << numThreads << " threads, actor " << i;
+            EXPECT_FLOAT_EQ(expected[i].z(), positions[i].z()) << numThreads << " threads, actor " << i;
+        }
+    }
+}
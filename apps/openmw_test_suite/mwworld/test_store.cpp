@@ -313,3 +313,190 @@ TEST_F(StoreTest, overwrite_test)
 
     ASSERT_TRUE (overwrittenRec && overwrittenRec->mModel == "the_new_model");
 }
+
+/// Tests that loading a staged content file has the same result as loading it directly.
+TEST_F(StoreTest, staged_load_test)
+{
+    const std::string recordId = "foobar";
+
+    typedef ESM::Apparatus RecordType;
+
+    RecordType record;
+    record.blank();
+    record.mId = recordId;
+
+    ESM::ESMReader reader;
+    std::vector<ESM::ESMReader> readerList;
+    readerList.push_back(reader);
+    reader.setGlobalReaderList(&readerList);
+
+    // master file inserts a record
+    Files::IStreamPtr file = getEsmFile(record, false);
+    reader.open(file, "filename");
+    mEsmStore.load(reader, &dummyListener);
+    mEsmStore.setUp();
+
+    // now a staged plugin overwrites it with changed data
+    record.mModel = "the_new_model";
+    file = getEsmFile(record, false);
+    reader.open(file, "filename");
+    {
+        MWWorld::StagedContent staged;
+        mEsmStore.stage(reader, staged);
+
+        ASSERT_TRUE (staged.mNumStaged == 1);
+        ASSERT_TRUE (mEsmStore.get<RecordType>().search(recordId)->mModel != "the_new_model");
+
+        mEsmStore.loadStaged(reader, staged, &dummyListener);
+        mEsmStore.setUp();
+    }
+
+    const RecordType* overwrittenRec = mEsmStore.get<RecordType>().search(recordId);
+    ASSERT_TRUE (overwrittenRec != NULL);
+    ASSERT_TRUE (overwrittenRec && overwrittenRec->mModel == "the_new_model");
+
+    // a staged plugin deleting the record
+    file = getEsmFile(record, true);
+    reader.open(file, "filename");
+    {
+        MWWorld::StagedContent staged;
+        mEsmStore.stage(reader, staged);
+        mEsmStore.loadStaged(reader, staged, &dummyListener);
+        mEsmStore.setUp();
+    }
+
+    ASSERT_TRUE (mEsmStore.get<RecordType>().getSize() == 0);
+}
+
+/// Tests case insensitive lookup of static and dynamic records.
+TEST_F(StoreTest, search_test)
+{
+    typedef ESM::Apparatus RecordType;
+
+    RecordType record;
+    record.blank();
+    record.mId = "Foobar";
+
+    ESM::ESMReader reader;
+    std::vector<ESM::ESMReader> readerList;
+    readerList.push_back(reader);
+    reader.setGlobalReaderList(&readerList);
+
+    Files::IStreamPtr file = getEsmFile(record, false);
+    reader.open(file, "filename");
+    mEsmStore.load(reader, &dummyListener);
+    mEsmStore.setUp();
+
+    MWWorld::Store<RecordType>& store = const_cast<MWWorld::Store<RecordType>&>(mEsmStore.get<RecordType>());
+
+    const RecordType* staticRec = store.search("FOOBAR");
+    ASSERT_TRUE (staticRec != NULL);
+    ASSERT_TRUE (store.search("foobar_and_more", 6) == staticRec);
+    ASSERT_TRUE (store.search("fooba") == NULL);
+    ASSERT_TRUE (!store.isDynamic("FooBar"));
+
+    // a dynamic record takes precedence over the static one
+    record.mModel = "the_new_model";
+    store.insert(record);
+    ASSERT_TRUE (store.isDynamic("FooBar"));
+    ASSERT_TRUE (store.search("fOObar")->mModel == "the_new_model");
+
+    store.erase("FOOBAR");
+    ASSERT_TRUE (store.search("foobar") == staticRec);
+
+    // many records, to make the index grow
+    for (int i=0; i<100; ++i)
+    {
+        std::ostringstream id;
+        id << "Dynamic" << i;
+        record.mId = id.str();
+        store.insert(record);
+    }
+    for (int i=0; i<100; i+=2)
+    {
+        std::ostringstream id;
+        id << "DYNAMIC" << i;
+        ASSERT_TRUE (store.erase(id.str()));
+    }
+    for (int i=0; i<100; ++i)
+    {
+        std::ostringstream id;
+        id << "dynamic" << i;
+        ASSERT_TRUE ((store.search(id.str()) != NULL) == (i % 2 == 1));
+    }
+
+    store.clearDynamic();
+    ASSERT_TRUE (store.search("dynamic1") == NULL);
+    ASSERT_TRUE (store.search("foobar") == staticRec);
+}
+
+/// Tests that a copied store finds its own records.
+TEST_F(StoreTest, copy_test)
+{
+    typedef ESM::Apparatus RecordType;
+
+    RecordType record;
+    record.blank();
+    record.mId = "FooBar";
+
+    MWWorld::Store<RecordType>* original = new MWWorld::Store<RecordType>;
+    original->insertStatic(record);
+    const RecordType* originalRec = original->search("foobar");
+    ASSERT_TRUE (originalRec != NULL);
+
+    MWWorld::Store<RecordType> copy (*original);
+    delete original;
+
+    const RecordType* copiedRec = copy.search("FOOBAR");
+    ASSERT_TRUE (copiedRec != NULL);
+    ASSERT_TRUE (copiedRec != originalRec);
+    ASSERT_TRUE (copiedRec->mId == "FooBar");
+    ASSERT_TRUE (copy.find("foobar") == copiedRec);
+}
+
+/// Tests overriding and lookup of land records by cell coordinates.
+TEST_F(StoreTest, land_test)
+{
+    ESM::ESMReader reader;
+    std::vector<ESM::ESMReader> readerList;
+    readerList.push_back(reader);
+    reader.setGlobalReaderList(&readerList);
+
+    ESM::Land land;
+    const int coords[][2] = { {0, 0}, {-2, 3}, {5, -1}, {0, 0} };
+    for (int i=0; i<4; ++i)
+    {
+        land.mX = coords[i][0];
+        land.mY = coords[i][1];
+        land.mFlags = i;
+
+        Files::IStreamPtr file = getEsmFile(land, false);
+        reader.open(file, "filename");
+        mEsmStore.load(reader, &dummyListener);
+    }
+    mEsmStore.setUp();
+
+    const MWWorld::Store<ESM::Land>& store = mEsmStore.get<ESM::Land>();
+
+    // the last plugin wins
+    ASSERT_TRUE (store.getSize() == 3);
+    ASSERT_TRUE (store.search(0, 0) && store.search(0, 0)->mFlags == 3);
+    ASSERT_TRUE (store.search(-2, 3) && store.search(-2, 3)->mFlags == 1);
+    ASSERT_TRUE (store.search(5, -1) && store.search(5, -1)->mFlags == 2);
+    ASSERT_TRUE (store.search(1, 1) == NULL);
+    ASSERT_TRUE (store.search(6, 0) == NULL);
+
+    // a stray record far away from the others
+    land.mX = 100000;
+    land.mY = -100000;
+    land.mFlags = 4;
+    Files::IStreamPtr file = getEsmFile(land, false);
+    reader.open(file, "filename");
+    mEsmStore.load(reader, &dummyListener);
+    mEsmStore.setUp();
+
+    ASSERT_TRUE (store.getSize() == 4);
+    ASSERT_TRUE (store.search(100000, -100000) && store.search(100000, -100000)->mFlags == 4);
+    ASSERT_TRUE (store.search(-2, 3) && store.search(-2, 3)->mFlags == 1);
+    ASSERT_TRUE (store.search(1, 1) == NULL);
+}
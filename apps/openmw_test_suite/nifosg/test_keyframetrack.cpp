@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <osg/Math>
+
+#include "components/nif/nifkey.hpp"
+#include "components/nifosg/keyframetrack.hpp"
+
+namespace
+{
+
+/// The lookup the controllers did before the keys were converted to tracks, as a reference
+float interpMap(const Nif::FloatKeyMap::MapType& keys, float time)
+{
+    if (time <= keys.begin()->first)
+        return keys.begin()->second.mValue;
+
+    Nif::FloatKeyMap::MapType::const_iterator it = keys.lower_bound(time);
+    if (it == keys.end())
+        return keys.rbegin()->second.mValue;
+
+    Nif::FloatKeyMap::MapType::const_iterator last = it;
+    --last;
+    float a = (time - last->first) / (it->first - last->first);
+    return last->second.mValue + ((it->second.mValue - last->second.mValue) * a);
+}
+
+Nif::FloatKeyMapPtr makeKeys(unsigned int numKeys)
+{
+    Nif::FloatKeyMapPtr keyMap (new Nif::FloatKeyMap);
+    for (unsigned int i=0; i<numKeys; ++i)
+    {
+        Nif::FloatKey key;
+        key.mValue = std::sin(i * 0.7f) * 10.f;
+        // Uneven spacing, so the cursor has to skip keys now and then
+        keyMap->mKeys[i * 0.5f + (i % 3) * 0.1f] = key;
+    }
+    return keyMap;
+}
+
+}
+
+TEST(KeyframeTrackTest, empty)
+{
+    NifOsg::KeyframeTrack<float> track;
+    ASSERT_TRUE(track.empty());
+    ASSERT_EQ(1.f, track.interpolate(0.5f, 1.f));
+
+    NifOsg::KeyframeTrack<float> fromEmptyMap ((Nif::FloatKeyMapPtr(new Nif::FloatKeyMap)));
+    ASSERT_TRUE(fromEmptyMap.empty());
+    ASSERT_EQ(2.f, fromEmptyMap.interpolate(0.5f, 2.f));
+
+    NifOsg::KeyframeTrack<float> fromNull ((Nif::FloatKeyMapPtr()));
+    ASSERT_TRUE(fromNull.empty());
+}
+
+TEST(KeyframeTrackTest, matches_map_lookup)
+{
+    Nif::FloatKeyMapPtr keyMap = makeKeys(50);
+    NifOsg::KeyframeTrack<float> track (keyMap);
+    ASSERT_FALSE(track.empty());
+
+    // Forward in small and large steps, backward, and on the keys themselves
+    for (float time = -1.f; time < 30.f; time += 0.05f)
+        ASSERT_FLOAT_EQ(interpMap(keyMap->mKeys, time), track.interpolate(time)) << time;
+    for (float time = 30.f; time > -1.f; time -= 0.3f)
+        ASSERT_FLOAT_EQ(interpMap(keyMap->mKeys, time), track.interpolate(time)) << time;
+    for (float time = -1.f; time < 30.f; time += 2.7f)
+        ASSERT_FLOAT_EQ(interpMap(keyMap->mKeys, time), track.interpolate(time)) << time;
+    for (Nif::FloatKeyMap::MapType::const_iterator it = keyMap->mKeys.begin(); it != keyMap->mKeys.end(); ++it)
+        ASSERT_FLOAT_EQ(interpMap(keyMap->mKeys, it->first), track.interpolate(it->first)) << it->first;
+}
+
+TEST(KeyframeTrackTest, copies_share_keys)
+{
+    Nif::FloatKeyMapPtr keyMap = makeKeys(10);
+    NifOsg::KeyframeTrack<float> track (keyMap);
+    track.interpolate(4.f);
+
+    // A copy has its own cursor, lookups on the original do not affect it
+    NifOsg::KeyframeTrack<float> copy (track);
+    track.interpolate(0.2f);
+    ASSERT_FLOAT_EQ(interpMap(keyMap->mKeys, 4.1f), copy.interpolate(4.1f));
+    ASSERT_FLOAT_EQ(interpMap(keyMap->mKeys, 0.3f), track.interpolate(0.3f));
+}
+
+TEST(KeyframeTrackTest, quaternion_shortest_path)
+{
+    Nif::QuaternionKeyMapPtr keyMap (new Nif::QuaternionKeyMap);
+    Nif::QuaternionKey key;
+    key.mValue = osg::Quat(0, 0, 0, 1);
+    keyMap->mKeys[0.f] = key;
+    // The same rotation as the first key, negated
+    key.mValue = osg::Quat(0, 0, 0, -1);
+    keyMap->mKeys[1.f] = key;
+
+    NifOsg::KeyframeTrack<osg::Quat> track (keyMap);
+    osg::Quat halfway = track.interpolate(0.5f);
+    ASSERT_NEAR(1.0, std::abs(halfway.w()), 1e-5);
+}
+
+TEST(KeyframeTrackTest, xyz_rotation_from_empty_maps_is_identity)
+{
+    NifOsg::XYZRotationTrack missing ((Nif::FloatKeyMapPtr()), Nif::FloatKeyMapPtr(), Nif::FloatKeyMapPtr());
+    ASSERT_TRUE(missing.empty());
+
+    // The maps are there, so the rotation is set from them, to the identity
+    NifOsg::XYZRotationTrack empty ((Nif::FloatKeyMapPtr(new Nif::FloatKeyMap)), Nif::FloatKeyMapPtr(), Nif::FloatKeyMapPtr());
+    ASSERT_FALSE(empty.empty());
+    osg::Quat rotation = empty.interpolate(0.5f);
+    ASSERT_NEAR(0.0, rotation.x(), 1e-5);
+    ASSERT_NEAR(0.0, rotation.y(), 1e-5);
+    ASSERT_NEAR(0.0, rotation.z(), 1e-5);
+    ASSERT_NEAR(1.0, rotation.w(), 1e-5);
+}
+
+TEST(KeyframeTrackTest, xyz_rotation)
+{
+    Nif::FloatKeyMapPtr zRotations (new Nif::FloatKeyMap);
+    Nif::FloatKey key;
+    key.mValue = 0.f;
+    zRotations->mKeys[0.f] = key;
+    key.mValue = static_cast<float>(osg::PI);
+    zRotations->mKeys[1.f] = key;
+
+    NifOsg::XYZRotationTrack track (Nif::FloatKeyMapPtr(), Nif::FloatKeyMapPtr(new Nif::FloatKeyMap), zRotations);
+    ASSERT_FALSE(track.empty());
+
+    // Half way, a quarter turn around the Z axis
+    osg::Quat rotation = track.interpolate(0.5f);
+    ASSERT_NEAR(0.0, rotation.x(), 1e-5);
+    ASSERT_NEAR(0.0, rotation.y(), 1e-5);
+    ASSERT_NEAR(std::sin(osg::PI / 4), rotation.z(), 1e-5);
+    ASSERT_NEAR(std::cos(osg::PI / 4), rotation.w(), 1e-5);
+}
@@ -0,0 +1,269 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <osg/Timer>
+
+#include <BulletCollision/CollisionShapes/btBoxShape.h>
+#include <BulletCollision/CollisionShapes/btCompoundShape.h>
+#include <BulletCollision/CollisionShapes/btTriangleMesh.h>
+
+#include "components/resource/bulletshape.hpp"
+#include "components/resource/bulletshapediskcache.hpp"
+#include "components/vfs/filesystemarchive.hpp"
+
+namespace
+{
+
+/// A bumpy grid of triangles, roughly what a static mesh of a cell looks like to the loader
+Resource::TriangleMeshShape* makeMeshShape(unsigned int size, unsigned int seed)
+{
+    btTriangleMesh* mesh = new btTriangleMesh(false);
+    for (unsigned int y=0; y<size; ++y)
+    {
+        for (unsigned int x=0; x<size; ++x)
+        {
+            btVector3 corners[4];
+            for (unsigned int i=0; i<4; ++i)
+            {
+                float cx = static_cast<float>(x + i % 2);
+                float cy = static_cast<float>(y + i / 2);
+                corners[i] = btVector3(cx * 16.f, cy * 16.f, std::sin(cx * 0.3f + seed) * std::cos(cy * 0.2f) * 50.f);
+            }
+            mesh->addTriangle(corners[0], corners[1], corners[2]);
+            mesh->addTriangle(corners[1], corners[3], corners[2]);
+        }
+    }
+    return new Resource::TriangleMeshShape(mesh, true);
+}
+
+void getAabb(const btCollisionShape* shape, btVector3& min, btVector3& max)
+{
+    btTransform transform;
+    transform.setIdentity();
+    shape->getAabb(transform, min, max);
+}
+
+int getNumTriangles(btCollisionShape* shape)
+{
+    return static_cast<btTriangleMesh*>(static_cast<btBvhTriangleMeshShape*>(shape)->getMeshInterface())->getNumTriangles();
+}
+
+class BulletShapeDiskCacheTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        mDirectory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("openmw-shapes-%%%%-%%%%");
+    }
+
+    virtual void TearDown()
+    {
+        boost::filesystem::remove_all(mDirectory);
+    }
+
+    boost::filesystem::path mDirectory;
+};
+
+}
+
+TEST_F(BulletShapeDiskCacheTest, round_trip)
+{
+    Resource::BulletShapeDiskCache cache (mDirectory);
+    ASSERT_TRUE(cache.isValid());
+
+    osg::ref_ptr<Resource::BulletShape> shape (new Resource::BulletShape);
+    shape->mCollisionBoxHalfExtents = osg::Vec3f(10.f, 20.f, 30.f);
+    shape->mCollisionBoxTranslate = osg::Vec3f(0.f, 0.f, 15.f);
+    shape->mAnimatedShapes[12] = 1;
+
+    btCompoundShape* compound = new btCompoundShape;
+    btTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(btVector3(1.f, 2.f, 3.f));
+    compound->addChildShape(transform, new btBoxShape(btVector3(5.f, 6.f, 7.f)));
+    transform.setRotation(btQuaternion(btVector3(0.f, 0.f, 1.f), 0.5f));
+    compound->addChildShape(transform, makeMeshShape(10, 1));
+    shape->mCollisionShape = compound;
+
+    cache.save("meshes/x/test.nif", 42, *shape);
+    osg::ref_ptr<Resource::BulletShape> loaded = cache.load("meshes/x/test.nif", 42);
+    ASSERT_TRUE(loaded.valid());
+
+    EXPECT_EQ(shape->mCollisionBoxHalfExtents, loaded->mCollisionBoxHalfExtents);
+    EXPECT_EQ(shape->mCollisionBoxTranslate, loaded->mCollisionBoxTranslate);
+    EXPECT_EQ(shape->mAnimatedShapes, loaded->mAnimatedShapes);
+
+    ASSERT_TRUE(loaded->mCollisionShape && loaded->mCollisionShape->isCompound());
+    btCompoundShape* loadedCompound = static_cast<btCompoundShape*>(loaded->mCollisionShape);
+    ASSERT_EQ(2, loadedCompound->getNumChildShapes());
+    for (int i=0; i<2; ++i)
+    {
+        EXPECT_EQ(compound->getChildShape(i)->getShapeType(), loadedCompound->getChildShape(i)->getShapeType());
+        EXPECT_TRUE(compound->getChildTransform(i).getOrigin() == loadedCompound->getChildTransform(i).getOrigin());
+
+        btVector3 min, max, loadedMin, loadedMax;
+        getAabb(compound->getChildShape(i), min, max);
+        getAabb(loadedCompound->getChildShape(i), loadedMin, loadedMax);
+        EXPECT_TRUE(min == loadedMin && max == loadedMax) << i;
+    }
+    EXPECT_EQ(getNumTriangles(compound->getChildShape(1)), getNumTriangles(loadedCompound->getChildShape(1)));
+
+    // The BVH is used as it was built, not built again
+    btOptimizedBvh* bvh = static_cast<btBvhTriangleMeshShape*>(compound->getChildShape(1))->getOptimizedBvh();
+    btOptimizedBvh* loadedBvh = static_cast<btBvhTriangleMeshShape*>(loadedCompound->getChildShape(1))->getOptimizedBvh();
+    ASSERT_TRUE(loadedBvh != NULL);
+    EXPECT_EQ(bvh->getQuantizedNodeArray().size(), loadedBvh->getQuantizedNodeArray().size());
+}
+
+TEST_F(BulletShapeDiskCacheTest, no_collision_shape)
+{
+    Resource::BulletShapeDiskCache cache (mDirectory);
+    osg::ref_ptr<Resource::BulletShape> shape (new Resource::BulletShape);
+    shape->mCollisionBoxHalfExtents = osg::Vec3f(1.f, 2.f, 3.f);
+
+    cache.save("meshes/actor.nif", 1, *shape);
+    osg::ref_ptr<Resource::BulletShape> loaded = cache.load("meshes/actor.nif", 1);
+    ASSERT_TRUE(loaded.valid());
+    EXPECT_TRUE(loaded->mCollisionShape == NULL);
+    EXPECT_EQ(shape->mCollisionBoxHalfExtents, loaded->mCollisionBoxHalfExtents);
+}
+
+TEST_F(BulletShapeDiskCacheTest, out_of_date_or_corrupt)
+{
+    Resource::BulletShapeDiskCache cache (mDirectory);
+    osg::ref_ptr<Resource::BulletShape> shape (new Resource::BulletShape);
+    shape->mCollisionShape = makeMeshShape(5, 2);
+    cache.save("meshes/a_b.nif", 7, *shape);
+
+    EXPECT_FALSE(cache.load("meshes/a_b.nif", 8).valid());
+    // Maps to the same file
+    EXPECT_FALSE(cache.load("meshes/a/b.nif", 7).valid());
+    EXPECT_FALSE(cache.load("meshes/c.nif", 7).valid());
+    ASSERT_TRUE(cache.load("meshes/a_b.nif", 7).valid());
+
+    // Cut off within the BVH
+    boost::filesystem::path file = mDirectory / "meshes_a_b.nif.shape";
+    ASSERT_TRUE(boost::filesystem::exists(file));
+    boost::filesystem::resize_file(file, boost::filesystem::file_size(file) - 16);
+    EXPECT_FALSE(cache.load("meshes/a_b.nif", 7).valid());
+}
+
+TEST_F(BulletShapeDiskCacheTest, hash)
+{
+    std::istringstream a ("some mesh data"), b ("some mesh data"), c ("some mesh date"), d ("some mesh data ");
+    boost::uint64_t hash = Resource::BulletShapeDiskCache::hash(a);
+    EXPECT_EQ(hash, Resource::BulletShapeDiskCache::hash(b));
+    EXPECT_NE(hash, Resource::BulletShapeDiskCache::hash(c));
+    EXPECT_NE(hash, Resource::BulletShapeDiskCache::hash(d));
+}
+
+TEST_F(BulletShapeDiskCacheTest, stamp_of_loose_file)
+{
+    boost::filesystem::create_directories(mDirectory);
+    boost::filesystem::path path = mDirectory / "mesh.nif";
+    VFS::FileSystemArchiveFile file (path.string());
+    EXPECT_EQ(0u, file.getStamp());
+
+    {
+        boost::filesystem::ofstream stream (path, std::ios::binary);
+        stream << "some mesh data";
+    }
+    boost::filesystem::last_write_time(path, 1000000000);
+    boost::uint64_t stamp = file.getStamp();
+    EXPECT_NE(0u, stamp);
+    EXPECT_EQ(stamp, file.getStamp());
+
+    // Same size, modified later
+    {
+        boost::filesystem::ofstream stream (path, std::ios::binary);
+        stream << "some mesh date";
+    }
+    boost::filesystem::last_write_time(path, 1000000060);
+    boost::uint64_t modified = file.getStamp();
+    EXPECT_NE(stamp, modified);
+
+    // Same modification time, different size
+    {
+        boost::filesystem::ofstream stream (path, std::ios::binary);
+        stream << "some mesh data ";
+    }
+    boost::filesystem::last_write_time(path, 1000000060);
+    EXPECT_NE(modified, file.getStamp());
+}
+
+TEST_F(BulletShapeDiskCacheTest, rescale_loaded_mesh)
+{
+    Resource::BulletShapeDiskCache cache (mDirectory);
+    osg::ref_ptr<Resource::BulletShape> shape (new Resource::BulletShape);
+    shape->mCollisionShape = makeMeshShape(5, 3);
+    cache.save("meshes/rescaled.nif", 3, *shape);
+
+    osg::ref_ptr<Resource::BulletShape> loaded = cache.load("meshes/rescaled.nif", 3);
+    ASSERT_TRUE(loaded.valid());
+    btVector3 min, max;
+    getAabb(loaded->mCollisionShape, min, max);
+
+    // Builds a new BVH owned by the shape, the one in the buffer from the cache has to be destroyed all the same
+    loaded->mCollisionShape->setLocalScaling(btVector3(2.f, 2.f, 2.f));
+    btVector3 scaledMin, scaledMax;
+    getAabb(loaded->mCollisionShape, scaledMin, scaledMax);
+    EXPECT_NEAR(max.x() * 2.f, scaledMax.x(), 0.1f);
+    EXPECT_NEAR(min.z() * 2.f, scaledMin.z(), 0.1f);
+
+    loaded = NULL;
+}
+
+/// Measure creating the collision shapes of a cell's worth of meshes, building their BVH (cold) compared to loading them from the disk cache (warm)
+TEST_F(BulletShapeDiskCacheTest, DISABLED_cell_load_benchmark)
+{
+    const unsigned int numMeshes = 150;
+
+    Resource::BulletShapeDiskCache cache (mDirectory);
+    std::vector<std::string> names;
+    for (unsigned int i=0; i<numMeshes; ++i)
+    {
+        std::ostringstream name;
+        name << "meshes/x/mesh" << i << ".nif";
+        names.push_back(name.str());
+    }
+
+    size_t numTriangles = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for (unsigned int i=0; i<numMeshes; ++i)
+    {
+        osg::ref_ptr<Resource::BulletShape> shape (new Resource::BulletShape);
+        shape->mCollisionShape = makeMeshShape(8 + i % 24, i);
+        numTriangles += getNumTriangles(shape->mCollisionShape);
+    }
+    double coldSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    for (unsigned int i=0; i<numMeshes; ++i)
+    {
+        osg::ref_ptr<Resource::BulletShape> shape (new Resource::BulletShape);
+        shape->mCollisionShape = makeMeshShape(8 + i % 24, i);
+        cache.save(names[i], i, *shape);
+    }
+
+    size_t warmTriangles = 0;
+    start = osg::Timer::instance()->tick();
+    for (unsigned int i=0; i<numMeshes; ++i)
+    {
+        osg::ref_ptr<Resource::BulletShape> shape = cache.load(names[i], i);
+        ASSERT_TRUE(shape.valid()) << i;
+        warmTriangles += getNumTriangles(shape->mCollisionShape);
+    }
+    double warmSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    ASSERT_EQ(numTriangles, warmTriangles);
+
+    std::cout << numMeshes << " meshes, " << numTriangles << " triangles: "
+              << "building the BVH " << coldSeconds * 1000.0 << " ms, "
+              << "loading from the disk cache " << warmSeconds * 1000.0 << " ms, "
+              << coldSeconds / warmSeconds << " times faster warm" << std::endl;
+}
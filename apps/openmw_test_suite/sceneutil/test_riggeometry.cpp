@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <osg/Matrixf>
+
+#include "components/sceneutil/skinning.hpp"
+
+namespace
+{
+
+osg::Matrixf makeMatrix()
+{
+    return osg::Matrixf::rotate(0.7f, osg::Vec3f(0.3f, 0.5f, 0.8f)) * osg::Matrixf::translate(10.f, -20.f, 5.f);
+}
+
+void makeMesh(unsigned int numVertices, std::vector<osg::Vec3f>& positions, std::vector<osg::Vec3f>& normals)
+{
+    for (unsigned int i=0; i<numVertices; ++i)
+    {
+        positions.push_back(osg::Vec3f(i % 17 * 1.5f, i % 31 * -0.5f, i % 7 * 3.f));
+        osg::Vec3f normal (i % 3 * 1.f, 1.f, i % 5 * -1.f);
+        normal.normalize();
+        normals.push_back(normal);
+    }
+}
+
+osg::Matrixf makeBoneMatrix(unsigned int bone)
+{
+    return osg::Matrixf::rotate(0.3f * bone, osg::Vec3f(1.f, bone * 0.2f, 0.5f)) * osg::Matrixf::translate(bone * 2.f, 1.f, -3.f * bone);
+}
+
+/// Weights for each bone, mostly shared by runs of vertices, with some vertices not influenced at all
+void makeWeights(unsigned int numVertices, unsigned int numBones, std::vector<SceneUtil::InfluenceGroups::VertexWeights>& weights)
+{
+    weights.resize(numBones);
+    for (unsigned int i=0; i<numVertices; ++i)
+    {
+        if (i % 10 == 9)
+            continue;
+        unsigned int first = i / 20 % numBones;
+        unsigned int second = (first + 1 + i % 2) % numBones;
+        float weight = 0.25f + (i / 40 % 3) * 0.25f;
+        weights[first][i] = weight;
+        weights[second][i] = 1.f - weight;
+    }
+}
+
+}
+
+TEST(RigGeometryTest, transform_vertices)
+{
+    std::vector<osg::Vec3f> positions, normals;
+    makeMesh(100, positions, normals);
+
+    // Every other vertex
+    std::vector<unsigned short> indices;
+    for (unsigned short i=0; i<positions.size(); i+=2)
+        indices.push_back(i);
+
+    std::vector<osg::Vec3f> positionsOut (positions.size());
+    std::vector<osg::Vec3f> normalsOut (normals.size());
+
+    osg::Matrixf matrix = makeMatrix();
+    SceneUtil::transformVertices(matrix, &indices[0], indices.size(), &positions[0], &normals[0], &positionsOut[0], &normalsOut[0]);
+
+    for (unsigned int i=0; i<positions.size(); ++i)
+    {
+        osg::Vec3f position = i % 2 == 0 ? matrix.preMult(positions[i]) : osg::Vec3f();
+        osg::Vec3f normal = i % 2 == 0 ? osg::Matrix::transform3x3(normals[i], matrix) : osg::Vec3f();
+        for (int j=0; j<3; ++j)
+        {
+            ASSERT_NEAR(position[j], positionsOut[i][j], 1e-4f) << i;
+            ASSERT_NEAR(normal[j], normalsOut[i][j], 1e-4f) << i;
+        }
+    }
+}
+
+TEST(RigGeometryTest, influence_groups)
+{
+    // Bone 0 influences vertices 0 to 3, bone 1 vertices 2 to 5, with the same weights for vertices 2 and 3
+    SceneUtil::InfluenceGroups::VertexWeights weights0, weights1;
+    for (unsigned short i=0; i<4; ++i)
+        weights0[i] = i < 2 ? 1.f : 0.5f;
+    for (unsigned short i=2; i<6; ++i)
+        weights1[i] = i < 4 ? 0.5f : 1.f;
+
+    std::vector<const SceneUtil::InfluenceGroups::VertexWeights*> boneWeights;
+    boneWeights.push_back(&weights0);
+    boneWeights.push_back(&weights1);
+
+    SceneUtil::InfluenceGroups groups;
+    ASSERT_TRUE(groups.empty());
+    groups.build(boneWeights);
+    ASSERT_FALSE(groups.empty());
+    ASSERT_EQ(3u, groups.getNumGroups());
+    ASSERT_EQ(6u, groups.getNumVertices());
+
+    // Building again replaces the groups
+    boneWeights.pop_back();
+    groups.build(boneWeights);
+    ASSERT_EQ(2u, groups.getNumGroups());
+    ASSERT_EQ(4u, groups.getNumVertices());
+}
+
+/// The grouped skinning against blending the bone transforms of each vertex on its own
+TEST(RigGeometryTest, grouped_matches_ungrouped_skinning)
+{
+    const unsigned int numVertices = 500;
+    const unsigned int numBones = 6;
+
+    std::vector<osg::Vec3f> positions, normals;
+    makeMesh(numVertices, positions, normals);
+
+    std::vector<SceneUtil::InfluenceGroups::VertexWeights> weights;
+    makeWeights(numVertices, numBones, weights);
+    std::vector<const SceneUtil::InfluenceGroups::VertexWeights*> boneWeights;
+    std::vector<osg::Matrixf> boneMatrices;
+    for (unsigned int i=0; i<numBones; ++i)
+    {
+        boneWeights.push_back(&weights[i]);
+        boneMatrices.push_back(makeBoneMatrix(i));
+    }
+    osg::Matrixf postMatrix = makeMatrix();
+
+    SceneUtil::InfluenceGroups groups;
+    groups.build(boneWeights);
+    ASSERT_LT(groups.getNumGroups(), groups.getNumVertices());
+
+    groups.computeMatrices(boneMatrices, postMatrix);
+    // Vertices that no bone influences are left as they were
+    std::vector<osg::Vec3f> positionsOut (numVertices, osg::Vec3f(-1.f, -1.f, -1.f));
+    std::vector<osg::Vec3f> normalsOut (numVertices, osg::Vec3f(-1.f, -1.f, -1.f));
+    groups.transform(&positions[0], &normals[0], &positionsOut[0], &normalsOut[0]);
+
+    for (unsigned int i=0; i<numVertices; ++i)
+    {
+        osg::Vec3f position (-1.f, -1.f, -1.f);
+        osg::Vec3f normal (-1.f, -1.f, -1.f);
+        if (i % 10 != 9)
+        {
+            osg::Vec3f blendedPosition, blendedNormal;
+            for (unsigned int bone=0; bone<numBones; ++bone)
+            {
+                SceneUtil::InfluenceGroups::VertexWeights::const_iterator found = weights[bone].find(i);
+                if (found == weights[bone].end())
+                    continue;
+                blendedPosition += boneMatrices[bone].preMult(positions[i]) * found->second;
+                blendedNormal += osg::Matrix::transform3x3(normals[i], boneMatrices[bone]) * found->second;
+            }
+            position = postMatrix.preMult(blendedPosition);
+            normal = osg::Matrix::transform3x3(blendedNormal, postMatrix);
+        }
+        for (int j=0; j<3; ++j)
+        {
+            ASSERT_NEAR(position[j], positionsOut[i][j], 1e-3f) << i;
+            ASSERT_NEAR(normal[j], normalsOut[i][j], 1e-4f) << i;
+        }
+    }
+}
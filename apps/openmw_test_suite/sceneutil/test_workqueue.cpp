@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Thread>
+
+#include "components/sceneutil/workqueue.hpp"
+
+namespace
+{
+
+/// Counts how often it was run
+class CountItem : public SceneUtil::WorkItem
+{
+public:
+    CountItem(OpenThreads::Atomic& counter)
+        : mCounter(counter)
+    {
+    }
+
+    virtual void doWork()
+    {
+        ++mCounter;
+        mTicket->signalDone();
+    }
+
+private:
+    OpenThreads::Atomic& mCounter;
+};
+
+/// Appends its id to a list, to check the order in which items are run
+class RecordItem : public SceneUtil::WorkItem
+{
+public:
+    RecordItem(int id, std::vector<int>& order, OpenThreads::Mutex& mutex)
+        : mId(id), mOrder(order), mMutex(mutex)
+    {
+    }
+
+    virtual void doWork()
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+            mOrder.push_back(mId);
+        }
+        mTicket->signalDone();
+    }
+
+private:
+    int mId;
+    std::vector<int>& mOrder;
+    OpenThreads::Mutex& mMutex;
+};
+
+/// Keeps a thread busy until the given ticket is done
+class BlockItem : public SceneUtil::WorkItem
+{
+public:
+    BlockItem(osg::ref_ptr<SceneUtil::WorkTicket> started, osg::ref_ptr<SceneUtil::WorkTicket> gate)
+        : mStarted(started), mGate(gate)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mStarted->signalDone();
+        mGate->waitTillDone();
+        mTicket->signalDone();
+    }
+
+private:
+    osg::ref_ptr<SceneUtil::WorkTicket> mStarted;
+    osg::ref_ptr<SceneUtil::WorkTicket> mGate;
+};
+
+/// Deletes a work queue, which waits for the items in progress
+class DeleteQueueThread : public OpenThreads::Thread
+{
+public:
+    DeleteQueueThread(SceneUtil::WorkQueue* queue)
+        : mQueue(queue)
+    {
+    }
+
+    virtual void run()
+    {
+        delete mQueue;
+    }
+
+private:
+    SceneUtil::WorkQueue* mQueue;
+};
+
+}
+
+TEST(WorkQueueTest, run_all_items)
+{
+    OpenThreads::Atomic counter;
+    std::vector<osg::ref_ptr<SceneUtil::WorkTicket> > tickets;
+    {
+        SceneUtil::WorkQueue queue(4);
+        for (int i=0; i<1000; ++i)
+            tickets.push_back(queue.addWorkItem(new CountItem(counter)));
+        for (unsigned int i=0; i<tickets.size(); ++i)
+            tickets[i]->waitTillDone();
+    }
+    ASSERT_EQ(1000u, static_cast<unsigned int>(counter));
+}
+
+TEST(WorkQueueTest, destroying_discards_queued_items)
+{
+    OpenThreads::Atomic counter;
+    osg::ref_ptr<SceneUtil::WorkTicket> started (new SceneUtil::WorkTicket);
+    osg::ref_ptr<SceneUtil::WorkTicket> gate (new SceneUtil::WorkTicket);
+
+    SceneUtil::WorkQueue* queue = new SceneUtil::WorkQueue(1);
+    queue->addWorkItem(new BlockItem(started, gate));
+    started->waitTillDone();
+
+    std::vector<osg::ref_ptr<SceneUtil::WorkTicket> > tickets;
+    for (int i=0; i<1000; ++i)
+        tickets.push_back(queue->addWorkItem(new CountItem(counter)));
+
+    // Release the queue while its thread is still busy
+    DeleteQueueThread deleter (queue);
+    deleter.startThread();
+    OpenThreads::Thread::microSleep(100000);
+    gate->signalDone();
+    deleter.join();
+
+    EXPECT_EQ(0u, static_cast<unsigned int>(counter));
+    for (unsigned int i=0; i<tickets.size(); ++i)
+    {
+        ASSERT_TRUE(tickets[i]->isDone());
+        ASSERT_TRUE(tickets[i]->isCancelled());
+    }
+}
+
+/// Base class for tests that need the only thread of a queue to be busy while items are added
+struct BlockedWorkQueueTest : public ::testing::Test
+{
+protected:
+    BlockedWorkQueueTest()
+        : mQueue(1)
+        , mStarted(new SceneUtil::WorkTicket)
+        , mGate(new SceneUtil::WorkTicket)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        mQueue.addWorkItem(new BlockItem(mStarted, mGate));
+        mStarted->waitTillDone();
+    }
+
+    virtual void TearDown()
+    {
+        unblock();
+    }
+
+    void unblock()
+    {
+        if (!mGate->isDone())
+            mGate->signalDone();
+    }
+
+    // Used by the items, so must outlive the queue
+    OpenThreads::Mutex mMutex;
+    std::vector<int> mOrder;
+
+    SceneUtil::WorkQueue mQueue;
+    osg::ref_ptr<SceneUtil::WorkTicket> mStarted;
+    osg::ref_ptr<SceneUtil::WorkTicket> mGate;
+};
+
+TEST_F(BlockedWorkQueueTest, priorities)
+{
+    osg::ref_ptr<SceneUtil::WorkTicket> low = mQueue.addWorkItem(new RecordItem(2, mOrder, mMutex), SceneUtil::WorkQueue::Priority_Low);
+    mQueue.addWorkItem(new RecordItem(1, mOrder, mMutex));
+    mQueue.addWorkItem(new RecordItem(0, mOrder, mMutex), SceneUtil::WorkQueue::Priority_High);
+
+    unblock();
+    low->waitTillDone();
+
+    ASSERT_EQ(3u, mOrder.size());
+    ASSERT_EQ(0, mOrder[0]);
+    ASSERT_EQ(1, mOrder[1]);
+    ASSERT_EQ(2, mOrder[2]);
+}
+
+TEST_F(BlockedWorkQueueTest, cancel)
+{
+    osg::ref_ptr<SceneUtil::WorkTicket> cancelled = mQueue.addWorkItem(new RecordItem(0, mOrder, mMutex));
+    osg::ref_ptr<SceneUtil::WorkTicket> ticket = mQueue.addWorkItem(new RecordItem(1, mOrder, mMutex));
+    cancelled->cancel();
+
+    unblock();
+    cancelled->waitTillDone();
+    ticket->waitTillDone();
+
+    ASSERT_TRUE(cancelled->isCancelled());
+    ASSERT_FALSE(ticket->isCancelled());
+    ASSERT_EQ(1u, mOrder.size());
+    ASSERT_EQ(1, mOrder[0]);
+}
+
+TEST_F(BlockedWorkQueueTest, continuation)
+{
+    std::vector<osg::ref_ptr<SceneUtil::WorkTicket> > dependencies;
+    dependencies.push_back(mQueue.addWorkItem(new RecordItem(0, mOrder, mMutex)));
+    dependencies.push_back(mQueue.addWorkItem(new RecordItem(1, mOrder, mMutex)));
+    osg::ref_ptr<SceneUtil::WorkTicket> continuation = mQueue.addContinuation(new RecordItem(2, mOrder, mMutex), dependencies,
+                                                                              SceneUtil::WorkQueue::Priority_High);
+
+    // Must not run before its dependencies, despite the higher priority
+    unblock();
+    continuation->waitTillDone();
+
+    ASSERT_EQ(3u, mOrder.size());
+    ASSERT_EQ(2, mOrder[2]);
+
+    // A continuation of tickets that are done already is queued right away
+    mQueue.addContinuation(new RecordItem(3, mOrder, mMutex), dependencies)->waitTillDone();
+    ASSERT_EQ(4u, mOrder.size());
+}
@@ -0,0 +1,415 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <osg/Image>
+#include <osg/TexMat>
+#include <osg/Vec3f>
+
+#include "components/resource/texturemanager.hpp"
+#include "components/terrain/compositemap.hpp"
+#include "components/terrain/material.hpp"
+#include "components/terrain/storage.hpp"
+#include "components/vfs/manager.hpp"
+
+namespace
+{
+
+osg::ref_ptr<osg::Image> makeImage(int size, GLenum format, unsigned int seed, bool binary = false)
+{
+    osg::ref_ptr<osg::Image> image (new osg::Image);
+    image->allocateImage(size, size, 1, format, GL_UNSIGNED_BYTE);
+    std::srand(seed);
+    for (unsigned int i=0; i<image->getTotalSizeInBytes(); ++i)
+        image->data()[i] = binary ? (std::rand() % 2) * 255 : std::rand() % 256;
+    return image;
+}
+
+// What the passes of the FixedFunctionTechnique compute for a fragment, with GL_LINEAR filtering
+
+float sampleBlendmap(const osg::Image* blendmap, float u, float v)
+{
+    // The texture matrix maps the corners of the chunk to the centres of the outer texels
+    const int size = blendmap->s();
+    const float scale = (size - 1) / static_cast<float>(size);
+    float s = (0.5f + (u - 0.5f) * scale) * size - 0.5f;
+    float t = (0.5f + (v - 0.5f) * scale) * size - 0.5f;
+
+    // GL_CLAMP_TO_EDGE
+    int s0 = std::max(0, std::min(size - 1, static_cast<int>(std::floor(s))));
+    int s1 = std::max(0, std::min(size - 1, static_cast<int>(std::floor(s)) + 1));
+    int t0 = std::max(0, std::min(size - 1, static_cast<int>(std::floor(t))));
+    int t1 = std::max(0, std::min(size - 1, static_cast<int>(std::floor(t)) + 1));
+    float fs = s - std::floor(s);
+    float ft = t - std::floor(t);
+    float upper = *blendmap->data(s0, t0) * (1.f - fs) + *blendmap->data(s1, t0) * fs;
+    float lower = *blendmap->data(s0, t1) * (1.f - fs) + *blendmap->data(s1, t1) * fs;
+    return (upper * (1.f - ft) + lower * ft) / 255.f;
+}
+
+osg::Vec3f sampleLayer(const osg::Image* layer, float u, float v, float tileSize)
+{
+    const int size = layer->s();
+    float s = u * tileSize * size - 0.5f;
+    float t = v * tileSize * size - 0.5f;
+
+    // GL_REPEAT
+    int s0 = ((static_cast<int>(std::floor(s)) % size) + size) % size;
+    int t0 = ((static_cast<int>(std::floor(t)) % size) + size) % size;
+    int s1 = (s0 + 1) % size;
+    int t1 = (t0 + 1) % size;
+    float fs = s - std::floor(s);
+    float ft = t - std::floor(t);
+
+    osg::Vec3f colour;
+    for (int channel=0; channel<3; ++channel)
+    {
+        float upper = layer->data(s0, t0)[channel] * (1.f - fs) + layer->data(s1, t0)[channel] * fs;
+        float lower = layer->data(s0, t1)[channel] * (1.f - fs) + layer->data(s1, t1)[channel] * fs;
+        colour[channel] = upper * (1.f - ft) + lower * ft;
+    }
+    return colour;
+}
+
+osg::Vec3f drawPasses(const std::vector<osg::ref_ptr<osg::Image> >& layers, const std::vector<osg::ref_ptr<osg::Image> >& blendmaps,
+                      float tileSize, float u, float v)
+{
+    osg::Vec3f colour = sampleLayer(layers[0], u, v, tileSize);
+    for (unsigned int i=1; i<layers.size(); ++i)
+    {
+        // GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+        float alpha = sampleBlendmap(blendmaps[i-1], u, v);
+        colour = colour * (1.f - alpha) + sampleLayer(layers[i], u, v, tileSize) * alpha;
+    }
+    return colour;
+}
+
+void expectMatchesPasses(const std::vector<osg::ref_ptr<osg::Image> >& layers, const std::vector<osg::ref_ptr<osg::Image> >& blendmaps,
+                         float tileSize, int size)
+{
+    osg::ref_ptr<osg::Image> target (new osg::Image);
+    target->allocateImage(size, size, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    Terrain::compositeLayers(layers, blendmaps, tileSize, target, 0, 0, size);
+
+    float maxError = 0.f;
+    for (int y=0; y<size; ++y)
+    {
+        for (int x=0; x<size; ++x)
+        {
+            osg::Vec3f expected = drawPasses(layers, blendmaps, tileSize, (x + 0.5f) / size, (y + 0.5f) / size);
+            for (int channel=0; channel<3; ++channel)
+                maxError = std::max(maxError, std::abs(target->data(x, y)[channel] - expected[channel]));
+        }
+    }
+    // Rounding to bytes only
+    EXPECT_LE(maxError, 0.51f);
+}
+
+// Two layers on every cell, the second one blended in with a constant blend value
+class BlendStorage : public Terrain::Storage
+{
+public:
+    BlendStorage()
+        : mBlendValue(255)
+        , mNumBlendmapCalls(0)
+    {
+    }
+
+    virtual void getBounds(float& minX, float& maxX, float& minY, float& maxY)
+    {
+        minX = minY = 0.f;
+        maxX = maxY = 4.f;
+    }
+
+    virtual bool getMinMaxHeights(float size, const osg::Vec2f& center, float& min, float& max)
+    {
+        min = max = 0.f;
+        return true;
+    }
+
+    virtual void fillVertexBuffers(int lodLevel, float size, const osg::Vec2f& center, osg::ref_ptr<osg::Vec3Array> positions,
+                                   osg::ref_ptr<osg::Vec3Array> normals, osg::ref_ptr<osg::Vec4Array> colours)
+    {
+    }
+
+    virtual void getBlendmaps(float chunkSize, const osg::Vec2f& chunkCenter, bool pack, ImageVector& blendmaps,
+                              std::vector<Terrain::LayerInfo>& layerList)
+    {
+        ++mNumBlendmapCalls;
+        layerList.push_back(getDefaultLayer());
+        layerList.push_back(getDefaultLayer());
+        layerList.back().mDiffuseMap = "textures/b.dds";
+
+        osg::ref_ptr<osg::Image> blendmap (new osg::Image);
+        blendmap->allocateImage(17, 17, 1, GL_ALPHA, GL_UNSIGNED_BYTE);
+        std::memset(blendmap->data(), mBlendValue, blendmap->getTotalSizeInBytes());
+        blendmaps.push_back(blendmap);
+    }
+
+    virtual float getHeightAt(const osg::Vec3f& worldPos)
+    {
+        return 0.f;
+    }
+
+    virtual Terrain::LayerInfo getDefaultLayer()
+    {
+        Terrain::LayerInfo layer;
+        layer.mDiffuseMap = "textures/a.dds";
+        layer.mParallax = false;
+        layer.mSpecular = false;
+        return layer;
+    }
+
+    virtual float getCellWorldSize()
+    {
+        return 8192.f;
+    }
+
+    virtual int getCellVertices()
+    {
+        return 65;
+    }
+
+    unsigned char mBlendValue;
+    int mNumBlendmapCalls;
+};
+
+class TerrainCompositeMapBakerTest : public ::testing::Test
+{
+protected:
+    TerrainCompositeMapBakerTest()
+        : mVFS(false)
+        , mTextureManager(&mVFS)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        mDirectory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("openmw-composite-%%%%-%%%%");
+    }
+
+    virtual void TearDown()
+    {
+        boost::filesystem::remove_all(mDirectory);
+    }
+
+    // The layer textures are not in the VFS, so they are baked in the neutral colour
+    VFS::Manager mVFS;
+    Resource::TextureManager mTextureManager;
+    BlendStorage mStorage;
+    boost::filesystem::path mDirectory;
+};
+
+}
+
+TEST(TerrainCompositeMapTest, matches_per_layer_blending)
+{
+    std::vector<osg::ref_ptr<osg::Image> > layers;
+    std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+    for (unsigned int i=0; i<4; ++i)
+    {
+        layers.push_back(makeImage(4, GL_RGB, i));
+        if (i > 0)
+            // Storage::getBlendmaps only writes 0 or 255
+            blendmaps.push_back(makeImage(17, GL_ALPHA, 100 + i, true));
+    }
+    expectMatchesPasses(layers, blendmaps, 16.f, 64);
+    // Fewer texels than blendmap texels
+    expectMatchesPasses(layers, blendmaps, 16.f, 8);
+}
+
+TEST(TerrainCompositeMapTest, matches_per_layer_blending_for_partial_cells)
+{
+    std::vector<osg::ref_ptr<osg::Image> > layers;
+    std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+    layers.push_back(makeImage(16, GL_RGB, 1));
+    layers.push_back(makeImage(16, GL_RGB, 2));
+    blendmaps.push_back(makeImage(5, GL_ALPHA, 3));
+    // A quarter cell, as the smallest chunks of the QuadTreeWorld
+    expectMatchesPasses(layers, blendmaps, 4.f, 256);
+}
+
+TEST(TerrainCompositeMapTest, single_layer)
+{
+    std::vector<osg::ref_ptr<osg::Image> > layers;
+    layers.push_back(new osg::Image);
+    layers.back()->allocateImage(1, 1, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    layers.back()->data()[0] = 10;
+    layers.back()->data()[1] = 20;
+    layers.back()->data()[2] = 30;
+
+    osg::ref_ptr<osg::Image> target (new osg::Image);
+    target->allocateImage(4, 4, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    Terrain::compositeLayers(layers, std::vector<osg::ref_ptr<osg::Image> >(), 16.f, target, 0, 0, 4);
+    for (unsigned int i=0; i<16; ++i)
+    {
+        EXPECT_EQ(10, target->data()[i*3]);
+        EXPECT_EQ(20, target->data()[i*3+1]);
+        EXPECT_EQ(30, target->data()[i*3+2]);
+    }
+}
+
+TEST(TerrainCompositeMapTest, writes_only_its_region)
+{
+    std::vector<osg::ref_ptr<osg::Image> > layers;
+    std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+    layers.push_back(makeImage(2, GL_RGB, 1));
+    layers.push_back(makeImage(2, GL_RGB, 2));
+    blendmaps.push_back(makeImage(17, GL_ALPHA, 3, true));
+
+    osg::ref_ptr<osg::Image> region (new osg::Image);
+    region->allocateImage(16, 16, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    Terrain::compositeLayers(layers, blendmaps, 16.f, region, 0, 0, 16);
+
+    // The north east cell of a chunk of four cells
+    osg::ref_ptr<osg::Image> target (new osg::Image);
+    target->allocateImage(32, 32, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    std::memset(target->data(), 7, target->getTotalSizeInBytes());
+    Terrain::compositeLayers(layers, blendmaps, 16.f, target, 16, 16, 16);
+
+    for (int y=0; y<32; ++y)
+    {
+        for (int x=0; x<32; ++x)
+        {
+            for (int channel=0; channel<3; ++channel)
+            {
+                if (x >= 16 && y >= 16)
+                    ASSERT_EQ(region->data(x-16, y-16)[channel], target->data(x, y)[channel]);
+                else
+                    ASSERT_EQ(7, target->data(x, y)[channel]);
+            }
+        }
+    }
+}
+
+TEST(TerrainCompositeMapTest, filter_layer)
+{
+    // Quadrants of different colours
+    osg::ref_ptr<osg::Image> image (new osg::Image);
+    image->allocateImage(8, 8, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    for (int y=0; y<8; ++y)
+    {
+        for (int x=0; x<8; ++x)
+        {
+            unsigned char value = (x < 4 ? 0 : 100) + (y < 4 ? 0 : 50);
+            image->data(x, y)[0] = value;
+            image->data(x, y)[1] = value + 1;
+            image->data(x, y)[2] = value + 2;
+        }
+    }
+
+    osg::ref_ptr<osg::Image> filtered = Terrain::filterLayer(image, 2);
+    ASSERT_TRUE(filtered.valid());
+    ASSERT_EQ(2, filtered->s());
+    ASSERT_EQ(2, filtered->t());
+    EXPECT_EQ(0, filtered->data(0, 0)[0]);
+    EXPECT_EQ(100, filtered->data(1, 0)[0]);
+    EXPECT_EQ(50, filtered->data(0, 1)[0]);
+    EXPECT_EQ(150, filtered->data(1, 1)[0]);
+    EXPECT_EQ(152, filtered->data(1, 1)[2]);
+
+    filtered = Terrain::filterLayer(image, 1);
+    ASSERT_TRUE(filtered.valid());
+    EXPECT_EQ(75, filtered->data()[0]);
+
+    // Not larger than the source
+    filtered = Terrain::filterLayer(image, 64);
+    ASSERT_TRUE(filtered.valid());
+    EXPECT_EQ(8, filtered->s());
+    EXPECT_EQ(0, std::memcmp(image->data(), filtered->data(), image->getTotalSizeInBytes()));
+}
+
+TEST_F(TerrainCompositeMapBakerTest, bakes_chunks_larger_than_a_cell_cell_by_cell)
+{
+    Terrain::CompositeMapBaker baker (&mStorage, &mTextureManager, 64, boost::filesystem::path(), 0);
+
+    osg::ref_ptr<osg::Texture2D> texture = baker.getCompositeMap(4.f, osg::Vec2f(2.f, 2.f));
+    ASSERT_TRUE(texture.valid());
+    EXPECT_EQ(16, mStorage.mNumBlendmapCalls);
+
+    // Drawn across the chunk once, see ChunkBuilder
+    EXPECT_EQ(osg::Texture::CLAMP_TO_EDGE, texture->getWrap(osg::Texture::WRAP_S));
+    EXPECT_EQ(osg::Texture::CLAMP_TO_EDGE, texture->getWrap(osg::Texture::WRAP_T));
+
+    const osg::Image* image = texture->getImage();
+    ASSERT_TRUE(image != NULL);
+    EXPECT_EQ(64, image->s());
+    EXPECT_EQ(64, image->t());
+    for (unsigned int i=0; i<image->getTotalSizeInBytes(); ++i)
+        ASSERT_EQ(128, image->data()[i]);
+
+    // Kept in memory while in use
+    EXPECT_EQ(texture.get(), baker.getCompositeMap(4.f, osg::Vec2f(2.f, 2.f)).get());
+    EXPECT_EQ(16, mStorage.mNumBlendmapCalls);
+
+    // A quarter cell
+    texture = baker.getCompositeMap(0.25f, osg::Vec2f(0.125f, 0.125f));
+    EXPECT_EQ(17, mStorage.mNumBlendmapCalls);
+    EXPECT_EQ(64, texture->getImage()->s());
+}
+
+TEST_F(TerrainCompositeMapBakerTest, composite_maps_on_disk_are_baked_again_when_the_land_changes)
+{
+    {
+        Terrain::CompositeMapBaker baker (&mStorage, &mTextureManager, 32, mDirectory, 0);
+        baker.getCompositeMap(1.f, osg::Vec2f(0.5f, 0.5f));
+    }
+
+    boost::filesystem::path filename;
+    for (boost::filesystem::directory_iterator it (mDirectory); it != boost::filesystem::directory_iterator(); ++it)
+    {
+        ASSERT_TRUE(filename.empty());
+        filename = it->path();
+    }
+    ASSERT_EQ(".composite", filename.extension().string());
+
+    // Tamper with the last texel, to tell the cached composite map from a baked one
+    {
+        boost::filesystem::fstream stream (filename, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(-1, std::ios::end);
+        stream.put(7);
+    }
+
+    {
+        Terrain::CompositeMapBaker baker (&mStorage, &mTextureManager, 32, mDirectory, 0);
+        osg::ref_ptr<osg::Texture2D> texture = baker.getCompositeMap(1.f, osg::Vec2f(0.5f, 0.5f));
+        const osg::Image* image = texture->getImage();
+        ASSERT_EQ(32, image->s());
+        EXPECT_EQ(7, image->data()[image->getTotalSizeInBytes()-1]);
+    }
+
+    mStorage.mBlendValue = 100;
+    {
+        Terrain::CompositeMapBaker baker (&mStorage, &mTextureManager, 32, mDirectory, 0);
+        osg::ref_ptr<osg::Texture2D> texture = baker.getCompositeMap(1.f, osg::Vec2f(0.5f, 0.5f));
+        const osg::Image* image = texture->getImage();
+        ASSERT_EQ(32, image->s());
+        EXPECT_EQ(128, image->data()[image->getTotalSizeInBytes()-1]);
+    }
+}
+
+TEST(TerrainCompositeMapTest, composite_map_is_drawn_in_one_pass)
+{
+    // What ChunkBuilder passes to the Effect of a chunk with a composite map
+    std::vector<osg::ref_ptr<osg::Texture2D> > layers;
+    layers.push_back(new osg::Texture2D);
+    osg::ref_ptr<Terrain::FixedFunctionTechnique> technique (new Terrain::FixedFunctionTechnique(
+                layers, std::vector<osg::ref_ptr<osg::Texture2D> >(), 64, 1.f));
+
+    ASSERT_EQ(1, technique->getNumPasses());
+    const osg::StateSet* stateset = technique->getPassStateSet(0);
+    EXPECT_EQ(layers[0].get(), stateset->getTextureAttribute(0, osg::StateAttribute::TEXTURE));
+    EXPECT_TRUE(stateset->getTextureAttribute(1, osg::StateAttribute::TEXTURE) == NULL);
+    EXPECT_EQ(0u, stateset->getMode(GL_BLEND) & osg::StateAttribute::ON);
+
+    // The composite map covers the chunk once
+    const osg::TexMat* texMat = dynamic_cast<const osg::TexMat*>(stateset->getTextureAttribute(0, osg::StateAttribute::TEXMAT));
+    ASSERT_TRUE(texMat != NULL);
+    EXPECT_TRUE(texMat->getMatrix().isIdentity());
+}
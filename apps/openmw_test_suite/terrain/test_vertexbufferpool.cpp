@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <osg/Geometry>
+
+#include "components/terrain/vertexbufferpool.hpp"
+
+TEST(TerrainVertexBufferPoolTest, allocates_slabs_of_the_requested_size)
+{
+    Terrain::VertexBufferPool pool;
+    Terrain::VertexBufferPool::Slab slab = pool.getSlab(289);
+    ASSERT_TRUE(slab.mPositions.valid() && slab.mNormals.valid() && slab.mColours.valid());
+    EXPECT_EQ(289u, slab.mPositions->size());
+    EXPECT_EQ(289u, slab.mNormals->size());
+    EXPECT_EQ(289u, slab.mColours->size());
+
+    // One vertex buffer object for all arrays of the chunk
+    EXPECT_TRUE(slab.mPositions->getVertexBufferObject() != NULL);
+    EXPECT_EQ(slab.mPositions->getVertexBufferObject(), slab.mNormals->getVertexBufferObject());
+    EXPECT_EQ(slab.mPositions->getVertexBufferObject(), slab.mColours->getVertexBufferObject());
+    EXPECT_EQ(1u, pool.getNumSlabs(289));
+}
+
+TEST(TerrainVertexBufferPoolTest, slabs_in_use_are_not_handed_out_again)
+{
+    Terrain::VertexBufferPool pool;
+    Terrain::VertexBufferPool::Slab first = pool.getSlab(289);
+    Terrain::VertexBufferPool::Slab second = pool.getSlab(289);
+    EXPECT_NE(first.mPositions, second.mPositions);
+
+    // A chunk that still uses only some of the arrays
+    osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
+    geometry->setNormalArray(second.mNormals, osg::Array::BIND_PER_VERTEX);
+    second = Terrain::VertexBufferPool::Slab();
+
+    Terrain::VertexBufferPool::Slab third = pool.getSlab(289);
+    EXPECT_NE(first.mPositions, third.mPositions);
+    EXPECT_NE(geometry->getNormalArray(), third.mNormals.get());
+    EXPECT_EQ(3u, pool.getNumSlabs(289));
+}
+
+TEST(TerrainVertexBufferPoolTest, recycles_slabs_of_released_chunks)
+{
+    Terrain::VertexBufferPool pool;
+    osg::Vec3Array* positions = NULL;
+    {
+        Terrain::VertexBufferPool::Slab slab = pool.getSlab(289);
+        osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
+        geometry->setVertexArray(slab.mPositions);
+        geometry->setNormalArray(slab.mNormals, osg::Array::BIND_PER_VERTEX);
+        geometry->setColorArray(slab.mColours, osg::Array::BIND_PER_VERTEX);
+        positions = slab.mPositions.get();
+    }
+    for (unsigned int i=0; i<=Terrain::VertexBufferPool::sFrameFence; ++i)
+        pool.update();
+
+    Terrain::VertexBufferPool::Slab slab = pool.getSlab(289);
+    EXPECT_EQ(positions, slab.mPositions.get());
+    EXPECT_EQ(1u, pool.getNumSlabs(289));
+
+    // Other sizes have their own slabs
+    Terrain::VertexBufferPool::Slab other = pool.getSlab(81);
+    EXPECT_EQ(81u, other.mPositions->size());
+    EXPECT_EQ(1u, pool.getNumSlabs(289));
+    EXPECT_EQ(1u, pool.getNumSlabs(81));
+}
+
+TEST(TerrainVertexBufferPoolTest, slabs_are_recycled_only_after_the_frame_fence)
+{
+    Terrain::VertexBufferPool pool;
+    osg::Vec3Array* positions = pool.getSlab(289).mPositions.get();
+
+    // Found free in the first update. A draw thread may still draw the released chunk until the fence has passed.
+    for (unsigned int i=0; i<=Terrain::VertexBufferPool::sFrameFence; ++i)
+    {
+        pool.update();
+        if (i < Terrain::VertexBufferPool::sFrameFence)
+        {
+            Terrain::VertexBufferPool::Slab slab = pool.getSlab(289);
+            EXPECT_NE(positions, slab.mPositions.get());
+        }
+    }
+    EXPECT_EQ(1u + Terrain::VertexBufferPool::sFrameFence, pool.getNumSlabs(289));
+    EXPECT_EQ(positions, pool.getSlab(289).mPositions.get());
+
+    // Without updates, nothing is recycled
+    Terrain::VertexBufferPool other;
+    other.getSlab(81);
+    other.getSlab(81);
+    EXPECT_EQ(2u, other.getNumSlabs(81));
+}
+
+TEST(TerrainVertexBufferPoolTest, releases_free_slabs_beyond_the_limit)
+{
+    Terrain::VertexBufferPool pool (2);
+    std::vector<Terrain::VertexBufferPool::Slab> slabs;
+    for (unsigned int i=0; i<5; ++i)
+        slabs.push_back(pool.getSlab(289));
+    pool.getSlab(81);
+
+    // Released chunks keep their slabs until the fence has passed
+    slabs.resize(1);
+    pool.update();
+    EXPECT_EQ(5u, pool.getNumSlabs(289));
+    for (unsigned int i=0; i<Terrain::VertexBufferPool::sFrameFence; ++i)
+        pool.update();
+    EXPECT_EQ(3u, pool.getNumSlabs(289));
+    EXPECT_EQ(1u, pool.getNumSlabs(81));
+
+    // The slab in use is kept
+    slabs.push_back(pool.getSlab(289));
+    slabs.push_back(pool.getSlab(289));
+    EXPECT_EQ(3u, pool.getNumSlabs(289));
+    EXPECT_NE(slabs[0].mPositions, slabs[1].mPositions);
+    EXPECT_NE(slabs[0].mPositions, slabs[2].mPositions);
+}
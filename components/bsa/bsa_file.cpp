@@ -162,10 +162,16 @@ int BSAFile::getIndex(const char *str) const
 }
 
 /// Open an archive file.
-void BSAFile::open(const string &file)
+void BSAFile::open(const string &file, bool memoryMapped)
 {
     filename = file;
     readHeader();
+
+    if (memoryMapped)
+    {
+        mapping.reset(new Files::MemoryMappedFile);
+        mapping->open(filename.c_str());
+    }
 }
 
 Files::IStreamPtr BSAFile::getFile(const char *file)
@@ -175,12 +181,22 @@ Files::IStreamPtr BSAFile::getFile(const char *file)
     if(i == -1)
         fail("File not found: " + string(file));
 
-    const FileStruct &fs = files[i];
-
-    return Files::openConstrainedFileStream (filename.c_str (), fs.offset, fs.fileSize);
+    return getFile(&files[i]);
 }
 
 Files::IStreamPtr BSAFile::getFile(const FileStruct *file)
 {
+    if (mapping)
+        return Files::IStreamPtr(new Files::MemoryMappedFileStream(mapping, file->offset, file->fileSize));
+
     return Files::openConstrainedFileStream (filename.c_str (), file->offset, file->fileSize);
 }
+
+const char* BSAFile::getFileData(const FileStruct *file) const
+{
+    if (!mapping)
+        return NULL;
+
+    // Offsets were validated against the archive size in readHeader()
+    return mapping->getData() + file->offset;
+}
@@ -32,6 +32,7 @@
 #include <components/misc/stringops.hpp>
 
 #include <components/files/constrainedfilestream.hpp>
+#include <components/files/memorymappedfile.hpp>
 
 
 namespace Bsa
@@ -69,6 +70,9 @@ private:
     /// Used for error messages
     std::string filename;
 
+    /// The whole archive mapped into memory, if opened in memory mapped mode
+    Files::MemoryMappedFilePtr mapping;
+
     /// Case insensitive string comparison
     struct iltstr
     {
@@ -103,7 +107,13 @@ public:
     { }
 
     /// Open an archive file.
-    void open(const std::string &file);
+    /// @param memoryMapped Map the whole archive into memory, so that files can be
+    /// read without further system calls or copies.
+    void open(const std::string &file, bool memoryMapped=false);
+
+    /// Is the archive mapped into memory?
+    bool isMemoryMapped() const
+    { return mapping.get() != NULL; }
 
     /* -----------------------------------
      * Archive file routines
@@ -121,6 +131,12 @@ public:
 
     Files::IStreamPtr getFile(const FileStruct* file);
 
+    /** Get a pointer to the contents of a file contained in the archive.
+        Only available in memory mapped mode, returns NULL otherwise.
+        The data remains valid for as long as the archive is open.
+    */
+    const char* getFileData(const FileStruct* file) const;
+
     /// Get a list of all files
     const FileList &getList() const
     { return files; }
@@ -2,11 +2,21 @@
 
 #include <stdexcept>
 
+namespace
+{
+    OpenThreads::Mutex sOnDemandMutex;
+}
+
 namespace ESM
 {
 
 using namespace Misc;
 
+OpenThreads::Mutex& ESMReader::getOnDemandMutex()
+{
+    return sOnDemandMutex;
+}
+
     std::string ESMReader::getName() const
     {
         return mCtx.filename;
@@ -7,6 +7,8 @@
 #include <vector>
 #include <sstream>
 
+#include <OpenThreads/Mutex>
+
 #include <components/files/constrainedfilestream.hpp>
 
 #include <components/misc/stringops.hpp>
@@ -87,6 +89,10 @@ public:
   void setGlobalReaderList(std::vector<ESMReader> *list) {mGlobalReaderList = list;}
   std::vector<ESMReader> *getGlobalReaderList() {return mGlobalReaderList;}
 
+  /// After the content files are loaded, their readers are still used for the data loaded on demand, e.g. the land
+  /// data and the cell references, which may be loaded from several threads. Hold this lock while using a reader for that.
+  static OpenThreads::Mutex& getOnDemandMutex();
+
   /*************************************************************************
    *
    *  Medium-level reading shortcuts
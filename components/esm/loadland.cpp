@@ -2,6 +2,8 @@
 
 #include <utility>
 
+#include <OpenThreads/ScopedLock>
+
 #include "esmreader.hpp"
 #include "esmwriter.hpp"
 #include "defs.hpp"
@@ -180,6 +182,9 @@ namespace ESM
 
     void Land::loadData(int flags) const
     {
+        // The terrain loads the data in the background, see ESMReader::getOnDemandMutex
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(ESMReader::getOnDemandMutex());
+
         // Try to load only available data
         flags = flags & mDataTypes;
         // Return if all required data is loaded
@@ -232,6 +237,7 @@ namespace ESM
 
     void Land::unloadData()
     {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(ESMReader::getOnDemandMutex());
         if (mDataLoaded)
         {
             delete mLandData;
@@ -253,6 +259,7 @@ namespace ESM
 
     bool Land::isDataLoaded(int flags) const
     {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(ESMReader::getOnDemandMutex());
         return (mDataLoaded & flags) == (flags & mDataTypes);
     }
 
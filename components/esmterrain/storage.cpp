@@ -1,5 +1,6 @@
 #include "storage.hpp"
 
+#include <cstring>
 #include <set>
 
 #include <osg/Image>
@@ -109,34 +110,6 @@ namespace ESMTerrain
         normal.normalize();
     }
 
-    void Storage::fixColour (osg::Vec4f& color, int cellX, int cellY, int col, int row)
-    {
-        if (col == ESM::Land::LAND_SIZE-1)
-        {
-            ++cellY;
-            col = 0;
-        }
-        if (row == ESM::Land::LAND_SIZE-1)
-        {
-            ++cellX;
-            row = 0;
-        }
-
-        if (const ESM::Land::LandData *data = getLandData (cellX, cellY, ESM::Land::DATA_VCLR))
-        {
-            color.r() = data->mColours[col*ESM::Land::LAND_SIZE*3+row*3] / 255.f;
-            color.g() = data->mColours[col*ESM::Land::LAND_SIZE*3+row*3+1] / 255.f;
-            color.b() = data->mColours[col*ESM::Land::LAND_SIZE*3+row*3+2] / 255.f;
-        }
-        else
-        {
-            color.r() = 1;
-            color.g() = 1;
-            color.b() = 1;
-        }
-
-    }
-
     void Storage::fillVertexBuffers (int lodLevel, float size, const osg::Vec2f& center,
                                             osg::ref_ptr<osg::Vec3Array> positions,
                                             osg::ref_ptr<osg::Vec3Array> normals,
@@ -156,21 +129,34 @@ namespace ESMTerrain
         normals->resize(numVerts*numVerts);
         colours->resize(numVerts*numVerts);
 
-        osg::Vec3f normal;
-        osg::Vec4f color;
+        osg::Vec3f* positionData = &(*positions)[0];
+        osg::Vec3f* normalData = &(*normals)[0];
+        osg::Vec4f* colourData = &(*colours)[0];
 
-        float vertY = 0;
-        float vertX = 0;
+        // The local coordinates are the same for each row and column
+        std::vector<float> coords (numVerts);
+        for (size_t i=0; i<numVerts; ++i)
+            coords[i] = (i / float(numVerts - 1) - 0.5f) * size * 8192;
 
-        float vertY_ = 0; // of current cell corner
+        size_t vertY_ = 0; // of current cell corner
         for (int cellY = startCellY; cellY < startCellY + std::ceil(size); ++cellY)
         {
-            float vertX_ = 0; // of current cell corner
+            size_t vertX_ = 0; // of current cell corner
+            size_t vertY = vertY_;
             for (int cellX = startCellX; cellX < startCellX + std::ceil(size); ++cellX)
             {
-                const ESM::Land::LandData *heightData = getLandData (cellX, cellY, ESM::Land::DATA_VHGT);
-                const ESM::Land::LandData *normalData = getLandData (cellX, cellY, ESM::Land::DATA_VNML);
-                const ESM::Land::LandData *colourData = getLandData (cellX, cellY, ESM::Land::DATA_VCLR);
+                const ESM::Land::LandData *heights = getLandData (cellX, cellY, ESM::Land::DATA_VHGT);
+
+                // The last row / column of a cell is taken from the neighbours, since the seams don't match in the data.
+                // Looked up once for the cell rather than for each vertex on its edges.
+                // Indexed by (row at the east edge) + 2*(column at the north edge).
+                const ESM::Land::LandData *normalSources[4];
+                const ESM::Land::LandData *colourSources[4];
+                for (int i=0; i<4; ++i)
+                {
+                    normalSources[i] = getLandData (cellX + i%2, cellY + i/2, ESM::Land::DATA_VNML);
+                    colourSources[i] = getLandData (cellX + i%2, cellY + i/2, ESM::Land::DATA_VCLR);
+                }
 
                 int rowStart = 0;
                 int colStart = 0;
@@ -187,71 +173,58 @@ namespace ESMTerrain
                 colStart += (origin.y() - startCellY) * ESM::Land::LAND_SIZE;
                 int rowEnd = rowStart + std::min(1.f, size) * (ESM::Land::LAND_SIZE-1) + 1;
                 int colEnd = colStart + std::min(1.f, size) * (ESM::Land::LAND_SIZE-1) + 1;
+                // Skipping the first row / column above must not move the end past the last row / column of the cell
+                rowEnd = std::min(rowEnd, static_cast<int>(ESM::Land::LAND_SIZE));
+                colEnd = std::min(colEnd, static_cast<int>(ESM::Land::LAND_SIZE));
 
+                size_t vertX = vertX_;
                 vertY = vertY_;
                 for (int col=colStart; col<colEnd; col += increment)
                 {
+                    assert(col >= 0 && col < ESM::Land::LAND_SIZE);
+                    assert (vertY < numVerts);
+
+                    const bool northEdge = (col == ESM::Land::LAND_SIZE-1);
+                    const int srcCol = northEdge ? 0 : col;
+
                     vertX = vertX_;
                     for (int row=rowStart; row<rowEnd; row += increment)
                     {
-                        int srcArrayIndex = col*ESM::Land::LAND_SIZE*3+row*3;
-
                         assert(row >= 0 && row < ESM::Land::LAND_SIZE);
-                        assert(col >= 0 && col < ESM::Land::LAND_SIZE);
-
                         assert (vertX < numVerts);
-                        assert (vertY < numVerts);
 
-                        float height = -2048;
-                        if (heightData)
-                            height = heightData->mHeights[col*ESM::Land::LAND_SIZE + row];
+                        const bool eastEdge = (row == ESM::Land::LAND_SIZE-1);
+                        const int source = (eastEdge ? 1 : 0) + (northEdge ? 2 : 0);
+                        const int srcArrayIndex = srcCol*ESM::Land::LAND_SIZE*3 + (eastEdge ? 0 : row)*3;
+                        const size_t index = vertX*numVerts + vertY;
 
-                        (*positions)[static_cast<unsigned int>(vertX*numVerts + vertY)]
-                            = osg::Vec3f((vertX / float(numVerts - 1) - 0.5f) * size * 8192,
-                                         (vertY / float(numVerts - 1) - 0.5f) * size * 8192,
-                                         height);
+                        float height = -2048;
+                        if (heights)
+                            height = heights->mHeights[col*ESM::Land::LAND_SIZE + row];
+                        positionData[index] = osg::Vec3f(coords[vertX], coords[vertY], height);
 
-                        if (normalData)
+                        osg::Vec3f& normal = normalData[index];
+                        if (const ESM::Land::LandData* data = normalSources[source])
                         {
-                            for (int i=0; i<3; ++i)
-                                normal[i] = normalData->mNormals[srcArrayIndex+i];
-
+                            normal = osg::Vec3f(data->mNormals[srcArrayIndex], data->mNormals[srcArrayIndex+1], data->mNormals[srcArrayIndex+2]);
                             normal.normalize();
                         }
                         else
                             normal = osg::Vec3f(0,0,1);
 
-                        // Normals apparently don't connect seamlessly between cells
-                        if (col == ESM::Land::LAND_SIZE-1 || row == ESM::Land::LAND_SIZE-1)
-                            fixNormal(normal, cellX, cellY, col, row);
-
                         // some corner normals appear to be complete garbage (z < 0)
-                        if ((row == 0 || row == ESM::Land::LAND_SIZE-1) && (col == 0 || col == ESM::Land::LAND_SIZE-1))
+                        if ((row == 0 || eastEdge) && (col == 0 || northEdge))
                             averageNormal(normal, cellX, cellY, col, row);
 
                         assert(normal.z() > 0);
 
-                        (*normals)[static_cast<unsigned int>(vertX*numVerts + vertY)] = normal;
-
-                        if (colourData)
-                        {
-                            for (int i=0; i<3; ++i)
-                                color[i] = colourData->mColours[srcArrayIndex+i] / 255.f;
-                        }
-                        else
-                        {
-                            color.r() = 1;
-                            color.g() = 1;
-                            color.b() = 1;
-                        }
-
                         // Unlike normals, colors mostly connect seamlessly between cells, but not always...
-                        if (col == ESM::Land::LAND_SIZE-1 || row == ESM::Land::LAND_SIZE-1)
-                            fixColour(color, cellX, cellY, col, row);
-
-                        color.a() = 1;
-
-                        (*colours)[static_cast<unsigned int>(vertX*numVerts + vertY)] = color;
+                        osg::Vec4f& color = colourData[index];
+                        if (const ESM::Land::LandData* data = colourSources[source])
+                            color = osg::Vec4f(data->mColours[srcArrayIndex] / 255.f, data->mColours[srcArrayIndex+1] / 255.f,
+                                               data->mColours[srcArrayIndex+2] / 255.f, 1.f);
+                        else
+                            color = osg::Vec4f(1.f, 1.f, 1.f, 1.f);
 
                         ++vertX;
                     }
@@ -342,12 +315,11 @@ namespace ESMTerrain
         // So we're always adding _land_default.dds as the base layer here, even if it's not referenced in this cell.
         textureIndices.insert(std::make_pair(0,0));
 
+        std::vector<UniqueTextureId> textureIds;
+        getTextureIds(cellX, cellY, textureIds);
         for (int y=colStart; y<colEnd; ++y)
             for (int x=rowStart; x<rowEnd; ++x)
-            {
-                UniqueTextureId id = getVtexIndexAt(cellX, cellY, x, y);
-                textureIndices.insert(id);
-            }
+                textureIndices.insert(textureIds[y*realTextureSize + x]);
 
         // Makes sure the indices are sorted, or rather,
         // retrieved as sorted. This is important to keep the splatting order
@@ -369,33 +341,72 @@ namespace ESMTerrain
         // Second iteration - create and fill in the blend maps
         const int blendmapSize = (realTextureSize-1) * chunkSize + 1;
 
+        std::vector<unsigned char*> blendmapData;
         for (int i=0; i<numBlendmaps; ++i)
         {
             GLenum format = pack ? GL_RGBA : GL_ALPHA;
 
             osg::ref_ptr<osg::Image> image (new osg::Image);
             image->allocateImage(blendmapSize, blendmapSize, 1, format, GL_UNSIGNED_BYTE);
-            unsigned char* pData = image->data();
+            std::memset(image->data(), 0, image->getTotalSizeInBytes());
+            blendmapData.push_back(image->data());
+            blendmaps.push_back(image);
+        }
 
-            for (int y=0; y<blendmapSize; ++y)
+        // All blend maps are filled in one pass, each texel is only set in the blend map and channel of its layer
+        UniqueTextureId lastId = std::make_pair(0,0);
+        int lastLayerIndex = 0;
+        for (int y=0; y<blendmapSize; ++y)
+        {
+            const UniqueTextureId* row = &textureIds[(y+colStart)*realTextureSize + rowStart];
+            for (int x=0; x<blendmapSize; ++x)
             {
-                for (int x=0; x<blendmapSize; ++x)
+                // Neighbouring texels mostly have the same texture
+                if (row[x] != lastId)
                 {
-                    UniqueTextureId id = getVtexIndexAt(cellX, cellY, x+rowStart, y+colStart);
-                    assert(textureIndicesMap.find(id) != textureIndicesMap.end());
-                    int layerIndex = textureIndicesMap.find(id)->second;
-                    int blendIndex = (pack ? static_cast<int>(std::floor((layerIndex - 1) / 4.f)) : layerIndex - 1);
-                    int channel = pack ? std::max(0, (layerIndex-1) % 4) : 0;
-
-                    if (blendIndex == i)
-                        pData[y*blendmapSize*channels + x*channels + channel] = 255;
-                    else
-                        pData[y*blendmapSize*channels + x*channels + channel] = 0;
+                    assert(textureIndicesMap.find(row[x]) != textureIndicesMap.end());
+                    lastId = row[x];
+                    lastLayerIndex = textureIndicesMap.find(lastId)->second;
                 }
+
+                // The base layer doesn't need blending
+                if (lastLayerIndex == 0)
+                    continue;
+
+                int blendIndex = pack ? (lastLayerIndex - 1) / 4 : lastLayerIndex - 1;
+                int channel = pack ? (lastLayerIndex - 1) % 4 : 0;
+                blendmapData[blendIndex][y*blendmapSize*channels + x*channels + channel] = 255;
             }
+        }
+    }
 
-            blendmaps.push_back(image);
+    void Storage::getTextureIds(int cellX, int cellY, std::vector<UniqueTextureId>& textureIds)
+    {
+        std::pair<int, int> cell = std::make_pair(cellX, cellY);
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mTextureIdsMutex);
+            TextureIdMap::const_iterator found = mTextureIds.find(cell);
+            if (found != mTextureIds.end())
+            {
+                textureIds = found->second;
+                return;
+            }
         }
+
+        const int realTextureSize = ESM::Land::LAND_TEXTURE_SIZE+1;
+        textureIds.resize(realTextureSize*realTextureSize);
+        for (int y=0; y<realTextureSize; ++y)
+            for (int x=0; x<realTextureSize; ++x)
+                textureIds[y*realTextureSize + x] = getVtexIndexAt(cellX, cellY, x, y);
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mTextureIdsMutex);
+        mTextureIds.insert(std::make_pair(cell, textureIds));
+    }
+
+    void Storage::clearCache()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mTextureIdsMutex);
+        mTextureIds.clear();
     }
 
     float Storage::getHeightAt(const osg::Vec3f &worldPos)
@@ -488,9 +499,12 @@ namespace ESMTerrain
     Terrain::LayerInfo Storage::getLayerInfo(const std::string& texture)
     {
         // Already have this cached?
-        std::map<std::string, Terrain::LayerInfo>::iterator found = mLayerInfoMap.find(texture);
-        if (found != mLayerInfoMap.end())
-            return found->second;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mLayerInfoMutex);
+            std::map<std::string, Terrain::LayerInfo>::iterator found = mLayerInfoMap.find(texture);
+            if (found != mLayerInfoMap.end())
+                return found->second;
+        }
 
         Terrain::LayerInfo info;
         info.mParallax = false;
@@ -520,6 +534,7 @@ namespace ESMTerrain
             info.mSpecular = true;
         }
 
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mLayerInfoMutex);
         mLayerInfoMap[texture] = info;
 
         return info;
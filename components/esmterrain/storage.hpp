@@ -1,6 +1,11 @@
 #ifndef COMPONENTS_ESM_TERRAIN_STORAGE_H
 #define COMPONENTS_ESM_TERRAIN_STORAGE_H
 
+#include <map>
+#include <vector>
+
+#include <OpenThreads/Mutex>
+
 #include <components/terrain/storage.hpp>
 
 #include <components/esm/loadland.hpp>
@@ -86,11 +91,12 @@ namespace ESMTerrain
         /// Get the number of vertices on one side for each cell. Should be (power of two)+1
         virtual int getCellVertices();
 
+        virtual void clearCache();
+
     private:
         const VFS::Manager* mVFS;
 
         void fixNormal (osg::Vec3f& normal, int cellX, int cellY, int col, int row);
-        void fixColour (osg::Vec4f& colour, int cellX, int cellY, int col, int row);
         void averageNormal (osg::Vec3f& normal, int cellX, int cellY, int col, int row);
 
         float getVertexHeight (const ESM::Land* land, int x, int y);
@@ -102,9 +108,19 @@ namespace ESMTerrain
 
         UniqueTextureId getVtexIndexAt(int cellX, int cellY,
                                                int x, int y);
+
+        /// Get the result of getVtexIndexAt for every blendmap texel of a cell, (LAND_TEXTURE_SIZE+1)^2 in row-major order.
+        /// @note Resolved once for each cell and kept until clearCache(), since getBlendmaps needs them for each chunk and blendmap.
+        void getTextureIds(int cellX, int cellY, std::vector<UniqueTextureId>& textureIds);
+
+        typedef std::map<std::pair<int, int>, std::vector<UniqueTextureId> > TextureIdMap;
+        TextureIdMap mTextureIds;
+        OpenThreads::Mutex mTextureIdsMutex;
+
         std::string getTextureName (UniqueTextureId id);
 
         std::map<std::string, Terrain::LayerInfo> mLayerInfoMap;
+        OpenThreads::Mutex mLayerInfoMutex;
 
         Terrain::LayerInfo getLayerInfo(const std::string& texture);
     };
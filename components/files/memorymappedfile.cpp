@@ -0,0 +1,196 @@
+#include "memorymappedfile.hpp"
+
+#include <stdexcept>
+#include <sstream>
+#include <cassert>
+
+#if FILE_API == FILE_API_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#elif FILE_API == FILE_API_WIN32
+#include <boost/locale.hpp>
+#endif
+
+namespace
+{
+
+    void failOpen(const char* filename)
+    {
+        std::ostringstream os;
+        os << "Failed to map '" << filename << "' into memory.";
+        throw std::runtime_error (os.str ());
+    }
+
+}
+
+namespace Files
+{
+
+MemoryMappedFile::MemoryMappedFile()
+    : mData(NULL)
+    , mSize(0)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    close();
+}
+
+#if FILE_API == FILE_API_STDIO
+
+void MemoryMappedFile::open(const char *filename)
+{
+    assert(mData == NULL);
+
+    FILE* handle = fopen(filename, "rb");
+    if (handle == NULL)
+        failOpen(filename);
+
+    long size = -1;
+    if (fseek(handle, 0, SEEK_END) == 0)
+        size = ftell(handle);
+
+    if (size < 0 || fseek(handle, 0, SEEK_SET) != 0)
+    {
+        fclose(handle);
+        failOpen(filename);
+    }
+
+    mBuffer.resize(size);
+    if (size > 0 && fread(&mBuffer[0], 1, size, handle) != size_t(size))
+    {
+        fclose(handle);
+        mBuffer.clear();
+        failOpen(filename);
+    }
+    fclose(handle);
+
+    mSize = mBuffer.size();
+    mData = mSize ? &mBuffer[0] : NULL;
+}
+
+void MemoryMappedFile::close()
+{
+    std::vector<char>().swap(mBuffer);
+    mData = NULL;
+    mSize = 0;
+}
+
+#elif FILE_API == FILE_API_POSIX
+
+void MemoryMappedFile::open(const char *filename)
+{
+    assert(mData == NULL);
+
+#ifdef O_BINARY
+    static const int openFlags = O_RDONLY | O_BINARY;
+#else
+    static const int openFlags = O_RDONLY;
+#endif
+
+    int handle = ::open(filename, openFlags, 0);
+    if (handle == -1)
+        failOpen(filename);
+
+    struct stat info;
+    if (::fstat(handle, &info) == -1)
+    {
+        ::close(handle);
+        failOpen(filename);
+    }
+
+    size_t size = info.st_size;
+    if (size > 0)
+    {
+        void* data = ::mmap(NULL, size, PROT_READ, MAP_PRIVATE, handle, 0);
+        if (data == MAP_FAILED)
+        {
+            ::close(handle);
+            failOpen(filename);
+        }
+        mData = static_cast<const char*>(data);
+    }
+    mSize = size;
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(handle);
+}
+
+void MemoryMappedFile::close()
+{
+    if (mData != NULL)
+        ::munmap(const_cast<char*>(mData), mSize);
+    mData = NULL;
+    mSize = 0;
+}
+
+#elif FILE_API == FILE_API_WIN32
+
+void MemoryMappedFile::open(const char *filename)
+{
+    assert(mData == NULL);
+
+    std::wstring wname = boost::locale::conv::utf_to_utf<wchar_t>(filename);
+    HANDLE handle = CreateFileW (wname.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if (handle == INVALID_HANDLE_VALUE)
+        failOpen(filename);
+
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle (handle, &info) || info.nFileSizeHigh != 0)
+    {
+        CloseHandle(handle);
+        failOpen(filename);
+    }
+
+    size_t size = info.nFileSizeLow;
+    if (size > 0)
+    {
+        HANDLE mapping = CreateFileMappingW(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+        {
+            CloseHandle(handle);
+            failOpen(filename);
+        }
+
+        const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+        // The view keeps the mapping object alive
+        CloseHandle(mapping);
+
+        if (data == NULL)
+        {
+            CloseHandle(handle);
+            failOpen(filename);
+        }
+        mData = static_cast<const char*>(data);
+    }
+    mSize = size;
+
+    CloseHandle(handle);
+}
+
+void MemoryMappedFile::close()
+{
+    if (mData != NULL)
+        UnmapViewOfFile(mData);
+    mData = NULL;
+    mSize = 0;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------
+
+MemoryMappedFileStream::MemoryMappedFileStream(MemoryMappedFilePtr file, size_t start, size_t length)
+    : MemBuf(file->getData() + start, length)
+    , IMemStream(file->getData() + start, length)
+    , mFile(file)
+{
+    assert(start + length <= file->getSize());
+}
+
+}
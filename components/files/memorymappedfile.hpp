@@ -0,0 +1,59 @@
+#ifndef OPENMW_COMPONENTS_FILES_MEMORYMAPPEDFILE_H
+#define OPENMW_COMPONENTS_FILES_MEMORYMAPPEDFILE_H
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "lowlevelfile.hpp"
+#include "memorystream.hpp"
+
+namespace Files
+{
+
+    /// @brief A read-only view of a whole file that is mapped into memory.
+    /// @note On platforms without memory mapping support, the file is read into a buffer instead.
+    class MemoryMappedFile
+    {
+    public:
+        MemoryMappedFile();
+        ~MemoryMappedFile();
+
+        /// @note Throws an exception if the file can not be mapped.
+        void open(const char* filename);
+
+        void close();
+
+        /// Get a pointer to the start of the file contents. May be NULL for empty files.
+        const char* getData() const { return mData; }
+
+        size_t getSize() const { return mSize; }
+
+    private:
+        MemoryMappedFile(const MemoryMappedFile&);
+        MemoryMappedFile& operator=(const MemoryMappedFile&);
+
+        const char* mData;
+        size_t mSize;
+
+#if FILE_API == FILE_API_STDIO
+        std::vector<char> mBuffer;
+#endif
+    };
+
+    typedef boost::shared_ptr<MemoryMappedFile> MemoryMappedFilePtr;
+
+    /// @brief A stream reading from a region of a memory mapped file, without copying.
+    /// @par Keeps the mapping alive for as long as the stream exists.
+    class MemoryMappedFileStream : public IMemStream
+    {
+    public:
+        MemoryMappedFileStream(MemoryMappedFilePtr file, size_t start, size_t length);
+
+    private:
+        MemoryMappedFilePtr mFile;
+    };
+
+}
+
+#endif
@@ -8,110 +8,167 @@
 
 namespace Interpreter
 {
-    void Interpreter::execute (Type_Code code)
+    Program::Program() : mInterpreter (0) {}
+
+    bool Program::isDecoded() const
     {
-        unsigned int segSpec = code>>30;
+        return mInterpreter!=0;
+    }
 
-        switch (segSpec)
+    void Program::clear()
+    {
+        mInterpreter = 0;
+        mInstructions.clear();
+    }
+
+    namespace
+    {
+        template<typename T>
+        T *findOpcode (const std::map<int, T *>& segment, int opcode)
         {
-            case 0:
-            {
-                int opcode = code>>24;
-                unsigned int arg0 = code & 0xffffff;
+            typename std::map<int, T *>::const_iterator iter = segment.find (opcode);
 
-                std::map<int, Opcode1 *>::iterator iter = mSegment0.find (opcode);
+            if (iter==segment.end())
+                return 0;
 
-                if (iter==mSegment0.end())
-                    abortUnknownCode (0, opcode);
+            return iter->second;
+        }
+    }
 
-                iter->second->execute (mRuntime, arg0);
+    void Interpreter::decode (Type_Code code, Program::Instruction& instruction) const
+    {
+        instruction.mArg0 = 0;
+        instruction.mArg1 = 0;
 
-                return;
-            }
+        int segment = -1;
+        int opcode = 0;
+        bool found = false;
 
-            case 1:
-            {
-                int opcode = (code>>24) & 0x3f;
-                unsigned int arg0 = (code>>16) & 0xfff;
-                unsigned int arg1 = code & 0xfff;
+        unsigned int segSpec = code>>30;
 
-                std::map<int, Opcode2 *>::iterator iter = mSegment1.find (opcode);
+        switch (segSpec)
+        {
+            case 0:
 
-                if (iter==mSegment1.end())
-                    abortUnknownCode (1, opcode);
+                segment = 0;
+                opcode = code>>24;
+                instruction.mType = Program::Instruction::Type_Opcode1;
+                instruction.mOpcode1 = findOpcode (mSegment0, opcode);
+                found = instruction.mOpcode1!=0;
+                instruction.mArg0 = code & 0xffffff;
+                break;
 
-                iter->second->execute (mRuntime, arg0, arg1);
+            case 1:
 
-                return;
-            }
+                segment = 1;
+                opcode = (code>>24) & 0x3f;
+                instruction.mType = Program::Instruction::Type_Opcode2;
+                instruction.mOpcode2 = findOpcode (mSegment1, opcode);
+                found = instruction.mOpcode2!=0;
+                instruction.mArg0 = (code>>16) & 0xfff;
+                instruction.mArg1 = code & 0xfff;
+                break;
 
             case 2:
-            {
-                int opcode = (code>>20) & 0x3ff;
-                unsigned int arg0 = code & 0xfffff;
 
-                std::map<int, Opcode1 *>::iterator iter = mSegment2.find (opcode);
-
-                if (iter==mSegment2.end())
-                    abortUnknownCode (2, opcode);
-
-                iter->second->execute (mRuntime, arg0);
-
-                return;
-            }
+                segment = 2;
+                opcode = (code>>20) & 0x3ff;
+                instruction.mType = Program::Instruction::Type_Opcode1;
+                instruction.mOpcode1 = findOpcode (mSegment2, opcode);
+                found = instruction.mOpcode1!=0;
+                instruction.mArg0 = code & 0xfffff;
+                break;
+
+            default:
+
+                switch (code>>26)
+                {
+                    case 0x30:
+
+                        segment = 3;
+                        opcode = (code>>8) & 0x3ffff;
+                        instruction.mType = Program::Instruction::Type_Opcode1;
+                        instruction.mOpcode1 = findOpcode (mSegment3, opcode);
+                        found = instruction.mOpcode1!=0;
+                        instruction.mArg0 = code & 0xff;
+                        break;
+
+                    case 0x31:
+
+                        segment = 4;
+                        opcode = (code>>16) & 0x3ff;
+                        instruction.mType = Program::Instruction::Type_Opcode2;
+                        instruction.mOpcode2 = findOpcode (mSegment4, opcode);
+                        found = instruction.mOpcode2!=0;
+                        instruction.mArg0 = (code>>8) & 0xff;
+                        instruction.mArg1 = code & 0xff;
+                        break;
+
+                    case 0x32:
+
+                        segment = 5;
+                        opcode = code & 0x3ffffff;
+                        instruction.mType = Program::Instruction::Type_Opcode0;
+                        instruction.mOpcode0 = findOpcode (mSegment5, opcode);
+                        found = instruction.mOpcode0!=0;
+                        break;
+                }
         }
 
-        segSpec = code>>26;
-
-        switch (segSpec)
+        if (segment==-1)
         {
-            case 0x30:
-            {
-                int opcode = (code>>8) & 0x3ffff;
-                unsigned int arg0 = code & 0xff;
-
-                std::map<int, Opcode1 *>::iterator iter = mSegment3.find (opcode);
+            instruction.mType = Program::Instruction::Type_UnknownSegment;
+            instruction.mArg0 = code;
+        }
+        else if (!found)
+        {
+            // Unknown opcodes are reported when they are executed, not when the script is decoded
+            instruction.mType = Program::Instruction::Type_UnknownCode;
+            instruction.mArg0 = opcode;
+            instruction.mArg1 = segment;
+        }
+    }
 
-                if (iter==mSegment3.end())
-                    abortUnknownCode (3, opcode);
+    void Interpreter::execute (const Program& program)
+    {
+        const Program::Instruction *instructions = &program.mInstructions[0];
+        const int size = static_cast<int> (program.mInstructions.size());
 
-                iter->second->execute (mRuntime, arg0);
+        int pc;
 
-                return;
-            }
+        while ((pc = mRuntime.getPC())>=0 && pc<size)
+        {
+            const Program::Instruction& instruction = instructions[pc];
+            mRuntime.setPC (pc+1);
 
-            case 0x31:
+            switch (instruction.mType)
             {
-                int opcode = (code>>16) & 0x3ff;
-                unsigned int arg0 = (code>>8) & 0xff;
-                unsigned int arg1 = code & 0xff;
+                case Program::Instruction::Type_Opcode0:
 
-                std::map<int, Opcode2 *>::iterator iter = mSegment4.find (opcode);
+                    instruction.mOpcode0->execute (mRuntime);
+                    break;
 
-                if (iter==mSegment4.end())
-                    abortUnknownCode (4, opcode);
+                case Program::Instruction::Type_Opcode1:
 
-                iter->second->execute (mRuntime, arg0, arg1);
+                    instruction.mOpcode1->execute (mRuntime, instruction.mArg0);
+                    break;
 
-                return;
-            }
+                case Program::Instruction::Type_Opcode2:
 
-            case 0x32:
-            {
-                int opcode = code & 0x3ffffff;
+                    instruction.mOpcode2->execute (mRuntime, instruction.mArg0, instruction.mArg1);
+                    break;
 
-                std::map<int, Opcode0 *>::iterator iter = mSegment5.find (opcode);
+                case Program::Instruction::Type_UnknownCode:
 
-                if (iter==mSegment5.end())
-                    abortUnknownCode (5, opcode);
+                    abortUnknownCode (instruction.mArg1, instruction.mArg0);
+                    break;
 
-                iter->second->execute (mRuntime);
+                case Program::Instruction::Type_UnknownSegment:
 
-                return;
+                    abortUnknownSegment (instruction.mArg0);
+                    break;
             }
         }
-
-        abortUnknownSegment (code);
     }
 
     void Interpreter::abortUnknownCode (int segment, int opcode)
@@ -225,26 +282,47 @@ namespace Interpreter
         mSegment5.insert (std::make_pair (code, opcode));
     }
 
+    void Interpreter::decode (const Type_Code *code, int codeSize, Program& program) const
+    {
+        assert (codeSize>=4);
+
+        int opcodes = static_cast<int> (code[0]);
+
+        assert (codeSize>=4+opcodes);
+
+        const Type_Code *codeBlock = code + 4;
+
+        program.mInstructions.resize (opcodes);
+
+        for (int i=0; i<opcodes; ++i)
+            decode (codeBlock[i], program.mInstructions[i]);
+
+        program.mInterpreter = this;
+    }
+
     void Interpreter::run (const Type_Code *code, int codeSize, Context& context)
+    {
+        Program program;
+        run (code, codeSize, program, context);
+    }
+
+    void Interpreter::run (const Type_Code *code, int codeSize, Program& program, Context& context)
     {
         assert (codeSize>=4);
 
+        if (program.mInterpreter!=this)
+            decode (code, codeSize, program);
+
+        if (program.mInstructions.empty())
+            return;
+
         begin();
 
         try
         {
             mRuntime.configure (code, codeSize, context);
 
-            int opcodes = static_cast<int> (code[0]);
-
-            const Type_Code *codeBlock = code + 4;
-
-            while (mRuntime.getPC()>=0 && mRuntime.getPC()<opcodes)
-            {
-                Type_Code code = codeBlock[mRuntime.getPC()];
-                mRuntime.setPC (mRuntime.getPC()+1);
-                execute (code);
-            }
+            execute (program);
         }
         catch (...)
         {
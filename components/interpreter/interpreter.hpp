@@ -3,6 +3,7 @@
 
 #include <map>
 #include <stack>
+#include <vector>
 
 #include "runtime.hpp"
 #include "types.hpp"
@@ -12,6 +13,56 @@ namespace Interpreter
     class Opcode0;
     class Opcode1;
     class Opcode2;
+    class Interpreter;
+
+    /// \brief Byte code of a script, decoded by an Interpreter.
+    ///
+    /// Each instruction is decoded only once into its opcode and unpacked arguments, so running the
+    /// script does not need to look up the opcodes again.
+    class Program
+    {
+        public:
+
+            struct Instruction
+            {
+                enum Type
+                {
+                    Type_Opcode0,
+                    Type_Opcode1,
+                    Type_Opcode2,
+                    Type_UnknownCode, ///< mArg0: opcode, mArg1: segment
+                    Type_UnknownSegment ///< mArg0: instruction
+                };
+
+                Type mType;
+
+                union
+                {
+                    Opcode0 *mOpcode0;
+                    Opcode1 *mOpcode1;
+                    Opcode2 *mOpcode2;
+                };
+
+                unsigned int mArg0;
+                unsigned int mArg1;
+            };
+
+        private:
+
+            friend class Interpreter;
+
+            const Interpreter *mInterpreter;
+            std::vector<Instruction> mInstructions;
+
+        public:
+
+            Program();
+
+            bool isDecoded() const;
+
+            void clear();
+            ///< Discard the decoded instructions, e.g. because the byte code changed.
+    };
 
     class Interpreter
     {
@@ -29,7 +80,9 @@ namespace Interpreter
             Interpreter (const Interpreter&);
             Interpreter& operator= (const Interpreter&);
 
-            void execute (Type_Code code);
+            void decode (Type_Code code, Program::Instruction& instruction) const;
+
+            void execute (const Program& program);
 
             void abortUnknownCode (int segment, int opcode);
 
@@ -63,7 +116,16 @@ namespace Interpreter
             void installSegment5 (int code, Opcode0 *opcode);
             ///< ownership of \a opcode is transferred to *this.
 
+            void decode (const Type_Code *code, int codeSize, Program& program) const;
+            ///< Decode the instructions of \a code. Opcodes installed afterwards are not
+            /// picked up by \a program, it needs to be decoded again.
+
             void run (const Type_Code *code, int codeSize, Context& context);
+            ///< Decode and run \a code. Prefer the overload taking a Program for code that
+            /// is run repeatedly.
+
+            void run (const Type_Code *code, int codeSize, Program& program, Context& context);
+            ///< Run \a code, decoding it into \a program first if it is not decoded yet.
     };
 }
 
@@ -8,11 +8,6 @@ namespace Interpreter
 {
     Runtime::Runtime() : mContext (0), mCode (0), mCodeSize(0), mPC (0) {}
 
-    int Runtime::getPC() const
-    {
-        return mPC;
-    }
-
     int Runtime::getIntegerLiteral (int index) const
     {
         assert (index>=0 && index<static_cast<int> (mCode[1]));
@@ -67,11 +62,6 @@ namespace Interpreter
         mStack.clear();
     }
 
-    void Runtime::setPC (int PC)
-    {
-        mPC = PC;
-    }
-
     void Runtime::push (const Data& data)
     {
         mStack.push_back (data);
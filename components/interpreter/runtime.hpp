@@ -24,7 +24,7 @@ namespace Interpreter
 
             Runtime ();
 
-            int getPC() const;
+            int getPC() const { return mPC; }
             ///< return program counter.
 
             int getIntegerLiteral (int index) const;
@@ -39,7 +39,7 @@ namespace Interpreter
 
             void clear();
 
-            void setPC (int PC);
+            void setPC (int PC) { mPC = PC; }
             ///< set program counter.
 
             void push (const Data& data);
@@ -55,6 +55,20 @@ public:
         return 0;
     }
 
+    /// Case insensitive FNV-1a hash of the first \a len characters of \a str
+    static size_t ciHash(const char *str, size_t len)
+    {
+        size_t hash = static_cast<size_t>(2166136261u);
+        for (size_t i=0; i<len; ++i)
+            hash = (hash ^ static_cast<unsigned char>(tolower(str[i]))) * static_cast<size_t>(16777619u);
+        return hash;
+    }
+
+    static size_t ciHash(const std::string &str)
+    {
+        return ciHash(str.data(), str.size());
+    }
+
     /// Transforms input string to lower case w/o copy
     static std::string &toLower(std::string &inout) {
         for (unsigned int i=0; i<inout.size(); ++i)
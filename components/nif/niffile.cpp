@@ -2,8 +2,13 @@
 #include "effect.hpp"
 
 #include <map>
+#include <new>
 #include <sstream>
 
+#include <boost/type_traits/alignment_of.hpp>
+
+#include <components/vfs/archive.hpp>
+
 namespace Nif
 {
 
@@ -12,24 +17,43 @@ NIFFile::NIFFile(Files::IStreamPtr stream, const std::string &name)
     : ver(0)
     , filename(name)
     , mUseSkinning(false)
-    , mStream(stream)
+    , mFileSize(0)
+{
+    parse(stream);
+}
+
+NIFFile::NIFFile(VFS::File *file, const std::string &name)
+    : ver(0)
+    , filename(name)
+    , mUseSkinning(false)
+    , mFileSize(0)
 {
-    parse();
+    // Decode straight from the archive if it is memory mapped
+    size_t size = 0;
+    if (const char* data = file->getData(size))
+        parse(data, size);
+    else
+        parse(file->open());
 }
 
 NIFFile::~NIFFile()
 {
+    // The records live in mArena, which releases their memory once it is destroyed
     for (std::vector<Record*>::iterator it = records.begin() ; it != records.end(); ++it)
     {
-        delete *it;
+        if (*it)
+            (*it)->~Record();
     }
 }
 
-template <typename NodeType> static Record* construct() { return new NodeType; }
+template <typename NodeType> static Record* construct(RecordArena& arena)
+{
+    return new (arena.allocate(sizeof(NodeType), boost::alignment_of<NodeType>::value)) NodeType;
+}
 
 struct RecordFactoryEntry {
 
-    typedef Record* (*create_t) ();
+    typedef Record* (*create_t) (RecordArena&);
 
     create_t        mCreate;
     RecordType      mType;
@@ -37,7 +61,7 @@ struct RecordFactoryEntry {
 };
 
 ///Helper function for adding records to the factory map
-static std::pair<std::string,RecordFactoryEntry> makeEntry(std::string recName, Record* (*create_t) (), RecordType type)
+static std::pair<std::string,RecordFactoryEntry> makeEntry(std::string recName, Record* (*create_t) (RecordArena&), RecordType type)
 {
     RecordFactoryEntry anEntry = {create_t,type};
     return std::make_pair(recName, anEntry);
@@ -134,9 +158,31 @@ std::string NIFFile::printVersion(unsigned int version)
     return stream.str();
 }
 
-void NIFFile::parse()
+void NIFFile::parse(Files::IStreamPtr stream)
+{
+    // Read the whole file at once, so that records can be decoded straight from memory
+    std::vector<char> buffer;
+    stream->seekg(0, std::ios_base::end);
+    std::streamoff size = stream->tellg();
+    if (size <= 0)
+        fail("Failed to read file");
+    stream->seekg(0, std::ios_base::beg);
+    buffer.resize(static_cast<size_t>(size));
+    stream->read(&buffer[0], buffer.size());
+    if (stream->gcount() != size)
+        fail("Failed to read file");
+
+    parse(&buffer[0], buffer.size());
+}
+
+void NIFFile::parse(const char *data, size_t size)
 {
-    NIFStream nif (this, mStream);
+    if (!size)
+        fail("Failed to read file");
+
+    mFileSize = size;
+
+    NIFStream nif (this, data, size);
 
     // Check the header string
     std::string head = nif.getVersionString();
@@ -176,7 +222,7 @@ void NIFFile::parse()
 
         if (entry != factories.end())
         {
-            r = entry->second.mCreate ();
+            r = entry->second.mCreate (mArena);
             r->recType = entry->second.mType;
         }
         else
@@ -10,6 +10,12 @@
 #include <components/files/constrainedfilestream.hpp>
 
 #include "record.hpp"
+#include "recordarena.hpp"
+
+namespace VFS
+{
+    class File;
+}
 
 namespace Nif
 {
@@ -26,6 +32,9 @@ class NIFFile
     /// File name, used for error messages and opening the file
     std::string filename;
 
+    /// Storage for the records, released all at once when the file is destroyed
+    RecordArena mArena;
+
     /// Record list
     std::vector<Record*> records;
 
@@ -34,8 +43,13 @@ class NIFFile
 
     bool mUseSkinning;
 
+    /// Size of the parsed file in bytes
+    size_t mFileSize;
+
     /// Parse the file
-    void parse();
+    void parse(Files::IStreamPtr stream);
+    /// Parse the file from its contents in memory, which are only needed during parsing
+    void parse(const char* data, size_t size);
 
     /// Get the file's version in a human readable form
     ///\returns A string containing a human readable NIF version number
@@ -46,8 +60,6 @@ class NIFFile
     ///\overload
     void operator = (NIFFile const &);
 
-    Files::IStreamPtr mStream;
-
 public:
     /// Used if file parsing fails
     void fail(const std::string &msg)
@@ -65,6 +77,9 @@ public:
 
     /// Open a NIF stream. The name is used for error messages.
     NIFFile(Files::IStreamPtr stream, const std::string &name);
+    /// Open a NIF file from the VFS. Files in memory mapped archives are parsed in place rather than read
+    /// through a stream, see VFS::File::getData.
+    NIFFile(VFS::File* file, const std::string &name);
     ~NIFFile();
 
     /// Get a given record
@@ -91,6 +106,12 @@ public:
 
     bool getUseSkinning() const;
 
+    /// Get the allocator used for the records, e.g. to gather statistics
+    const RecordArena& getRecordArena() const { return mArena; }
+
+    /// Get the size of the parsed file in bytes
+    size_t getFileSize() const { return mFileSize; }
+
     /// Get the name of the file
     std::string getFilename(){ return filename; }
 };
@@ -1,78 +1,95 @@
 #include "nifstream.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+
 //For error reporting
 #include "niffile.hpp"
 
+namespace
+{
+
+    bool isLittleEndian()
+    {
+        const uint16_t one = 1;
+        return *reinterpret_cast<const uint8_t*>(&one) == 1;
+    }
+
+}
+
 namespace Nif
 {
 
 //Private functions
-uint8_t NIFStream::read_byte()
-{
-    uint8_t byte;
-    inp->read((char*)&byte, 1);
-    return byte;
-}
-uint16_t NIFStream::read_le16()
+void NIFStream::failReadPastEnd(size_t count, size_t elementSize)
 {
-    uint8_t buffer[2];
-    inp->read((char*)buffer, 2);
-    return buffer[0] | (buffer[1]<<8);
+    std::stringstream error;
+    error << "Attempted to read " << count << " elements of " << elementSize << " bytes at offset " << mPos << ", past the end of the file (" << mSize << " bytes)";
+    file->fail(error.str());
 }
-uint32_t NIFStream::read_le32()
+
+void NIFStream::readLittleEndian16(void *dest, size_t count)
 {
-    uint8_t buffer[4];
-    inp->read((char*)buffer, 4);
-    return buffer[0] | (buffer[1]<<8) | (buffer[2]<<16) | (buffer[3]<<24);
+    checkAvailable(count, 2);
+    std::memcpy(dest, mData + mPos, count * 2);
+    mPos += count * 2;
+
+    if (!isLittleEndian())
+    {
+        uint8_t* bytes = static_cast<uint8_t*>(dest);
+        for (size_t i=0; i<count; ++i, bytes += 2)
+            std::swap(bytes[0], bytes[1]);
+    }
 }
-float NIFStream::read_le32f()
+
+void NIFStream::readLittleEndian32(void *dest, size_t count)
 {
-    union {
-        uint32_t i;
-        float f;
-    } u = { read_le32() };
-    return u.f;
+    checkAvailable(count, 4);
+    std::memcpy(dest, mData + mPos, count * 4);
+    mPos += count * 4;
+
+    if (!isLittleEndian())
+    {
+        uint8_t* bytes = static_cast<uint8_t*>(dest);
+        for (size_t i=0; i<count; ++i, bytes += 4)
+        {
+            std::swap(bytes[0], bytes[3]);
+            std::swap(bytes[1], bytes[2]);
+        }
+    }
 }
 
 //Public functions
 osg::Vec2f NIFStream::getVector2()
 {
     osg::Vec2f vec;
-    for(size_t i = 0;i < 2;i++)
-        vec._v[i] = getFloat();
+    readLittleEndian32(vec._v, 2);
     return vec;
 }
 osg::Vec3f NIFStream::getVector3()
 {
     osg::Vec3f vec;
-    for(size_t i = 0;i < 3;i++)
-        vec._v[i] = getFloat();
+    readLittleEndian32(vec._v, 3);
     return vec;
 }
 osg::Vec4f NIFStream::getVector4()
 {
     osg::Vec4f vec;
-    for(size_t i = 0;i < 4;i++)
-        vec._v[i] = getFloat();
+    readLittleEndian32(vec._v, 4);
     return vec;
 }
 Matrix3 NIFStream::getMatrix3()
 {
     Matrix3 mat;
-    for(size_t i = 0;i < 3;i++)
-    {
-        for(size_t j = 0;j < 3;j++)
-            mat.mValues[i][j] = getFloat();
-    }
+    readLittleEndian32(&mat.mValues[0][0], 9);
     return mat;
 }
 osg::Quat NIFStream::getQuaternion()
 {
-    osg::Quat quat;
-    quat.w() = getFloat();
-    quat.x() = getFloat();
-    quat.y() = getFloat();
-    quat.z() = getFloat();
-    return quat;
+    float values[4];
+    readLittleEndian32(values, 4);
+    return osg::Quat(values[1], values[2], values[3], values[0]);
 }
 Transformation NIFStream::getTrafo()
 {
@@ -85,11 +102,12 @@ Transformation NIFStream::getTrafo()
 
 std::string NIFStream::getString(size_t length)
 {
-    std::vector<char> str (length+1, 0);
-
-    inp->read(&str[0], length);
+    checkAvailable(length);
+    const char* begin = mData + mPos;
+    mPos += length;
 
-    return &str[0];
+    // The string ends at the first null character, if any
+    return std::string(begin, std::find(begin, begin + length, '\0'));
 }
 std::string NIFStream::getString()
 {
@@ -98,46 +116,65 @@ std::string NIFStream::getString()
 }
 std::string NIFStream::getVersionString()
 {
-    std::string result;
-    std::getline(*inp, result);
-    return result;
+    const char* begin = mData + mPos;
+    const char* end = std::find(begin, mData + mSize, '\n');
+    mPos = std::min<size_t>(end + 1 - mData, mSize);
+    return std::string(begin, end);
 }
 
+// The array readers copy the whole array at once, which relies on the vector types being tightly packed floats.
 void NIFStream::getUShorts(osg::VectorGLushort* vec, size_t size)
 {
-    vec->reserve(size);
-    for(size_t i = 0;i < size;i++)
-        vec->push_back(getUShort());
+    checkAvailable(size, 2);
+    size_t offset = vec->size();
+    vec->resize(offset + size);
+    if (size)
+        readLittleEndian16(&(*vec)[offset], size);
 }
 void NIFStream::getFloats(std::vector<float> &vec, size_t size)
 {
+    checkAvailable(size, 4);
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getFloat();
+    if (size)
+        readLittleEndian32(&vec[0], size);
 }
 void NIFStream::getVector2s(osg::Vec2Array* vec, size_t size)
 {
-    vec->reserve(size);
-    for(size_t i = 0;i < size;i++)
-        vec->push_back(getVector2());
+    checkAvailable(size, 8);
+    size_t offset = vec->size();
+    vec->resize(offset + size);
+    if (size)
+        readLittleEndian32((*vec)[offset].ptr(), size * 2);
 }
 void NIFStream::getVector3s(osg::Vec3Array* vec, size_t size)
 {
-    vec->reserve(size);
-    for(size_t i = 0;i < size;i++)
-        vec->push_back(getVector3());
+    checkAvailable(size, 12);
+    size_t offset = vec->size();
+    vec->resize(offset + size);
+    if (size)
+        readLittleEndian32((*vec)[offset].ptr(), size * 3);
 }
 void NIFStream::getVector4s(osg::Vec4Array* vec, size_t size)
 {
-    vec->reserve(size);
-    for(size_t i = 0;i < size;i++)
-        vec->push_back(getVector4());
+    checkAvailable(size, 16);
+    size_t offset = vec->size();
+    vec->resize(offset + size);
+    if (size)
+        readLittleEndian32((*vec)[offset].ptr(), size * 4);
 }
 void NIFStream::getQuaternions(std::vector<osg::Quat> &quat, size_t size)
 {
+    // osg::Quat is stored as doubles in x, y, z, w order, so the floats must be converted
+    checkAvailable(size, 16);
+    std::vector<float> values;
+    getFloats(values, size * 4);
+
     quat.resize(size);
     for(size_t i = 0;i < quat.size();i++)
-        quat[i] = getQuaternion();
+    {
+        const float* value = &values[i*4];
+        quat[i].set(value[1], value[2], value[3], value[0]);
+    }
 }
 
 }
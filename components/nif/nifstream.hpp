@@ -6,8 +6,7 @@
 #include <stdint.h>
 #include <stdexcept>
 #include <vector>
-
-#include <components/files/constrainedfilestream.hpp>
+#include <string>
 
 #include <osg/Vec3f>
 #include <osg/Vec4f>
@@ -23,23 +22,66 @@ namespace Nif
 
 class NIFFile;
 
+/// @brief Reads NIF data from a contiguous in-memory buffer.
+/// @note Reading past the end of the buffer is reported as an error through NIFFile::fail.
 class NIFStream {
 
-    /// Input stream
-    Files::IStreamPtr inp;
-
-    uint8_t read_byte();
-    uint16_t read_le16();
-    uint32_t read_le32();
-    float read_le32f();
+    /// Input data, not owned by the stream
+    const char* mData;
+    size_t mSize;
+    size_t mPos;
+
+    /// Fail unless there are at least @a count more elements of @a elementSize bytes to read
+    void checkAvailable(size_t count, size_t elementSize=1)
+    {
+        if (count > (mSize - mPos) / elementSize)
+            failReadPastEnd(count, elementSize);
+    }
+    void failReadPastEnd(size_t count, size_t elementSize);
+
+    /// Copy @a count little-endian 16-bit values into @a dest, converting to host byte order
+    void readLittleEndian16(void* dest, size_t count);
+    /// Copy @a count little-endian 32-bit values into @a dest, converting to host byte order
+    void readLittleEndian32(void* dest, size_t count);
+
+    uint8_t read_byte()
+    {
+        checkAvailable(1);
+        return static_cast<uint8_t>(mData[mPos++]);
+    }
+    uint16_t read_le16()
+    {
+        checkAvailable(2);
+        const uint8_t* buffer = reinterpret_cast<const uint8_t*>(mData + mPos);
+        mPos += 2;
+        return buffer[0] | (buffer[1]<<8);
+    }
+    uint32_t read_le32()
+    {
+        checkAvailable(4);
+        const uint8_t* buffer = reinterpret_cast<const uint8_t*>(mData + mPos);
+        mPos += 4;
+        return buffer[0] | (buffer[1]<<8) | (buffer[2]<<16) | (uint32_t(buffer[3])<<24);
+    }
+    float read_le32f()
+    {
+        union {
+            uint32_t i;
+            float f;
+        } u = { read_le32() };
+        return u.f;
+    }
 
 public:
 
     NIFFile * const file;
 
-    NIFStream (NIFFile * file, Files::IStreamPtr inp): inp (inp), file (file) {}
+    NIFStream (NIFFile * file, const char* data, size_t size): mData (data), mSize (size), mPos (0), file (file) {}
+
+    void skip(size_t size) { checkAvailable(size); mPos += size; }
 
-    void skip(size_t size) { inp->ignore(size); }
+    /// Number of bytes read so far
+    size_t tell() const { return mPos; }
 
     char getChar() { return read_byte(); }
     short getShort() { return read_le16(); }
@@ -0,0 +1,51 @@
+#include "recordarena.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+namespace Nif
+{
+
+RecordArena::RecordArena(size_t blockSize)
+    : mBlockSize(blockSize)
+    , mCurrent(NULL)
+    , mEnd(NULL)
+    , mNumAllocations(0)
+    , mBytesUsed(0)
+    , mBytesReserved(0)
+{
+}
+
+RecordArena::~RecordArena()
+{
+    for (std::vector<char*>::iterator it = mBlocks.begin(); it != mBlocks.end(); ++it)
+        delete[] *it;
+}
+
+void* RecordArena::allocate(size_t size, size_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment-1)) == 0);
+
+    size_t padding = (alignment - (reinterpret_cast<size_t>(mCurrent) & (alignment-1))) & (alignment-1);
+    if (mCurrent == NULL || size + padding > size_t(mEnd - mCurrent))
+    {
+        // Start a new block. Oversized requests get a block of their own.
+        size_t blockSize = std::max(mBlockSize, size + alignment);
+        char* block = new char[blockSize];
+        mBlocks.push_back(block);
+        mBytesReserved += blockSize;
+
+        mCurrent = block;
+        mEnd = block + blockSize;
+        padding = (alignment - (reinterpret_cast<size_t>(mCurrent) & (alignment-1))) & (alignment-1);
+    }
+
+    char* result = mCurrent + padding;
+    mCurrent = result + size;
+
+    ++mNumAllocations;
+    mBytesUsed += size;
+    return result;
+}
+
+}
@@ -0,0 +1,52 @@
+#ifndef OPENMW_COMPONENTS_NIF_RECORDARENA_HPP
+#define OPENMW_COMPONENTS_NIF_RECORDARENA_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace Nif
+{
+
+/// @brief Monotonic allocator for the records of a NIFFile.
+/// @par Memory is handed out from large blocks and only released all at once, when the arena is destroyed.
+/// The arena does not run destructors, the owner is responsible for destroying the objects it placed in the arena.
+class RecordArena
+{
+public:
+    RecordArena(size_t blockSize = 64*1024);
+    ~RecordArena();
+
+    /// Allocate @a size bytes with the given alignment, which must be a power of two.
+    void* allocate(size_t size, size_t alignment);
+
+    /// Number of allocations made from this arena
+    size_t getNumAllocations() const { return mNumAllocations; }
+
+    /// Number of blocks requested from the system allocator
+    size_t getNumBlocks() const { return mBlocks.size(); }
+
+    /// Total number of bytes handed out. As memory is never reused, this is also the peak usage.
+    size_t getBytesUsed() const { return mBytesUsed; }
+
+    /// Total size of all blocks
+    size_t getBytesReserved() const { return mBytesReserved; }
+
+private:
+    RecordArena(const RecordArena&);
+    RecordArena& operator=(const RecordArena&);
+
+    size_t mBlockSize;
+
+    std::vector<char*> mBlocks;
+
+    char* mCurrent;
+    char* mEnd;
+
+    size_t mNumAllocations;
+    size_t mBytesUsed;
+    size_t mBytesReserved;
+};
+
+}
+
+#endif
@@ -76,9 +76,7 @@ KeyframeController::KeyframeController(const KeyframeController &copy, const osg
     : osg::NodeCallback(copy, copyop)
     , Controller(copy)
     , mRotations(copy.mRotations)
-    , mXRotations(copy.mXRotations)
-    , mYRotations(copy.mYRotations)
-    , mZRotations(copy.mZRotations)
+    , mXYZRotations(copy.mXYZRotations)
     , mTranslations(copy.mTranslations)
     , mScales(copy.mScales)
 {
@@ -86,67 +84,15 @@ KeyframeController::KeyframeController(const KeyframeController &copy, const osg
 
 KeyframeController::KeyframeController(const Nif::NiKeyframeData *data)
     : mRotations(data->mRotations)
-    , mXRotations(data->mXRotations)
-    , mYRotations(data->mYRotations)
-    , mZRotations(data->mZRotations)
+    , mXYZRotations(data->mXRotations, data->mYRotations, data->mZRotations)
     , mTranslations(data->mTranslations)
     , mScales(data->mScales)
 {
 }
 
-osg::Quat KeyframeController::interpKey(const Nif::QuaternionKeyMap::MapType &keys, float time)
-{
-    if(time <= keys.begin()->first)
-        return keys.begin()->second.mValue;
-
-    Nif::QuaternionKeyMap::MapType::const_iterator it = keys.lower_bound(time);
-    if (it != keys.end())
-    {
-        float aTime = it->first;
-        const Nif::QuaternionKey* aKey = &it->second;
-
-        assert (it != keys.begin()); // Shouldn't happen, was checked at beginning of this function
-
-        Nif::QuaternionKeyMap::MapType::const_iterator last = --it;
-        float aLastTime = last->first;
-        const Nif::QuaternionKey* aLastKey = &last->second;
-
-        float a = (time - aLastTime) / (aTime - aLastTime);
-
-        osg::Quat v1 = aLastKey->mValue;
-        osg::Quat v2 = aKey->mValue;
-        // don't take the long path
-        if (v1.x()*v2.x() + v1.y()*v2.y() + v1.z()*v2.z() + v1.w()*v2.w() < 0) // dotProduct(v1,v2)
-            v1 = -v1;
-
-        osg::Quat result;
-        result.slerp(a, v1, v2);
-        return result;
-    }
-    else
-        return keys.rbegin()->second.mValue;
-}
-
-osg::Quat KeyframeController::getXYZRotation(float time) const
-{
-    float xrot = 0, yrot = 0, zrot = 0;
-    if (mXRotations.get())
-        xrot = interpKey(mXRotations->mKeys, time);
-    if (mYRotations.get())
-        yrot = interpKey(mYRotations->mKeys, time);
-    if (mZRotations.get())
-        zrot = interpKey(mZRotations->mKeys, time);
-    osg::Quat xr(xrot, osg::Vec3f(1,0,0));
-    osg::Quat yr(yrot, osg::Vec3f(0,1,0));
-    osg::Quat zr(zrot, osg::Vec3f(0,0,1));
-    return (xr*yr*zr);
-}
-
 osg::Vec3f KeyframeController::getTranslation(float time) const
 {
-    if(mTranslations.get() && mTranslations->mKeys.size() > 0)
-        return interpKey(mTranslations->mKeys, time);
-    return osg::Vec3f();
+    return mTranslations.interpolate(time);
 }
 
 void KeyframeController::operator() (osg::Node* node, osg::NodeVisitor* nv)
@@ -162,14 +108,14 @@ void KeyframeController::operator() (osg::Node* node, osg::NodeVisitor* nv)
         Nif::Matrix3& rot = userdata->mRotationScale;
 
         bool setRot = false;
-        if(mRotations.get() && !mRotations->mKeys.empty())
+        if(!mRotations.empty())
         {
-            mat.setRotate(interpKey(mRotations->mKeys, time));
+            mat.setRotate(mRotations.interpolate(time));
             setRot = true;
         }
-        else if (mXRotations.get() || mYRotations.get() || mZRotations.get())
+        else if (!mXYZRotations.empty())
         {
-            mat.setRotate(getXYZRotation(time));
+            mat.setRotate(mXYZRotations.interpolate(time));
             setRot = true;
         }
         else
@@ -186,15 +132,15 @@ void KeyframeController::operator() (osg::Node* node, osg::NodeVisitor* nv)
                     rot.mValues[i][j] = mat(j,i); // NB column/row major difference
 
         float& scale = userdata->mScale;
-        if(mScales.get() && !mScales->mKeys.empty())
-            scale = interpKey(mScales->mKeys, time);
+        if(!mScales.empty())
+            scale = mScales.interpolate(time);
 
         for (int i=0;i<3;++i)
             for (int j=0;j<3;++j)
                 mat(i,j) *= scale;
 
-        if(mTranslations.get() && !mTranslations->mKeys.empty())
-            mat.setTrans(interpKey(mTranslations->mKeys, time));
+        if(!mTranslations.empty())
+            mat.setTrans(mTranslations.interpolate(time));
 
         trans->setMatrix(mat);
     }
@@ -216,7 +162,7 @@ GeomMorpherController::GeomMorpherController(const GeomMorpherController &copy,
 GeomMorpherController::GeomMorpherController(const Nif::NiMorphData *data)
 {
     for (unsigned int i=0; i<data->mMorphs.size(); ++i)
-        mKeyFrames.push_back(data->mMorphs[i].mKeyFrames);
+        mKeyFrames.push_back(KeyframeTrack<float>(data->mMorphs[i].mKeyFrames));
 }
 
 void GeomMorpherController::update(osg::NodeVisitor *nv, osg::Drawable *drawable)
@@ -228,11 +174,9 @@ void GeomMorpherController::update(osg::NodeVisitor *nv, osg::Drawable *drawable
             return;
         float input = getInputValue(nv);
         int i = 0;
-        for (std::vector<Nif::FloatKeyMapPtr>::iterator it = mKeyFrames.begin()+1; it != mKeyFrames.end(); ++it,++i)
+        for (std::vector<KeyframeTrack<float> >::iterator it = mKeyFrames.begin()+1; it != mKeyFrames.end(); ++it,++i)
         {
-            float val = 0;
-            if (!(*it)->mKeys.empty())
-                val = interpKey((*it)->mKeys, input);
+            float val = it->interpolate(input);
             val = std::max(0.f, std::min(1.f, val));
 
             osgAnimation::MorphGeometry::MorphTarget& target = morphGeom->getMorphTarget(i);
@@ -282,10 +226,10 @@ void UVController::apply(osg::StateSet* stateset, osg::NodeVisitor* nv)
     if (hasInput())
     {
         float value = getInputValue(nv);
-        float uTrans = interpKey(mUTrans->mKeys, value, 0.0f);
-        float vTrans = interpKey(mVTrans->mKeys, value, 0.0f);
-        float uScale = interpKey(mUScale->mKeys, value, 1.0f);
-        float vScale = interpKey(mVScale->mKeys, value, 1.0f);
+        float uTrans = mUTrans.interpolate(value, 0.0f);
+        float vTrans = mVTrans.interpolate(value, 0.0f);
+        float uScale = mUScale.interpolate(value, 1.0f);
+        float vScale = mVScale.interpolate(value, 1.0f);
 
         osg::Matrixf mat = osg::Matrixf::scale(uScale, vScale, 1);
         mat.setTrans(uTrans, vTrans, 0);
@@ -350,7 +294,7 @@ AlphaController::AlphaController()
 }
 
 AlphaController::AlphaController(const AlphaController &copy, const osg::CopyOp &copyop)
-    : StateSetUpdater(copy, copyop), Controller(copy), ValueInterpolator()
+    : StateSetUpdater(copy, copyop), Controller(copy)
     , mData(copy.mData)
 {
 }
@@ -366,7 +310,7 @@ void AlphaController::apply(osg::StateSet *stateset, osg::NodeVisitor *nv)
 {
     if (hasInput())
     {
-        float value = interpKey(mData->mKeys, getInputValue(nv));
+        float value = mData.interpolate(getInputValue(nv));
         osg::Material* mat = static_cast<osg::Material*>(stateset->getAttribute(osg::StateAttribute::MATERIAL));
         osg::Vec4f diffuse = mat->getDiffuse(osg::Material::FRONT_AND_BACK);
         diffuse.a() = value;
@@ -400,7 +344,7 @@ void MaterialColorController::apply(osg::StateSet *stateset, osg::NodeVisitor *n
 {
     if (hasInput())
     {
-        osg::Vec3f value = interpKey(mData->mKeys, getInputValue(nv));
+        osg::Vec3f value = mData.interpolate(getInputValue(nv));
         osg::Material* mat = static_cast<osg::Material*>(stateset->getAttribute(osg::StateAttribute::MATERIAL));
         osg::Vec4f diffuse = mat->getDiffuse(osg::Material::FRONT_AND_BACK);
         diffuse.set(value.x(), value.y(), value.z(), diffuse.a());
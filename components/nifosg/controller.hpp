@@ -9,6 +9,8 @@
 #include <components/sceneutil/controller.hpp>
 #include <components/sceneutil/statesetupdater.hpp>
 
+#include "keyframetrack.hpp"
+
 #include <boost/shared_ptr.hpp>
 
 #include <set> //UVController
@@ -42,38 +44,6 @@ namespace osgAnimation
 namespace NifOsg
 {
 
-    class ValueInterpolator
-    {
-    protected:
-        template <typename T>
-        T interpKey (const std::map< float, Nif::KeyT<T> >& keys, float time, T defaultValue = T()) const
-        {
-            if (keys.size() == 0)
-                return defaultValue;
-
-            if(time <= keys.begin()->first)
-                return keys.begin()->second.mValue;
-
-            typename std::map< float, Nif::KeyT<T> >::const_iterator it = keys.lower_bound(time);
-            if (it != keys.end())
-            {
-                float aTime = it->first;
-                const Nif::KeyT<T>* aKey = &it->second;
-
-                assert (it != keys.begin()); // Shouldn't happen, was checked at beginning of this function
-
-                typename std::map< float, Nif::KeyT<T> >::const_iterator last = --it;
-                float aLastTime = last->first;
-                const Nif::KeyT<T>* aLastKey = &last->second;
-
-                float a = (time - aLastTime) / (aTime - aLastTime);
-                return aLastKey->mValue + ((aKey->mValue - aLastKey->mValue) * a);
-            }
-            else
-                return keys.rbegin()->second.mValue;
-        }
-    };
-
     class ControllerFunction : public SceneUtil::ControllerFunction
     {
     private:
@@ -98,7 +68,7 @@ namespace NifOsg
     };
 
     /// Must be set on an osgAnimation::MorphGeometry.
-    class GeomMorpherController : public osg::Drawable::UpdateCallback, public SceneUtil::Controller, public ValueInterpolator
+    class GeomMorpherController : public osg::Drawable::UpdateCallback, public SceneUtil::Controller
     {
     public:
         GeomMorpherController(const Nif::NiMorphData* data);
@@ -110,10 +80,10 @@ namespace NifOsg
         virtual void update(osg::NodeVisitor* nv, osg::Drawable* drawable);
 
     private:
-        std::vector<Nif::FloatKeyMapPtr> mKeyFrames;
+        std::vector<KeyframeTrack<float> > mKeyFrames;
     };
 
-    class KeyframeController : public osg::NodeCallback, public SceneUtil::Controller, public ValueInterpolator
+    class KeyframeController : public osg::NodeCallback, public SceneUtil::Controller
     {
     public:
         KeyframeController(const Nif::NiKeyframeData *data);
@@ -127,23 +97,15 @@ namespace NifOsg
         virtual void operator() (osg::Node*, osg::NodeVisitor*);
 
     private:
-        Nif::QuaternionKeyMapPtr mRotations;
-
-        Nif::FloatKeyMapPtr mXRotations;
-        Nif::FloatKeyMapPtr mYRotations;
-        Nif::FloatKeyMapPtr mZRotations;
-
-        Nif::Vector3KeyMapPtr mTranslations;
-        Nif::FloatKeyMapPtr mScales;
-
-        using ValueInterpolator::interpKey;
+        KeyframeTrack<osg::Quat> mRotations;
 
-        osg::Quat interpKey(const Nif::QuaternionKeyMap::MapType &keys, float time);
+        XYZRotationTrack mXYZRotations;
 
-        osg::Quat getXYZRotation(float time) const;
+        KeyframeTrack<osg::Vec3f> mTranslations;
+        KeyframeTrack<float> mScales;
     };
 
-    class UVController : public SceneUtil::StateSetUpdater, public SceneUtil::Controller, public ValueInterpolator
+    class UVController : public SceneUtil::StateSetUpdater, public SceneUtil::Controller
     {
     public:
         UVController();
@@ -156,10 +118,10 @@ namespace NifOsg
         virtual void apply(osg::StateSet *stateset, osg::NodeVisitor *nv);
 
     private:
-        Nif::FloatKeyMapPtr mUTrans;
-        Nif::FloatKeyMapPtr mVTrans;
-        Nif::FloatKeyMapPtr mUScale;
-        Nif::FloatKeyMapPtr mVScale;
+        KeyframeTrack<float> mUTrans;
+        KeyframeTrack<float> mVTrans;
+        KeyframeTrack<float> mUScale;
+        KeyframeTrack<float> mVScale;
         std::set<int> mTextureUnits;
     };
 
@@ -180,10 +142,10 @@ namespace NifOsg
         virtual void operator() (osg::Node* node, osg::NodeVisitor* nv);
     };
 
-    class AlphaController : public SceneUtil::StateSetUpdater, public SceneUtil::Controller, public ValueInterpolator
+    class AlphaController : public SceneUtil::StateSetUpdater, public SceneUtil::Controller
     {
     private:
-        Nif::FloatKeyMapPtr mData;
+        KeyframeTrack<float> mData;
 
     public:
         AlphaController(const Nif::NiFloatData *data);
@@ -197,10 +159,10 @@ namespace NifOsg
         META_Object(NifOsg, AlphaController)
     };
 
-    class MaterialColorController : public SceneUtil::StateSetUpdater, public SceneUtil::Controller, public ValueInterpolator
+    class MaterialColorController : public SceneUtil::StateSetUpdater, public SceneUtil::Controller
     {
     private:
-        Nif::Vector3KeyMapPtr mData;
+        KeyframeTrack<osg::Vec3f> mData;
 
     public:
         MaterialColorController(const Nif::NiPosData *data);
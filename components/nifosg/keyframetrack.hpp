@@ -0,0 +1,167 @@
+#ifndef OPENMW_COMPONENTS_NIFOSG_KEYFRAMETRACK_H
+#define OPENMW_COMPONENTS_NIFOSG_KEYFRAMETRACK_H
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/shared_ptr.hpp>
+
+#include <osg/Quat>
+#include <osg/Vec3f>
+
+namespace NifOsg
+{
+
+    /// Linear interpolation between two keys, \a a is the fraction of the way from \a v1 to \a v2.
+    template <typename T>
+    inline T interpolateKeys(const T& v1, const T& v2, float a)
+    {
+        return v1 + ((v2 - v1) * a);
+    }
+
+    /// Spherical interpolation between two rotation keys.
+    inline osg::Quat interpolateKeys(const osg::Quat& v1, const osg::Quat& v2, float a)
+    {
+        osg::Quat from = v1;
+        // don't take the long path
+        if (v1.x()*v2.x() + v1.y()*v2.y() + v1.z()*v2.z() + v1.w()*v2.w() < 0) // dotProduct(v1,v2)
+            from = -v1;
+
+        osg::Quat result;
+        result.slerp(a, from, v2);
+        return result;
+    }
+
+    /// @brief The keys of one animated value, converted from a Nif::KeyMapT into contiguous arrays of times and values.
+    /// @par Copies of a track share the keys. Each copy remembers the key its last lookup ended at, so an animation
+    /// that is played forward finds the next key without searching.
+    template <typename T>
+    class KeyframeTrack
+    {
+    public:
+        KeyframeTrack()
+            : mCursor(0)
+        {
+        }
+
+        /// @param keyMap Shared pointer to a Nif::KeyMapT, may be empty.
+        template <class KeyMapPtr>
+        explicit KeyframeTrack(const KeyMapPtr& keyMap)
+            : mCursor(0)
+        {
+            if (!keyMap || keyMap->mKeys.empty())
+                return;
+
+            typedef typename KeyMapPtr::element_type::MapType MapType;
+
+            boost::shared_ptr<Keys> keys (new Keys);
+            keys->mTimes.reserve(keyMap->mKeys.size());
+            keys->mValues.reserve(keyMap->mKeys.size());
+            for (typename MapType::const_iterator it = keyMap->mKeys.begin(); it != keyMap->mKeys.end(); ++it)
+            {
+                keys->mTimes.push_back(it->first);
+                keys->mValues.push_back(it->second.mValue);
+            }
+            mKeys = keys;
+        }
+
+        bool empty() const
+        {
+            return !mKeys;
+        }
+
+        /// @return The value at the given time, or \a defaultValue if the track has no keys.
+        /// Times outside of the keys are clamped to the first or last key.
+        T interpolate(float time, const T& defaultValue = T()) const
+        {
+            if (!mKeys)
+                return defaultValue;
+
+            const std::vector<float>& times = mKeys->mTimes;
+            const std::vector<T>& values = mKeys->mValues;
+
+            if (time <= times.front())
+                return values.front();
+            if (time > times.back())
+                return values.back();
+
+            unsigned int i = findKey(time);
+            float a = (time - times[i-1]) / (times[i] - times[i-1]);
+            return interpolateKeys(values[i-1], values[i], a);
+        }
+
+    private:
+        /// @return The index i of the key with times[i-1] < time <= times[i].
+        /// @note The time must be within the keys, excluding the first.
+        unsigned int findKey(float time) const
+        {
+            const std::vector<float>& times = mKeys->mTimes;
+            unsigned int i = mCursor;
+
+            // Still between the same keys, or moved on to the next ones
+            if (i > 0 && i < times.size() && times[i-1] < time)
+            {
+                if (time <= times[i])
+                    return i;
+                if (i+1 < times.size() && time <= times[i+1])
+                    return mCursor = i+1;
+            }
+
+            i = std::lower_bound(times.begin(), times.end(), time) - times.begin();
+            return mCursor = i;
+        }
+
+        struct Keys
+        {
+            std::vector<float> mTimes;
+            std::vector<T> mValues;
+        };
+        boost::shared_ptr<const Keys> mKeys;
+
+        mutable unsigned int mCursor;
+    };
+
+    /// @brief Rotation from separate keys for the angles around the X, Y and Z axes.
+    /// @par A NIF that has any of the three key maps gets the rotation from them, even if the maps have no keys.
+    /// The angles of missing or empty maps are 0, so the rotation is the identity if all of them are empty.
+    class XYZRotationTrack
+    {
+    public:
+        XYZRotationTrack()
+            : mHasKeyMaps(false)
+        {
+        }
+
+        template <class KeyMapPtr>
+        XYZRotationTrack(const KeyMapPtr& xRotations, const KeyMapPtr& yRotations, const KeyMapPtr& zRotations)
+            : mXRotations(xRotations)
+            , mYRotations(yRotations)
+            , mZRotations(zRotations)
+            , mHasKeyMaps(xRotations || yRotations || zRotations)
+        {
+        }
+
+        /// Does the NIF have none of the key maps?
+        bool empty() const
+        {
+            return !mHasKeyMaps;
+        }
+
+        osg::Quat interpolate(float time) const
+        {
+            osg::Quat xr(mXRotations.interpolate(time), osg::Vec3f(1,0,0));
+            osg::Quat yr(mYRotations.interpolate(time), osg::Vec3f(0,1,0));
+            osg::Quat zr(mZRotations.interpolate(time), osg::Vec3f(0,0,1));
+            return (xr*yr*zr);
+        }
+
+    private:
+        KeyframeTrack<float> mXRotations;
+        KeyframeTrack<float> mYRotations;
+        KeyframeTrack<float> mZRotations;
+        bool mHasKeyMaps;
+    };
+
+}
+
+#endif
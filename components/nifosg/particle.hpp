@@ -12,7 +12,7 @@
 #include <components/nif/nifkey.hpp>
 #include <components/nif/data.hpp>
 
-#include "controller.hpp" // ValueInterpolator
+#include "keyframetrack.hpp"
 
 namespace Nif
 {
@@ -130,7 +130,7 @@ namespace NifOsg
         float mCachedDefaultSize;
     };
 
-    class ParticleColorAffector : public osgParticle::Operator, public ValueInterpolator
+    class ParticleColorAffector : public osgParticle::Operator
     {
     public:
         ParticleColorAffector(const Nif::NiColorData* clrdata);
@@ -142,7 +142,7 @@ namespace NifOsg
         virtual void operate(osgParticle::Particle* particle, double dt);
 
     private:
-        Nif::NiColorData mData;
+        KeyframeTrack<osg::Vec4f> mData;
     };
 
     class GravityAffector : public osgParticle::Operator
@@ -8,6 +8,7 @@
 #include <osg/Vec3f>
 
 #include <BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
+#include <BulletCollision/CollisionShapes/btOptimizedBvh.h>
 
 class btCollisionShape;
 
@@ -62,14 +63,34 @@ namespace Resource
     {
         TriangleMeshShape(btStridingMeshInterface* meshInterface, bool useQuantizedAabbCompression)
             : btBvhTriangleMeshShape(meshInterface, useQuantizedAabbCompression)
+            , mBvhBuffer(NULL)
         {
         }
 
+        // Use a BVH that was deserialized in place, see BulletShapeDiskCache. The buffer is freed along with the shape.
+        TriangleMeshShape(btStridingMeshInterface* meshInterface, btOptimizedBvh* bvh, void* bvhBuffer, const btVector3& localScaling)
+            : btBvhTriangleMeshShape(meshInterface, true, false)
+            , mBvhBuffer(bvhBuffer)
+        {
+            setOptimizedBvh(bvh, localScaling);
+        }
+
         virtual ~TriangleMeshShape()
         {
+            if (mBvhBuffer)
+            {
+                // Not owned by the base class, as it was not built by it. The BVH lives at the start of the buffer, and its
+                // arrays point into the buffer as well, so they do not free anything. Destroyed through the buffer rather than
+                // getOptimizedBvh(), which is a BVH the base class owns if setLocalScaling() built a new one.
+                static_cast<btOptimizedBvh*>(mBvhBuffer)->~btOptimizedBvh();
+                btAlignedFree(mBvhBuffer);
+            }
             delete getTriangleInfoMap();
             delete m_meshInterface;
         }
+
+    private:
+        void* mBvhBuffer;
     };
 
 
@@ -0,0 +1,473 @@
+#include "bulletshapediskcache.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <memory>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <OpenThreads/Atomic>
+
+#include <BulletCollision/CollisionShapes/btBoxShape.h>
+#include <BulletCollision/CollisionShapes/btCompoundShape.h>
+#include <BulletCollision/CollisionShapes/btTriangleMesh.h>
+#include <BulletCollision/CollisionShapes/btOptimizedBvh.h>
+
+#include "bulletshape.hpp"
+
+namespace
+{
+
+    const char sMagic[4] = { 'O', 'M', 'W', 'S' };
+
+    // Increase when the file format or the way shapes are built changes
+    const boost::uint32_t sVersion = 2;
+
+    // Read back as a different value on a machine of the other endianness
+    const boost::uint32_t sByteOrderMark = 0x01020304;
+
+    enum ShapeType
+    {
+        Shape_None = 0,
+        Shape_Box = 1,
+        Shape_TriangleMesh = 2,
+        Shape_Compound = 3
+    };
+
+    // Unique suffixes for the temporary files, as several threads may save the same shape
+    OpenThreads::Atomic sTempCounter;
+
+    template <class T>
+    void write(std::ostream& stream, const T& value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    bool read(std::istream& stream, T& value)
+    {
+        stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return stream.good();
+    }
+
+    void writeString(std::ostream& stream, const std::string& value)
+    {
+        write(stream, static_cast<boost::uint32_t>(value.size()));
+        stream.write(value.data(), value.size());
+    }
+
+    bool readString(std::istream& stream, std::string& value)
+    {
+        boost::uint32_t size;
+        if (!read(stream, size) || size > 4096)
+            return false;
+        value.resize(size);
+        if (size > 0)
+            stream.read(&value[0], size);
+        return stream.good();
+    }
+
+    void writeVector(std::ostream& stream, const btVector3& vec)
+    {
+        for (int i=0; i<3; ++i)
+            write(stream, vec[i]);
+    }
+
+    bool readVector(std::istream& stream, btVector3& vec)
+    {
+        btScalar values[3];
+        stream.read(reinterpret_cast<char*>(values), sizeof(values));
+        vec.setValue(values[0], values[1], values[2]);
+        return stream.good();
+    }
+
+    bool isIdentity(const btVector3& scaling)
+    {
+        return scaling == btVector3(1.f, 1.f, 1.f);
+    }
+
+    /// @return False if the shape type is not supported.
+    bool writeTriangleMesh(std::ostream& stream, btBvhTriangleMeshShape* shape)
+    {
+        btStridingMeshInterface* mesh = shape->getMeshInterface();
+        btOptimizedBvh* bvh = shape->getOptimizedBvh();
+        if (!bvh || mesh->getNumSubParts() != 1 || shape->getTriangleInfoMap())
+            return false;
+
+        const unsigned char* vertexBase;
+        int numVerts;
+        PHY_ScalarType vertexType;
+        int vertexStride;
+        const unsigned char* indexBase;
+        int indexStride;
+        int numFaces;
+        PHY_ScalarType indexType;
+        mesh->getLockedReadOnlyVertexIndexBase(&vertexBase, numVerts, vertexType, vertexStride,
+                                               &indexBase, indexStride, numFaces, indexType, 0);
+
+        bool supported = (vertexType == PHY_FLOAT || vertexType == PHY_DOUBLE)
+                && (indexType == PHY_INTEGER || indexType == PHY_SHORT);
+        if (supported)
+        {
+            write(stream, static_cast<unsigned char>(Shape_TriangleMesh));
+            write(stream, static_cast<unsigned char>(indexType == PHY_INTEGER));
+            write(stream, static_cast<boost::uint32_t>(numFaces));
+
+            // The triangles are stored in order without an index buffer, so they keep the indices the BVH refers to
+            for (int face=0; face<numFaces; ++face)
+            {
+                const unsigned char* indices = indexBase + face * indexStride;
+                for (int i=0; i<3; ++i)
+                {
+                    int index = indexType == PHY_INTEGER ? reinterpret_cast<const int*>(indices)[i]
+                                                         : reinterpret_cast<const unsigned short*>(indices)[i];
+                    const unsigned char* vertex = vertexBase + index * vertexStride;
+                    for (int j=0; j<3; ++j)
+                    {
+                        btScalar value = vertexType == PHY_FLOAT ? static_cast<btScalar>(reinterpret_cast<const float*>(vertex)[j])
+                                                                 : static_cast<btScalar>(reinterpret_cast<const double*>(vertex)[j]);
+                        write(stream, value);
+                    }
+                }
+            }
+        }
+        mesh->unLockReadOnlyVertexBase(0);
+        if (!supported)
+            return false;
+
+        writeVector(stream, shape->getLocalScaling());
+
+        unsigned int bvhSize = bvh->calculateSerializeBufferSize();
+        void* buffer = btAlignedAlloc(bvhSize, 16);
+        bool serialized = bvh->serializeInPlace(buffer, bvhSize, false);
+        if (serialized)
+        {
+            write(stream, static_cast<boost::uint32_t>(bvhSize));
+            stream.write(static_cast<const char*>(buffer), bvhSize);
+        }
+        btAlignedFree(buffer);
+        return serialized;
+    }
+
+    btCollisionShape* readTriangleMesh(std::istream& stream)
+    {
+        unsigned char use32bitIndices;
+        boost::uint32_t numFaces;
+        if (!read(stream, use32bitIndices) || !read(stream, numFaces) || numFaces > (1u<<24))
+            return NULL;
+
+        std::vector<btScalar> vertices (numFaces * 9);
+        if (numFaces > 0)
+            stream.read(reinterpret_cast<char*>(&vertices[0]), vertices.size() * sizeof(btScalar));
+
+        btVector3 scaling;
+        boost::uint32_t bvhSize;
+        if (!readVector(stream, scaling) || !read(stream, bvhSize) || bvhSize > (1u<<30))
+            return NULL;
+
+        std::auto_ptr<btTriangleMesh> mesh (new btTriangleMesh(use32bitIndices != 0));
+        mesh->preallocateVertices(numFaces * 3);
+        mesh->preallocateIndices(numFaces * 3);
+        for (boost::uint32_t face=0; face<numFaces; ++face)
+        {
+            const btScalar* v = &vertices[face * 9];
+            mesh->addTriangle(btVector3(v[0], v[1], v[2]), btVector3(v[3], v[4], v[5]), btVector3(v[6], v[7], v[8]));
+        }
+
+        void* buffer = btAlignedAlloc(bvhSize, 16);
+        stream.read(static_cast<char*>(buffer), bvhSize);
+        btOptimizedBvh* bvh = stream.good() ? btOptimizedBvh::deSerializeInPlace(buffer, bvhSize, false) : NULL;
+        if (!bvh)
+        {
+            btAlignedFree(buffer);
+            return NULL;
+        }
+
+        return new Resource::TriangleMeshShape(mesh.release(), bvh, buffer, scaling);
+    }
+
+    bool writeBox(std::ostream& stream, btBoxShape* shape)
+    {
+        if (!isIdentity(shape->getLocalScaling()))
+            return false;
+        write(stream, static_cast<unsigned char>(Shape_Box));
+        writeVector(stream, shape->getHalfExtentsWithMargin());
+        return true;
+    }
+
+    btCollisionShape* readBox(std::istream& stream)
+    {
+        btVector3 halfExtents;
+        if (!readVector(stream, halfExtents))
+            return NULL;
+        return new btBoxShape(halfExtents);
+    }
+
+    /// @param allowCompound Compounds are only supported at the top level, as the loaders create them.
+    bool writeShape(std::ostream& stream, btCollisionShape* shape, bool allowCompound)
+    {
+        if (!shape)
+        {
+            write(stream, static_cast<unsigned char>(Shape_None));
+            return true;
+        }
+
+        switch (shape->getShapeType())
+        {
+        case BOX_SHAPE_PROXYTYPE:
+            return writeBox(stream, static_cast<btBoxShape*>(shape));
+        case TRIANGLE_MESH_SHAPE_PROXYTYPE:
+            return writeTriangleMesh(stream, static_cast<btBvhTriangleMeshShape*>(shape));
+        case COMPOUND_SHAPE_PROXYTYPE:
+        {
+            btCompoundShape* compound = static_cast<btCompoundShape*>(shape);
+            if (!allowCompound || !isIdentity(compound->getLocalScaling()))
+                return false;
+
+            write(stream, static_cast<unsigned char>(Shape_Compound));
+            write(stream, static_cast<boost::uint32_t>(compound->getNumChildShapes()));
+            for (int i=0; i<compound->getNumChildShapes(); ++i)
+            {
+                btScalar matrix[16];
+                compound->getChildTransform(i).getOpenGLMatrix(matrix);
+                stream.write(reinterpret_cast<const char*>(matrix), sizeof(matrix));
+                if (!compound->getChildShape(i) || !writeShape(stream, compound->getChildShape(i), false))
+                    return false;
+            }
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    /// @param shape Set to the shape read, NULL for no shape.
+    /// @return False if the shape could not be read.
+    bool readShape(std::istream& stream, btCollisionShape*& shape, bool allowCompound)
+    {
+        shape = NULL;
+
+        unsigned char type;
+        if (!read(stream, type))
+            return false;
+
+        switch (type)
+        {
+        case Shape_None:
+            return true;
+        case Shape_Box:
+            shape = readBox(stream);
+            return shape != NULL;
+        case Shape_TriangleMesh:
+            shape = readTriangleMesh(stream);
+            return shape != NULL;
+        case Shape_Compound:
+        {
+            boost::uint32_t numChildren;
+            if (!allowCompound || !read(stream, numChildren))
+                return false;
+
+            btCompoundShape* compound = new btCompoundShape;
+            for (boost::uint32_t i=0; i<numChildren; ++i)
+            {
+                btScalar matrix[16];
+                stream.read(reinterpret_cast<char*>(matrix), sizeof(matrix));
+                btCollisionShape* child = NULL;
+                if (!stream.good() || !readShape(stream, child, false) || !child)
+                {
+                    for (int j=0; j<compound->getNumChildShapes(); ++j)
+                        delete compound->getChildShape(j);
+                    delete compound;
+                    delete child;
+                    return false;
+                }
+                btTransform transform;
+                transform.setFromOpenGLMatrix(matrix);
+                compound->addChildShape(transform, child);
+            }
+            shape = compound;
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    void writeHeader(std::ostream& stream, const std::string& normalizedName, boost::uint64_t stamp)
+    {
+        stream.write(sMagic, sizeof(sMagic));
+        write(stream, sVersion);
+        write(stream, sByteOrderMark);
+        write(stream, static_cast<boost::uint32_t>(BT_BULLET_VERSION));
+        write(stream, static_cast<boost::uint32_t>(sizeof(btScalar)));
+        write(stream, stamp);
+        writeString(stream, normalizedName);
+    }
+
+    bool readHeader(std::istream& stream, const std::string& normalizedName, boost::uint64_t stamp)
+    {
+        char magic[sizeof(sMagic)];
+        stream.read(magic, sizeof(magic));
+        if (!stream.good() || !std::equal(magic, magic + sizeof(magic), sMagic))
+            return false;
+
+        boost::uint32_t version, byteOrderMark, bulletVersion, scalarSize;
+        boost::uint64_t fileStamp;
+        std::string name;
+        if (!read(stream, version) || !read(stream, byteOrderMark) || !read(stream, bulletVersion)
+                || !read(stream, scalarSize) || !read(stream, fileStamp) || !readString(stream, name))
+            return false;
+
+        // The serialized BVH is only compatible with the same Bullet version and configuration
+        return version == sVersion && byteOrderMark == sByteOrderMark && bulletVersion == BT_BULLET_VERSION
+                && scalarSize == sizeof(btScalar) && fileStamp == stamp && name == normalizedName;
+    }
+
+    void writeVec3f(std::ostream& stream, const osg::Vec3f& vec)
+    {
+        for (int i=0; i<3; ++i)
+            write(stream, vec[i]);
+    }
+
+    bool readVec3f(std::istream& stream, osg::Vec3f& vec)
+    {
+        for (int i=0; i<3; ++i)
+            if (!read(stream, vec[i]))
+                return false;
+        return true;
+    }
+
+}
+
+namespace Resource
+{
+
+BulletShapeDiskCache::BulletShapeDiskCache(const boost::filesystem::path& directory)
+    : mDirectory(directory)
+    , mValid(false)
+{
+    try
+    {
+        boost::filesystem::create_directories(mDirectory);
+        mValid = boost::filesystem::is_directory(mDirectory);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Failed to create shape cache directory " << mDirectory << ": " << e.what() << std::endl;
+    }
+}
+
+bool BulletShapeDiskCache::isValid() const
+{
+    return mValid;
+}
+
+boost::uint64_t BulletShapeDiskCache::hash(std::istream& stream)
+{
+    boost::crc_32_type crc;
+    boost::uint64_t size = 0;
+    char buffer[65536];
+    while (stream)
+    {
+        stream.read(buffer, sizeof(buffer));
+        crc.process_bytes(buffer, static_cast<size_t>(stream.gcount()));
+        size += stream.gcount();
+    }
+    return (size << 32) ^ crc.checksum();
+}
+
+boost::filesystem::path BulletShapeDiskCache::getFilename(const std::string& normalizedName) const
+{
+    // The full name is stored in the file as well, so names that map to the same file just replace each other
+    std::string filename = normalizedName;
+    for (std::string::iterator it = filename.begin(); it != filename.end(); ++it)
+    {
+        if (*it == '/' || *it == '\\' || *it == ':')
+            *it = '_';
+    }
+    return mDirectory / (filename + ".shape");
+}
+
+osg::ref_ptr<BulletShape> BulletShapeDiskCache::load(const std::string& normalizedName, boost::uint64_t stamp) const
+{
+    if (!mValid)
+        return osg::ref_ptr<BulletShape>();
+
+    boost::filesystem::ifstream stream (getFilename(normalizedName), std::ios::binary);
+    if (!stream.is_open() || !readHeader(stream, normalizedName, stamp))
+        return osg::ref_ptr<BulletShape>();
+
+    osg::ref_ptr<BulletShape> shape (new BulletShape);
+    if (!readVec3f(stream, shape->mCollisionBoxHalfExtents) || !readVec3f(stream, shape->mCollisionBoxTranslate))
+        return osg::ref_ptr<BulletShape>();
+
+    boost::uint32_t numAnimatedShapes;
+    if (!read(stream, numAnimatedShapes))
+        return osg::ref_ptr<BulletShape>();
+    for (boost::uint32_t i=0; i<numAnimatedShapes; ++i)
+    {
+        boost::int32_t recordIndex, childIndex;
+        if (!read(stream, recordIndex) || !read(stream, childIndex))
+            return osg::ref_ptr<BulletShape>();
+        shape->mAnimatedShapes[recordIndex] = childIndex;
+    }
+
+    if (!readShape(stream, shape->mCollisionShape, true))
+    {
+        std::cerr << "Failed to read cached shape for " << normalizedName << ", rebuilding it" << std::endl;
+        return osg::ref_ptr<BulletShape>();
+    }
+    return shape;
+}
+
+void BulletShapeDiskCache::save(const std::string& normalizedName, boost::uint64_t stamp, const BulletShape& shape) const
+{
+    if (!mValid)
+        return;
+
+    // Serialize to memory first, so unsupported shapes do not leave partial files behind
+    std::ostringstream buffer (std::ios::binary);
+    writeHeader(buffer, normalizedName, stamp);
+    writeVec3f(buffer, shape.mCollisionBoxHalfExtents);
+    writeVec3f(buffer, shape.mCollisionBoxTranslate);
+    write(buffer, static_cast<boost::uint32_t>(shape.mAnimatedShapes.size()));
+    for (std::map<int, int>::const_iterator it = shape.mAnimatedShapes.begin(); it != shape.mAnimatedShapes.end(); ++it)
+    {
+        write(buffer, static_cast<boost::int32_t>(it->first));
+        write(buffer, static_cast<boost::int32_t>(it->second));
+    }
+    if (!writeShape(buffer, shape.mCollisionShape, true))
+        return;
+
+    // Write to a temporary file and move it in place, so a concurrent load never sees a partial file
+    boost::filesystem::path filename = getFilename(normalizedName);
+    std::ostringstream tempName;
+    tempName << filename.string() << "." << ++sTempCounter << ".tmp";
+    boost::filesystem::path tempFilename (tempName.str());
+
+    try
+    {
+        {
+            boost::filesystem::ofstream stream (tempFilename, std::ios::binary);
+            const std::string data = buffer.str();
+            stream.write(data.data(), data.size());
+            stream.close();
+            if (stream.fail())
+                throw std::runtime_error("write failed");
+        }
+        boost::filesystem::rename(tempFilename, filename);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Failed to cache shape for " << normalizedName << ": " << e.what() << std::endl;
+        boost::system::error_code ec;
+        boost::filesystem::remove(tempFilename, ec);
+    }
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_BULLETSHAPEDISKCACHE_H
+#define OPENMW_COMPONENTS_RESOURCE_BULLETSHAPEDISKCACHE_H
+
+#include <string>
+#include <istream>
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <osg/ref_ptr>
+
+namespace Resource
+{
+
+    class BulletShape;
+
+    /// @brief Stores built collision shapes on disk, so the triangle meshes and their BVH do not need to be built again
+    /// the next time the game is started.
+    /// @par Each shape is stored in its own file, along with the name and a stamp of the file it was built from, e.g. its
+    /// size and modification time. A cached shape is only used when both match, so changes to the data files are picked up. Shapes that use Bullet shape types
+    /// other than boxes, triangle meshes and compounds of them are not cached.
+    /// @note Thread safe, a shape may be loaded and saved from multiple threads at the same time.
+    class BulletShapeDiskCache
+    {
+    public:
+        /// @param directory The directory to store the shapes in, created if it does not exist.
+        BulletShapeDiskCache(const boost::filesystem::path& directory);
+
+        /// @return Whether the cache directory can be used.
+        bool isValid() const;
+
+        /// Hash of the contents of a source file, reads the stream to the end. A stamp for files that have no
+        /// VFS::File::getStamp().
+        static boost::uint64_t hash(std::istream& stream);
+
+        /// @param normalizedName The normalized VFS path of the file the shape was built from.
+        /// @param stamp The stamp of that file.
+        /// @return The cached shape, or NULL if it is not cached, out of date or can not be read.
+        osg::ref_ptr<BulletShape> load(const std::string& normalizedName, boost::uint64_t stamp) const;
+
+        /// Store the shape for \a normalizedName, replacing any previous version. Errors are logged and otherwise ignored,
+        /// the shape will just be built again next time.
+        void save(const std::string& normalizedName, boost::uint64_t stamp, const BulletShape& shape) const;
+
+    private:
+        boost::filesystem::path getFilename(const std::string& normalizedName) const;
+
+        boost::filesystem::path mDirectory;
+        bool mValid;
+    };
+
+}
+
+#endif
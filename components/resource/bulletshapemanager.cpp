@@ -5,12 +5,16 @@
 #include <osg/TriangleFunctor>
 
 #include <BulletCollision/CollisionShapes/btTriangleMesh.h>
+#include <BulletCollision/CollisionShapes/btCompoundShape.h>
+#include <BulletCollision/CollisionShapes/btBoxShape.h>
 
 #include <components/vfs/manager.hpp>
+#include <components/vfs/archive.hpp>
 
 #include <components/nifbullet/bulletnifloader.hpp>
 
 #include "bulletshape.hpp"
+#include "bulletshapediskcache.hpp"
 #include "scenemanager.hpp"
 
 
@@ -94,6 +98,48 @@ private:
     btTriangleMesh* mTriangleMesh;
 };
 
+/// Estimates the memory used by a collision shape, including the mesh data and BVH of triangle meshes.
+size_t estimateSize(const btCollisionShape* shape)
+{
+    if (!shape)
+        return 0;
+
+    if (shape->isCompound())
+    {
+        const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+        size_t size = sizeof(btCompoundShape);
+        for (int i=0; i<compound->getNumChildShapes(); ++i)
+            size += estimateSize(compound->getChildShape(i));
+        return size;
+    }
+
+    if (shape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
+    {
+        const btStridingMeshInterface* mesh = static_cast<const btBvhTriangleMeshShape*>(shape)->getMeshInterface();
+        size_t size = sizeof(btBvhTriangleMeshShape);
+        for (int part=0; part<mesh->getNumSubParts(); ++part)
+        {
+            const unsigned char* vertexBase;
+            int numVerts;
+            PHY_ScalarType vertexType;
+            int vertexStride;
+            const unsigned char* indexBase;
+            int indexStride;
+            int numFaces;
+            PHY_ScalarType indexType;
+            mesh->getLockedReadOnlyVertexIndexBase(&vertexBase, numVerts, vertexType, vertexStride,
+                                                   &indexBase, indexStride, numFaces, indexType, part);
+            mesh->unLockReadOnlyVertexBase(part);
+
+            // Roughly two quantized BVH nodes of 16 bytes per triangle
+            size += numVerts * vertexStride + numFaces * (indexStride + 32);
+        }
+        return size;
+    }
+
+    return sizeof(btBoxShape);
+}
+
 BulletShapeManager::BulletShapeManager(const VFS::Manager* vfs, SceneManager* sceneMgr)
     : mVFS(vfs)
     , mSceneManager(sceneMgr)
@@ -106,48 +152,98 @@ BulletShapeManager::~BulletShapeManager()
 
 }
 
-osg::ref_ptr<BulletShapeInstance> BulletShapeManager::createInstance(const std::string &name)
+osg::ref_ptr<BulletShape> BulletShapeManager::getShape(const std::string &name)
 {
     std::string normalized = name;
     mVFS->normalizeFilename(normalized);
 
-    osg::ref_ptr<BulletShape> shape;
-    Index::iterator it = mIndex.find(normalized);
-    if (it == mIndex.end())
-    {
-        Files::IStreamPtr file = mVFS->get(normalized);
+    osg::ref_ptr<BulletShape> shape = mCache.get(normalized);
+    if (shape)
+        return shape;
 
-        size_t extPos = normalized.find_last_of('.');
-        std::string ext;
-        if (extPos != std::string::npos && extPos+1 < normalized.size())
-            ext = normalized.substr(extPos+1);
+    VFS::File* file = mVFS->getFileNormalized(normalized);
 
-        if (ext == "nif")
-        {
-            NifBullet::BulletNifLoader loader;
-            // might be worth sharing NIFFiles with SceneManager in some way
-            shape = loader.load(Nif::NIFFilePtr(new Nif::NIFFile(file, normalized)));
-        }
-        else
+    boost::uint64_t stamp = 0;
+    if (mDiskCache.get())
+    {
+        // Usually the size and modification time, so a cached shape is found without reading the file
+        stamp = file->getStamp();
+        if (!stamp)
         {
-            // TODO: support .bullet shape files
-
-            osg::ref_ptr<const osg::Node> constNode (mSceneManager->getTemplate(normalized));
-            osg::ref_ptr<osg::Node> node (const_cast<osg::Node*>(constNode.get())); // const-trickery required because there is no const version of NodeVisitor
-            NodeToShapeVisitor visitor;
-            node->accept(visitor);
-            shape = visitor.getShape();
-            if (!shape)
-                return osg::ref_ptr<BulletShapeInstance>();
+            Files::IStreamPtr stream = file->open();
+            stamp = BulletShapeDiskCache::hash(*stream);
         }
+        shape = mDiskCache->load(normalized, stamp);
+        if (shape)
+            return mCache.add(normalized, shape, sizeof(BulletShape) + estimateSize(shape->mCollisionShape));
+    }
+
+    size_t extPos = normalized.find_last_of('.');
+    std::string ext;
+    if (extPos != std::string::npos && extPos+1 < normalized.size())
+        ext = normalized.substr(extPos+1);
 
-        mIndex[normalized] = shape;
+    if (ext == "nif")
+    {
+        NifBullet::BulletNifLoader loader;
+        // might be worth sharing NIFFiles with SceneManager in some way
+        shape = loader.load(Nif::NIFFilePtr(new Nif::NIFFile(file, normalized)));
     }
     else
-        shape = it->second;
+    {
+        // TODO: support .bullet shape files
+
+        osg::ref_ptr<const osg::Node> constNode (mSceneManager->getTemplate(normalized));
+        osg::ref_ptr<osg::Node> node (const_cast<osg::Node*>(constNode.get())); // const-trickery required because there is no const version of NodeVisitor
+        NodeToShapeVisitor visitor;
+        node->accept(visitor);
+        shape = visitor.getShape();
+        if (!shape)
+            return osg::ref_ptr<BulletShape>();
+    }
+
+    if (mDiskCache.get())
+        mDiskCache->save(normalized, stamp, *shape);
+
+    // If another thread loaded the same shape in the meantime, use that one
+    return mCache.add(normalized, shape, sizeof(BulletShape) + estimateSize(shape->mCollisionShape));
+}
+
+osg::ref_ptr<BulletShapeInstance> BulletShapeManager::createInstance(const std::string &name)
+{
+    osg::ref_ptr<BulletShape> shape = getShape(name);
+    if (!shape)
+        return osg::ref_ptr<BulletShapeInstance>();
 
     osg::ref_ptr<BulletShapeInstance> instance = shape->makeInstance();
     return instance;
 }
 
+void BulletShapeManager::updateCache(double referenceTime)
+{
+    mCache.update(referenceTime);
+}
+
+void BulletShapeManager::setExpiryDelay(double expiryDelay)
+{
+    mCache.setExpiryDelay(expiryDelay);
+}
+
+void BulletShapeManager::setMaxCacheSize(size_t bytes)
+{
+    mCache.setMaxBytes(bytes);
+}
+
+void BulletShapeManager::setDiskCache(const boost::filesystem::path &directory)
+{
+    mDiskCache.reset(new BulletShapeDiskCache(directory));
+    if (!mDiskCache->isValid())
+        mDiskCache.reset();
+}
+
+void BulletShapeManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+{
+    mCache.reportStats(frameNumber, stats, "Shape cache");
+}
+
 }
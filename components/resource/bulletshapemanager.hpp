@@ -2,11 +2,16 @@
 #define OPENMW_COMPONENTS_BULLETSHAPEMANAGER_H
 
 #include <map>
+#include <memory>
 #include <string>
 
+#include <boost/filesystem/path.hpp>
+
 #include <osg/ref_ptr>
 
 #include "bulletshape.hpp"
+#include "objectcache.hpp"
+#include "resourcemanager.hpp"
 
 namespace VFS
 {
@@ -19,21 +24,42 @@ namespace Resource
 
     class BulletShape;
     class BulletShapeInstance;
+    class BulletShapeDiskCache;
 
-    class BulletShapeManager
+    /// @note May be used from multiple threads, e.g. for preloading.
+    /// @par Shapes that are no longer used by any instance expire from the cache, see ObjectCache.
+    class BulletShapeManager : public ResourceManager
     {
     public:
         BulletShapeManager(const VFS::Manager* vfs, SceneManager* sceneMgr);
         ~BulletShapeManager();
 
+        /// Get the shared, read-only shape for the given mesh, loading it if necessary.
+        /// @return NULL if the mesh has no collision shape.
+        osg::ref_ptr<BulletShape> getShape(const std::string& name);
+
         osg::ref_ptr<BulletShapeInstance> createInstance(const std::string& name);
 
+        virtual void updateCache(double referenceTime);
+
+        virtual void setExpiryDelay(double expiryDelay);
+
+        /// @param bytes Budget for the estimated size of the cached shapes, 0 for no budget.
+        void setMaxCacheSize(size_t bytes);
+
+        /// Store the shapes built from meshes in \a directory, and load them from there the next time instead of building them again.
+        /// @note Not thread safe, call before using the manager.
+        void setDiskCache(const boost::filesystem::path& directory);
+
+        virtual void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
     private:
         const VFS::Manager* mVFS;
         SceneManager* mSceneManager;
 
-        typedef std::map<std::string, osg::ref_ptr<BulletShape> > Index;
-        Index mIndex;
+        ObjectCache<std::string, BulletShape> mCache;
+
+        std::auto_ptr<BulletShapeDiskCache> mDiskCache;
     };
 
 }
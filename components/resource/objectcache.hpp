@@ -0,0 +1,217 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_OBJECTCACHE_H
+#define OPENMW_COMPONENTS_RESOURCE_OBJECTCACHE_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <osg/ref_ptr>
+#include <osg/Stats>
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
+namespace Resource
+{
+
+    /// @brief Thread safe cache of reference counted objects, e.g. loaded resources.
+    /// @par An object that is only referenced by the cache expires when it has not been requested for the expiry delay.
+    /// When the estimated size of the cached objects exceeds the budget, unreferenced objects are evicted early,
+    /// least recently used first. Objects that are still referenced elsewhere are never evicted, as that would not free any memory.
+    template <class Key, class T>
+    class ObjectCache
+    {
+    public:
+        ObjectCache()
+            : mExpiryDelay(300.0)
+            , mMaxBytes(0)
+            , mReferenceTime(0.0)
+            , mLastScan(0.0)
+            , mBytes(0)
+            , mHits(0)
+            , mMisses(0)
+            , mEvictions(0)
+        {
+        }
+
+        /// How long to keep unreferenced objects after they were last requested, in seconds.
+        void setExpiryDelay(double expiryDelay)
+        {
+            Lock lock(mMutex);
+            mExpiryDelay = expiryDelay;
+        }
+
+        /// @param maxBytes Budget for the estimated size of the cached objects, 0 for no budget.
+        void setMaxBytes(size_t maxBytes)
+        {
+            Lock lock(mMutex);
+            mMaxBytes = maxBytes;
+        }
+
+        /// @return The cached object, or NULL if there is none.
+        osg::ref_ptr<T> get(const Key& key)
+        {
+            Lock lock(mMutex);
+            typename Objects::iterator found = mObjects.find(key);
+            if (found == mObjects.end())
+            {
+                ++mMisses;
+                return osg::ref_ptr<T>();
+            }
+            ++mHits;
+            found->second.mLastUsed = mReferenceTime;
+            return found->second.mObject;
+        }
+
+        /// Add an object, unless another thread has added an object for the same key in the meantime.
+        /// @param bytes The estimated memory used by the object.
+        /// @return The object that is now cached for the key.
+        osg::ref_ptr<T> add(const Key& key, T* object, size_t bytes)
+        {
+            Lock lock(mMutex);
+            Entry entry;
+            entry.mObject = object;
+            entry.mBytes = bytes;
+            entry.mLastUsed = mReferenceTime;
+            std::pair<typename Objects::iterator, bool> result = mObjects.insert(std::make_pair(key, entry));
+            if (result.second)
+                mBytes += bytes;
+            else
+                result.first->second.mLastUsed = mReferenceTime;
+            return result.first->second.mObject;
+        }
+
+        /// Remove expired objects, and unreferenced objects that exceed the budget.
+        /// @param referenceTime The current time in seconds. Also used to time stamp objects requested until the next update.
+        void update(double referenceTime)
+        {
+            // Release the objects after unlocking, their destructors may be expensive
+            std::vector<osg::ref_ptr<T> > evicted;
+
+            Lock lock(mMutex);
+            mReferenceTime = referenceTime;
+
+            // Checking every object is only needed once in a while, unless we are over budget
+            bool overBudget = mMaxBytes != 0 && mBytes > mMaxBytes;
+            if (!overBudget && referenceTime >= mLastScan && referenceTime - mLastScan < sScanInterval)
+                return;
+            mLastScan = referenceTime;
+
+            std::vector<typename Objects::iterator> unreferenced;
+            for (typename Objects::iterator it = mObjects.begin(); it != mObjects.end();)
+            {
+                Entry& entry = it->second;
+                if (entry.mObject->referenceCount() > 1)
+                {
+                    // Still in use
+                    entry.mLastUsed = referenceTime;
+                    ++it;
+                }
+                else if (entry.mLastUsed + mExpiryDelay <= referenceTime)
+                    evict(it++, evicted);
+                else
+                    unreferenced.push_back(it++);
+            }
+
+            if (mMaxBytes != 0 && mBytes > mMaxBytes)
+            {
+                std::sort(unreferenced.begin(), unreferenced.end(), LessRecentlyUsed());
+                for (typename std::vector<typename Objects::iterator>::iterator it = unreferenced.begin();
+                     it != unreferenced.end() && mBytes > mMaxBytes; ++it)
+                    evict(*it, evicted);
+            }
+        }
+
+        /// Remove all objects.
+        void clear()
+        {
+            Objects objects;
+            Lock lock(mMutex);
+            objects.swap(mObjects);
+            mBytes = 0;
+        }
+
+        /// Call functor(key, object) for each cached object.
+        /// @note The cache is locked meanwhile, the functor must not use it.
+        template <class Functor>
+        void forEach(Functor& functor)
+        {
+            Lock lock(mMutex);
+            for (typename Objects::iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+                functor(it->first, it->second.mObject.get());
+        }
+
+        /// Report the hit, miss and eviction counts and the size of the cache as "<name> hits" etc.
+        void reportStats(unsigned int frameNumber, osg::Stats* stats, const std::string& name) const
+        {
+            Lock lock(mMutex);
+            stats->setAttribute(frameNumber, name + " hits", mHits);
+            stats->setAttribute(frameNumber, name + " misses", mMisses);
+            stats->setAttribute(frameNumber, name + " evictions", mEvictions);
+            stats->setAttribute(frameNumber, name + " objects", mObjects.size());
+            stats->setAttribute(frameNumber, name + " bytes", mBytes);
+        }
+
+        size_t getBytes() const
+        {
+            Lock lock(mMutex);
+            return mBytes;
+        }
+
+        size_t getNumObjects() const
+        {
+            Lock lock(mMutex);
+            return mObjects.size();
+        }
+
+    private:
+        typedef OpenThreads::ScopedLock<OpenThreads::Mutex> Lock;
+
+        struct Entry
+        {
+            osg::ref_ptr<T> mObject;
+            size_t mBytes;
+            double mLastUsed;
+        };
+
+        typedef std::map<Key, Entry> Objects;
+
+        struct LessRecentlyUsed
+        {
+            bool operator() (const typename Objects::iterator& left, const typename Objects::iterator& right) const
+            {
+                return left->second.mLastUsed < right->second.mLastUsed;
+            }
+        };
+
+        void evict(typename Objects::iterator it, std::vector<osg::ref_ptr<T> >& evicted)
+        {
+            evicted.push_back(it->second.mObject);
+            mBytes -= it->second.mBytes;
+            ++mEvictions;
+            mObjects.erase(it);
+        }
+
+        static const double sScanInterval;
+
+        mutable OpenThreads::Mutex mMutex;
+        Objects mObjects;
+
+        double mExpiryDelay;
+        size_t mMaxBytes;
+        double mReferenceTime;
+        double mLastScan;
+        size_t mBytes;
+
+        unsigned int mHits;
+        unsigned int mMisses;
+        unsigned int mEvictions;
+    };
+
+    template <class Key, class T>
+    const double ObjectCache<Key, T>::sScanInterval = 1.0;
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_MANAGER_H
+#define OPENMW_COMPONENTS_RESOURCE_MANAGER_H
+
+namespace osg
+{
+    class Stats;
+}
+
+namespace Resource
+{
+
+    /// @brief Base class for managers that keep loaded resources in an ObjectCache.
+    /// @see ResourceSystem::addResourceManager
+    class ResourceManager
+    {
+    public:
+        virtual ~ResourceManager() {}
+
+        /// Remove cached resources that are no longer needed, see ObjectCache::update().
+        virtual void updateCache(double referenceTime) = 0;
+
+        /// How long to keep unused resources in the cache, in seconds.
+        virtual void setExpiryDelay(double expiryDelay) = 0;
+
+        /// Report the statistics of the caches to the viewer stats.
+        virtual void reportStats(unsigned int frameNumber, osg::Stats* stats) const = 0;
+    };
+
+}
+
+#endif
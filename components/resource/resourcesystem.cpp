@@ -1,16 +1,23 @@
 #include "resourcesystem.hpp"
 
+#include <algorithm>
+
 #include "scenemanager.hpp"
 #include "texturemanager.hpp"
+#include "resourcemanager.hpp"
 
 namespace Resource
 {
 
     ResourceSystem::ResourceSystem(const VFS::Manager *vfs)
-        : mVFS(vfs)
+        : mExpiryDelay(300.0)
+        , mVFS(vfs)
     {
         mTextureManager.reset(new TextureManager(vfs));
         mSceneManager.reset(new SceneManager(vfs, mTextureManager.get()));
+
+        addResourceManager(mTextureManager.get());
+        addResourceManager(mSceneManager.get());
     }
 
     ResourceSystem::~ResourceSystem()
@@ -33,4 +40,36 @@ namespace Resource
         return mVFS;
     }
 
+    void ResourceSystem::updateCache(double referenceTime)
+    {
+        for (std::vector<ResourceManager*>::iterator it = mResourceManagers.begin(); it != mResourceManagers.end(); ++it)
+            (*it)->updateCache(referenceTime);
+    }
+
+    void ResourceSystem::setExpiryDelay(double expiryDelay)
+    {
+        mExpiryDelay = expiryDelay;
+        for (std::vector<ResourceManager*>::iterator it = mResourceManagers.begin(); it != mResourceManagers.end(); ++it)
+            (*it)->setExpiryDelay(expiryDelay);
+    }
+
+    void ResourceSystem::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+    {
+        for (std::vector<ResourceManager*>::const_iterator it = mResourceManagers.begin(); it != mResourceManagers.end(); ++it)
+            (*it)->reportStats(frameNumber, stats);
+    }
+
+    void ResourceSystem::addResourceManager(ResourceManager *resourceMgr)
+    {
+        resourceMgr->setExpiryDelay(mExpiryDelay);
+        mResourceManagers.push_back(resourceMgr);
+    }
+
+    void ResourceSystem::removeResourceManager(ResourceManager *resourceMgr)
+    {
+        std::vector<ResourceManager*>::iterator found = std::find(mResourceManagers.begin(), mResourceManagers.end(), resourceMgr);
+        if (found != mResourceManagers.end())
+            mResourceManagers.erase(found);
+    }
+
 }
@@ -2,17 +2,24 @@
 #define OPENMW_COMPONENTS_RESOURCE_RESOURCESYSTEM_H
 
 #include <memory>
+#include <vector>
 
 namespace VFS
 {
     class Manager;
 }
 
+namespace osg
+{
+    class Stats;
+}
+
 namespace Resource
 {
 
     class SceneManager;
     class TextureManager;
+    class ResourceManager;
 
     /// @brief Wrapper class that constructs and provides access to the various resource subsystems.
     /// @par Resource subsystems can be used with multiple OpenGL contexts, just like the OSG equivalents, but
@@ -28,10 +35,32 @@ namespace Resource
 
         const VFS::Manager* getVFS() const;
 
+        /// Indicates to each resource manager to clear the cache, i.e. to drop cached objects that are no longer
+        /// referenced and have not been used for the expiry delay, or that exceed the budget of the cache.
+        /// @note May be called every frame, the caches are only searched for expired objects once in a while.
+        void updateCache(double referenceTime);
+
+        /// How long to keep unused resources in the caches, in seconds.
+        void setExpiryDelay(double expiryDelay);
+
+        /// Report the statistics of all resource caches to the viewer stats.
+        void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
+        /// Add a resource manager owned elsewhere, e.g. the collision shape manager, so that its cache is updated
+        /// along with the others.
+        /// @note The manager must be removed with removeResourceManager() before it is destroyed.
+        void addResourceManager(ResourceManager* resourceMgr);
+        void removeResourceManager(ResourceManager* resourceMgr);
+
     private:
         std::auto_ptr<SceneManager> mSceneManager;
         std::auto_ptr<TextureManager> mTextureManager;
 
+        // All managers with a cache, including those owned elsewhere
+        std::vector<ResourceManager*> mResourceManagers;
+
+        double mExpiryDelay;
+
         const VFS::Manager* mVFS;
 
         ResourceSystem(const ResourceSystem&);
@@ -2,6 +2,7 @@
 
 #include <osg/Node>
 #include <osg/Geode>
+#include <osg/Geometry>
 #include <osg/UserDataContainer>
 #include <osg/Version>
 
@@ -16,6 +17,7 @@
 #include <components/nif/niffile.hpp>
 
 #include <components/vfs/manager.hpp>
+#include <components/vfs/archive.hpp>
 
 #include <components/sceneutil/clone.hpp>
 #include <components/sceneutil/util.hpp>
@@ -99,6 +101,74 @@ namespace
     private:
         unsigned int mMask;
     };
+
+    /// Estimates the memory used by the geometry of a scene. Textures are accounted for by the TextureManager.
+    class EstimateSizeVisitor : public osg::NodeVisitor
+    {
+    public:
+        EstimateSizeVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mBytes(0)
+        {
+        }
+
+        void apply(osg::Geode& geode)
+        {
+            for (unsigned int i=0;i<geode.getNumDrawables();++i)
+                addDrawable(*geode.getDrawable(i));
+        }
+
+#if OSG_VERSION_GREATER_OR_EQUAL(3,3,3)
+        void apply(osg::Drawable& drw)
+        {
+            addDrawable(drw);
+        }
+#endif
+
+        void addDrawable(osg::Drawable& drw)
+        {
+            osg::Geometry* geom = drw.asGeometry();
+            if (!geom)
+                return;
+
+            addArray(geom->getVertexArray());
+            addArray(geom->getNormalArray());
+            addArray(geom->getColorArray());
+            for (unsigned int i=0; i<geom->getNumTexCoordArrays(); ++i)
+                addArray(geom->getTexCoordArray(i));
+            for (unsigned int i=0; i<geom->getNumVertexAttribArrays(); ++i)
+                addArray(geom->getVertexAttribArray(i));
+
+            for (unsigned int i=0; i<geom->getNumPrimitiveSets(); ++i)
+            {
+                if (osg::DrawElements* elements = geom->getPrimitiveSet(i)->getDrawElements())
+                    mBytes += elements->getTotalDataSize();
+            }
+        }
+
+        void addArray(const osg::Array* array)
+        {
+            if (array)
+                mBytes += array->getTotalDataSize();
+        }
+
+        size_t mBytes;
+    };
+
+    struct ReleaseGLObjectsFunctor
+    {
+        ReleaseGLObjectsFunctor(osg::State* state)
+            : mState(state)
+        {
+        }
+
+        void operator() (const std::string& name, const osg::Node* node)
+        {
+            node->releaseGLObjects(mState);
+        }
+
+        osg::State* mState;
+    };
 }
 
 namespace Resource
@@ -150,7 +220,7 @@ namespace Resource
         return std::string();
     }
 
-    osg::ref_ptr<osg::Node> load (Files::IStreamPtr file, const std::string& normalizedFilename, Resource::TextureManager* textureMgr)
+    osg::ref_ptr<osg::Node> load (VFS::File* file, const std::string& normalizedFilename, Resource::TextureManager* textureMgr)
     {
         std::string ext = getFileExtension(normalizedFilename);
         if (ext == "nif")
@@ -171,7 +241,7 @@ namespace Resource
             // but findFileCallback does not support virtual files, so we can't implement it.
             options->setReadFileCallback(new ImageReadCallback(textureMgr));
 
-            osgDB::ReaderWriter::ReadResult result = reader->readNode(*file, options);
+            osgDB::ReaderWriter::ReadResult result = reader->readNode(*file->open(), options);
             if (!result.success())
             {
                 std::stringstream errormsg;
@@ -187,22 +257,24 @@ namespace Resource
         std::string normalized = name;
         mVFS->normalizeFilename(normalized);
 
-        Index::iterator it = mIndex.find(normalized);
-        if (it == mIndex.end())
+        osg::ref_ptr<const osg::Node> cached = mCache.get(normalized);
+        if (cached)
+            return cached;
+
+        // Load without holding the lock, so other threads are not blocked.
+        // If two threads load the same scene, the first one to finish wins.
         {
             osg::ref_ptr<osg::Node> loaded;
             try
             {
-                Files::IStreamPtr file = mVFS->get(normalized);
-
-                loaded = load(file, normalized, mTextureManager);
+                loaded = load(mVFS->getFileNormalized(normalized), normalized, mTextureManager);
             }
             catch (std::exception& e)
             {
                 std::cerr << "Failed to load '" << name << "': " << e.what() << ", using marker_error.nif instead" << std::endl;
-                Files::IStreamPtr file = mVFS->get("meshes/marker_error.nif");
                 normalized = "meshes/marker_error.nif";
-                loaded = load(file, normalized, mTextureManager);
+                mVFS->normalizeFilename(normalized);
+                loaded = load(mVFS->getFileNormalized(normalized), normalized, mTextureManager);
             }
 
             osgDB::Registry::instance()->getOrCreateSharedStateManager()->share(loaded.get());
@@ -210,17 +282,41 @@ namespace Resource
             if (mIncrementalCompileOperation)
                 mIncrementalCompileOperation->add(loaded);
 
-            mIndex[normalized] = loaded;
-            return loaded;
+            EstimateSizeVisitor estimateSize;
+            loaded->accept(estimateSize);
+
+            return mCache.add(normalized, loaded, estimateSize.mBytes);
         }
-        else
-            return it->second;
     }
 
+    /// Keeps the template of a scene instance referenced for as long as the instance exists, so that the cache sees
+    /// the template as in use. The instance shares the children of the template, but not the template itself.
+    class TemplateRef : public osg::Object
+    {
+    public:
+        TemplateRef(const osg::Node* node)
+            : mTemplate(node)
+        {
+        }
+        TemplateRef() {}
+        TemplateRef(const TemplateRef& copy, const osg::CopyOp& copyop)
+            : osg::Object(copy, copyop)
+            , mTemplate(copy.mTemplate)
+        {
+        }
+
+        META_Object(Resource, TemplateRef)
+
+    private:
+        osg::ref_ptr<const osg::Node> mTemplate;
+    };
+
     osg::ref_ptr<osg::Node> SceneManager::createInstance(const std::string &name)
     {
         osg::ref_ptr<const osg::Node> scene = getTemplate(name);
         osg::ref_ptr<osg::Node> cloned = osg::clone(scene.get(), SceneUtil::CopyOp());
+        // The user data is deep copied, so this is only added to the instance
+        cloned->getOrCreateUserDataContainer()->addUserObject(new TemplateRef(scene));
         return cloned;
     }
 
@@ -236,10 +332,12 @@ namespace Resource
         std::string normalized = name;
         mVFS->normalizeFilename(normalized);
 
-        KeyframeIndex::iterator it = mKeyframeIndex.find(normalized);
-        if (it == mKeyframeIndex.end())
+        osg::ref_ptr<const NifOsg::KeyframeHolder> cached = mKeyframeCache.get(normalized);
+        if (cached)
+            return cached;
+
         {
-            Files::IStreamPtr file = mVFS->get(normalized);
+            VFS::File* file = mVFS->getFileNormalized(normalized);
 
             std::string ext = getFileExtension(normalized);
 
@@ -249,11 +347,9 @@ namespace Resource
             osg::ref_ptr<NifOsg::KeyframeHolder> loaded (new NifOsg::KeyframeHolder);
             NifOsg::Loader::loadKf(Nif::NIFFilePtr(new Nif::NIFFile(file, normalized)), *loaded.get());
 
-            mKeyframeIndex[normalized] = loaded;
-            return loaded;
+            // Keyframes are small compared to the scenes using them, they only expire and do not count against the budget
+            return mKeyframeCache.add(normalized, loaded, 0);
         }
-        else
-            return it->second;
     }
 
     void SceneManager::attachTo(osg::Node *instance, osg::Group *parentNode) const
@@ -264,10 +360,31 @@ namespace Resource
 
     void SceneManager::releaseGLObjects(osg::State *state)
     {
-        for (Index::iterator it = mIndex.begin(); it != mIndex.end(); ++it)
-        {
-            it->second->releaseGLObjects(state);
-        }
+        ReleaseGLObjectsFunctor functor(state);
+        mCache.forEach(functor);
+    }
+
+    void SceneManager::updateCache(double referenceTime)
+    {
+        mCache.update(referenceTime);
+        mKeyframeCache.update(referenceTime);
+    }
+
+    void SceneManager::setExpiryDelay(double expiryDelay)
+    {
+        mCache.setExpiryDelay(expiryDelay);
+        mKeyframeCache.setExpiryDelay(expiryDelay);
+    }
+
+    void SceneManager::setMaxCacheSize(size_t bytes)
+    {
+        mCache.setMaxBytes(bytes);
+    }
+
+    void SceneManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+    {
+        mCache.reportStats(frameNumber, stats, "Scene cache");
+        mKeyframeCache.reportStats(frameNumber, stats, "Keyframe cache");
     }
 
     void SceneManager::setIncrementalCompileOperation(osgUtil::IncrementalCompileOperation *ico)
@@ -7,6 +7,9 @@
 #include <osg/ref_ptr>
 #include <osg/Node>
 
+#include "objectcache.hpp"
+#include "resourcemanager.hpp"
+
 namespace Resource
 {
     class TextureManager;
@@ -31,7 +34,10 @@ namespace Resource
 {
 
     /// @brief Handles loading and caching of scenes, e.g. NIF files
-    class SceneManager
+    /// @note getTemplate() may be used from multiple threads, e.g. for preloading.
+    /// @par Scenes that are no longer in use expire from the cache, see ObjectCache. The instances created by
+    /// createInstance() keep their template in use.
+    class SceneManager : public ResourceManager
     {
     public:
         SceneManager(const VFS::Manager* vfs, Resource::TextureManager* textureManager);
@@ -76,6 +82,15 @@ namespace Resource
         /// @param mask The node mask to apply to loaded particle system nodes.
         void setParticleSystemMask(unsigned int mask);
 
+        virtual void updateCache(double referenceTime);
+
+        virtual void setExpiryDelay(double expiryDelay);
+
+        /// @param bytes Budget for the estimated size of the cached scenes, not including their textures. 0 for no budget.
+        void setMaxCacheSize(size_t bytes);
+
+        virtual void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
     private:
         const VFS::Manager* mVFS;
         Resource::TextureManager* mTextureManager;
@@ -84,12 +99,9 @@ namespace Resource
 
         unsigned int mParticleSystemMask;
 
-        // observer_ptr?
-        typedef std::map<std::string, osg::ref_ptr<const osg::Node> > Index;
-        Index mIndex;
+        ObjectCache<std::string, const osg::Node> mCache;
 
-        typedef std::map<std::string, osg::ref_ptr<const NifOsg::KeyframeHolder> > KeyframeIndex;
-        KeyframeIndex mKeyframeIndex;
+        ObjectCache<std::string, const NifOsg::KeyframeHolder> mKeyframeCache;
 
         SceneManager(const SceneManager&);
         void operator = (const SceneManager&);
@@ -39,6 +39,50 @@ namespace
         return warningTexture;
     }
 
+    struct SetFilterSettingsFunctor
+    {
+        SetFilterSettingsFunctor(osg::Texture::FilterMode minFilter, osg::Texture::FilterMode magFilter, int maxAnisotropy)
+            : mMinFilter(minFilter)
+            , mMagFilter(magFilter)
+            , mMaxAnisotropy(maxAnisotropy)
+        {
+        }
+
+        template <class Key>
+        void operator() (const Key& key, osg::Texture2D* tex)
+        {
+            // Keep mip-mapping disabled if the texture creator explicitely requested no mipmapping.
+            osg::Texture::FilterMode oldMin = tex->getFilter(osg::Texture::MIN_FILTER);
+            if (oldMin == osg::Texture::LINEAR || oldMin == osg::Texture::NEAREST)
+            {
+                osg::Texture::FilterMode newMin = osg::Texture::LINEAR;
+                switch (mMinFilter)
+                {
+                case osg::Texture::LINEAR:
+                case osg::Texture::LINEAR_MIPMAP_LINEAR:
+                case osg::Texture::LINEAR_MIPMAP_NEAREST:
+                    newMin = osg::Texture::LINEAR;
+                    break;
+                case osg::Texture::NEAREST:
+                case osg::Texture::NEAREST_MIPMAP_LINEAR:
+                case osg::Texture::NEAREST_MIPMAP_NEAREST:
+                    newMin = osg::Texture::NEAREST;
+                    break;
+                }
+                tex->setFilter(osg::Texture::MIN_FILTER, newMin);
+            }
+            else
+                tex->setFilter(osg::Texture::MIN_FILTER, mMinFilter);
+
+            tex->setFilter(osg::Texture::MAG_FILTER, mMagFilter);
+            tex->setMaxAnisotropy(static_cast<float>(mMaxAnisotropy));
+        }
+
+        osg::Texture::FilterMode mMinFilter;
+        osg::Texture::FilterMode mMagFilter;
+        int mMaxAnisotropy;
+    };
+
 }
 
 namespace Resource
@@ -71,36 +115,8 @@ namespace Resource
         mMagFilter = magFilter;
         mMaxAnisotropy = std::max(1, maxAnisotropy);
 
-        for (std::map<MapKey, osg::ref_ptr<osg::Texture2D> >::iterator it = mTextures.begin(); it != mTextures.end(); ++it)
-        {
-            osg::ref_ptr<osg::Texture2D> tex = it->second;
-
-            // Keep mip-mapping disabled if the texture creator explicitely requested no mipmapping.
-            osg::Texture::FilterMode oldMin = tex->getFilter(osg::Texture::MIN_FILTER);
-            if (oldMin == osg::Texture::LINEAR || oldMin == osg::Texture::NEAREST)
-            {
-                osg::Texture::FilterMode newMin = osg::Texture::LINEAR;
-                switch (mMinFilter)
-                {
-                case osg::Texture::LINEAR:
-                case osg::Texture::LINEAR_MIPMAP_LINEAR:
-                case osg::Texture::LINEAR_MIPMAP_NEAREST:
-                    newMin = osg::Texture::LINEAR;
-                    break;
-                case osg::Texture::NEAREST:
-                case osg::Texture::NEAREST_MIPMAP_LINEAR:
-                case osg::Texture::NEAREST_MIPMAP_NEAREST:
-                    newMin = osg::Texture::NEAREST;
-                    break;
-                }
-                tex->setFilter(osg::Texture::MIN_FILTER, newMin);
-            }
-            else
-                tex->setFilter(osg::Texture::MIN_FILTER, mMinFilter);
-
-            tex->setFilter(osg::Texture::MAG_FILTER, mMagFilter);
-            tex->setMaxAnisotropy(static_cast<float>(mMaxAnisotropy));
-        }
+        SetFilterSettingsFunctor functor(mMinFilter, mMagFilter, mMaxAnisotropy);
+        mTextures.forEach(functor);
     }
 
     /*
@@ -147,15 +163,17 @@ namespace Resource
     {
         std::string normalized = filename;
         mVFS->normalizeFilename(normalized);
-        std::map<std::string, osg::ref_ptr<osg::Image> >::iterator found = mImages.find(normalized);
-        if (found != mImages.end())
-            return found->second;
-        else
+        osg::ref_ptr<osg::Image> cached = mImages.get(normalized);
+        if (cached)
+            return cached;
+
+        // Load without holding the lock, so other threads are not blocked.
+        // If two threads load the same image, the first one to finish wins.
         {
             Files::IStreamPtr stream;
             try
             {
-                stream = mVFS->get(normalized.c_str());
+                stream = mVFS->getNormalized(normalized);
             }
             catch (std::exception& e)
             {
@@ -189,8 +207,7 @@ namespace Resource
                 return NULL;
             }
 
-            mImages.insert(std::make_pair(normalized, image));
-            return image;
+            return mImages.add(normalized, image, image->getTotalSizeInBytesIncludingMipmaps());
         }
     }
 
@@ -199,17 +216,16 @@ namespace Resource
         std::string normalized = filename;
         mVFS->normalizeFilename(normalized);
         MapKey key = std::make_pair(std::make_pair(wrapS, wrapT), normalized);
-        std::map<MapKey, osg::ref_ptr<osg::Texture2D> >::iterator found = mTextures.find(key);
-        if (found != mTextures.end())
-        {
-            return found->second;
-        }
-        else
+        osg::ref_ptr<osg::Texture2D> cached = mTextures.get(key);
+        if (cached)
+            return cached;
+
+        // Load without holding the lock, see getImage()
         {
             Files::IStreamPtr stream;
             try
             {
-                stream = mVFS->get(normalized.c_str());
+                stream = mVFS->getNormalized(normalized);
             }
             catch (std::exception& e)
             {
@@ -261,11 +277,35 @@ namespace Resource
 
             texture->setUnRefImageDataAfterApply(mUnRefImageDataAfterApply);
 
-            mTextures.insert(std::make_pair(key, texture));
-            return texture;
+            // The image data may be released after it is applied, but it is still used by the graphics driver
+            return mTextures.add(key, texture, image->getTotalSizeInBytesIncludingMipmaps());
         }
     }
 
+    void TextureManager::updateCache(double referenceTime)
+    {
+        mImages.update(referenceTime);
+        mTextures.update(referenceTime);
+    }
+
+    void TextureManager::setExpiryDelay(double expiryDelay)
+    {
+        mImages.setExpiryDelay(expiryDelay);
+        mTextures.setExpiryDelay(expiryDelay);
+    }
+
+    void TextureManager::setMaxCacheSize(size_t bytes)
+    {
+        mImages.setMaxBytes(bytes);
+        mTextures.setMaxBytes(bytes);
+    }
+
+    void TextureManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+    {
+        mImages.reportStats(frameNumber, stats, "Image cache");
+        mTextures.reportStats(frameNumber, stats, "Texture cache");
+    }
+
     osg::Texture2D* TextureManager::getWarningTexture()
     {
         return mWarningTexture.get();
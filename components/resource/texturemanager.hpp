@@ -8,6 +8,9 @@
 #include <osg/Image>
 #include <osg/Texture2D>
 
+#include "objectcache.hpp"
+#include "resourcemanager.hpp"
+
 namespace VFS
 {
     class Manager;
@@ -17,7 +20,9 @@ namespace Resource
 {
 
     /// @brief Handles loading/caching of Images and Texture StateAttributes.
-    class TextureManager
+    /// @note getImage() and getTexture2D() may be used from multiple threads.
+    /// @par Images and textures that are no longer in use expire from the cache, see ObjectCache.
+    class TextureManager : public ResourceManager
     {
     public:
         TextureManager(const VFS::Manager* vfs);
@@ -40,6 +45,15 @@ namespace Resource
 
         osg::Texture2D* getWarningTexture();
 
+        virtual void updateCache(double referenceTime);
+
+        virtual void setExpiryDelay(double expiryDelay);
+
+        /// @param bytes Budget for the estimated size of the cached textures, and separately for the cached images. 0 for no budget.
+        void setMaxCacheSize(size_t bytes);
+
+        virtual void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
     private:
         const VFS::Manager* mVFS;
 
@@ -49,9 +63,9 @@ namespace Resource
 
         typedef std::pair<std::pair<int, int>, std::string> MapKey;
 
-        std::map<std::string, osg::ref_ptr<osg::Image> > mImages;
+        ObjectCache<std::string, osg::Image> mImages;
 
-        std::map<MapKey, osg::ref_ptr<osg::Texture2D> > mTextures;
+        ObjectCache<MapKey, osg::Texture2D> mTextures;
 
         osg::ref_ptr<osg::Texture2D> mWarningTexture;
 
@@ -66,6 +66,32 @@ public:
     virtual osg::BoundingBox computeBound(const osg::Drawable&) const  { return osg::BoundingBox(); }
 };
 
+class RigGeometry::SkinningItem : public WorkItem
+{
+public:
+    SkinningItem(RigGeometry* rig)
+        : mRig(rig)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mRig->skin();
+        mTicket->signalDone();
+    }
+
+private:
+    // Keeps the arrays alive until the skinning is done
+    osg::ref_ptr<RigGeometry> mRig;
+};
+
+WorkQueue* RigGeometry::sWorkQueue = NULL;
+
+void RigGeometry::setWorkQueue(WorkQueue *workQueue)
+{
+    sWorkQueue = workQueue;
+}
+
 RigGeometry::RigGeometry()
     : mSkeleton(NULL)
     , mLastFrameNumber(0)
@@ -151,8 +177,7 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
         return false;
     }
 
-    typedef std::map<unsigned short, std::vector<BoneWeight> > Vertex2BoneMap;
-    Vertex2BoneMap vertex2BoneMap;
+    std::vector<const InfluenceGroups::VertexWeights*> boneWeights;
     for (std::map<std::string, BoneInfluence>::const_iterator it = mInfluenceMap->mMap.begin(); it != mInfluenceMap->mMap.end(); ++it)
     {
         Bone* bone = mSkeleton->getBone(it->first);
@@ -166,47 +191,17 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
 
         const BoneInfluence& bi = it->second;
 
-        const std::map<unsigned short, float>& weights = it->second.mWeights;
-        for (std::map<unsigned short, float>::const_iterator weightIt = weights.begin(); weightIt != weights.end(); ++weightIt)
-        {
-            std::vector<BoneWeight>& vec = vertex2BoneMap[weightIt->first];
-
-            BoneWeight b = std::make_pair(std::make_pair(bone, bi.mInvBindMatrix), weightIt->second);
-
-            vec.push_back(b);
-        }
+        mBones.push_back(bone);
+        mInvBindMatrices.push_back(bi.mInvBindMatrix);
+        boneWeights.push_back(&bi.mWeights);
     }
+    mBoneMatrices.resize(mBones.size());
 
-    for (Vertex2BoneMap::iterator it = vertex2BoneMap.begin(); it != vertex2BoneMap.end(); it++)
-    {
-        mBone2VertexMap[it->second].push_back(it->first);
-    }
+    mInfluenceGroups.build(boneWeights);
 
     return true;
 }
 
-void accumulateMatrix(const osg::Matrixf& invBindMatrix, const osg::Matrixf& matrix, float weight, osg::Matrixf& result)
-{
-    osg::Matrixf m = invBindMatrix * matrix;
-    float* ptr = m.ptr();
-    float* ptrresult = result.ptr();
-    ptrresult[0] += ptr[0] * weight;
-    ptrresult[1] += ptr[1] * weight;
-    ptrresult[2] += ptr[2] * weight;
-
-    ptrresult[4] += ptr[4] * weight;
-    ptrresult[5] += ptr[5] * weight;
-    ptrresult[6] += ptr[6] * weight;
-
-    ptrresult[8] += ptr[8] * weight;
-    ptrresult[9] += ptr[9] * weight;
-    ptrresult[10] += ptr[10] * weight;
-
-    ptrresult[12] += ptr[12] * weight;
-    ptrresult[13] += ptr[13] * weight;
-    ptrresult[14] += ptr[14] * weight;
-}
-
 void RigGeometry::update(osg::NodeVisitor* nv)
 {
     if (!mSkeleton)
@@ -224,40 +219,50 @@ void RigGeometry::update(osg::NodeVisitor* nv)
 
     mSkeleton->updateBoneMatrices(nv);
 
-    // skinning
+    if (mInfluenceGroups.empty())
+        return;
+
+    // The last skinning must be done before its matrices and arrays are changed again
+    if (mSkinningTicket)
+    {
+        mSkinningTicket->waitTillDone();
+        mSkinningTicket = NULL;
+    }
+
+    // A bone usually influences several groups, so only multiply its matrices once
+    for (unsigned int i=0; i<mBones.size(); ++i)
+        mBoneMatrices[i] = mInvBindMatrices[i] * mBones[i]->mMatrixInSkeletonSpace;
+
+    mInfluenceGroups.computeMatrices(mBoneMatrices, mGeomToSkelMatrix);
+
+    // Smaller meshes are skinned faster than a work item is queued
+    if (sWorkQueue && mInfluenceGroups.getNumVertices() >= 256)
+        mSkinningTicket = sWorkQueue->addWorkItem(new SkinningItem(this), WorkQueue::Priority_High);
+    else
+        skin();
+
+    getVertexArray()->dirty();
+    getNormalArray()->dirty();
+}
+
+void RigGeometry::skin()
+{
     osg::Vec3Array* positionSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getVertexArray());
     osg::Vec3Array* normalSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getNormalArray());
 
     osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(getVertexArray());
     osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(getNormalArray());
 
-    for (Bone2VertexMap::const_iterator it = mBone2VertexMap.begin(); it != mBone2VertexMap.end(); ++it)
-    {
-        osg::Matrixf resultMat  (0, 0, 0, 0,
-                                0, 0, 0, 0,
-                                0, 0, 0, 0,
-                                0, 0, 0, 1);
-
-        for (std::vector<BoneWeight>::const_iterator weightIt = it->first.begin(); weightIt != it->first.end(); ++weightIt)
-        {
-            Bone* bone = weightIt->first.first;
-            const osg::Matrix& invBindMatrix = weightIt->first.second;
-            float weight = weightIt->second;
-            const osg::Matrixf& boneMatrix = bone->mMatrixInSkeletonSpace;
-            accumulateMatrix(invBindMatrix, boneMatrix, weight, resultMat);
-        }
-        resultMat = resultMat * mGeomToSkelMatrix;
+    mInfluenceGroups.transform(&positionSrc->front(), &normalSrc->front(), &positionDst->front(), &normalDst->front());
+}
 
-        for (std::vector<unsigned short>::const_iterator vertexIt = it->second.begin(); vertexIt != it->second.end(); ++vertexIt)
-        {
-            unsigned short vertex = *vertexIt;
-            (*positionDst)[vertex] = resultMat.preMult((*positionSrc)[vertex]);
-            (*normalDst)[vertex] = osg::Matrix::transform3x3((*normalSrc)[vertex], resultMat);
-        }
-    }
+void RigGeometry::drawImplementation(osg::RenderInfo &renderInfo) const
+{
+    // The vertex arrays are uploaded while drawing, so wait for the skinning as late as that
+    if (mSkinningTicket)
+        mSkinningTicket->waitTillDone();
 
-    positionDst->dirty();
-    normalDst->dirty();
+    osg::Geometry::drawImplementation(renderInfo);
 }
 
 void RigGeometry::updateBounds(osg::NodeVisitor *nv)
@@ -4,6 +4,9 @@
 #include <osg/Geometry>
 #include <osg/Matrixf>
 
+#include "skinning.hpp"
+#include "workqueue.hpp"
+
 namespace SceneUtil
 {
 
@@ -21,6 +24,11 @@ namespace SceneUtil
 
         META_Object(NifOsg, RigGeometry)
 
+        /// Skin larger meshes on the threads of this queue, alongside the cull traversal. The skinning is waited for
+        /// when the mesh is drawn. Without a queue (the default), meshes are skinned in the cull traversal.
+        /// @note The queue must outlive the drawing of the RigGeometries, set it back to NULL before destroying it.
+        static void setWorkQueue(WorkQueue* workQueue);
+
         struct BoneInfluence
         {
             osg::Matrixf mInvBindMatrix;
@@ -44,7 +52,14 @@ namespace SceneUtil
         // Called automatically by our UpdateCallback
         void updateBounds(osg::NodeVisitor* nv);
 
+        virtual void drawImplementation(osg::RenderInfo& renderInfo) const;
+
     private:
+        class SkinningItem;
+        friend class SkinningItem;
+
+        static WorkQueue* sWorkQueue;
+
         osg::ref_ptr<osg::Geometry> mSourceGeometry;
         Skeleton* mSkeleton;
 
@@ -53,15 +68,17 @@ namespace SceneUtil
 
         osg::ref_ptr<InfluenceMap> mInfluenceMap;
 
-        typedef std::pair<Bone*, osg::Matrixf> BoneBindMatrixPair;
-
-        typedef std::pair<BoneBindMatrixPair, float> BoneWeight;
+        // The bones that influence this geometry, and their inverse bind matrices
+        std::vector<Bone*> mBones;
+        std::vector<osg::Matrixf> mInvBindMatrices;
 
-        typedef std::vector<unsigned short> VertexList;
+        // Product of the inverse bind matrix and the current bone matrix, per bone. Only used during update().
+        std::vector<osg::Matrixf> mBoneMatrices;
 
-        typedef std::map<std::vector<BoneWeight>, VertexList> Bone2VertexMap;
+        InfluenceGroups mInfluenceGroups;
 
-        Bone2VertexMap mBone2VertexMap;
+        // The skinning on a worker thread, if any
+        osg::ref_ptr<WorkTicket> mSkinningTicket;
 
         typedef std::map<Bone*, osg::BoundingSpheref> BoneSphereMap;
 
@@ -73,6 +90,9 @@ namespace SceneUtil
         bool initFromParentSkeleton(osg::NodeVisitor* nv);
 
         void updateGeomToSkelMatrix(osg::NodeVisitor* nv);
+
+        /// Transform the vertices by the matrices of the influence groups.
+        void skin();
     };
 
 }
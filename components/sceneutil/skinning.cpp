@@ -0,0 +1,175 @@
+#include "skinning.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OPENMW_SKINNING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+
+    void accumulateMatrix(const osg::Matrixf& matrix, float weight, osg::Matrixf& result)
+    {
+        const float* ptr = matrix.ptr();
+        float* ptrresult = result.ptr();
+        ptrresult[0] += ptr[0] * weight;
+        ptrresult[1] += ptr[1] * weight;
+        ptrresult[2] += ptr[2] * weight;
+
+        ptrresult[4] += ptr[4] * weight;
+        ptrresult[5] += ptr[5] * weight;
+        ptrresult[6] += ptr[6] * weight;
+
+        ptrresult[8] += ptr[8] * weight;
+        ptrresult[9] += ptr[9] * weight;
+        ptrresult[10] += ptr[10] * weight;
+
+        ptrresult[12] += ptr[12] * weight;
+        ptrresult[13] += ptr[13] * weight;
+        ptrresult[14] += ptr[14] * weight;
+    }
+
+#ifdef OPENMW_SKINNING_SSE
+    // Only write x, y and z, the next vertex follows right after them
+    inline void storeVec3(float* out, __m128 value)
+    {
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), value);
+        _mm_store_ss(out + 2, _mm_movehl_ps(value, value));
+    }
+#endif
+
+}
+
+namespace SceneUtil
+{
+
+void transformVertices(const osg::Matrixf& matrix, const unsigned short* indices, unsigned int numIndices,
+                       const osg::Vec3f* positionsIn, const osg::Vec3f* normalsIn,
+                       osg::Vec3f* positionsOut, osg::Vec3f* normalsOut)
+{
+    // Equivalent to matrix.preMult() and osg::Matrix::transform3x3(), without the divide by w that an affine matrix does not need
+    const float* m = matrix.ptr();
+
+#ifdef OPENMW_SKINNING_SSE
+    // One row of the matrix per register, so a vertex is transformed with three multiplies and adds
+    const __m128 row0 = _mm_setr_ps(m[0], m[1], m[2], 0.f);
+    const __m128 row1 = _mm_setr_ps(m[4], m[5], m[6], 0.f);
+    const __m128 row2 = _mm_setr_ps(m[8], m[9], m[10], 0.f);
+    const __m128 row3 = _mm_setr_ps(m[12], m[13], m[14], 0.f);
+
+    for (unsigned int i=0; i<numIndices; ++i)
+    {
+        const unsigned short vertex = indices[i];
+
+        const float* position = positionsIn[vertex].ptr();
+        __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(position[0]), row0),
+                                              _mm_mul_ps(_mm_set1_ps(position[1]), row1)),
+                                   _mm_add_ps(_mm_mul_ps(_mm_set1_ps(position[2]), row2), row3));
+        storeVec3(positionsOut[vertex].ptr(), result);
+
+        const float* normal = normalsIn[vertex].ptr();
+        result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(normal[0]), row0),
+                                       _mm_mul_ps(_mm_set1_ps(normal[1]), row1)),
+                            _mm_mul_ps(_mm_set1_ps(normal[2]), row2));
+        storeVec3(normalsOut[vertex].ptr(), result);
+    }
+#else
+    const float m0 = m[0], m1 = m[1], m2 = m[2];
+    const float m4 = m[4], m5 = m[5], m6 = m[6];
+    const float m8 = m[8], m9 = m[9], m10 = m[10];
+    const float m12 = m[12], m13 = m[13], m14 = m[14];
+
+    for (unsigned int i=0; i<numIndices; ++i)
+    {
+        const unsigned short vertex = indices[i];
+
+        const osg::Vec3f& position = positionsIn[vertex];
+        positionsOut[vertex].set(position.x() * m0 + position.y() * m4 + position.z() * m8 + m12,
+                                 position.x() * m1 + position.y() * m5 + position.z() * m9 + m13,
+                                 position.x() * m2 + position.y() * m6 + position.z() * m10 + m14);
+
+        const osg::Vec3f& normal = normalsIn[vertex];
+        normalsOut[vertex].set(normal.x() * m0 + normal.y() * m4 + normal.z() * m8,
+                               normal.x() * m1 + normal.y() * m5 + normal.z() * m9,
+                               normal.x() * m2 + normal.y() * m6 + normal.z() * m10);
+    }
+#endif
+}
+
+void InfluenceGroups::build(const std::vector<const VertexWeights*>& boneWeights)
+{
+    mGroups.clear();
+    mBoneWeights.clear();
+    mVertices.clear();
+    mMatrices.clear();
+
+    typedef std::map<unsigned short, std::vector<BoneWeight> > Vertex2BoneMap;
+    Vertex2BoneMap vertex2BoneMap;
+    for (unsigned int bone=0; bone<boneWeights.size(); ++bone)
+    {
+        const VertexWeights& weights = *boneWeights[bone];
+        for (VertexWeights::const_iterator it = weights.begin(); it != weights.end(); ++it)
+            vertex2BoneMap[it->first].push_back(std::make_pair(bone, it->second));
+    }
+
+    typedef std::map<std::vector<BoneWeight>, std::vector<unsigned short> > Bone2VertexMap;
+    Bone2VertexMap bone2VertexMap;
+    for (Vertex2BoneMap::iterator it = vertex2BoneMap.begin(); it != vertex2BoneMap.end(); ++it)
+        bone2VertexMap[it->second].push_back(it->first);
+
+    // Flatten the groups, so the skinning does not need to chase the map nodes
+    for (Bone2VertexMap::const_iterator it = bone2VertexMap.begin(); it != bone2VertexMap.end(); ++it)
+    {
+        Group group;
+        group.mFirstWeight = mBoneWeights.size();
+        group.mNumWeights = it->first.size();
+        group.mFirstVertex = mVertices.size();
+        group.mNumVertices = it->second.size();
+        mGroups.push_back(group);
+
+        mBoneWeights.insert(mBoneWeights.end(), it->first.begin(), it->first.end());
+        mVertices.insert(mVertices.end(), it->second.begin(), it->second.end());
+    }
+    mMatrices.resize(mGroups.size());
+}
+
+bool InfluenceGroups::empty() const
+{
+    return mVertices.empty();
+}
+
+unsigned int InfluenceGroups::getNumGroups() const
+{
+    return mGroups.size();
+}
+
+unsigned int InfluenceGroups::getNumVertices() const
+{
+    return mVertices.size();
+}
+
+void InfluenceGroups::computeMatrices(const std::vector<osg::Matrixf>& boneMatrices, const osg::Matrixf& postMatrix)
+{
+    for (unsigned int i=0; i<mGroups.size(); ++i)
+    {
+        osg::Matrixf resultMat  (0, 0, 0, 0,
+                                0, 0, 0, 0,
+                                0, 0, 0, 0,
+                                0, 0, 0, 1);
+
+        const BoneWeight* weights = &mBoneWeights[mGroups[i].mFirstWeight];
+        for (unsigned int j=0; j<mGroups[i].mNumWeights; ++j)
+            accumulateMatrix(boneMatrices[weights[j].first], weights[j].second, resultMat);
+        mMatrices[i] = resultMat * postMatrix;
+    }
+}
+
+void InfluenceGroups::transform(const osg::Vec3f* positionsIn, const osg::Vec3f* normalsIn,
+                                osg::Vec3f* positionsOut, osg::Vec3f* normalsOut) const
+{
+    for (unsigned int i=0; i<mGroups.size(); ++i)
+        transformVertices(mMatrices[i], &mVertices[mGroups[i].mFirstVertex], mGroups[i].mNumVertices,
+                          positionsIn, normalsIn, positionsOut, normalsOut);
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_SKINNING_H
+#define OPENMW_COMPONENTS_SCENEUTIL_SKINNING_H
+
+#include <map>
+#include <vector>
+
+#include <osg/Matrixf>
+#include <osg/Vec3f>
+
+namespace SceneUtil
+{
+
+    /// Transform some of the vertices of a mesh, and their normals, by an affine matrix. Used for skinning.
+    /// @param indices The vertices to transform, the other vertices in \a positionsOut and \a normalsOut are left as they are.
+    void transformVertices(const osg::Matrixf& matrix, const unsigned short* indices, unsigned int numIndices,
+                           const osg::Vec3f* positionsIn, const osg::Vec3f* normalsIn,
+                           osg::Vec3f* positionsOut, osg::Vec3f* normalsOut);
+
+    /// @brief The bone weights of a skinned mesh, in flat arrays. Vertices that are influenced by the same bones with
+    /// the same weights form a group, and are skinned with a single matrix.
+    class InfluenceGroups
+    {
+    public:
+        /// <vertex index, weight>
+        typedef std::map<unsigned short, float> VertexWeights;
+
+        /// @param boneWeights The weights of the vertices influenced by each bone, in the order of the bone
+        /// matrices passed to computeMatrices().
+        void build(const std::vector<const VertexWeights*>& boneWeights);
+
+        bool empty() const;
+
+        unsigned int getNumGroups() const;
+
+        /// The number of vertices influenced by any bone.
+        unsigned int getNumVertices() const;
+
+        /// Compute the skinning matrix of each group.
+        /// @param boneMatrices Per bone, its inverse bind matrix multiplied by its current matrix.
+        /// @param postMatrix Applied after the weighted bone matrices.
+        void computeMatrices(const std::vector<osg::Matrixf>& boneMatrices, const osg::Matrixf& postMatrix);
+
+        /// Transform the vertices of each group by the matrix from the last computeMatrices(). The vertices
+        /// that no bone influences are left as they are.
+        void transform(const osg::Vec3f* positionsIn, const osg::Vec3f* normalsIn,
+                       osg::Vec3f* positionsOut, osg::Vec3f* normalsOut) const;
+
+    private:
+        // <bone index, weight>
+        typedef std::pair<unsigned int, float> BoneWeight;
+
+        /// Refers to a range of mBoneWeights and a range of mVertices.
+        struct Group
+        {
+            unsigned int mFirstWeight;
+            unsigned int mNumWeights;
+            unsigned int mFirstVertex;
+            unsigned int mNumVertices;
+        };
+
+        std::vector<Group> mGroups;
+        std::vector<BoneWeight> mBoneWeights;
+        std::vector<unsigned short> mVertices;
+
+        // Per group
+        std::vector<osg::Matrixf> mMatrices;
+    };
+
+}
+
+#endif
@@ -1,8 +1,16 @@
 #include "workqueue.hpp"
 
+#include <algorithm>
+
 namespace SceneUtil
 {
 
+WorkTicket::WorkTicket()
+    : mDone(0)
+    , mCancelled(0)
+{
+}
+
 void WorkTicket::waitTillDone()
 {
     if (mDone > 0)
@@ -15,13 +23,47 @@ void WorkTicket::waitTillDone()
     }
 }
 
+bool WorkTicket::isDone()
+{
+    return mDone > 0;
+}
+
 void WorkTicket::signalDone()
 {
+    std::vector<Continuation> continuations;
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
         mDone.exchange(1);
+        continuations.swap(mContinuations);
     }
     mCondition.broadcast();
+
+    for (std::vector<Continuation>::const_iterator it = continuations.begin(); it != continuations.end(); ++it)
+        it->mWorkQueue->dependencyDone(it->mItem, it->mPriority);
+}
+
+void WorkTicket::cancel()
+{
+    mCancelled.exchange(1);
+}
+
+bool WorkTicket::isCancelled()
+{
+    return mCancelled > 0;
+}
+
+bool WorkTicket::addContinuation(WorkQueue *workQueue, WorkItem *item, int priority)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    if (mDone > 0)
+        return false;
+
+    Continuation continuation;
+    continuation.mWorkQueue = workQueue;
+    continuation.mItem = item;
+    continuation.mPriority = priority;
+    mContinuations.push_back(continuation);
+    return true;
 }
 
 WorkItem::WorkItem()
@@ -46,10 +88,17 @@ osg::ref_ptr<WorkTicket> WorkItem::getTicket()
 
 WorkQueue::WorkQueue(int workerThreads)
     : mIsReleased(false)
+    , mNumQueued(0)
+    , mNextThread(0)
+    , mNumSleeping(0)
 {
+    // Need a queue to add items to, even without threads
+    for (int i=0; i<std::max(1, workerThreads); ++i)
+        mQueues.push_back(new ThreadQueue);
+
     for (int i=0; i<workerThreads; ++i)
     {
-        WorkThread* thread = new WorkThread(this);
+        WorkThread* thread = new WorkThread(this, i);
         mThreads.push_back(thread);
         thread->startThread();
     }
@@ -59,12 +108,6 @@ WorkQueue::~WorkQueue()
 {
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-        while (mQueue.size())
-        {
-            WorkItem* item = mQueue.front();
-            delete item;
-            mQueue.pop();
-        }
         mIsReleased = true;
         mCondition.broadcast();
     }
@@ -74,36 +117,183 @@ WorkQueue::~WorkQueue()
         mThreads[i]->join();
         delete mThreads[i];
     }
+
+    // Discard the items that were not run yet. Their continuations are discarded as well, as the queue is released.
+    // Items scheduled from elsewhere after a queue is released are discarded right away.
+    std::vector<WorkItem*> items;
+    for (unsigned int i=0; i<mQueues.size(); ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mQueues[i]->mMutex);
+        mQueues[i]->mIsReleased = true;
+        for (int priority=0; priority<Priority_Count; ++priority)
+        {
+            items.insert(items.end(), mQueues[i]->mItems[priority].begin(), mQueues[i]->mItems[priority].end());
+            mQueues[i]->mItems[priority].clear();
+        }
+    }
+    for (std::vector<WorkItem*>::iterator it = items.begin(); it != items.end(); ++it)
+        discard(*it);
+
+    for (unsigned int i=0; i<mQueues.size(); ++i)
+        delete mQueues[i];
 }
 
-osg::ref_ptr<WorkTicket> WorkQueue::addWorkItem(WorkItem *item)
+osg::ref_ptr<WorkTicket> WorkQueue::addWorkItem(WorkItem *item, Priority priority)
 {
     osg::ref_ptr<WorkTicket> ticket = item->getTicket();
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-    mQueue.push(item);
-    mCondition.signal();
+    schedule(item, priority);
     return ticket;
 }
 
-WorkItem *WorkQueue::removeWorkItem()
+osg::ref_ptr<WorkTicket> WorkQueue::addContinuation(WorkItem *item, const std::vector<osg::ref_ptr<WorkTicket> > &dependencies,
+                                                    Priority priority)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-    while (!mQueue.size() && !mIsReleased)
+    osg::ref_ptr<WorkTicket> ticket = item->getTicket();
+
+    // Hold the item back until all dependencies are registered
+    item->mPendingDependencies.exchange(dependencies.size() + 1);
+    for (std::vector<osg::ref_ptr<WorkTicket> >::const_iterator it = dependencies.begin(); it != dependencies.end(); ++it)
     {
-        mCondition.wait(&mMutex);
+        if (!(*it)->addContinuation(this, item, priority))
+            --item->mPendingDependencies;
     }
-    if (mQueue.size())
+    dependencyDone(item, priority);
+
+    return ticket;
+}
+
+void WorkQueue::dependencyDone(WorkItem *item, int priority)
+{
+    if (--item->mPendingDependencies == 0)
+        schedule(item, priority);
+}
+
+void WorkQueue::schedule(WorkItem *item, int priority)
+{
+    // Items added by one of our threads go to the front of its own queue, as the data they need is likely in its cache
+    WorkThread* current = dynamic_cast<WorkThread*>(OpenThreads::Thread::CurrentThread());
+    bool local = current && current->getWorkQueue() == this;
+
+    // Only the lock of the target queue is taken, so producers adding to different queues do not contend
+    unsigned int thread = local ? current->getIndex() : (++mNextThread) % mQueues.size();
+    ThreadQueue& queue = *mQueues[thread];
+    bool released;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue.mMutex);
+        // The destructor drains the queues under their locks once released, so no item is left behind
+        released = queue.mIsReleased;
+        if (!released)
+        {
+            // Count the item before it is queued, so a thread that removes it never sees a negative count
+            ++mNumQueued;
+            ++mNumQueuedWithPriority[priority];
+
+            if (local)
+                queue.mItems[priority].push_front(item);
+            else
+                queue.mItems[priority].push_back(item);
+        }
+    }
+
+    if (released)
+    {
+        discard(item);
+        return;
+    }
+
+    // The sleeping threads count themselves before checking mNumQueued, so they either see the new item or get woken up
+    if (mNumSleeping > 0)
     {
-        WorkItem* item = mQueue.front();
-        mQueue.pop();
-        return item;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        mCondition.signal();
+    }
+}
+
+WorkItem* WorkQueue::popWorkItem(unsigned int thread)
+{
+    const unsigned int numQueues = mQueues.size();
+    for (int priority=0; priority<Priority_Count; ++priority)
+    {
+        if (mNumQueuedWithPriority[priority] == 0)
+            continue;
+
+        // Our own queue first, then steal from the back of the others
+        for (unsigned int i=0; i<numQueues; ++i)
+        {
+            ThreadQueue& queue = *mQueues[(thread + i) % numQueues];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue.mMutex);
+            std::deque<WorkItem*>& items = queue.mItems[priority];
+            if (items.empty())
+                continue;
+
+            WorkItem* item;
+            if (i == 0)
+            {
+                item = items.front();
+                items.pop_front();
+            }
+            else
+            {
+                item = items.back();
+                items.pop_back();
+            }
+            --mNumQueuedWithPriority[priority];
+            --mNumQueued;
+            return item;
+        }
     }
-    else
-        return NULL;
+    return NULL;
+}
+
+WorkItem *WorkQueue::removeWorkItem(unsigned int thread)
+{
+    while (true)
+    {
+        // Once the queue is released, the destructor discards the items that were not run yet
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+            if (mIsReleased)
+                return NULL;
+        }
+
+        WorkItem* item = popWorkItem(thread);
+        if (item)
+        {
+            if (item->getTicket()->isCancelled())
+            {
+                discard(item);
+                continue;
+            }
+            return item;
+        }
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        // Count ourselves as sleeping before checking for work, see schedule()
+        ++mNumSleeping;
+        while (mNumQueued == 0 && !mIsReleased)
+            mCondition.wait(&mMutex);
+        --mNumSleeping;
+        if (mIsReleased)
+            return NULL;
+    }
+}
+
+unsigned int WorkQueue::getNumThreads() const
+{
+    return mThreads.size();
+}
+
+void WorkQueue::discard(WorkItem *item)
+{
+    osg::ref_ptr<WorkTicket> ticket = item->getTicket();
+    delete item;
+    ticket->cancel();
+    ticket->signalDone();
 }
 
-WorkThread::WorkThread(WorkQueue *workQueue)
+WorkThread::WorkThread(WorkQueue *workQueue, unsigned int index)
     : mWorkQueue(workQueue)
+    , mIndex(index)
 {
 }
 
@@ -111,7 +301,7 @@ void WorkThread::run()
 {
     while (true)
     {
-        WorkItem* item = mWorkQueue->removeWorkItem();
+        WorkItem* item = mWorkQueue->removeWorkItem(mIndex);
         if (!item)
             return;
         item->doWork();
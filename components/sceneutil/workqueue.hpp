@@ -9,20 +9,49 @@
 #include <osg/Referenced>
 #include <osg/ref_ptr>
 
-#include <queue>
+#include <deque>
+#include <vector>
 
 namespace SceneUtil
 {
 
+    class WorkItem;
+    class WorkQueue;
+
     class WorkTicket : public osg::Referenced
     {
     public:
+        WorkTicket();
+
         void waitTillDone();
 
         void signalDone();
 
+        /// Has the work item signalled that it is done? Does not block.
+        bool isDone();
+
+        /// Request that the work is not done after all. A work item that has not been started yet is discarded
+        /// (the ticket is still signalled as done), a work item in progress may check isCancelled() to stop early.
+        void cancel();
+
+        bool isCancelled();
+
     private:
+        friend class WorkQueue;
+
+        /// @return false if the ticket is already done, the continuation is not added then.
+        bool addContinuation(WorkQueue* workQueue, WorkItem* item, int priority);
+
+        struct Continuation
+        {
+            WorkQueue* mWorkQueue;
+            WorkItem* mItem;
+            int mPriority;
+        };
+        std::vector<Continuation> mContinuations;
+
         OpenThreads::Atomic mDone;
+        OpenThreads::Atomic mCancelled;
         OpenThreads::Mutex mMutex;
         OpenThreads::Condition mCondition;
     };
@@ -41,46 +70,101 @@ namespace SceneUtil
 
     protected:
         osg::ref_ptr<WorkTicket> mTicket;
-    };
 
-    class WorkQueue;
+    private:
+        friend class WorkQueue;
+
+        // Number of dependencies that are not done yet, see WorkQueue::addContinuation
+        OpenThreads::Atomic mPendingDependencies;
+    };
 
     class WorkThread : public OpenThreads::Thread
     {
     public:
-        WorkThread(WorkQueue* workQueue);
+        WorkThread(WorkQueue* workQueue, unsigned int index);
 
         virtual void run();
 
+        WorkQueue* getWorkQueue() const { return mWorkQueue; }
+        unsigned int getIndex() const { return mIndex; }
+
     private:
         WorkQueue* mWorkQueue;
+        unsigned int mIndex;
     };
 
     /// @brief A work queue that users can push work items onto, to be completed by one or more background threads.
+    /// @par Each thread has its own queue for each priority, so the threads do not contend for a single lock. A thread that runs
+    /// out of work steals from the other threads. Items added by a work item (e.g. continuations) are queued on its own thread.
     class WorkQueue
     {
     public:
+        enum Priority
+        {
+            Priority_High, ///< Work that is waited for, e.g. loading that blocks the main thread
+            Priority_Normal,
+            Priority_Low, ///< Speculative work, e.g. preloading
+
+            Priority_Count
+        };
+
         WorkQueue(int numWorkerThreads=1);
         ~WorkQueue();
 
         /// Add a new work item to the back of the queue.
         /// @par The returned WorkTicket may be used by the caller to wait until the work is complete.
-        osg::ref_ptr<WorkTicket> addWorkItem(WorkItem* item);
+        osg::ref_ptr<WorkTicket> addWorkItem(WorkItem* item, Priority priority=Priority_Normal);
+
+        /// Add a work item that is queued once all of the given tickets are done (or cancelled).
+        osg::ref_ptr<WorkTicket> addContinuation(WorkItem* item, const std::vector<osg::ref_ptr<WorkTicket> >& dependencies,
+                                                 Priority priority=Priority_Normal);
 
-        /// Get the next work item from the front of the queue. If the queue is empty, waits until a new item is added.
-        /// If the workqueue is in the process of being destroyed, may return NULL.
+        /// Get the next work item for the given thread, stealing from the other threads if it has none. If there is no work,
+        /// waits until a new item is added. If the workqueue is in the process of being destroyed, may return NULL.
         /// @note The caller must free the returned WorkItem
-        WorkItem* removeWorkItem();
+        WorkItem* removeWorkItem(unsigned int thread);
 
-        void runThread();
+        unsigned int getNumThreads() const;
 
     private:
+        friend class WorkTicket;
+
+        /// Called by a ticket this queue has a continuation of.
+        void dependencyDone(WorkItem* item, int priority);
+
+        void schedule(WorkItem* item, int priority);
+
+        WorkItem* popWorkItem(unsigned int thread);
+
+        /// Discard a work item that will not be run, signalling its ticket.
+        static void discard(WorkItem* item);
+
+        struct ThreadQueue
+        {
+            ThreadQueue() : mIsReleased(false) {}
+
+            // Protects the items and mIsReleased, items are only added and removed under this lock
+            OpenThreads::Mutex mMutex;
+            bool mIsReleased;
+            std::deque<WorkItem*> mItems[Priority_Count];
+        };
+
         bool mIsReleased;
-        std::queue<WorkItem*> mQueue;
 
+        // Items in the thread queues that have not been removed yet, in total and per priority
+        OpenThreads::Atomic mNumQueued;
+        OpenThreads::Atomic mNumQueuedWithPriority[Priority_Count];
+
+        // Round robin counter for the queue that items from other threads are added to
+        OpenThreads::Atomic mNextThread;
+        // Threads waiting for work. Only changed under mMutex, but read without it to skip the wakeup when nobody sleeps.
+        OpenThreads::Atomic mNumSleeping;
+
+        // Protects mIsReleased and the sleeping of threads, it is not taken to queue items
         OpenThreads::Mutex mMutex;
         OpenThreads::Condition mCondition;
 
+        std::vector<ThreadQueue*> mQueues;
         std::vector<WorkThread*> mThreads;
     };
 
@@ -0,0 +1,200 @@
+#include "chunkbuilder.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <components/resource/resourcesystem.hpp>
+#include <components/resource/texturemanager.hpp>
+
+#include <components/sceneutil/lightmanager.hpp>
+#include <components/sceneutil/positionattitudetransform.hpp>
+
+#include <components/esm/loadland.hpp>
+
+#include <osg/Geometry>
+#include <osg/Geode>
+#include <osg/Texture2D>
+#include <osg/Version>
+
+#include <osgFX/Effect>
+
+#include <osgUtil/IncrementalCompileOperation>
+
+#include "compositemap.hpp"
+#include "material.hpp"
+#include "storage.hpp"
+
+namespace
+{
+    class StaticBoundingBoxCallback : public osg::Drawable::ComputeBoundingBoxCallback
+    {
+    public:
+        StaticBoundingBoxCallback(const osg::BoundingBox& bounds)
+            : mBoundingBox(bounds)
+        {
+        }
+
+        virtual osg::BoundingBox computeBound(const osg::Drawable&) const
+        {
+            return mBoundingBox;
+        }
+
+    private:
+        osg::BoundingBox mBoundingBox;
+    };
+}
+
+namespace Terrain
+{
+
+ChunkBuilder::ChunkBuilder(Storage *storage, Resource::ResourceSystem *resourceSystem, osgUtil::IncrementalCompileOperation *ico,
+                           CompositeMapBaker *compositeMaps)
+    : mStorage(storage)
+    , mResourceSystem(resourceSystem)
+    , mCompositeMaps(compositeMaps)
+    , mIncrementalCompileOperation(ico)
+{
+}
+
+ChunkBuilder::~ChunkBuilder()
+{
+}
+
+osg::ref_ptr<osg::Node> ChunkBuilder::buildChunk(float chunkSize, const osg::Vec2f &chunkCenter, int lodLevel,
+                                                 osg::DrawElements *indexBuffer, osg::Vec2Array *uvBuffer, bool compositeMap,
+                                                 osg::BoundingBox* bounds)
+{
+    osg::Vec2f worldCenter = chunkCenter*mStorage->getCellWorldSize();
+    osg::ref_ptr<SceneUtil::PositionAttitudeTransform> transform (new SceneUtil::PositionAttitudeTransform);
+    transform->setPosition(osg::Vec3f(worldCenter.x(), worldCenter.y(), 0.f));
+
+    // Arrays of chunks that were unloaded are filled again, see VertexBufferPool
+    unsigned int numVerts = static_cast<unsigned int>(chunkSize*(mStorage->getCellVertices()-1) / (1 << lodLevel) + 1);
+    VertexBufferPool::Slab slab = mVertexBuffers.getSlab(numVerts*numVerts);
+    osg::ref_ptr<osg::Vec3Array> positions = slab.mPositions;
+    osg::ref_ptr<osg::Vec3Array> normals = slab.mNormals;
+    osg::ref_ptr<osg::Vec4Array> colors = slab.mColours;
+
+    mStorage->fillVertexBuffers(lodLevel, chunkSize, chunkCenter, positions, normals, colors);
+
+    positions->dirty();
+    normals->dirty();
+    colors->dirty();
+
+    osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
+    geometry->setVertexArray(positions);
+    geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    geometry->setColorArray(colors, osg::Array::BIND_PER_VERTEX);
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+
+    geometry->addPrimitiveSet(indexBuffer);
+
+    // The heights are known from the vertices just filled in, and the bounds do not change after that,
+    // so no need to let OSG compute them.
+    float minHeight = std::numeric_limits<float>::max();
+    float maxHeight = -std::numeric_limits<float>::max();
+    for (osg::Vec3Array::const_iterator it = positions->begin(); it != positions->end(); ++it)
+    {
+        minHeight = std::min(minHeight, it->z());
+        maxHeight = std::max(maxHeight, it->z());
+    }
+    osg::Vec3f min(-0.5f*mStorage->getCellWorldSize()*chunkSize,
+                   -0.5f*mStorage->getCellWorldSize()*chunkSize,
+                   minHeight);
+    osg::Vec3f max (0.5f*mStorage->getCellWorldSize()*chunkSize,
+                       0.5f*mStorage->getCellWorldSize()*chunkSize,
+                       maxHeight);
+    osg::BoundingBox boundingBox(min, max);
+    geometry->setComputeBoundingBoxCallback(new StaticBoundingBoxCallback(boundingBox));
+    if (bounds)
+        *bounds = boundingBox;
+
+    // Chunks larger than one cell always use their composite map when there is one, see Storage::getBlendmaps
+    compositeMap = mCompositeMaps && (compositeMap || chunkSize > 1.f);
+
+    std::vector<LayerInfo> layerList;
+    std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+    if (!compositeMap)
+    {
+        if (chunkSize <= 1.f)
+            mStorage->getBlendmaps(chunkSize, chunkCenter, false, blendmaps, layerList);
+        else
+        {
+            // Blending the layers of many cells would need too many textures, see Storage::getBlendmaps.
+            // The vertex colours still give distant chunks their tint.
+            layerList.push_back(mStorage->getDefaultLayer());
+        }
+    }
+
+    // For compiling textures, I don't think the osgFX::Effect does it correctly
+    osg::ref_ptr<osg::Node> textureCompileDummy (new osg::Node);
+
+    std::vector<osg::ref_ptr<osg::Texture2D> > layerTextures;
+    for (std::vector<LayerInfo>::const_iterator it = layerList.begin(); it != layerList.end(); ++it)
+    {
+        layerTextures.push_back(mResourceSystem->getTextureManager()->getTexture2D(it->mDiffuseMap, osg::Texture::REPEAT, osg::Texture::REPEAT));
+        textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(0, layerTextures.back());
+    }
+
+    float layerTileSize = ESM::Land::LAND_TEXTURE_SIZE*chunkSize;
+    if (compositeMap)
+    {
+        // The layers are already blended into one texture, see CompositeMapBaker
+        layerTextures.push_back(mCompositeMaps->getCompositeMap(chunkSize, chunkCenter));
+        textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(0, layerTextures.back());
+        // The composite map covers the chunk once, rather than repeating like the layers
+        layerTileSize = 1.f;
+    }
+
+    std::vector<osg::ref_ptr<osg::Texture2D> > blendmapTextures;
+    for (std::vector<osg::ref_ptr<osg::Image> >::const_iterator it = blendmaps.begin(); it != blendmaps.end(); ++it)
+    {
+        osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D);
+        texture->setImage(*it);
+        texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+        texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+        texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+        texture->setResizeNonPowerOfTwoHint(false);
+        blendmapTextures.push_back(texture);
+
+        textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(0, layerTextures.back());
+    }
+
+    // use texture coordinates for both texture units, the layer texture and blend texture
+    for (unsigned int i=0; i<2; ++i)
+        geometry->setTexCoordArray(i, uvBuffer);
+
+    float blendmapScale = ESM::Land::LAND_TEXTURE_SIZE*chunkSize;
+    osg::ref_ptr<osgFX::Effect> effect (new Terrain::Effect(layerTextures, blendmapTextures, blendmapScale, layerTileSize));
+
+    effect->addCullCallback(new SceneUtil::LightListCallback);
+
+    transform->addChild(effect);
+
+#if OSG_VERSION_GREATER_OR_EQUAL(3,3,3)
+    osg::Node* toAttach = geometry.get();
+#else
+    osg::ref_ptr<osg::Geode> geode (new osg::Geode);
+    geode->addDrawable(geometry);
+    osg::Node* toAttach = geode.get();
+#endif
+
+    effect->addChild(toAttach);
+
+    if (mIncrementalCompileOperation)
+    {
+        mIncrementalCompileOperation->add(toAttach);
+        mIncrementalCompileOperation->add(textureCompileDummy);
+    }
+
+    return transform;
+}
+
+void ChunkBuilder::update()
+{
+    mVertexBuffers.update();
+}
+
+}
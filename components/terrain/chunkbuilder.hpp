@@ -0,0 +1,70 @@
+#ifndef COMPONENTS_TERRAIN_CHUNKBUILDER_H
+#define COMPONENTS_TERRAIN_CHUNKBUILDER_H
+
+#include <osg/ref_ptr>
+#include <osg/Array>
+#include <osg/BoundingBox>
+#include <osg/Vec2f>
+
+#include "vertexbufferpool.hpp"
+
+namespace osg
+{
+    class Node;
+    class DrawElements;
+}
+
+namespace osgUtil
+{
+    class IncrementalCompileOperation;
+}
+
+namespace Resource
+{
+    class ResourceSystem;
+}
+
+namespace Terrain
+{
+
+    class Storage;
+    class CompositeMapBaker;
+
+    /// @brief Creates the scene graph of terrain chunks: the geometry from the Storage, and the textured material.
+    class ChunkBuilder
+    {
+    public:
+        /// @param compositeMaps Bakes the composite maps of the chunks that use them, may be NULL if none do.
+        ChunkBuilder(Storage* storage, Resource::ResourceSystem* resourceSystem, osgUtil::IncrementalCompileOperation* ico,
+                     CompositeMapBaker* compositeMaps = NULL);
+        ~ChunkBuilder();
+
+        /// Build a chunk, positioned at its center.
+        /// @note May be called from background threads, as far as the Storage allows.
+        /// @param chunkSize size of the chunk in cell units. Chunks larger than one cell are textured with their composite map,
+        ///        or with the default layer only when there is no CompositeMapBaker.
+        /// @param chunkCenter center of the chunk in cell units
+        /// @param lodLevel LOD level of the vertices, see Storage::fillVertexBuffers
+        /// @param indexBuffer index buffer from the BufferCache, matching the number of vertices of the chunk
+        /// @param uvBuffer texture coordinates from the same BufferCache
+        /// @param compositeMap Draw the chunk in a single pass with its composite map, rather than one pass per layer.
+        /// @param bounds If not NULL, receives the bounding box of the chunk's vertices, relative to its center.
+        osg::ref_ptr<osg::Node> buildChunk(float chunkSize, const osg::Vec2f& chunkCenter, int lodLevel,
+                                           osg::DrawElements* indexBuffer, osg::Vec2Array* uvBuffer, bool compositeMap = false,
+                                           osg::BoundingBox* bounds = NULL);
+
+        /// Recycle the vertex arrays of chunks that are gone, see VertexBufferPool.
+        /// @note Call once per frame from the update traversal.
+        void update();
+
+    private:
+        Storage* mStorage;
+        Resource::ResourceSystem* mResourceSystem;
+        CompositeMapBaker* mCompositeMaps;
+        VertexBufferPool mVertexBuffers;
+        osg::ref_ptr<osgUtil::IncrementalCompileOperation> mIncrementalCompileOperation;
+    };
+
+}
+
+#endif
@@ -0,0 +1,436 @@
+#include "compositemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <osg/Version>
+
+#include <OpenThreads/Atomic>
+
+#include <components/esm/loadland.hpp>
+#include <components/resource/texturemanager.hpp>
+
+#include "storage.hpp"
+
+namespace
+{
+
+    const char sMagic[4] = { 'O', 'M', 'W', 'C' };
+
+    // Increment when the way composite maps are baked changes, to invalidate the cached ones
+    const boost::uint32_t sVersion = 1;
+
+    // A second checksum with a different polynomial, so that the hash of the baking inputs has 64 bits
+    typedef boost::crc_optimal<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true> crc_32c_type;
+
+    // Unique suffixes for the temporary files, as several threads may save the same composite map
+    OpenThreads::Atomic sTempCounter;
+
+    template <class T>
+    void write(std::ostream& stream, const T& value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    bool read(std::istream& stream, T& value)
+    {
+        stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return stream.good();
+    }
+
+    /// For each texel along one axis of the region, the two texels of the source image to interpolate between, and the weight of the second.
+    struct Axis
+    {
+        std::vector<int> mFirst;
+        std::vector<int> mSecond;
+        std::vector<float> mWeight;
+
+        void resize(int size)
+        {
+            mFirst.resize(size);
+            mSecond.resize(size);
+            mWeight.resize(size);
+        }
+    };
+
+    /// A blendmap clamped to its edges. The texture matrix of the FixedFunctionTechnique maps the corners of the
+    /// region to the centres of the outer texels, so the blendmap texels are sourceTexels-1 apart.
+    void sampleClamped(int size, int sourceTexels, Axis& axis)
+    {
+        axis.resize(size);
+        for (int i=0; i<size; ++i)
+        {
+            float pos = (i + 0.5f) / size * (sourceTexels - 1);
+            int first = std::min(static_cast<int>(pos), std::max(0, sourceTexels - 2));
+            axis.mFirst[i] = first;
+            axis.mSecond[i] = std::min(first + 1, sourceTexels - 1);
+            axis.mWeight[i] = pos - first;
+        }
+    }
+
+    /// A layer texture repeating \a repeats times across the region.
+    void sampleRepeated(int size, int sourceTexels, float repeats, Axis& axis)
+    {
+        axis.resize(size);
+        for (int i=0; i<size; ++i)
+        {
+            float pos = (i + 0.5f) / size * repeats * sourceTexels - 0.5f;
+            float floor = std::floor(pos);
+            int first = static_cast<int>(floor) % sourceTexels;
+            if (first < 0)
+                first += sourceTexels;
+            axis.mFirst[i] = first;
+            axis.mSecond[i] = (first + 1) % sourceTexels;
+            axis.mWeight[i] = pos - floor;
+        }
+    }
+
+    osg::ref_ptr<osg::Texture2D> createTexture(osg::Image* image)
+    {
+        osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D(image));
+        texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+        texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR_MIPMAP_LINEAR);
+        texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+        texture->setResizeNonPowerOfTwoHint(false);
+        return texture;
+    }
+
+}
+
+namespace Terrain
+{
+
+void compositeLayers(const std::vector<osg::ref_ptr<osg::Image> >& layers, const std::vector<osg::ref_ptr<osg::Image> >& blendmaps,
+                     float layerTileSize, osg::Image* target, int x, int y, int size)
+{
+    if (layers.empty() || size <= 0)
+        return;
+
+    // The interpolation weights only depend on the column or the row, so they are worked out once for the whole region
+    std::vector<Axis> layerColumns (layers.size());
+    std::vector<Axis> layerRows (layers.size());
+    for (unsigned int i=0; i<layers.size(); ++i)
+    {
+        sampleRepeated(size, layers[i]->s(), layerTileSize, layerColumns[i]);
+        sampleRepeated(size, layers[i]->t(), layerTileSize, layerRows[i]);
+    }
+
+    std::vector<Axis> blendColumns (blendmaps.size());
+    std::vector<Axis> blendRows (blendmaps.size());
+    for (unsigned int i=0; i<blendmaps.size(); ++i)
+    {
+        sampleClamped(size, blendmaps[i]->s(), blendColumns[i]);
+        sampleClamped(size, blendmaps[i]->t(), blendRows[i]);
+    }
+
+    std::vector<float> colour (size*3);
+    for (int row=0; row<size; ++row)
+    {
+        for (unsigned int layer=0; layer<layers.size() && layer<=blendmaps.size(); ++layer)
+        {
+            const Axis& columns = layerColumns[layer];
+            const unsigned char* top = layers[layer]->data(0, layerRows[layer].mFirst[row]);
+            const unsigned char* bottom = layers[layer]->data(0, layerRows[layer].mSecond[row]);
+            const float rowWeight = layerRows[layer].mWeight[row];
+
+            if (layer == 0)
+            {
+                // The base layer is drawn without blending
+                for (int column=0; column<size; ++column)
+                {
+                    const int first = columns.mFirst[column]*3;
+                    const int second = columns.mSecond[column]*3;
+                    const float weight = columns.mWeight[column];
+                    for (int channel=0; channel<3; ++channel)
+                    {
+                        float upper = top[first+channel] + (top[second+channel] - top[first+channel]) * weight;
+                        float lower = bottom[first+channel] + (bottom[second+channel] - bottom[first+channel]) * weight;
+                        colour[column*3+channel] = upper + (lower - upper) * rowWeight;
+                    }
+                }
+                continue;
+            }
+
+            const osg::Image* blendmap = blendmaps[layer-1].get();
+            const Axis& blendColumnAxis = blendColumns[layer-1];
+            const unsigned char* blendTop = blendmap->data(0, blendRows[layer-1].mFirst[row]);
+            const unsigned char* blendBottom = blendmap->data(0, blendRows[layer-1].mSecond[row]);
+            const float blendRowWeight = blendRows[layer-1].mWeight[row];
+
+            for (int column=0; column<size; ++column)
+            {
+                const int blendFirst = blendColumnAxis.mFirst[column];
+                const int blendSecond = blendColumnAxis.mSecond[column];
+                const float blendWeight = blendColumnAxis.mWeight[column];
+                float upperAlpha = blendTop[blendFirst] + (blendTop[blendSecond] - blendTop[blendFirst]) * blendWeight;
+                float lowerAlpha = blendBottom[blendFirst] + (blendBottom[blendSecond] - blendBottom[blendFirst]) * blendWeight;
+                float alpha = (upperAlpha + (lowerAlpha - upperAlpha) * blendRowWeight) / 255.f;
+                if (alpha <= 0.f)
+                    continue;
+
+                const int first = columns.mFirst[column]*3;
+                const int second = columns.mSecond[column]*3;
+                const float weight = columns.mWeight[column];
+                for (int channel=0; channel<3; ++channel)
+                {
+                    float upper = top[first+channel] + (top[second+channel] - top[first+channel]) * weight;
+                    float lower = bottom[first+channel] + (bottom[second+channel] - bottom[first+channel]) * weight;
+                    float value = upper + (lower - upper) * rowWeight;
+                    colour[column*3+channel] += (value - colour[column*3+channel]) * alpha;
+                }
+            }
+        }
+
+        unsigned char* out = target->data(x, y + row);
+        for (int i=0; i<size*3; ++i)
+            out[i] = static_cast<unsigned char>(std::min(255.f, std::max(0.f, colour[i])) + 0.5f);
+    }
+}
+
+osg::ref_ptr<osg::Image> filterLayer(const osg::Image* image, int size)
+{
+#if !OSG_VERSION_GREATER_OR_EQUAL(3,4,0)
+    // Image::getColor can not decompress S3TC before OSG 3.4
+    if (image->isCompressed())
+        return NULL;
+#endif
+
+    const int width = image->s();
+    const int height = image->t();
+    if (width <= 0 || height <= 0 || size <= 0)
+        return NULL;
+    size = std::min(size, std::min(width, height));
+
+    std::vector<osg::Vec4f> sums (size*size);
+    std::vector<int> counts (size*size, 0);
+    for (int t=0; t<height; ++t)
+    {
+        const int row = t * size / height;
+        for (int s=0; s<width; ++s)
+        {
+            const int texel = row * size + s * size / width;
+            sums[texel] += image->getColor(s, t);
+            ++counts[texel];
+        }
+    }
+
+    osg::ref_ptr<osg::Image> filtered (new osg::Image);
+    filtered->allocateImage(size, size, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    unsigned char* data = filtered->data();
+    for (int i=0; i<size*size; ++i)
+    {
+        for (int channel=0; channel<3; ++channel)
+        {
+            float value = sums[i][channel] / counts[i] * 255.f;
+            data[i*3+channel] = static_cast<unsigned char>(std::min(255.f, std::max(0.f, value)) + 0.5f);
+        }
+    }
+    return filtered;
+}
+
+CompositeMapBaker::CompositeMapBaker(Storage *storage, Resource::TextureManager *textureManager, int resolution,
+                                     const boost::filesystem::path &cacheDirectory, size_t maxCacheBytes)
+    : mStorage(storage)
+    , mTextureManager(textureManager)
+    , mResolution(std::max(1, resolution))
+    , mCacheDirectory(cacheDirectory)
+    , mUseDiskCache(false)
+{
+    mCompositeMaps.setMaxBytes(maxCacheBytes);
+
+    if (!mCacheDirectory.empty())
+    {
+        try
+        {
+            boost::filesystem::create_directories(mCacheDirectory);
+            mUseDiskCache = boost::filesystem::is_directory(mCacheDirectory);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Failed to create composite map cache directory " << mCacheDirectory << ": " << e.what() << std::endl;
+        }
+    }
+}
+
+CompositeMapBaker::~CompositeMapBaker()
+{
+}
+
+osg::ref_ptr<osg::Texture2D> CompositeMapBaker::getCompositeMap(float chunkSize, const osg::Vec2f &chunkCenter)
+{
+    ChunkId id = std::make_pair(chunkSize, std::make_pair(chunkCenter.x(), chunkCenter.y()));
+    osg::ref_ptr<osg::Texture2D> cached = mCompositeMaps.get(id);
+    if (cached)
+        return cached;
+
+    // Bake without holding the lock. If two threads bake the same chunk, the first one to finish wins.
+    osg::ref_ptr<osg::Image> image = bake(chunkSize, chunkCenter);
+    return mCompositeMaps.add(id, createTexture(image), image->getTotalSizeInBytes());
+}
+
+void CompositeMapBaker::updateCache(double referenceTime)
+{
+    mCompositeMaps.update(referenceTime);
+    mFilteredLayers.update(referenceTime);
+}
+
+osg::ref_ptr<osg::Image> CompositeMapBaker::bake(float chunkSize, const osg::Vec2f &chunkCenter)
+{
+    // Storage::getBlendmaps handles at most one cell, so larger chunks are composited cell by cell
+    const float regionSize = std::min(chunkSize, 1.f);
+    const int regionsPerSide = std::max(1, static_cast<int>(chunkSize / regionSize + 0.5f));
+    const int regionTexels = std::max(1, mResolution / regionsPerSide);
+    const float layerTileSize = ESM::Land::LAND_TEXTURE_SIZE * regionSize;
+
+    std::vector<Storage::ImageVector> blendmaps (regionsPerSide*regionsPerSide);
+    std::vector<std::vector<LayerInfo> > layerLists (regionsPerSide*regionsPerSide);
+
+    boost::crc_32_type crc;
+    crc_32c_type crc32c;
+    for (int i=0; i<regionsPerSide*regionsPerSide; ++i)
+    {
+        osg::Vec2f regionCenter = chunkCenter + osg::Vec2f((i % regionsPerSide + 0.5f) * regionSize - chunkSize / 2.f,
+                                                           (i / regionsPerSide + 0.5f) * regionSize - chunkSize / 2.f);
+        mStorage->getBlendmaps(regionSize, regionCenter, false, blendmaps[i], layerLists[i]);
+
+        for (std::vector<LayerInfo>::const_iterator it = layerLists[i].begin(); it != layerLists[i].end(); ++it)
+        {
+            crc.process_bytes(it->mDiffuseMap.c_str(), it->mDiffuseMap.size() + 1);
+            crc32c.process_bytes(it->mDiffuseMap.c_str(), it->mDiffuseMap.size() + 1);
+        }
+        for (Storage::ImageVector::const_iterator it = blendmaps[i].begin(); it != blendmaps[i].end(); ++it)
+        {
+            crc.process_bytes((*it)->data(), (*it)->getTotalSizeInBytes());
+            crc32c.process_bytes((*it)->data(), (*it)->getTotalSizeInBytes());
+        }
+    }
+    const boost::uint64_t hash = (static_cast<boost::uint64_t>(crc.checksum()) << 32) | crc32c.checksum();
+    const int imageSize = regionTexels * regionsPerSide;
+
+    boost::filesystem::path filename;
+    if (mUseDiskCache)
+    {
+        filename = getFilename(chunkSize, chunkCenter);
+        osg::ref_ptr<osg::Image> loaded = load(filename, hash);
+        if (loaded && loaded->s() == imageSize && loaded->t() == imageSize)
+            return loaded;
+    }
+
+    osg::ref_ptr<osg::Image> image (new osg::Image);
+    image->allocateImage(imageSize, imageSize, 1, GL_RGB, GL_UNSIGNED_BYTE);
+
+    // The texels of the layers that make up one texel of the composite map
+    const int layerTexels = std::max(1, static_cast<int>(regionTexels / layerTileSize));
+
+    for (int i=0; i<regionsPerSide*regionsPerSide; ++i)
+    {
+        std::vector<osg::ref_ptr<osg::Image> > layers;
+        for (std::vector<LayerInfo>::const_iterator it = layerLists[i].begin(); it != layerLists[i].end(); ++it)
+            layers.push_back(getFilteredLayer(it->mDiffuseMap, layerTexels));
+
+        compositeLayers(layers, blendmaps[i], layerTileSize, image, (i % regionsPerSide) * regionTexels, (i / regionsPerSide) * regionTexels, regionTexels);
+    }
+
+    if (mUseDiskCache)
+        save(filename, hash, *image);
+    return image;
+}
+
+osg::ref_ptr<osg::Image> CompositeMapBaker::getFilteredLayer(const std::string &texture, int size)
+{
+    std::pair<std::string, int> key = std::make_pair(texture, size);
+    osg::ref_ptr<osg::Image> cached = mFilteredLayers.get(key);
+    if (cached)
+        return cached;
+
+    osg::ref_ptr<osg::Image> filtered;
+    osg::ref_ptr<osg::Image> image = mTextureManager->getImage(texture);
+    if (image)
+        filtered = filterLayer(image, size);
+    if (!filtered)
+    {
+        std::cerr << "Failed to read " << texture << " for the terrain composite maps" << std::endl;
+        // A neutral colour, the vertex colours still tint the chunk
+        filtered = new osg::Image;
+        filtered->allocateImage(1, 1, 1, GL_RGB, GL_UNSIGNED_BYTE);
+        std::memset(filtered->data(), 128, 3);
+    }
+    return mFilteredLayers.add(key, filtered, filtered->getTotalSizeInBytes());
+}
+
+boost::filesystem::path CompositeMapBaker::getFilename(float chunkSize, const osg::Vec2f &chunkCenter) const
+{
+    std::ostringstream stream;
+    stream << chunkSize << "_" << chunkCenter.x() << "_" << chunkCenter.y() << ".composite";
+    return mCacheDirectory / stream.str();
+}
+
+osg::ref_ptr<osg::Image> CompositeMapBaker::load(const boost::filesystem::path &filename, boost::uint64_t hash) const
+{
+    boost::filesystem::ifstream stream (filename, std::ios::binary);
+    if (!stream.is_open())
+        return NULL;
+
+    char magic[sizeof(sMagic)];
+    boost::uint32_t version, width, height;
+    boost::uint64_t fileHash;
+    stream.read(magic, sizeof(magic));
+    if (!stream.good() || std::memcmp(magic, sMagic, sizeof(sMagic)) != 0
+            || !read(stream, version) || !read(stream, width) || !read(stream, height) || !read(stream, fileHash)
+            || version != sVersion || fileHash != hash || width == 0 || height == 0
+            || width > static_cast<boost::uint32_t>(mResolution) || height > static_cast<boost::uint32_t>(mResolution))
+        return NULL;
+
+    osg::ref_ptr<osg::Image> image (new osg::Image);
+    image->allocateImage(width, height, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    stream.read(reinterpret_cast<char*>(image->data()), image->getTotalSizeInBytes());
+    if (stream.gcount() != static_cast<std::streamsize>(image->getTotalSizeInBytes()))
+    {
+        std::cerr << "Failed to read cached composite map " << filename << ", baking it again" << std::endl;
+        return NULL;
+    }
+    return image;
+}
+
+void CompositeMapBaker::save(const boost::filesystem::path &filename, boost::uint64_t hash, const osg::Image &image) const
+{
+    // Write to a temporary file and move it in place, so a concurrent load never sees a partial file
+    std::ostringstream tempName;
+    tempName << filename.string() << "." << ++sTempCounter << ".tmp";
+    boost::filesystem::path tempFilename (tempName.str());
+
+    try
+    {
+        {
+            boost::filesystem::ofstream stream (tempFilename, std::ios::binary);
+            stream.write(sMagic, sizeof(sMagic));
+            write(stream, sVersion);
+            write(stream, static_cast<boost::uint32_t>(image.s()));
+            write(stream, static_cast<boost::uint32_t>(image.t()));
+            write(stream, hash);
+            stream.write(reinterpret_cast<const char*>(image.data()), image.getTotalSizeInBytes());
+            stream.close();
+            if (stream.fail())
+                throw std::runtime_error("write failed");
+        }
+        boost::filesystem::rename(tempFilename, filename);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Failed to cache composite map " << filename << ": " << e.what() << std::endl;
+        boost::system::error_code ec;
+        boost::filesystem::remove(tempFilename, ec);
+    }
+}
+
+}
@@ -0,0 +1,90 @@
+#ifndef COMPONENTS_TERRAIN_COMPOSITEMAP_H
+#define COMPONENTS_TERRAIN_COMPOSITEMAP_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <osg/ref_ptr>
+#include <osg/Vec2f>
+#include <osg/Image>
+#include <osg/Texture2D>
+
+#include <components/resource/objectcache.hpp>
+
+namespace Resource
+{
+    class TextureManager;
+}
+
+namespace Terrain
+{
+
+    class Storage;
+
+    /// Blend the layers of a terrain region into a square of \a target, the way the passes of the FixedFunctionTechnique
+    /// blend them: each layer after the first is blended over the result so far, weighted by its linearly filtered blendmap.
+    /// @param layers One repeat of each layer texture as an RGB image, filtered to the footprint of a texel of \a target, see filterLayer.
+    /// @param blendmaps Blend values of each layer but the first, as GL_ALPHA images from Storage::getBlendmaps without packing.
+    /// @param layerTileSize How often the layer textures repeat across the region.
+    /// @param target RGB image to write to.
+    /// @param x, y, size The square of \a target covered by the region, in texels.
+    void compositeLayers(const std::vector<osg::ref_ptr<osg::Image> >& layers, const std::vector<osg::ref_ptr<osg::Image> >& blendmaps,
+                         float layerTileSize, osg::Image* target, int x, int y, int size);
+
+    /// Box filter a layer texture down to \a size texels on each side.
+    /// @return An RGB image, or NULL if the pixels of \a image can not be read.
+    osg::ref_ptr<osg::Image> filterLayer(const osg::Image* image, int size);
+
+    /// @brief Bakes the layers of a terrain chunk into a single colour texture, so that distant chunks are drawn in one pass
+    /// rather than one pass per layer, and do not need blendmaps at all.
+    /// @par A texel of a distant composite map covers many repeats of the layer textures, so the layers are filtered
+    /// down to that footprint first. Composite maps are kept in memory, and optionally on disk along with a hash of the
+    /// layer names and blend values they were baked from, so that they are baked again when the land changes.
+    /// @note Thread safe, composite maps are baked by the work items building the chunks.
+    class CompositeMapBaker
+    {
+    public:
+        /// @param resolution Texels on each side of a composite map, regardless of the size of the chunk.
+        /// @param cacheDirectory Where to store the composite maps for the next session, or empty to not store them.
+        /// @param maxCacheBytes Budget for the composite maps kept in memory, 0 for no budget.
+        CompositeMapBaker(Storage* storage, Resource::TextureManager* textureManager, int resolution,
+                          const boost::filesystem::path& cacheDirectory, size_t maxCacheBytes);
+        ~CompositeMapBaker();
+
+        /// Get the composite map of a chunk, baking it if needed.
+        /// @param chunkSize size of the chunk in cell units, a power of two
+        /// @param chunkCenter center of the chunk in cell units
+        osg::ref_ptr<osg::Texture2D> getCompositeMap(float chunkSize, const osg::Vec2f& chunkCenter);
+
+        /// Expire the composite maps that are no longer used by any chunk, see Resource::ObjectCache.
+        void updateCache(double referenceTime);
+
+    private:
+        osg::ref_ptr<osg::Image> bake(float chunkSize, const osg::Vec2f& chunkCenter);
+
+        osg::ref_ptr<osg::Image> getFilteredLayer(const std::string& texture, int size);
+
+        boost::filesystem::path getFilename(float chunkSize, const osg::Vec2f& chunkCenter) const;
+        osg::ref_ptr<osg::Image> load(const boost::filesystem::path& filename, boost::uint64_t hash) const;
+        void save(const boost::filesystem::path& filename, boost::uint64_t hash, const osg::Image& image) const;
+
+        Storage* mStorage;
+        Resource::TextureManager* mTextureManager;
+        int mResolution;
+
+        boost::filesystem::path mCacheDirectory;
+        bool mUseDiskCache;
+
+        typedef std::pair<float, std::pair<float, float> > ChunkId;
+        Resource::ObjectCache<ChunkId, osg::Texture2D> mCompositeMaps;
+
+        Resource::ObjectCache<std::pair<std::string, int>, osg::Image> mFilteredLayers;
+    };
+
+}
+
+#endif
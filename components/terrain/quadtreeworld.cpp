@@ -0,0 +1,520 @@
+#include "quadtreeworld.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include <osg/BoundingBox>
+#include <osg/Group>
+#include <osg/PrimitiveSet>
+#include <osg/Timer>
+
+#include <OpenThreads/Thread>
+
+#include <components/resource/resourcesystem.hpp>
+
+#include <components/sceneutil/workqueue.hpp>
+
+#include "storage.hpp"
+
+namespace
+{
+    // Vertices along each side of a chunk. The smallest chunks have the full resolution of the terrain data.
+    const unsigned int sChunkVertices = 17;
+
+    // Stitching an edge can skip at most all vertices of that edge but the corners
+    const unsigned int sMaxLodDelta = 4;
+}
+
+namespace Terrain
+{
+
+struct QuadTreeNode
+{
+    QuadTreeNode(QuadTreeNode* parent, float size, const osg::Vec2f& center)
+        : mParent(parent)
+        , mSize(size)
+        , mCenter(center)
+        , mMinHeight(std::numeric_limits<float>::max())
+        , mMaxHeight(-std::numeric_limits<float>::max())
+        , mChildrenBuilt(false)
+        , mSelectedFrame(0)
+    {
+        for (int i=0; i<4; ++i)
+            mChildren[i] = NULL;
+    }
+
+    ~QuadTreeNode()
+    {
+        for (int i=0; i<4; ++i)
+            delete mChildren[i];
+    }
+
+    QuadTreeNode* mParent;
+
+    // In cell units
+    float mSize;
+    osg::Vec2f mCenter;
+
+    // Not known (min > max) until a chunk within the node was built, see QuadTreeWorld::expandHeights
+    float mMinHeight;
+    float mMaxHeight;
+
+    // Indexed by getChildIndex, NULL where there is no terrain
+    QuadTreeNode* mChildren[4];
+    bool mChildrenBuilt;
+
+    // The frame this node was last selected for display in
+    unsigned int mSelectedFrame;
+};
+
+/// The built chunk, shared between the QuadTreeWorld and the work item building it.
+class ChunkRequest : public osg::Referenced
+{
+public:
+    osg::ref_ptr<osg::Node> mNode;
+    osg::BoundingBox mBounds;
+};
+
+namespace
+{
+    int getChildIndex(const QuadTreeNode* node, const osg::Vec2f& point)
+    {
+        return (point.x() >= node->mCenter.x() ? 1 : 0) + (point.y() >= node->mCenter.y() ? 2 : 0);
+    }
+
+    /// Distance from the view point to the closest point of the node's bounding box, in world units.
+    /// Only the horizontal distance while the heights of the node are not known.
+    float getDistance(const QuadTreeNode* node, const osg::Vec3f& viewPoint, float cellWorldSize)
+    {
+        float halfSize = node->mSize * cellWorldSize / 2.f;
+        bool heightsKnown = node->mMinHeight <= node->mMaxHeight;
+        osg::Vec3f min (node->mCenter.x() * cellWorldSize - halfSize, node->mCenter.y() * cellWorldSize - halfSize,
+                        heightsKnown ? node->mMinHeight : viewPoint.z());
+        osg::Vec3f max (node->mCenter.x() * cellWorldSize + halfSize, node->mCenter.y() * cellWorldSize + halfSize,
+                        heightsKnown ? node->mMaxHeight : viewPoint.z());
+        osg::Vec3f closest;
+        for (int i=0; i<3; ++i)
+            closest[i] = std::max(min[i], std::min(max[i], viewPoint[i]));
+        return (closest - viewPoint).length();
+    }
+
+    class BuildChunkItem : public SceneUtil::WorkItem
+    {
+    public:
+        BuildChunkItem(ChunkBuilder* builder, ChunkRequest* request, float size, const osg::Vec2f& center, int lodLevel,
+                       osg::DrawElements* indexBuffer, osg::Vec2Array* uvBuffer, bool compositeMap)
+            : mBuilder(builder)
+            , mRequest(request)
+            , mSize(size)
+            , mCenter(center)
+            , mLodLevel(lodLevel)
+            , mIndexBuffer(indexBuffer)
+            , mUVBuffer(uvBuffer)
+            , mCompositeMap(compositeMap)
+        {
+        }
+
+        virtual void doWork()
+        {
+            if (!mTicket->isCancelled())
+            {
+                try
+                {
+                    mRequest->mNode = mBuilder->buildChunk(mSize, mCenter, mLodLevel, mIndexBuffer, mUVBuffer, mCompositeMap,
+                                                           &mRequest->mBounds);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Failed to build terrain chunk at " << mCenter.x() << ", " << mCenter.y() << ": " << e.what() << std::endl;
+                }
+            }
+            mTicket->signalDone();
+        }
+
+    private:
+        ChunkBuilder* mBuilder;
+        osg::ref_ptr<ChunkRequest> mRequest;
+        float mSize;
+        osg::Vec2f mCenter;
+        int mLodLevel;
+        osg::ref_ptr<osg::DrawElements> mIndexBuffer;
+        osg::ref_ptr<osg::Vec2Array> mUVBuffer;
+        bool mCompositeMap;
+    };
+}
+
+bool QuadTreeWorld::ChunkKey::operator< (const ChunkKey& other) const
+{
+    if (mSize != other.mSize)
+        return mSize < other.mSize;
+    if (mCenter != other.mCenter)
+        return mCenter < other.mCenter;
+    if (mLodFlags != other.mLodFlags)
+        return mLodFlags < other.mLodFlags;
+    return mCompositeMap < other.mCompositeMap;
+}
+
+bool QuadTreeWorld::ChunkKey::operator== (const ChunkKey& other) const
+{
+    return mSize == other.mSize && mCenter == other.mCenter && mLodFlags == other.mLodFlags && mCompositeMap == other.mCompositeMap;
+}
+
+QuadTreeWorld::QuadTreeWorld(osg::Group* parent, Resource::ResourceSystem* resourceSystem, osgUtil::IncrementalCompileOperation* ico,
+                             Storage* storage, int nodeMask, float lodFactor, unsigned int maxCachedChunks,
+                             float compositeMapDistance, int compositeMapResolution, const boost::filesystem::path& compositeMapDirectory,
+                             size_t maxCompositeMapBytes)
+    : Terrain::World(parent, resourceSystem, ico, storage, nodeMask)
+    , mCompositeMaps(storage, resourceSystem->getTextureManager(), compositeMapResolution, compositeMapDirectory, maxCompositeMapBytes)
+    , mChunkBuilder(storage, resourceSystem, ico, &mCompositeMaps)
+    , mRootNode(NULL)
+    , mTreeBuilt(false)
+    , mLodFactor(lodFactor)
+    , mViewDistance(std::numeric_limits<float>::max())
+    , mCompositeMapDistance(compositeMapDistance)
+    , mMaxCachedChunks(maxCachedChunks)
+    , mFrame(0)
+    , mWorkQueue(new SceneUtil::WorkQueue(std::max(1, OpenThreads::GetNumberOfProcessors() / 2)))
+{
+    mCache = BufferCache(sChunkVertices);
+    mUVBuffer = mCache.getUVBuffer();
+}
+
+QuadTreeWorld::~QuadTreeWorld()
+{
+    // Discard the chunks that were not started yet, and wait for the ones in progress
+    for (ChunkMap::iterator it = mChunks.begin(); it != mChunks.end(); ++it)
+        it->second.mTicket->cancel();
+    mWorkQueue.reset();
+
+    delete mRootNode;
+}
+
+void QuadTreeWorld::buildTree()
+{
+    mTreeBuilt = true;
+
+    float minX, maxX, minY, maxY;
+    mStorage->getBounds(minX, maxX, minY, maxY);
+
+    // Align the nodes to the cells, with a power of two cells on each side of the root
+    osg::Vec2f origin (std::floor(minX), std::floor(minY));
+    float extent = std::max(maxX - origin.x(), maxY - origin.y());
+    float size = 1.f;
+    while (size < extent)
+        size *= 2.f;
+
+    mRootNode = buildNode(NULL, size, origin + osg::Vec2f(size/2.f, size/2.f));
+}
+
+QuadTreeNode* QuadTreeWorld::buildNode(QuadTreeNode* parent, float size, const osg::Vec2f& center)
+{
+    // Only which cells have terrain is looked up here, the land data is loaded by the chunks that need it.
+    // The children of nodes up to one cell are only built once they are needed, see buildChildren.
+    if (size < 1.f)
+        return new QuadTreeNode(parent, size, center);
+    if (size == 1.f)
+    {
+        if (!mStorage->hasData(static_cast<int>(std::floor(center.x())), static_cast<int>(std::floor(center.y()))))
+            return NULL;
+        return new QuadTreeNode(parent, size, center);
+    }
+
+    QuadTreeNode* node = new QuadTreeNode(parent, size, center);
+    node->mChildrenBuilt = true;
+    bool hasChildren = false;
+    float childSize = size/2.f;
+    for (int i=0; i<4; ++i)
+    {
+        osg::Vec2f childCenter = center + osg::Vec2f((i%2 ? 0.5f : -0.5f) * childSize, (i/2 ? 0.5f : -0.5f) * childSize);
+        node->mChildren[i] = buildNode(node, childSize, childCenter);
+        hasChildren = hasChildren || node->mChildren[i];
+    }
+    if (!hasChildren)
+    {
+        delete node;
+        return NULL;
+    }
+    return node;
+}
+
+void QuadTreeWorld::buildChildren(QuadTreeNode* node)
+{
+    node->mChildrenBuilt = true;
+
+    float childSize = node->mSize/2.f;
+    for (int i=0; i<4; ++i)
+    {
+        osg::Vec2f childCenter = node->mCenter + osg::Vec2f((i%2 ? 0.5f : -0.5f) * childSize, (i/2 ? 0.5f : -0.5f) * childSize);
+        node->mChildren[i] = buildNode(node, childSize, childCenter);
+    }
+}
+
+void QuadTreeWorld::expandHeights(QuadTreeNode* node, float minHeight, float maxHeight)
+{
+    for (; node; node = node->mParent)
+    {
+        node->mMinHeight = std::min(node->mMinHeight, minHeight);
+        node->mMaxHeight = std::max(node->mMaxHeight, maxHeight);
+    }
+}
+
+void QuadTreeWorld::selectLeaves(QuadTreeNode* node, const osg::Vec3f& viewPoint, std::vector<QuadTreeNode*>& leaves)
+{
+    const float cellWorldSize = mStorage->getCellWorldSize();
+    const float minLeafSize = (sChunkVertices-1) / static_cast<float>(mStorage->getCellVertices()-1);
+    // Storage::fillVertexBuffers can skip at most all vertices of a cell but the first
+    const float maxLeafSize = static_cast<float>(sChunkVertices-1);
+
+    float distance = getDistance(node, viewPoint, cellWorldSize);
+
+    if (distance > mViewDistance)
+        return;
+
+    bool split = node->mSize > maxLeafSize || (node->mSize > minLeafSize && distance < node->mSize * cellWorldSize * mLodFactor);
+    if (split)
+    {
+        if (!node->mChildrenBuilt)
+            buildChildren(node);
+        for (int i=0; i<4; ++i)
+        {
+            if (node->mChildren[i])
+                selectLeaves(node->mChildren[i], viewPoint, leaves);
+        }
+        return;
+    }
+
+    node->mSelectedFrame = mFrame;
+    leaves.push_back(node);
+}
+
+const QuadTreeNode* QuadTreeWorld::findSelected(const osg::Vec2f& point) const
+{
+    float halfSize = mRootNode->mSize / 2.f;
+    if (std::abs(point.x() - mRootNode->mCenter.x()) > halfSize || std::abs(point.y() - mRootNode->mCenter.y()) > halfSize)
+        return NULL;
+
+    const QuadTreeNode* node = mRootNode;
+    while (node)
+    {
+        if (node->mSelectedFrame == mFrame)
+            return node;
+        if (!node->mChildrenBuilt)
+            return NULL;
+        node = node->mChildren[getChildIndex(node, point)];
+    }
+    return NULL;
+}
+
+unsigned int QuadTreeWorld::getLodFlags(const QuadTreeNode* leaf) const
+{
+    // A point in the middle of each edge, just inside the neighbour. Smaller neighbours stitch their own edges.
+    const float offset = leaf->mSize / 2.f + leaf->mSize / 4.f;
+    osg::Vec2f offsets[4];
+    offsets[North] = osg::Vec2f(0.f, offset);
+    offsets[East] = osg::Vec2f(offset, 0.f);
+    offsets[South] = osg::Vec2f(0.f, -offset);
+    offsets[West] = osg::Vec2f(-offset, 0.f);
+
+    unsigned int flags = 0;
+    for (unsigned int direction=0; direction<4; ++direction)
+    {
+        const QuadTreeNode* neighbour = findSelected(leaf->mCenter + offsets[direction]);
+        if (!neighbour || neighbour->mSize <= leaf->mSize)
+            continue;
+
+        unsigned int delta = 0;
+        for (float size = leaf->mSize; size < neighbour->mSize; size *= 2.f)
+            ++delta;
+        flags |= std::min(delta, sMaxLodDelta) << (4*direction);
+    }
+    return flags;
+}
+
+QuadTreeWorld::Chunk& QuadTreeWorld::getChunk(const ChunkKey& key)
+{
+    ChunkMap::iterator found = mChunks.find(key);
+    if (found != mChunks.end())
+        return found->second;
+
+    // All chunks have the same number of vertices, so larger chunks skip vertices of the terrain data
+    const float minLeafSize = (sChunkVertices-1) / static_cast<float>(mStorage->getCellVertices()-1);
+    int lodLevel = 0;
+    while (minLeafSize * (1 << lodLevel) < key.mSize)
+        ++lodLevel;
+
+    Chunk& chunk = mChunks[key];
+    chunk.mRequest = new ChunkRequest;
+    chunk.mLastUsed = mFrame;
+    chunk.mTicket = mWorkQueue->addWorkItem(new BuildChunkItem(&mChunkBuilder, chunk.mRequest, key.mSize, key.mCenter, lodLevel,
+                                                               mCache.getIndexBuffer(key.mLodFlags), mUVBuffer, key.mCompositeMap));
+    return chunk;
+}
+
+bool QuadTreeWorld::findBuiltChunk(const QuadTreeNode* node, ChunkKey& key)
+{
+    // The chunks of a node are next to each other in the map, whatever their LOD flags
+    ChunkKey first;
+    first.mSize = node->mSize;
+    first.mCenter = node->mCenter;
+    first.mLodFlags = 0;
+    first.mCompositeMap = false;
+    for (ChunkMap::iterator it = mChunks.lower_bound(first);
+         it != mChunks.end() && it->first.mSize == node->mSize && it->first.mCenter == node->mCenter; ++it)
+    {
+        if (it->second.mTicket->isDone() && it->second.mRequest->mNode)
+        {
+            it->second.mLastUsed = mFrame;
+            key = it->first;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool QuadTreeWorld::overlapsLoadedCells(const QuadTreeNode* node) const
+{
+    float halfSize = node->mSize / 2.f;
+    for (std::set<std::pair<int, int> >::const_iterator it = mLoadedCells.begin(); it != mLoadedCells.end(); ++it)
+    {
+        if (it->first < node->mCenter.x() + halfSize && it->first + 1 > node->mCenter.x() - halfSize
+                && it->second < node->mCenter.y() + halfSize && it->second + 1 > node->mCenter.y() - halfSize)
+            return true;
+    }
+    return false;
+}
+
+void QuadTreeWorld::loadCell(int x, int y)
+{
+    mLoadedCells.insert(std::make_pair(x, y));
+}
+
+void QuadTreeWorld::unloadCell(int x, int y)
+{
+    mLoadedCells.erase(std::make_pair(x, y));
+}
+
+void QuadTreeWorld::update(const osg::Vec3f& viewPoint)
+{
+    mChunkBuilder.update();
+
+    if (mLoadedCells.empty())
+    {
+        // In an interior, keep the built chunks for when we return
+        mTerrainRoot->removeChildren(0, mTerrainRoot->getNumChildren());
+        mDisplayedChunks.clear();
+        return;
+    }
+
+    if (!mTreeBuilt)
+        buildTree();
+    if (!mRootNode)
+        return;
+
+    ++mFrame;
+
+    std::vector<QuadTreeNode*> leaves;
+    selectLeaves(mRootNode, viewPoint, leaves);
+
+    // Until the chunk of a leaf is built, the closest of its ancestors that has a chunk built is displayed in its place.
+    // The chunks are built in the background, so the view only waits for them in the loaded cells, when there is nothing
+    // to display in their place.
+    std::vector<std::pair<const QuadTreeNode*, ChunkKey> > display;
+    std::set<const QuadTreeNode*> substitutes;
+    for (std::vector<QuadTreeNode*>::const_iterator it = leaves.begin(); it != leaves.end(); ++it)
+    {
+        ChunkKey key;
+        key.mSize = (*it)->mSize;
+        key.mCenter = (*it)->mCenter;
+        key.mLodFlags = getLodFlags(*it);
+        key.mCompositeMap = (*it)->mSize > 1.f || getDistance(*it, viewPoint, mStorage->getCellWorldSize()) >= mCompositeMapDistance;
+
+        Chunk& chunk = getChunk(key);
+        chunk.mLastUsed = mFrame;
+        if (!chunk.mTicket->isDone())
+        {
+            const QuadTreeNode* substitute = NULL;
+            ChunkKey substituteKey;
+            for (const QuadTreeNode* ancestor = (*it)->mParent; ancestor && !substitute; ancestor = ancestor->mParent)
+            {
+                if (findBuiltChunk(ancestor, substituteKey))
+                    substitute = ancestor;
+            }
+
+            if (substitute)
+            {
+                if (substitutes.insert(substitute).second)
+                    display.push_back(std::make_pair(substitute, substituteKey));
+                continue;
+            }
+
+            // Only the distant land may be missing for a while, the loaded cells are where the actors walk
+            if (!overlapsLoadedCells(*it))
+                continue;
+            chunk.mTicket->waitTillDone();
+        }
+
+        if (chunk.mRequest->mNode)
+            expandHeights(*it, chunk.mRequest->mBounds.zMin(), chunk.mRequest->mBounds.zMax());
+        display.push_back(std::make_pair(*it, key));
+    }
+
+    // Leave out what a displayed ancestor covers already
+    std::vector<ChunkKey> selection;
+    selection.reserve(display.size());
+    for (std::vector<std::pair<const QuadTreeNode*, ChunkKey> >::const_iterator it = display.begin(); it != display.end(); ++it)
+    {
+        bool covered = false;
+        for (const QuadTreeNode* ancestor = it->first->mParent; ancestor && !covered; ancestor = ancestor->mParent)
+            covered = substitutes.count(ancestor) != 0;
+        if (!covered)
+            selection.push_back(it->second);
+    }
+
+    if (selection != mDisplayedChunks)
+    {
+        mTerrainRoot->removeChildren(0, mTerrainRoot->getNumChildren());
+        for (std::vector<ChunkKey>::const_iterator it = selection.begin(); it != selection.end(); ++it)
+        {
+            osg::Node* node = mChunks[*it].mRequest->mNode.get();
+            if (node)
+                mTerrainRoot->addChild(node);
+        }
+        mDisplayedChunks.swap(selection);
+    }
+
+    pruneCache();
+
+    mCompositeMaps.updateCache(osg::Timer::instance()->time_s());
+}
+
+void QuadTreeWorld::pruneCache()
+{
+    if (mChunks.size() <= mMaxCachedChunks)
+        return;
+
+    // Least recently used first, leaving out the chunks that are selected or displayed
+    std::vector<std::pair<unsigned int, ChunkKey> > unused;
+    for (ChunkMap::const_iterator it = mChunks.begin(); it != mChunks.end(); ++it)
+    {
+        if (it->second.mLastUsed != mFrame)
+            unused.push_back(std::make_pair(it->second.mLastUsed, it->first));
+    }
+    std::sort(unused.begin(), unused.end());
+
+    for (std::vector<std::pair<unsigned int, ChunkKey> >::const_iterator it = unused.begin();
+         it != unused.end() && mChunks.size() > mMaxCachedChunks; ++it)
+    {
+        ChunkMap::iterator found = mChunks.find(it->second);
+        found->second.mTicket->cancel();
+        mChunks.erase(found);
+    }
+}
+
+void QuadTreeWorld::setViewDistance(float distance)
+{
+    mViewDistance = distance;
+}
+
+}
@@ -0,0 +1,137 @@
+#ifndef COMPONENTS_TERRAIN_QUADTREEWORLD_H
+#define COMPONENTS_TERRAIN_QUADTREEWORLD_H
+
+#include <map>
+#include <set>
+#include <memory>
+#include <vector>
+
+#include <osg/Vec2f>
+#include <osg/Vec3f>
+
+#include "world.hpp"
+#include "chunkbuilder.hpp"
+#include "compositemap.hpp"
+
+namespace SceneUtil
+{
+    class WorkQueue;
+    class WorkTicket;
+}
+
+namespace Terrain
+{
+
+    struct QuadTreeNode;
+    class ChunkRequest;
+
+    /// @brief Terrain implementation that displays the whole landscape, using a quadtree of chunks with geometric LOD.
+    /// @par All chunks have the same number of vertices, so chunks further away from the view point cover more cells
+    /// with coarser vertices. A chunk is split into its four children while the view point is closer than its size
+    /// times the LOD factor, which bounds the number of displayed vertices regardless of the view distance.
+    /// Edges towards coarser neighbours are stitched with the index buffers of the BufferCache.
+    /// @par Chunks beyond the composite map distance, and all chunks larger than a cell, are drawn with a composite map
+    /// in one pass, rather than with one pass per layer, see CompositeMapBaker.
+    /// @par Chunks are built in the background and kept in a cache, least recently used chunks are discarded first.
+    /// Until the chunk of a selected node is built, the closest of its ancestors that has a chunk built is displayed instead.
+    /// @note The tree is built from the cells that have terrain, see Storage::hasData. The land data is only loaded by
+    /// the chunks that need it, in the background.
+    class QuadTreeWorld : public Terrain::World
+    {
+    public:
+        /// @param lodFactor Chunks are split while the view point is closer than their size times this factor.
+        /// @param maxCachedChunks Number of built chunks to keep, including the displayed ones.
+        /// @param compositeMapDistance Distance from the view point beyond which chunks use their composite map, in world units.
+        /// @param compositeMapResolution Texels on each side of the composite map of a chunk.
+        /// @param compositeMapDirectory Where to store the composite maps for the next session, or empty to not store them.
+        /// @param maxCompositeMapBytes Budget for the composite maps kept in memory, 0 for no budget.
+        QuadTreeWorld(osg::Group* parent, Resource::ResourceSystem* resourceSystem, osgUtil::IncrementalCompileOperation* ico,
+                      Storage* storage, int nodeMask, float lodFactor, unsigned int maxCachedChunks,
+                      float compositeMapDistance, int compositeMapResolution, const boost::filesystem::path& compositeMapDirectory,
+                      size_t maxCompositeMapBytes);
+        ~QuadTreeWorld();
+
+        /// The landscape is only displayed while exterior cells are loaded.
+        virtual void loadCell(int x, int y);
+        virtual void unloadCell(int x, int y);
+
+        virtual void update(const osg::Vec3f& viewPoint);
+
+        virtual void setViewDistance(float distance);
+
+    private:
+        struct ChunkKey
+        {
+            float mSize;
+            osg::Vec2f mCenter;
+            unsigned int mLodFlags;
+            bool mCompositeMap;
+
+            bool operator< (const ChunkKey& other) const;
+            bool operator== (const ChunkKey& other) const;
+        };
+
+        struct Chunk
+        {
+            osg::ref_ptr<ChunkRequest> mRequest;
+            osg::ref_ptr<SceneUtil::WorkTicket> mTicket;
+            unsigned int mLastUsed;
+        };
+
+        void buildTree();
+        QuadTreeNode* buildNode(QuadTreeNode* parent, float size, const osg::Vec2f& center);
+        void buildChildren(QuadTreeNode* node);
+
+        /// Include a height range of a built chunk in the bounds of \a node and its ancestors.
+        void expandHeights(QuadTreeNode* node, float minHeight, float maxHeight);
+
+        void selectLeaves(QuadTreeNode* node, const osg::Vec3f& viewPoint, std::vector<QuadTreeNode*>& leaves);
+
+        /// @return The LOD deltas towards the coarser neighbours of a selected leaf, in the format of BufferCache::getIndexBuffer.
+        unsigned int getLodFlags(const QuadTreeNode* leaf) const;
+
+        /// @return The selected leaf containing \a point, or NULL if there is none.
+        const QuadTreeNode* findSelected(const osg::Vec2f& point) const;
+
+        Chunk& getChunk(const ChunkKey& key);
+
+        /// @return Whether \a node covers any of the loaded cells.
+        bool overlapsLoadedCells(const QuadTreeNode* node) const;
+
+        /// Find a chunk of \a node that is built, with any LOD flags.
+        /// @return Whether there is one, its key is stored in \a key.
+        bool findBuiltChunk(const QuadTreeNode* node, ChunkKey& key);
+
+        void pruneCache();
+
+        // Declared before the ChunkBuilder using it
+        CompositeMapBaker mCompositeMaps;
+        ChunkBuilder mChunkBuilder;
+
+        osg::ref_ptr<osg::Vec2Array> mUVBuffer;
+
+        QuadTreeNode* mRootNode;
+        bool mTreeBuilt;
+
+        float mLodFactor;
+        float mViewDistance;
+        float mCompositeMapDistance;
+        unsigned int mMaxCachedChunks;
+
+        unsigned int mFrame;
+
+        typedef std::map<ChunkKey, Chunk> ChunkMap;
+        ChunkMap mChunks;
+
+        std::set<std::pair<int, int> > mLoadedCells;
+
+        // The chunks attached to the terrain root
+        std::vector<ChunkKey> mDisplayedChunks;
+
+        // Declared last, so that its threads finish before the members they use are destroyed
+        std::auto_ptr<SceneUtil::WorkQueue> mWorkQueue;
+    };
+
+}
+
+#endif
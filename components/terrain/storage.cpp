@@ -1 +1,12 @@
 #include "storage.hpp"
+
+namespace Terrain
+{
+
+bool Storage::hasData(int cellX, int cellY)
+{
+    float minHeight, maxHeight;
+    return getMinMaxHeights(1.f, osg::Vec2f(cellX + 0.5f, cellY + 0.5f), minHeight, maxHeight);
+}
+
+}
@@ -27,6 +27,10 @@ namespace Terrain
         /// Get bounds of the whole terrain in cell units
         virtual void getBounds(float& minX, float& maxX, float& minY, float& maxY) = 0;
 
+        /// @return Whether there is terrain in a cell. Implementations should not need to load the terrain data for this,
+        /// by default it is checked with getMinMaxHeights.
+        virtual bool hasData(int cellX, int cellY);
+
         /// Get the minimum and maximum heights of a terrain region.
         /// @note Will only be called for chunks with size = minBatchSize, i.e. leafs of the quad tree.
         ///        Larger chunks can simply merge AABB of children.
@@ -42,6 +46,8 @@ namespace Terrain
         /// @note returned colors need to be in render-system specific format! Use RenderSystem::convertColourValue.
         /// @note Vertices should be written in row-major order (a row is defined as parallel to the x-axis).
         ///       The specified positions should be in local space, i.e. relative to the center of the terrain chunk.
+        /// @note The buffers may be recycled from a chunk that was unloaded, so every vertex must be written. They usually
+        ///       have the right size already, resizing them is only needed otherwise.
         /// @param lodLevel LOD level, 0 = most detailed
         /// @param size size of the terrain chunk in cell units
         /// @param center center of the chunk in cell units
@@ -78,6 +84,9 @@ namespace Terrain
 
         /// Get the number of vertices on one side for each cell. Should be (power of two)+1
         virtual int getCellVertices() = 0;
+
+        /// Drop the data derived from the land so far, e.g. when the land may have changed.
+        virtual void clearCache() {}
     };
 
 }
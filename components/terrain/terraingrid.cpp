@@ -2,46 +2,11 @@
 
 #include <memory>
 
-#include <components/resource/resourcesystem.hpp>
-#include <components/resource/texturemanager.hpp>
-
-#include <components/sceneutil/lightmanager.hpp>
-#include <components/sceneutil/positionattitudetransform.hpp>
-
-#include <components/esm/loadland.hpp>
-
-#include <osg/Geometry>
-#include <osg/Geode>
+#include <osg/Group>
 #include <osg/KdTree>
-#include <osg/Version>
-
-#include <osgFX/Effect>
 
-#include <osgUtil/IncrementalCompileOperation>
-
-#include "material.hpp"
 #include "storage.hpp"
 
-namespace
-{
-    class StaticBoundingBoxCallback : public osg::Drawable::ComputeBoundingBoxCallback
-    {
-    public:
-        StaticBoundingBoxCallback(const osg::BoundingBox& bounds)
-            : mBoundingBox(bounds)
-        {
-        }
-
-        virtual osg::BoundingBox computeBound(const osg::Drawable&) const
-        {
-            return mBoundingBox;
-        }
-
-    private:
-        osg::BoundingBox mBoundingBox;
-    };
-}
-
 namespace Terrain
 {
 
@@ -49,9 +14,12 @@ TerrainGrid::TerrainGrid(osg::Group* parent, Resource::ResourceSystem* resourceS
                          Storage* storage, int nodeMask)
     : Terrain::World(parent, resourceSystem, ico, storage, nodeMask)
     , mNumSplits(4)
+    , mChunkBuilder(storage, resourceSystem, ico)
     , mKdTreeBuilder(new osg::KdTreeBuilder)
 {
     mCache = BufferCache((storage->getCellVertices()-1)/static_cast<float>(mNumSplits) + 1);
+    mIndexBuffer = mCache.getIndexBuffer(0);
+    mUVBuffer = mCache.getUVBuffer();
 }
 
 TerrainGrid::~TerrainGrid()
@@ -90,100 +58,10 @@ osg::ref_ptr<osg::Node> TerrainGrid::buildTerrain (osg::Group* parent, float chu
         if (!mStorage->getMinMaxHeights(chunkSize, chunkCenter, minH, maxH))
             return NULL; // no terrain defined
 
-        osg::Vec2f worldCenter = chunkCenter*mStorage->getCellWorldSize();
-        osg::ref_ptr<SceneUtil::PositionAttitudeTransform> transform (new SceneUtil::PositionAttitudeTransform);
-        transform->setPosition(osg::Vec3f(worldCenter.x(), worldCenter.y(), 0.f));
-
+        osg::ref_ptr<osg::Node> chunk = mChunkBuilder.buildChunk(chunkSize, chunkCenter, 0, mIndexBuffer, mUVBuffer);
         if (parent)
-            parent->addChild(transform);
-
-        osg::ref_ptr<osg::Vec3Array> positions (new osg::Vec3Array);
-        osg::ref_ptr<osg::Vec3Array> normals (new osg::Vec3Array);
-        osg::ref_ptr<osg::Vec4Array> colors (new osg::Vec4Array);
-
-        osg::ref_ptr<osg::VertexBufferObject> vbo (new osg::VertexBufferObject);
-        positions->setVertexBufferObject(vbo);
-        normals->setVertexBufferObject(vbo);
-        colors->setVertexBufferObject(vbo);
-
-        mStorage->fillVertexBuffers(0, chunkSize, chunkCenter, positions, normals, colors);
-
-        osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
-        geometry->setVertexArray(positions);
-        geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
-        geometry->setColorArray(colors, osg::Array::BIND_PER_VERTEX);
-        geometry->setUseDisplayList(false);
-        geometry->setUseVertexBufferObjects(true);
-
-        geometry->addPrimitiveSet(mCache.getIndexBuffer(0));
-
-        // we already know the bounding box, so no need to let OSG compute it.
-        osg::Vec3f min(-0.5f*mStorage->getCellWorldSize()*chunkSize,
-                       -0.5f*mStorage->getCellWorldSize()*chunkSize,
-                       minH);
-        osg::Vec3f max (0.5f*mStorage->getCellWorldSize()*chunkSize,
-                           0.5f*mStorage->getCellWorldSize()*chunkSize,
-                           maxH);
-        osg::BoundingBox bounds(min, max);
-        geometry->setComputeBoundingBoxCallback(new StaticBoundingBoxCallback(bounds));
-
-        std::vector<LayerInfo> layerList;
-        std::vector<osg::ref_ptr<osg::Image> > blendmaps;
-        mStorage->getBlendmaps(chunkSize, chunkCenter, false, blendmaps, layerList);
-
-        // For compiling textures, I don't think the osgFX::Effect does it correctly
-        osg::ref_ptr<osg::Node> textureCompileDummy (new osg::Node);
-
-        std::vector<osg::ref_ptr<osg::Texture2D> > layerTextures;
-        for (std::vector<LayerInfo>::const_iterator it = layerList.begin(); it != layerList.end(); ++it)
-        {
-            layerTextures.push_back(mResourceSystem->getTextureManager()->getTexture2D(it->mDiffuseMap, osg::Texture::REPEAT, osg::Texture::REPEAT));
-            textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(0, layerTextures.back());
-        }
-
-        std::vector<osg::ref_ptr<osg::Texture2D> > blendmapTextures;
-        for (std::vector<osg::ref_ptr<osg::Image> >::const_iterator it = blendmaps.begin(); it != blendmaps.end(); ++it)
-        {
-            osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D);
-            texture->setImage(*it);
-            texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
-            texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
-            texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
-            texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
-            texture->setResizeNonPowerOfTwoHint(false);
-            blendmapTextures.push_back(texture);
-
-            textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(0, layerTextures.back());
-        }
-
-        // use texture coordinates for both texture units, the layer texture and blend texture
-        for (unsigned int i=0; i<2; ++i)
-            geometry->setTexCoordArray(i, mCache.getUVBuffer());
-
-        float blendmapScale = ESM::Land::LAND_TEXTURE_SIZE*chunkSize;
-        osg::ref_ptr<osgFX::Effect> effect (new Terrain::Effect(layerTextures, blendmapTextures, blendmapScale, blendmapScale));
-
-        effect->addCullCallback(new SceneUtil::LightListCallback);
-
-        transform->addChild(effect);
-
-#if OSG_VERSION_GREATER_OR_EQUAL(3,3,3)
-        osg::Node* toAttach = geometry.get();
-#else
-        osg::ref_ptr<osg::Geode> geode (new osg::Geode);
-        geode->addDrawable(geometry);
-        osg::Node* toAttach = geode.get();
-#endif
-
-        effect->addChild(toAttach);
-
-        if (mIncrementalCompileOperation)
-        {
-            mIncrementalCompileOperation->add(toAttach);
-            mIncrementalCompileOperation->add(textureCompileDummy);
-        }
-
-        return transform;
+            parent->addChild(chunk);
+        return chunk;
     }
 }
 
@@ -192,9 +70,24 @@ void TerrainGrid::loadCell(int x, int y)
     if (mGrid.find(std::make_pair(x, y)) != mGrid.end())
         return; // already loaded
 
-    osg::Vec2f center(x+0.5f, y+0.5f);
+    osg::ref_ptr<osg::Node> terrainNode;
+    bool cached = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mCachedCellsMutex);
+        CachedCells::iterator found = mCachedCells.find(std::make_pair(x, y));
+        if (found != mCachedCells.end())
+        {
+            terrainNode = found->second;
+            mCachedCells.erase(found);
+            cached = true;
+        }
+    }
 
-    osg::ref_ptr<osg::Node> terrainNode = buildTerrain(NULL, 1.f, center);
+    if (!cached)
+    {
+        osg::Vec2f center(x+0.5f, y+0.5f);
+        terrainNode = buildTerrain(NULL, 1.f, center);
+    }
     if (!terrainNode)
         return; // no terrain defined
 
@@ -212,6 +105,28 @@ void TerrainGrid::loadCell(int x, int y)
     mGrid[std::make_pair(x,y)] = element.release();
 }
 
+void TerrainGrid::cacheCell(int x, int y)
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mCachedCellsMutex);
+        if (mCachedCells.find(std::make_pair(x, y)) != mCachedCells.end())
+            return;
+    }
+
+    osg::Vec2f center(x+0.5f, y+0.5f);
+    osg::ref_ptr<osg::Node> terrainNode = buildTerrain(NULL, 1.f, center);
+
+    // Also cache cells without terrain, so loadCell() does not need to check again
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mCachedCellsMutex);
+    mCachedCells.insert(std::make_pair(std::make_pair(x, y), terrainNode));
+}
+
+void TerrainGrid::uncacheCell(int x, int y)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mCachedCellsMutex);
+    mCachedCells.erase(std::make_pair(x, y));
+}
+
 void TerrainGrid::unloadCell(int x, int y)
 {
     Grid::iterator it = mGrid.find(std::make_pair(x,y));
@@ -225,4 +140,9 @@ void TerrainGrid::unloadCell(int x, int y)
     mGrid.erase(it);
 }
 
+void TerrainGrid::update(const osg::Vec3f& viewPoint)
+{
+    mChunkBuilder.update();
+}
+
 }
@@ -1,10 +1,14 @@
 #ifndef COMPONENTS_TERRAIN_TERRAINGRID_H
 #define COMPONENTS_TERRAIN_TERRAINGRID_H
 
+#include <map>
+
 #include <osg/Vec2f>
 
+#include <OpenThreads/Mutex>
+
 #include "world.hpp"
-#include "material.hpp"
+#include "chunkbuilder.hpp"
 
 namespace osg
 {
@@ -27,6 +31,11 @@ namespace Terrain
         virtual void loadCell(int x, int y);
         virtual void unloadCell(int x, int y);
 
+        virtual void cacheCell(int x, int y);
+        virtual void uncacheCell(int x, int y);
+
+        virtual void update(const osg::Vec3f& viewPoint);
+
     private:
         osg::ref_ptr<osg::Node> buildTerrain (osg::Group* parent, float chunkSize, const osg::Vec2f& chunkCenter);
 
@@ -36,6 +45,17 @@ namespace Terrain
         typedef std::map<std::pair<int, int>, GridElement*> Grid;
         Grid mGrid;
 
+        // Terrain built ahead of time by cacheCell()
+        typedef std::map<std::pair<int, int>, osg::ref_ptr<osg::Node> > CachedCells;
+        CachedCells mCachedCells;
+        OpenThreads::Mutex mCachedCellsMutex;
+
+        ChunkBuilder mChunkBuilder;
+
+        // Retrieved once, so that building terrain only reads shared state
+        osg::ref_ptr<osg::DrawElements> mIndexBuffer;
+        osg::ref_ptr<osg::Vec2Array> mUVBuffer;
+
         osg::ref_ptr<osg::KdTreeBuilder> mKdTreeBuilder;
     };
 
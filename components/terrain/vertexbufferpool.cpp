@@ -0,0 +1,108 @@
+#include "vertexbufferpool.hpp"
+
+#include <OpenThreads/ScopedLock>
+
+namespace
+{
+    bool isFree(const Terrain::VertexBufferPool::Slab& slab)
+    {
+        // Only referenced by the pool
+        return slab.mPositions->referenceCount() == 1 && slab.mNormals->referenceCount() == 1 && slab.mColours->referenceCount() == 1;
+    }
+}
+
+namespace Terrain
+{
+
+const unsigned int VertexBufferPool::sFrameFence;
+
+VertexBufferPool::VertexBufferPool(unsigned int maxFreeSlabs)
+    : mMaxFreeSlabs(maxFreeSlabs)
+    , mFrame(0)
+{
+}
+
+VertexBufferPool::Slab VertexBufferPool::getSlab(unsigned int numVertices)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    Slabs& slabs = mSlabMap[numVertices];
+
+    const size_t count = slabs.mSlabs.size();
+    for (size_t i=0; i<count; ++i)
+    {
+        size_t index = (slabs.mNext + i) % count;
+        Entry& entry = slabs.mSlabs[index];
+        if (entry.mFree && mFrame - entry.mFreeSince >= sFrameFence)
+        {
+            entry.mFree = false;
+            slabs.mNext = (index + 1) % count;
+            return entry.mSlab;
+        }
+    }
+
+    Entry entry;
+    entry.mSlab.mPositions = new osg::Vec3Array(numVertices);
+    entry.mSlab.mNormals = new osg::Vec3Array(numVertices);
+    entry.mSlab.mColours = new osg::Vec4Array(numVertices);
+
+    osg::ref_ptr<osg::VertexBufferObject> vbo (new osg::VertexBufferObject);
+    entry.mSlab.mPositions->setVertexBufferObject(vbo);
+    entry.mSlab.mNormals->setVertexBufferObject(vbo);
+    entry.mSlab.mColours->setVertexBufferObject(vbo);
+
+    slabs.mSlabs.push_back(entry);
+    return entry.mSlab;
+}
+
+void VertexBufferPool::update()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    ++mFrame;
+
+    for (SlabMap::iterator it = mSlabMap.begin(); it != mSlabMap.end(); ++it)
+    {
+        std::vector<Entry>& entries = it->second.mSlabs;
+        size_t numFree = 0;
+        for (std::vector<Entry>::iterator entry = entries.begin(); entry != entries.end(); ++entry)
+        {
+            if (!entry->mFree && isFree(entry->mSlab))
+            {
+                entry->mFree = true;
+                entry->mFreeSince = mFrame;
+            }
+            if (entry->mFree)
+                ++numFree;
+        }
+
+        if (numFree <= mMaxFreeSlabs)
+            continue;
+
+        // Only the slabs past the fence can be released, a draw thread may still use the others.
+        // Releasing the arrays deletes their buffer object, which queues its GL buffer for deletion.
+        size_t kept = 0;
+        for (size_t i=0; i<entries.size(); ++i)
+        {
+            if (numFree > mMaxFreeSlabs && entries[i].mFree && mFrame - entries[i].mFreeSince >= sFrameFence)
+            {
+                --numFree;
+                continue;
+            }
+            if (kept != i)
+                entries[kept] = entries[i];
+            ++kept;
+        }
+        entries.resize(kept);
+        it->second.mNext = 0;
+    }
+}
+
+unsigned int VertexBufferPool::getNumSlabs(unsigned int numVertices) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    SlabMap::const_iterator found = mSlabMap.find(numVertices);
+    if (found == mSlabMap.end())
+        return 0;
+    return found->second.mSlabs.size();
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef COMPONENTS_TERRAIN_VERTEXBUFFERPOOL_H
+#define COMPONENTS_TERRAIN_VERTEXBUFFERPOOL_H
+
+#include <map>
+#include <vector>
+
+#include <osg/ref_ptr>
+#include <osg/Array>
+
+#include <OpenThreads/Mutex>
+
+namespace Terrain
+{
+
+    /// @brief Recycles the vertex arrays of terrain chunks, so that loading and unloading chunks while travelling does not
+    /// allocate and free them over and over.
+    /// @par The arrays of a slab have a fixed number of vertices and share one vertex buffer object. A slab is free once the
+    /// chunk using it is gone, i.e. when the pool holds the only references to its arrays, so no explicit release is needed.
+    /// The GL buffer object of the slab is reused along with it.
+    /// @par A draw thread may still be drawing a chunk for a few frames after the update traversal removed it, so a free
+    /// slab is only handed out again a few calls to update() later, see sFrameFence. Free slabs beyond a limit are released.
+    /// @note Thread safe, chunks are built in background threads.
+    class VertexBufferPool
+    {
+    public:
+        struct Slab
+        {
+            osg::ref_ptr<osg::Vec3Array> mPositions;
+            osg::ref_ptr<osg::Vec3Array> mNormals;
+            osg::ref_ptr<osg::Vec4Array> mColours;
+        };
+
+        /// The number of calls to update() after the one that found a slab free, before the slab is handed out again.
+        /// With the multi-threaded threading models of osgViewer, the draw traversals lag behind the update traversal by up
+        /// to two frames.
+        static const unsigned int sFrameFence = 2;
+
+        /// @param maxFreeSlabs The number of free slabs to keep for each number of vertices.
+        VertexBufferPool(unsigned int maxFreeSlabs = 32);
+
+        /// Get arrays of \a numVertices vertices that are not used by any chunk, allocating new ones only when none are free.
+        /// @note The contents of recycled arrays are undefined. Call dirty() on the arrays once they are filled.
+        Slab getSlab(unsigned int numVertices);
+
+        /// Find the slabs that became free, and release the free slabs beyond the limit.
+        /// @note Call once per frame from the update traversal, slabs are not recycled otherwise.
+        void update();
+
+        /// @return The number of slabs of \a numVertices vertices, used or free.
+        unsigned int getNumSlabs(unsigned int numVertices) const;
+
+    private:
+        struct Entry
+        {
+            Entry() : mFree(false), mFreeSince(0) {}
+
+            Slab mSlab;
+            bool mFree;
+            // The frame in which the slab was found free
+            unsigned int mFreeSince;
+        };
+
+        struct Slabs
+        {
+            Slabs() : mNext(0) {}
+
+            std::vector<Entry> mSlabs;
+            // Where to continue looking for a free slab, so the slabs in use at the front are not checked every time
+            size_t mNext;
+        };
+
+        typedef std::map<unsigned int, Slabs> SlabMap;
+        SlabMap mSlabMap;
+
+        unsigned int mMaxFreeSlabs;
+        unsigned int mFrame;
+
+        mutable OpenThreads::Mutex mMutex;
+    };
+
+}
+
+#endif
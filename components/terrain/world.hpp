@@ -45,6 +45,20 @@ namespace Terrain
         virtual void loadCell(int x, int y) {}
         virtual void unloadCell(int x, int y) {}
 
+        /// Build the terrain of a cell ahead of time, so that a later loadCell() is cheap.
+        /// @note Unlike loadCell(), this may be called from a worker thread. The terrain data of the cell
+        /// and its neighbours must have been loaded already, see Storage.
+        virtual void cacheCell(int x, int y) {}
+
+        /// Discard terrain built by cacheCell() that is no longer needed.
+        virtual void uncacheCell(int x, int y) {}
+
+        /// Called once per frame with the position of the camera, for implementations that select what to display by distance.
+        virtual void update(const osg::Vec3f& viewPoint) {}
+
+        /// Terrain further away than this from the view point may be left out. This is only a hint.
+        virtual void setViewDistance(float distance) {}
+
         Storage* getStorage() { return mStorage; }
 
     protected:
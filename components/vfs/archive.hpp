@@ -2,6 +2,9 @@
 #define OPENMW_COMPONENTS_RESOURCE_ARCHIVE_H
 
 #include <map>
+#include <ctime>
+
+#include <boost/cstdint.hpp>
 
 #include <components/files/constrainedfilestream.hpp>
 
@@ -14,6 +17,23 @@ namespace VFS
         virtual ~File() {}
 
         virtual Files::IStreamPtr open() = 0;
+
+        /// Get a pointer to the contents of this file, if they are available as a contiguous block of memory
+        /// (e.g. when the file is contained in a memory mapped archive). The data remains valid for the lifetime of the archive.
+        /// @param size Receives the size of the file in bytes.
+        /// @return The file contents, or NULL if not available, in which case open() must be used instead.
+        virtual const char* getData(size_t& size) { size = 0; return NULL; }
+
+        /// Get a value that changes whenever the contents of this file change, without reading the file. Used to tell
+        /// whether data derived from the file is out of date, see Resource::BulletShapeDiskCache.
+        /// @return The stamp, or 0 if not available, in which case the contents have to be compared instead.
+        virtual boost::uint64_t getStamp() { return 0; }
+
+        /// The stamp of a file of \a size bytes that was last modified at \a modificationTime.
+        static boost::uint64_t makeStamp(boost::uint64_t size, std::time_t modificationTime)
+        {
+            return (size << 32) ^ static_cast<boost::uint64_t>(modificationTime);
+        }
     };
 
     class Archive
@@ -1,17 +1,25 @@
 #include "bsaarchive.hpp"
 
+#include <boost/filesystem/operations.hpp>
+
 namespace VFS
 {
 
 
-BsaArchive::BsaArchive(const std::string &filename)
+BsaArchive::BsaArchive(const std::string &filename, bool memoryMapped)
 {
-    mFile.open(filename);
+    mFile.open(filename, memoryMapped);
+
+    // The files in an archive only change along with the archive
+    boost::system::error_code ec;
+    std::time_t archiveTime = boost::filesystem::last_write_time(filename, ec);
+    if (ec)
+        archiveTime = 0;
 
     const Bsa::BSAFile::FileList &filelist = mFile.getList();
     for(Bsa::BSAFile::FileList::const_iterator it = filelist.begin();it != filelist.end();++it)
     {
-        mResources.push_back(BsaArchiveFile(&*it, &mFile));
+        mResources.push_back(BsaArchiveFile(&*it, &mFile, archiveTime));
     }
 }
 
@@ -28,9 +36,10 @@ void BsaArchive::listResources(std::map<std::string, File *> &out, char (*normal
 
 // ------------------------------------------------------------------------------
 
-BsaArchiveFile::BsaArchiveFile(const Bsa::BSAFile::FileStruct *info, Bsa::BSAFile* bsa)
+BsaArchiveFile::BsaArchiveFile(const Bsa::BSAFile::FileStruct *info, Bsa::BSAFile* bsa, std::time_t archiveTime)
     : mInfo(info)
     , mFile(bsa)
+    , mArchiveTime(archiveTime)
 {
 
 }
@@ -40,4 +49,18 @@ Files::IStreamPtr BsaArchiveFile::open()
     return mFile->getFile(mInfo);
 }
 
+const char* BsaArchiveFile::getData(size_t &size)
+{
+    const char* data = mFile->getFileData(mInfo);
+    size = data ? mInfo->fileSize : 0;
+    return data;
+}
+
+boost::uint64_t BsaArchiveFile::getStamp()
+{
+    if (!mArchiveTime)
+        return 0;
+    return makeStamp(mInfo->fileSize, mArchiveTime);
+}
+
 }
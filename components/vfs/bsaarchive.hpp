@@ -11,18 +11,25 @@ namespace VFS
     class BsaArchiveFile : public File
     {
     public:
-        BsaArchiveFile(const Bsa::BSAFile::FileStruct* info, Bsa::BSAFile* bsa);
+        /// @param archiveTime The modification time of the archive, 0 if not known.
+        BsaArchiveFile(const Bsa::BSAFile::FileStruct* info, Bsa::BSAFile* bsa, std::time_t archiveTime);
 
         virtual Files::IStreamPtr open();
 
+        virtual const char* getData(size_t& size);
+
+        virtual boost::uint64_t getStamp();
+
         const Bsa::BSAFile::FileStruct* mInfo;
         Bsa::BSAFile* mFile;
+        std::time_t mArchiveTime;
     };
 
     class BsaArchive : public Archive
     {
     public:
-        BsaArchive(const std::string& filename);
+        /// @param memoryMapped Map the archive into memory, see Bsa::BSAFile::open
+        BsaArchive(const std::string& filename, bool memoryMapped=false);
 
         virtual void listResources(std::map<std::string, File*>& out, char (*normalize_function) (char));
 
@@ -62,4 +62,16 @@ namespace VFS
         return Files::openConstrainedFileStream(mPath.c_str());
     }
 
+    boost::uint64_t FileSystemArchiveFile::getStamp()
+    {
+        boost::system::error_code ec;
+        boost::uintmax_t size = boost::filesystem::file_size(mPath, ec);
+        if (ec)
+            return 0;
+        std::time_t time = boost::filesystem::last_write_time(mPath, ec);
+        if (ec)
+            return 0;
+        return makeStamp(size, time);
+    }
+
 }
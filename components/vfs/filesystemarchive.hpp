@@ -13,6 +13,8 @@ namespace VFS
 
         virtual Files::IStreamPtr open();
 
+        virtual boost::uint64_t getStamp();
+
     private:
         std::string mPath;
 
@@ -2,6 +2,9 @@
 
 #include <stdexcept>
 #include <locale>
+#include <algorithm>
+
+#include <boost/thread.hpp>
 
 #include "archive.hpp"
 
@@ -24,6 +27,58 @@ namespace
         std::transform(path.begin(), path.end(), path.begin(), normalize_char);
     }
 
+    // FNV-1a
+    const size_t sHashOffset = static_cast<size_t>(2166136261u);
+    const size_t sHashPrime = 16777619u;
+
+    inline size_t hashChar(size_t hash, char ch)
+    {
+        return (hash ^ static_cast<unsigned char>(ch)) * sHashPrime;
+    }
+
+    size_t hashString(const std::string& str)
+    {
+        size_t hash = sHashOffset;
+        for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+            hash = hashChar(hash, *it);
+        return hash;
+    }
+
+    typedef std::map<std::string, VFS::File*> FileMap;
+
+    /// Lists the resources of a range of archives, each into its own FileMap.
+    class ListResourcesJob
+    {
+    public:
+        ListResourcesJob(const std::vector<VFS::Archive*>& archives, std::vector<FileMap>& results,
+                         size_t& nextArchive, boost::mutex& mutex, char (*normalize_function) (char))
+            : mArchives(archives), mResults(results), mNextArchive(nextArchive), mMutex(mutex), mNormalize(normalize_function)
+        {
+        }
+
+        void operator()()
+        {
+            while (true)
+            {
+                size_t index;
+                {
+                    boost::mutex::scoped_lock lock(mMutex);
+                    if (mNextArchive >= mArchives.size())
+                        return;
+                    index = mNextArchive++;
+                }
+                mArchives[index]->listResources(mResults[index], mNormalize);
+            }
+        }
+
+    private:
+        const std::vector<VFS::Archive*>& mArchives;
+        std::vector<FileMap>& mResults;
+        size_t& mNextArchive;
+        boost::mutex& mMutex;
+        char (*mNormalize) (char);
+    };
+
 }
 
 namespace VFS
@@ -50,33 +105,127 @@ namespace VFS
     void Manager::buildIndex()
     {
         mIndex.clear();
+        mHashIndex.clear();
+
+        char (*normalize_function)(char) = mStrict ? &strict_normalize_char : &nonstrict_normalize_char;
+
+        // Scanning large directory trees dominates, so list each archive on a worker thread
+        std::vector<FileMap> archiveIndices(mArchives.size());
+        size_t numThreads = std::min<size_t>(std::max(1u, boost::thread::hardware_concurrency()), mArchives.size());
+        if (numThreads > 1)
+        {
+            size_t nextArchive = 0;
+            boost::mutex mutex;
+            boost::thread_group threads;
+            for (size_t i=0; i<numThreads; ++i)
+                threads.create_thread(ListResourcesJob(mArchives, archiveIndices, nextArchive, mutex, normalize_function));
+            threads.join_all();
+        }
+        else
+        {
+            for (size_t i=0; i<mArchives.size(); ++i)
+                mArchives[i]->listResources(archiveIndices[i], normalize_function);
+        }
+
+        // Later archives have priority
+        for (std::vector<FileMap>::const_iterator archiveIt = archiveIndices.begin(); archiveIt != archiveIndices.end(); ++archiveIt)
+        {
+            FileMap::iterator hint = mIndex.begin();
+            for (FileMap::const_iterator it = archiveIt->begin(); it != archiveIt->end(); ++it)
+            {
+                hint = mIndex.insert(hint, *it);
+                hint->second = it->second;
+            }
+        }
+
+        size_t capacity = 16;
+        while (capacity < mIndex.size() * 2)
+            capacity *= 2;
+
+        HashEntry empty = { 0, NULL, NULL };
+        mHashIndex.assign(capacity, empty);
+
+        const size_t mask = capacity - 1;
+        for (FileMap::const_iterator it = mIndex.begin(); it != mIndex.end(); ++it)
+        {
+            size_t hash = hashString(it->first);
+            size_t slot = hash & mask;
+            while (mHashIndex[slot].mName)
+                slot = (slot + 1) & mask;
+
+            HashEntry& entry = mHashIndex[slot];
+            entry.mHash = hash;
+            entry.mName = &it->first;
+            entry.mFile = it->second;
+        }
+    }
 
-        for (std::vector<Archive*>::const_iterator it = mArchives.begin(); it != mArchives.end(); ++it)
-            (*it)->listResources(mIndex, mStrict ? &strict_normalize_char : &nonstrict_normalize_char);
+    File* Manager::lookup(const std::string &name, char (*normalize_function)(char)) const
+    {
+        if (mHashIndex.empty())
+            return NULL;
+
+        size_t hash = sHashOffset;
+        for (std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+            hash = hashChar(hash, normalize_function(*it));
+
+        const size_t mask = mHashIndex.size() - 1;
+        for (size_t slot = hash & mask; mHashIndex[slot].mName; slot = (slot + 1) & mask)
+        {
+            const HashEntry& entry = mHashIndex[slot];
+            if (entry.mHash != hash || entry.mName->size() != name.size())
+                continue;
+
+            std::string::const_iterator nameIt = name.begin();
+            std::string::const_iterator entryIt = entry.mName->begin();
+            for (; nameIt != name.end(); ++nameIt, ++entryIt)
+                if (normalize_function(*nameIt) != *entryIt)
+                    break;
+
+            if (nameIt == name.end())
+                return entry.mFile;
+        }
+        return NULL;
+    }
+
+    File* Manager::find(const std::string &name) const
+    {
+        return lookup(name, mStrict ? &strict_normalize_char : &nonstrict_normalize_char);
+    }
+
+    File* Manager::findNormalized(const std::string &normalizedName) const
+    {
+        return lookup(normalizedName, &strict_normalize_char);
     }
 
     Files::IStreamPtr Manager::get(const std::string &name) const
     {
-        std::string normalized = name;
-        normalize_path(normalized, mStrict);
+        File* file = find(name);
+        if (!file)
+        {
+            std::string normalized = name;
+            normalize_path(normalized, mStrict);
+            throw std::runtime_error("Resource '" + normalized + "' not found");
+        }
+        return file->open();
+    }
 
-        return getNormalized(normalized);
+    File* Manager::getFileNormalized(const std::string &normalizedName) const
+    {
+        File* file = findNormalized(normalizedName);
+        if (!file)
+            throw std::runtime_error("Resource '" + normalizedName + "' not found");
+        return file;
     }
 
     Files::IStreamPtr Manager::getNormalized(const std::string &normalizedName) const
     {
-        std::map<std::string, File*>::const_iterator found = mIndex.find(normalizedName);
-        if (found == mIndex.end())
-            throw std::runtime_error("Resource '" + normalizedName + "' not found");
-        return found->second->open();
+        return getFileNormalized(normalizedName)->open();
     }
 
     bool Manager::exists(const std::string &name) const
     {
-        std::string normalized = name;
-        normalize_path(normalized, mStrict);
-
-        return mIndex.find(normalized) != mIndex.end();
+        return find(name) != NULL;
     }
 
     const std::map<std::string, File*>& Manager::getIndex() const
@@ -30,6 +30,7 @@ namespace VFS
         void addArchive(Archive* archive);
 
         /// Build the file index. Should be called when all archives have been registered.
+        /// @note Archives are scanned in parallel, but the index is merged in registration order.
         void buildIndex();
 
         /// Does a file with this name exist?
@@ -41,6 +42,18 @@ namespace VFS
         /// Normalize the given filename, making slashes/backslashes consistent, and lower-casing if mStrict is false.
         void normalizeFilename(std::string& name) const;
 
+        /// Look up a file by name, without opening it. Returns NULL if the file can not be found.
+        /// @note Does not allocate. The returned handle remains valid until the next buildIndex() call,
+        /// so callers may cache it instead of repeating the lookup.
+        File* find(const std::string& name) const;
+
+        /// Look up a file by name (name is already normalized), without opening it. Returns NULL if the file can not be found.
+        File* findNormalized(const std::string& normalizedName) const;
+
+        /// Look up a file by name (name is already normalized), without opening it.
+        /// @note Throws an exception if the file can not be found.
+        File* getFileNormalized(const std::string& normalizedName) const;
+
         /// Retrieve a file by name.
         /// @note Throws an exception if the file can not be found.
         Files::IStreamPtr get(const std::string& name) const;
@@ -50,11 +63,25 @@ namespace VFS
         Files::IStreamPtr getNormalized(const std::string& normalizedName) const;
 
     private:
+        /// Look up a file in the hash index, normalizing the name on the fly.
+        File* lookup(const std::string& name, char (*normalize_function) (char)) const;
+
         bool mStrict;
 
         std::vector<Archive*> mArchives;
 
         std::map<std::string, File*> mIndex;
+
+        struct HashEntry
+        {
+            size_t mHash;
+            /// Points to the key in mIndex, NULL for an unused slot
+            const std::string* mName;
+            File* mFile;
+        };
+
+        /// Open addressing hash table over mIndex, used for fast lookups. Size is a power of two.
+        std::vector<HashEntry> mHashIndex;
     };
 
 }